@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+/*
+ * Measures the throughput of creating, running and destroying
+ * coroutine tasks, and prints the statistics of the frame
+ * allocator.
+ */
+
+#include "co/FrameAllocator.hxx"
+#include "co/Task.hxx"
+#include "co/InvokeTask.hxx"
+#include "util/PrintException.hxx"
+
+#include <fmt/core.h>
+
+#include <chrono>
+#include <cstdlib>
+
+static Co::Task<unsigned>
+Leaf(unsigned i)
+{
+	co_return i;
+}
+
+static Co::EagerTask<unsigned>
+Middle(unsigned i)
+{
+	co_return co_await Leaf(i) + co_await Leaf(i + 1);
+}
+
+static Co::InvokeTask
+Outer(unsigned n, unsigned &result)
+{
+	for (unsigned i = 0; i < n; ++i)
+		result += co_await Middle(i);
+}
+
+static void
+OnComplete(void *, std::exception_ptr) noexcept
+{
+}
+
+int
+main(int argc, char **argv) noexcept
+try {
+	const unsigned n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+	/* each iteration creates three frames plus one InvokeTask
+	   frame per 1000 iterations */
+	constexpr unsigned per_invoke = 1000;
+
+	unsigned result = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (unsigned i = 0; i < n; i += per_invoke) {
+		auto task = Outer(per_invoke, result);
+		task.Start({nullptr, OnComplete});
+	}
+
+	const std::chrono::duration<double> duration =
+		std::chrono::steady_clock::now() - start;
+
+	const auto &stats = Co::GetFrameAllocatorStats();
+
+	fmt::print("{} frames in {:.3f} s ({:.1f} ns per frame), result={}\n",
+		   stats.n_allocations, duration.count(),
+		   duration.count() * 1e9 / stats.n_allocations,
+		   result);
+	fmt::print("recycled={} large={} cached={}\n",
+		   stats.n_recycled, stats.n_large, stats.n_cached);
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
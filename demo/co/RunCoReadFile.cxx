@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+/*
+ * Copy a (possibly large) file to stdout using io_uring with
+ * registered buffers and a fixed file.
+ */
+
+#include "co/InvokeTask.hxx"
+#include "co/Task.hxx"
+#include "event/Loop.hxx"
+#include "event/ShutdownListener.hxx"
+#include "event/uring/Manager.hxx"
+#include "io/uring/BufferPool.hxx"
+#include "io/uring/CoOpenStatRead.hxx"
+#include "io/uring/CoOperation.hxx"
+#include "io/uring/FixedFiles.hxx"
+#include "memory/SlicePool.hxx"
+#include "util/PrintException.hxx"
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+#include <fcntl.h>
+
+struct Instance final {
+	EventLoop event_loop;
+	ShutdownListener shutdown_listener;
+
+	Uring::Manager uring;
+
+	SlicePool slice_pool{256 * 1024, 16, "io_buffers"};
+	Uring::RegisteredBufferPool buffers{uring, slice_pool, 4};
+	Uring::FixedFileTable files{uring, 16};
+
+	Co::InvokeTask task;
+
+	std::exception_ptr error;
+
+	Instance()
+		:shutdown_listener(event_loop, BIND_THIS_METHOD(OnShutdown)),
+		 uring(event_loop)
+	{
+		shutdown_listener.Enable();
+	}
+
+	void OnShutdown() noexcept {
+		task = {};
+		uring.SetVolatile();
+	}
+
+	void OnCompletion(std::exception_ptr _error) noexcept {
+		error = std::move(_error);
+		uring.SetVolatile();
+		shutdown_listener.Disable();
+	}
+};
+
+static Co::Task<void>
+WriteAll(Uring::Queue &queue, FileDescriptor fd,
+	 std::span<const std::byte> src)
+{
+	while (!src.empty()) {
+		const auto nbytes = co_await Uring::CoWrite(queue, fd, src, -1);
+		if (nbytes == 0)
+			throw std::runtime_error{"Short write"};
+
+		src = src.subspan(nbytes);
+	}
+}
+
+static Co::InvokeTask
+Run(Instance &instance, const char *path)
+{
+	auto &queue = instance.uring;
+
+	auto buffer = instance.buffers.Get();
+	assert(buffer);
+
+	const auto result = co_await Uring::CoOpenStatRead(queue, instance.files,
+							   {FileDescriptor(AT_FDCWD), path},
+							   buffer.GetBuffer());
+	const auto fd = Uring::FixedFileTable::GetFileDescriptor(result.slot);
+
+	try {
+		if (!S_ISREG(result.stx.stx_mode))
+			throw std::runtime_error{"Not a regular file"};
+
+		const uint_least64_t size = result.stx.stx_size;
+		uint_least64_t offset = result.nbytes;
+
+		co_await WriteAll(queue, FileDescriptor(STDOUT_FILENO),
+				  buffer.GetBuffer().first(result.nbytes));
+
+		while (offset < size) {
+			const auto nbytes =
+				co_await Uring::CoReadFixed(queue, fd,
+							    buffer.GetBuffer(),
+							    buffer.GetIndex(),
+							    offset,
+							    IOSQE_FIXED_FILE);
+			if (nbytes == 0)
+				break;
+
+			co_await WriteAll(queue, FileDescriptor(STDOUT_FILENO),
+					  buffer.GetBuffer().first(nbytes));
+			offset += nbytes;
+		}
+	} catch (...) {
+		instance.files.Remove(result.slot);
+		throw;
+	}
+
+	instance.files.Remove(result.slot);
+}
+
+int
+main(int argc, char **argv) noexcept
+try {
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s PATH\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const char *const path = argv[1];
+
+	Instance instance;
+
+	instance.task = Run(instance, path);
+	instance.task.Start(BIND_METHOD(instance, &Instance::OnCompletion));
+
+	instance.event_loop.Run();
+
+	if (instance.error)
+		std::rethrow_exception(instance.error);
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
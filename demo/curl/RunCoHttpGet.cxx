@@ -45,7 +45,9 @@ Run(CurlGlobal &global, const char *url)
 
 	printf("status=%u\n", static_cast<unsigned>(response.status));
 	for (const auto &[key, value] : response.headers)
-		printf("%s: %s\n", key.c_str(), value.c_str());
+		printf("%.*s: %.*s\n",
+		       int(key.size()), key.data(),
+		       int(value.size()), value.data());
 	printf("\n");
 	fputs(response.body.c_str(), stdout);
 }
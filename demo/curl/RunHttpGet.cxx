@@ -40,9 +40,10 @@ private:
 		       Curl::Headers &&headers) override {
 		fprintf(stderr, "status %u\n", static_cast<unsigned>(status));
 
-		for (const auto &i : headers)
-			fprintf(stderr, "%s: %s\n",
-				i.first.c_str(), i.second.c_str());
+		for (const auto &[name, value] : headers)
+			fprintf(stderr, "%.*s: %.*s\n",
+				int(name.size()), name.data(),
+				int(value.size()), value.data());
 
 		fprintf(stderr, "\n");
 	}
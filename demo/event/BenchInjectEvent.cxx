@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+/*
+ * Measure the throughput of InjectEvent::Schedule() with several
+ * producer threads contending for the same #EventLoop.
+ */
+
+#include "event/Loop.hxx"
+#include "event/InjectEvent.hxx"
+#include "util/PrintException.hxx"
+
+#include <fmt/core.h>
+
+#include <chrono>
+#include <forward_list>
+#include <thread>
+#include <vector>
+
+#include <stdlib.h>
+
+static constexpr unsigned EVENTS_PER_THREAD = 64;
+
+struct Counters {
+	std::size_t n_callbacks = 0;
+	unsigned n_finished = 0, n_threads;
+};
+
+class InjectTarget {
+	Counters &counters;
+
+public:
+	InjectEvent event;
+
+	InjectTarget(EventLoop &event_loop, Counters &_counters) noexcept
+		:counters(_counters),
+		 event(event_loop, BIND_THIS_METHOD(OnInject)) {}
+
+private:
+	void OnInject() noexcept {
+		++counters.n_callbacks;
+	}
+};
+
+class Producer {
+	EventLoop &event_loop;
+	Counters &counters;
+
+	std::forward_list<InjectTarget> targets;
+
+	InjectEvent finish_event;
+
+public:
+	Producer(EventLoop &_event_loop, Counters &_counters) noexcept
+		:event_loop(_event_loop), counters(_counters),
+		 finish_event(event_loop, BIND_THIS_METHOD(OnFinished))
+	{
+		for (unsigned i = 0; i < EVENTS_PER_THREAD; ++i)
+			targets.emplace_front(event_loop, counters);
+	}
+
+	void Run(unsigned iterations) noexcept {
+		auto i = targets.begin();
+		for (unsigned n = 0; n < iterations; ++n) {
+			i->event.Schedule();
+			if (++i == targets.end())
+				i = targets.begin();
+		}
+
+		finish_event.Schedule();
+	}
+
+private:
+	void OnFinished() noexcept {
+		if (++counters.n_finished == counters.n_threads)
+			event_loop.Break();
+	}
+};
+
+int
+main(int argc, char **argv) noexcept
+try {
+	if (argc > 3) {
+		fmt::print(stderr, "Usage: {} [THREADS [ITERATIONS]]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const unsigned n_threads = argc > 1 ? strtoul(argv[1], nullptr, 10) : 4;
+	const unsigned iterations = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000000;
+	if (n_threads == 0)
+		return EXIT_SUCCESS;
+
+	EventLoop event_loop;
+	Counters counters;
+	counters.n_threads = n_threads;
+
+	std::forward_list<Producer> producers;
+	for (unsigned i = 0; i < n_threads; ++i)
+		producers.emplace_front(event_loop, counters);
+
+	const auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> threads;
+	for (auto &i : producers)
+		threads.emplace_back([&i, iterations]{ i.Run(iterations); });
+
+	event_loop.Run();
+
+	const std::chrono::duration<double> duration =
+		std::chrono::steady_clock::now() - start;
+
+	for (auto &i : threads)
+		i.join();
+
+	const double n_schedules = double(n_threads) * iterations;
+	fmt::print("{} threads: {:.1f} M Schedule()/s, {} callbacks ({:.1f}% coalesced) in {:.3f}s\n",
+		   n_threads, n_schedules / duration.count() / 1e6,
+		   counters.n_callbacks,
+		   100. * (1. - counters.n_callbacks / n_schedules),
+		   duration.count());
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+/*
+ * Compare the CopyRegularFile() methods on a generated sparse file
+ * (like a VM or database image).
+ *
+ * The file is created in DIR (default: /tmp); it is SIZE MiB large
+ * (default: 1024) and has one MiB of data every STRIDE MiB (default:
+ * 16).  Run it on btrfs or XFS to see reflinks in action.
+ */
+
+#include "io/CopyRegularFile.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+#include "lib/fmt/SystemError.hxx"
+#include "util/PrintException.hxx"
+
+#include <fmt/core.h>
+
+#include <chrono>
+#include <string>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+static constexpr off_t MiB = 1024 * 1024;
+
+static UniqueFileDescriptor
+CreateTempFile(const char *dir)
+{
+	UniqueFileDescriptor fd;
+	if (!fd.Open(dir, O_TMPFILE|O_RDWR, 0600))
+		throw FmtErrno("Failed to create a file in {:?}", dir);
+	return fd;
+}
+
+static UniqueFileDescriptor
+CreateSparseFile(const char *dir, off_t size, off_t stride)
+{
+	auto fd = CreateTempFile(dir);
+
+	const std::string data(MiB, 'x');
+	for (off_t offset = 0; offset < size; offset += stride)
+		if (pwrite(fd.Get(), data.data(), data.size(), offset) < 0)
+			throw MakeErrno("Failed to write");
+
+	if (ftruncate(fd.Get(), size) < 0)
+		throw MakeErrno("Failed to truncate");
+
+	return fd;
+}
+
+static struct stat
+Stat(FileDescriptor fd)
+{
+	struct stat st;
+	if (fstat(fd.Get(), &st) < 0)
+		throw MakeErrno("Failed to stat");
+	return st;
+}
+
+static void
+Run(const char *name, const char *dir, FileDescriptor src, off_t size,
+    const CopyRegularFileOptions &options)
+{
+	const auto dst = CreateTempFile(dir);
+
+	const auto start = std::chrono::steady_clock::now();
+
+	CopyRegularFile(src, dst, size, options);
+
+	const std::chrono::duration<double> duration =
+		std::chrono::steady_clock::now() - start;
+
+	fmt::print("  {}: {:.3f} s, {} MiB allocated\n", name,
+		   duration.count(),
+		   Stat(dst).st_blocks * 512 / MiB);
+}
+
+int
+main(int argc, char **argv) noexcept
+try {
+	if (argc > 4) {
+		fmt::print(stderr, "Usage: {} [DIR] [SIZE] [STRIDE]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const char *const dir = argc > 1 ? argv[1] : "/tmp";
+	const off_t size = (argc > 2 ? strtoul(argv[2], nullptr, 10) : 1024) * MiB;
+	const off_t stride = (argc > 3 ? strtoul(argv[3], nullptr, 10) : 16) * MiB;
+
+	const auto src = CreateSparseFile(dir, size, stride);
+	fmt::print("source: {} MiB, {} MiB allocated\n",
+		   size / MiB, Stat(src).st_blocks * 512 / MiB);
+
+	Run("copy everything", dir, src, size, {
+		.reflink = false,
+		.sparse = false,
+	});
+
+	Run("skip holes", dir, src, size, {
+		.reflink = false,
+	});
+
+	Run("reflink", dir, src, size, {});
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
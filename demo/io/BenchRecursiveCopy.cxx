@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+/*
+ * Compare RecursiveCopy() and RecursiveDelete() with their parallel
+ * variants on a generated tree.
+ *
+ * The tree is created in a new temporary directory inside DIR
+ * (default: /tmp); it consists of nested directories with FANOUT
+ * subdirectories each (DEPTH levels) and 16 small files per
+ * directory.
+ */
+
+#include "io/RecursiveCopy.hxx"
+#include "io/RecursiveDelete.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+#include "io/MakeDirectory.hxx"
+#include "io/Open.hxx"
+#include "lib/fmt/SystemError.hxx"
+#include "util/PrintException.hxx"
+
+#include <fmt/core.h>
+
+#include <chrono>
+#include <string>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static constexpr unsigned FILES_PER_DIRECTORY = 16;
+
+static std::size_t
+GenerateTree(FileDescriptor parent, const char *name,
+	     unsigned fanout, unsigned depth)
+{
+	const auto dir = MakeDirectory(parent, name);
+	std::size_t n = 1;
+
+	for (unsigned i = 0; i < FILES_PER_DIRECTORY; ++i) {
+		const auto filename = fmt::format("file{}", i);
+		UniqueFileDescriptor fd;
+		if (!fd.Open(dir, filename.c_str(), O_CREAT|O_WRONLY, 0666))
+			throw FmtErrno("Failed to create {:?}", filename);
+
+		const auto contents = fmt::format("{}/{}\n", name, i);
+		if (fd.Write(contents.data(), contents.size()) < 0)
+			throw FmtErrno("Failed to write {:?}", filename);
+
+		++n;
+	}
+
+	if (depth > 0) {
+		for (unsigned i = 0; i < fanout; ++i) {
+			const auto subdir = fmt::format("dir{}", i);
+			n += GenerateTree(dir, subdir.c_str(),
+					  fanout, depth - 1);
+		}
+	}
+
+	return n;
+}
+
+template<typename F>
+static void
+Run(const char *name, std::size_t n_files, F &&f)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	f();
+
+	const std::chrono::duration<double> duration =
+		std::chrono::steady_clock::now() - start;
+
+	fmt::print("  {}: {:.3f} s ({:.0f} files/s)\n", name,
+		   duration.count(), n_files / duration.count());
+}
+
+int
+main(int argc, char **argv) noexcept
+try {
+	if (argc > 5) {
+		fmt::print(stderr, "Usage: {} [DIR] [FANOUT] [DEPTH] [THREADS]\n",
+			   argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const char *const base = argc > 1 ? argv[1] : "/tmp";
+	const unsigned fanout = argc > 2 ? strtoul(argv[2], nullptr, 10) : 8;
+	const unsigned depth = argc > 3 ? strtoul(argv[3], nullptr, 10) : 4;
+	const unsigned n_threads = argc > 4 ? strtoul(argv[4], nullptr, 10) : 0;
+
+	std::string tmp = fmt::format("{}/BenchRecursiveCopy.XXXXXX", base);
+	if (mkdtemp(tmp.data()) == nullptr)
+		throw FmtErrno("Failed to create a directory in {:?}", base);
+
+	const auto dir = OpenPath(tmp.c_str(), O_DIRECTORY);
+
+	const std::size_t n_files = GenerateTree(dir, "src", fanout, depth);
+	fmt::print("{} files and directories\n", n_files);
+
+	Run("RecursiveCopy", n_files, [&dir]{
+		RecursiveCopy(dir, "src", dir, "sequential");
+	});
+
+	Run("ParallelRecursiveCopy", n_files, [&dir, n_threads]{
+		ParallelRecursiveCopy(dir, "src", dir, "parallel",
+				      0, n_threads);
+	});
+
+	Run("RecursiveDelete", n_files, [&dir]{
+		RecursiveDelete(dir, "sequential");
+	});
+
+	Run("ParallelRecursiveDelete", n_files, [&dir, n_threads]{
+		ParallelRecursiveDelete(dir, "parallel", n_threads);
+	});
+
+	RecursiveDelete(dir, "src");
+
+	if (rmdir(tmp.c_str()) < 0)
+		throw FmtErrno("Failed to delete {:?}", tmp);
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+/*
+ * Compare the MountInfo lookups using statmount()/listmount() with
+ * parsing /proc/self/mountinfo.
+ *
+ * With a COUNT parameter, this program creates a new mount namespace
+ * with COUNT additional tmpfs mounts first, to simulate a host with
+ * many (container) mounts.  This requires CAP_SYS_ADMIN; run it as
+ * root or with "unshare -rm".
+ */
+
+#include "io/linux/MountInfo.hxx"
+#include "lib/fmt/RuntimeError.hxx"
+#include "lib/fmt/SystemError.hxx"
+#include "util/PrintException.hxx"
+
+#include <fmt/core.h>
+
+#include <chrono>
+#include <string>
+
+#include <sched.h> // for unshare()
+#include <stdlib.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h> // for major(), minor()
+
+static constexpr unsigned ITERATIONS = 1000;
+
+/**
+ * Create a private mount namespace with the given number of tmpfs
+ * mounts.
+ *
+ * @return the path of the last mount
+ */
+static std::string
+CreateSyntheticMounts(unsigned count)
+{
+	if (unshare(CLONE_NEWNS) < 0)
+		throw MakeErrno("unshare(CLONE_NEWNS) failed");
+
+	if (mount(nullptr, "/", nullptr, MS_REC|MS_PRIVATE, nullptr) < 0)
+		throw MakeErrno("Failed to make / private");
+
+	char base[] = "/tmp/BenchMountInfo.XXXXXX";
+	if (mkdtemp(base) == nullptr)
+		throw MakeErrno("mkdtemp() failed");
+
+	/* mount a tmpfs on the base directory, so the mount points
+	   don't appear outside of this namespace */
+	if (mount("none", base, "tmpfs", 0, "size=1m") < 0)
+		throw FmtErrno("Failed to mount tmpfs on {:?}", base);
+
+	std::string path;
+	for (unsigned i = 0; i < count; ++i) {
+		path = fmt::format("{}/{}", base, i);
+		if (mkdir(path.c_str(), 0700) < 0)
+			throw FmtErrno("Failed to create {:?}", path);
+
+		if (mount("bench", path.c_str(), "tmpfs", 0, "size=64k") < 0)
+			throw FmtErrno("Failed to mount tmpfs on {:?}", path);
+	}
+
+	return path;
+}
+
+template<typename F>
+static void
+Run(const char *name, F &&f)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	std::size_t n_found = 0;
+	for (unsigned i = 0; i < ITERATIONS; ++i)
+		n_found += f().IsDefined();
+
+	const std::chrono::duration<double> duration =
+		std::chrono::steady_clock::now() - start;
+
+	if (n_found != ITERATIONS)
+		throw FmtRuntimeError("{}: mount not found", name);
+
+	fmt::print("  {}: {:.1f} us\n", name,
+		   duration.count() * 1e6 / ITERATIONS);
+}
+
+static void
+RunAll(const char *path, const MountInfo &expected)
+{
+	struct stat st;
+	if (stat(path, &st) < 0)
+		throw FmtErrno("Failed to stat {:?}", path);
+
+	const std::string device = fmt::format("{}:{}",
+					       major(st.st_dev),
+					       minor(st.st_dev));
+
+	Run("FindMountInfoByPath", [path]{
+		return FindMountInfoByPath(path);
+	});
+
+	Run("FindMountInfoById", [&expected]{
+		return FindMountInfoById(0, expected.mnt_id);
+	});
+
+	Run("FindMountInfoByDevice", [&device]{
+		return FindMountInfoByDevice(0, device.c_str());
+	});
+
+	Run("ReadProcessMount", [path]{
+		return ReadProcessMount(0, path);
+	});
+}
+
+int
+main(int argc, char **argv) noexcept
+try {
+	if (argc > 2) {
+		fmt::print(stderr, "Usage: {} [COUNT]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	std::string path = "/";
+	if (argc > 1)
+		path = CreateSyntheticMounts(strtoul(argv[1], nullptr, 10));
+
+	const auto expected = FindMountInfoByPath(path.c_str());
+	if (!expected.IsDefined())
+		throw "Mount not found";
+
+	fmt::print("statmount/listmount:\n");
+	RunAll(path.c_str(), expected);
+
+	DisableMountInfoSyscalls();
+
+	fmt::print("/proc/self/mountinfo:\n");
+	RunAll(path.c_str(), expected);
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+/*
+ * Measure the throughput of ParseDatagram() and #IndexedDatagram on
+ * a corpus of recorded datagrams (one datagram per file, e.g. the
+ * fuzzer corpus).
+ */
+
+#include "net/log/Parser.hxx"
+#include "net/log/IndexedDatagram.hxx"
+#include "net/log/Datagram.hxx"
+#include "io/Open.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+#include "util/PrintException.hxx"
+#include "util/SpanCast.hxx"
+
+#include <fmt/core.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+
+static constexpr unsigned ITERATIONS = 10000;
+
+/**
+ * Load the raw contents of a file (unlike LoadStringFile(), which
+ * strips whitespace and would corrupt binary datagrams).
+ */
+static std::string
+LoadFile(const char *path)
+{
+	const auto fd = OpenReadOnly(path);
+	std::string result(fd.GetSize(), '\0');
+	fd.FullRead(std::as_writable_bytes(std::span{result}));
+	return result;
+}
+
+template<typename F>
+static void
+Run(const char *name, const std::vector<std::string> &corpus,
+    std::size_t total_size, F &&f)
+{
+	std::size_t n_valid = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (unsigned i = 0; i < ITERATIONS; ++i) {
+		for (const auto &d : corpus) {
+			try {
+				if (f(AsBytes(d)))
+					++n_valid;
+			} catch (Net::Log::ProtocolError) {
+			}
+		}
+	}
+
+	const std::chrono::duration<double> duration =
+		std::chrono::steady_clock::now() - start;
+
+	fmt::print("{}: {:.1f} Mdatagrams/s, {:.1f} MB/s ({} valid)\n",
+		   name,
+		   corpus.size() * ITERATIONS / duration.count() / 1e6,
+		   total_size * ITERATIONS / duration.count() / 1e6,
+		   n_valid / ITERATIONS);
+}
+
+int
+main(int argc, char **argv) noexcept
+try {
+	if (argc < 2) {
+		fmt::print(stderr, "Usage: {} FILE...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	std::vector<std::string> corpus;
+	std::size_t total_size = 0;
+	for (int i = 1; i < argc; ++i) {
+		corpus.emplace_back(LoadFile(argv[i]));
+		total_size += corpus.back().size();
+	}
+
+	Run("ParseDatagram", corpus, total_size, [](std::span<const std::byte> d){
+		const auto datagram = Net::Log::ParseDatagram(d);
+		return datagram.site != nullptr || datagram.valid_traffic;
+	});
+
+	Run("IndexedDatagram", corpus, total_size, [](std::span<const std::byte> d){
+		const Net::Log::IndexedDatagram datagram{d};
+		return datagram.GetString(Net::Log::Attribute::SITE) != nullptr ||
+			datagram.GetTraffic();
+	});
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+/*
+ * Compare evaluating a set of URI routing rules with one
+ * UniqueRegex::Match() call per rule (which allocates a match data
+ * object each time), with UniqueRegex::Test() and with #RegexSet
+ * (literal prefilter).
+ */
+
+#include "lib/pcre/RegexSet.hxx"
+#include "util/PrintException.hxx"
+
+#include <fmt/core.h>
+
+#include <chrono>
+#include <vector>
+
+#include <stdlib.h>
+
+static constexpr unsigned ITERATIONS = 20000;
+
+struct Rule {
+	const char *pattern;
+	Pcre::CompileOptions options;
+};
+
+static constexpr Rule rules[] = {
+	{"/static/", {.anchored=true}},
+	{"/assets/[0-9a-f]{8,}/", {.anchored=true}},
+	{"\\.(?:css|js|map)$", {}},
+	{"\\.(?:png|gif|jpe?g|webp|svg|ico)$", {.caseless=true}},
+	{"\\.(?:woff2?|ttf|otf|eot)$", {}},
+	{"/favicon\\.ico$", {.anchored=true}},
+	{"/robots\\.txt$", {.anchored=true}},
+	{"/sitemap[0-9]*\\.xml$", {.anchored=true}},
+	{"/\\.well-known/acme-challenge/", {.anchored=true}},
+	{"/\\.well-known/", {.anchored=true}},
+	{"/api/v[0-9]+/users/[0-9]+$", {.anchored=true}},
+	{"/api/v[0-9]+/users/[0-9]+/avatar$", {.anchored=true}},
+	{"/api/v[0-9]+/orders(?:/[0-9]+)?$", {.anchored=true}},
+	{"/api/v[0-9]+/search\\?", {.anchored=true}},
+	{"/api/internal/", {.anchored=true}},
+	{"/admin/", {.anchored=true, .caseless=true}},
+	{"/wp-(?:admin|login|content)", {}},
+	{"\\.php[0-9]?(?:/|$)", {}},
+	{"/cgi-bin/", {}},
+	{"/\\.(?:git|svn|hg)/", {}},
+	{"/\\.env$", {}},
+	{"/shop/[a-z0-9-]+/product/[0-9]+$", {.anchored=true}},
+	{"/shop/[a-z0-9-]+/category/", {.anchored=true}},
+	{"/shop/cart$", {.anchored=true}},
+	{"/shop/checkout/", {.anchored=true}},
+	{"/blog/[0-9]{4}/[0-9]{2}/[a-z0-9-]+/?$", {.anchored=true}},
+	{"/blog/tag/", {.anchored=true}},
+	{"/blog/feed\\.(?:rss|atom)$", {.anchored=true}},
+	{"/docs/[a-z]{2}/", {.anchored=true}},
+	{"/download/[^/]+\\.(?:zip|tar\\.gz|exe|dmg)$", {.anchored=true}},
+	{"/media/video/[0-9]+/[0-9]+p\\.mp4$", {.anchored=true}},
+	{"/ws/notifications$", {.anchored=true}},
+	{"/graphql$", {.anchored=true}},
+	{"/login$", {.anchored=true, .caseless=true}},
+	{"/logout$", {.anchored=true, .caseless=true}},
+	{"/oauth2/(?:authorize|token|callback)$", {.anchored=true}},
+	{"/health(?:z|check)?$", {.anchored=true}},
+	{"/metrics$", {.anchored=true}},
+	{"[?&]utm_[a-z]+=", {}},
+	{"[?&]session_?id=", {.caseless=true}},
+};
+
+static constexpr const char *uris[] = {
+	"/",
+	"/index.html",
+	"/static/css/main.3f9a2c.css",
+	"/assets/0badc0ffee/app.js",
+	"/img/Logo.PNG",
+	"/favicon.ico",
+	"/robots.txt",
+	"/api/v2/users/4711",
+	"/api/v2/users/4711/avatar",
+	"/api/v1/orders/123",
+	"/api/v1/search?q=foo&utm_source=bar",
+	"/shop/shoes/product/98765",
+	"/shop/cart",
+	"/blog/2024/05/hello-world/",
+	"/blog/feed.rss",
+	"/docs/en/getting-started/install",
+	"/download/tool-1.2.3.tar.gz",
+	"/wp-login.php",
+	"/.git/config",
+	"/about/team?ref=newsletter",
+	"/health",
+	"/some/deep/path/without/any/rule/matching/at/all",
+};
+
+template<typename F>
+static void
+Run(const char *name, F &&f)
+{
+	std::size_t n_matches = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for (unsigned i = 0; i < ITERATIONS; ++i)
+		for (const char *uri : uris)
+			n_matches += f(uri);
+
+	const std::chrono::duration<double> duration =
+		std::chrono::steady_clock::now() - start;
+
+	fmt::print("{}: {:.0f} ns/URI ({} matches per pass)\n",
+		   name,
+		   duration.count() * 1e9 / (ITERATIONS * std::size(uris)),
+		   n_matches / ITERATIONS);
+}
+
+int
+main() noexcept
+try {
+	std::vector<UniqueRegex> regexes;
+	RegexSet set;
+
+	for (const auto &rule : rules) {
+		regexes.emplace_back(rule.pattern, rule.options);
+		set.Add(rule.pattern, rule.options);
+	}
+
+	fmt::print("{} rules, {} URIs\n", std::size(rules), std::size(uris));
+
+	Run("Match", [&regexes](std::string_view uri){
+		std::size_t n = 0;
+		for (const auto &i : regexes)
+			if (i.Match(uri))
+				++n;
+		return n;
+	});
+
+	Run("Match (reused MatchData)", [&regexes](std::string_view uri){
+		std::size_t n = 0;
+		MatchData match_data;
+		for (const auto &i : regexes)
+			if (i.Match(uri, match_data))
+				++n;
+		return n;
+	});
+
+	Run("Test", [&regexes](std::string_view uri){
+		std::size_t n = 0;
+		for (const auto &i : regexes)
+			if (i.Test(uri))
+				++n;
+		return n;
+	});
+
+	Run("RegexSet::MatchAll", [&set](std::string_view uri){
+		std::size_t n = 0;
+		set.MatchAll(uri, [&n](std::size_t){ ++n; });
+		return n;
+	});
+
+	Run("RegexSet::MatchFirst", [&set](std::string_view uri){
+		return std::size_t(set.MatchFirst(uri) != RegexSet::npos);
+	});
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
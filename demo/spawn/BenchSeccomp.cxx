@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+/*
+ * Measure the rate at which child processes can be created with the
+ * standard seccomp filter installed: once by building and compiling
+ * the filter in each child (like SpawnChildProcess() used to do) and
+ * once by loading the program which was compiled by the parent
+ * (GetSyscallFilterProgram()).
+ */
+
+#include "spawn/SeccompFilter.hxx"
+#include "spawn/SeccompProgram.hxx"
+#include "spawn/SyscallFilter.hxx"
+#include "lib/fmt/SystemError.hxx"
+#include "util/PrintException.hxx"
+
+#include <fmt/core.h>
+
+#include <chrono>
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+
+static constexpr unsigned DEFAULT_COUNT = 1000;
+
+static constexpr bool forbid_user_ns = true;
+static constexpr bool forbid_multicast = true;
+static constexpr bool forbid_bind = true;
+
+static void
+CompileAndLoad()
+{
+	Seccomp::Filter sf(SCMP_ACT_ALLOW);
+	sf.AddSecondaryArchs();
+
+	BuildSyscallFilter(sf);
+
+	if (forbid_user_ns)
+		ForbidUserNamespace(sf);
+
+	if (forbid_multicast)
+		ForbidMulticast(sf);
+
+	if (forbid_bind)
+		ForbidBind(sf);
+
+	sf.Load();
+}
+
+static void
+LoadCached()
+{
+	GetSyscallFilterProgram(forbid_user_ns, forbid_multicast,
+				forbid_bind).Load();
+}
+
+template<typename F>
+static void
+Run(const char *name, unsigned count, F &&f)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	for (unsigned i = 0; i < count; ++i) {
+		const pid_t pid = fork();
+		if (pid < 0)
+			throw MakeErrno("fork() failed");
+
+		if (pid == 0) {
+			/* allows loading a seccomp filter without
+			   CAP_SYS_ADMIN */
+			prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0);
+
+			try {
+				f();
+			} catch (...) {
+				PrintException(std::current_exception());
+				_exit(EXIT_FAILURE);
+			}
+
+			_exit(EXIT_SUCCESS);
+		}
+
+		int status;
+		if (waitpid(pid, &status, 0) < 0)
+			throw MakeErrno("waitpid() failed");
+
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+			throw std::runtime_error("Child process failed");
+	}
+
+	const std::chrono::duration<double> duration =
+		std::chrono::steady_clock::now() - start;
+
+	fmt::print("{}: {:.0f} children/s ({:.1f} us per child)\n",
+		   name, count / duration.count(),
+		   duration.count() * 1e6 / count);
+}
+
+int
+main(int argc, char **argv) noexcept
+try {
+	if (argc > 2) {
+		fmt::print(stderr, "Usage: {} [COUNT]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const unsigned count = argc > 1
+		? strtoul(argv[1], nullptr, 10)
+		: DEFAULT_COUNT;
+	if (count == 0)
+		throw std::runtime_error("Invalid count");
+
+	/* compile the program before starting the clock, just like
+	   the spawner does it once for all children */
+	(void)GetSyscallFilterProgram(forbid_user_ns, forbid_multicast,
+				      forbid_bind);
+
+	Run("compile in child", count, CompileAndLoad);
+	Run("load cached program", count, LoadCached);
+
+	return EXIT_SUCCESS;
+} catch (...) {
+	PrintException(std::current_exception());
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+/*
+ * Measures the throughput of the hex and base64 codecs, compared
+ * with a scalar hex implementation.
+ */
+
+#include "util/Base64.hxx"
+#include "util/HexFormat.hxx"
+#include "util/HexParse.hxx"
+
+#include <fmt/core.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+template<typename F>
+static void
+Measure(const char *name, std::size_t size, unsigned n, F &&f)
+{
+	const auto start = std::chrono::steady_clock::now();
+	for (unsigned i = 0; i < n; ++i) {
+		f();
+		asm volatile("" ::: "memory");
+	}
+	const std::chrono::duration<double> duration =
+		std::chrono::steady_clock::now() - start;
+
+	fmt::print("{:<24} {:8.0f} MB/s\n", name,
+		   double(size) * n / (1024 * 1024) / duration.count());
+}
+
+int
+main(int argc, char **argv) noexcept
+{
+	const std::size_t size = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4096;
+	const unsigned n = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100000;
+
+	std::mt19937 gen{42};
+	std::vector<std::byte> src(size);
+	for (auto &i : src)
+		i = std::byte(gen());
+
+	std::vector<char> hex(size * 2);
+	std::vector<char> b64(CalcBase64EncodedSize(size, Base64Variant::URL_SAFE_NO_PADDING));
+	std::vector<std::byte> decoded(CalcBase64DecodedMaxSize(b64.size()));
+
+	Measure("hex format (scalar)", size, n, [&]{
+		char *p = hex.data();
+		for (const auto i : src)
+			p = HexFormatUint8Fixed(p, (uint8_t)i);
+	});
+
+	Measure("hex format", size, n, [&]{
+		HexFormat(hex.data(), src);
+	});
+
+	Measure("hex parse (scalar)", size, n, [&]{
+		const char *p = hex.data();
+		for (auto &i : decoded)
+			p = ParseLowerHexFixed(p, i);
+	});
+
+	Measure("hex parse", size, n, [&]{
+		if (ParseLowerHexFixed(hex.data(), std::span{decoded}.first(size)) == nullptr)
+			std::abort();
+	});
+
+	Measure("base64url encode", size, n, [&]{
+		Base64Encode(b64.data(), src, Base64Variant::URL_SAFE_NO_PADDING);
+	});
+
+	Measure("base64url decode", size, n, [&]{
+		if (Base64Decode(decoded.data(), {b64.data(), b64.size()},
+				 Base64Variant::URL_SAFE_NO_PADDING) == nullptr)
+			std::abort();
+	});
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+/*
+ * Compares the null-terminated (scalar) and the std::string_view
+ * (block/SIMD) overloads of ValidateUTF8() and LengthUTF8() on
+ * corpora with different ratios of multi-byte characters.
+ */
+
+#include "util/UTF8.hxx"
+
+#include <fmt/core.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+static std::string
+MakeCorpus(std::size_t size, unsigned multibyte_percent)
+{
+	static constexpr std::string_view multibyte[] = {
+		"\xc3\xbc", "\xe2\x82\xac", "\xf0\x9f\x98\x80",
+	};
+
+	std::mt19937 gen{42};
+	std::uniform_int_distribution<unsigned> percent{0, 99};
+	std::uniform_int_distribution<unsigned> ascii{'a', 'z'};
+	std::uniform_int_distribution<std::size_t> which{0, std::size(multibyte) - 1};
+
+	std::string s;
+	s.reserve(size + 4);
+	while (s.size() < size) {
+		if (percent(gen) < multibyte_percent)
+			s.append(multibyte[which(gen)]);
+		else
+			s.push_back(char(ascii(gen)));
+	}
+
+	return s;
+}
+
+template<typename F>
+static double
+Measure(F &&f, unsigned n)
+{
+	const auto start = std::chrono::steady_clock::now();
+	for (unsigned i = 0; i < n; ++i)
+		f();
+	const std::chrono::duration<double> duration =
+		std::chrono::steady_clock::now() - start;
+	return duration.count();
+}
+
+int
+main(int argc, char **argv) noexcept
+{
+	const std::size_t size = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4096;
+	const unsigned n = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100000;
+
+	for (const unsigned multibyte_percent : {0U, 1U, 10U, 50U}) {
+		const auto corpus = MakeCorpus(size, multibyte_percent);
+		const std::string_view sv{corpus};
+		const double mb = double(corpus.size()) * n / (1024 * 1024);
+
+		bool valid = true;
+		std::size_t length = 0;
+
+		const double t_validate_cstr = Measure([&]{
+			valid &= ValidateUTF8(corpus.c_str());
+			asm volatile("" ::: "memory");
+		}, n);
+
+		const double t_validate_sv = Measure([&]{
+			valid &= ValidateUTF8(sv);
+			asm volatile("" ::: "memory");
+		}, n);
+
+		const double t_length_cstr = Measure([&]{
+			length += LengthUTF8(corpus.c_str());
+			asm volatile("" ::: "memory");
+		}, n);
+
+		const double t_length_sv = Measure([&]{
+			length += LengthUTF8(sv);
+			asm volatile("" ::: "memory");
+		}, n);
+
+		fmt::print("{:2}% multi-byte: validate {:7.0f} -> {:7.0f} MB/s, length {:7.0f} -> {:7.0f} MB/s{}\n",
+			   multibyte_percent,
+			   mb / t_validate_cstr, mb / t_validate_sv,
+			   mb / t_length_cstr, mb / t_length_sv,
+			   valid && length > 0 ? "" : " (BUG)");
+	}
+
+	return EXIT_SUCCESS;
+}
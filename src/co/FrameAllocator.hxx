@@ -0,0 +1,263 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "util/Poison.hxx"
+
+#include <array>
+#include <cstddef>
+#include <new>
+
+namespace Co {
+
+/**
+ * Statistics of the calling thread's #FrameAllocator.
+ */
+struct FrameAllocatorStats {
+	/**
+	 * The total number of coroutine frames allocated.
+	 */
+	std::size_t n_allocations = 0;
+
+	/**
+	 * The number of allocations which were satisfied from a free
+	 * list.
+	 */
+	std::size_t n_recycled = 0;
+
+	/**
+	 * The number of allocations which were too large for a size
+	 * class and went straight to the global operator new.
+	 */
+	std::size_t n_large = 0;
+
+	/**
+	 * The number of frames currently kept in free lists.
+	 */
+	std::size_t n_cached = 0;
+};
+
+/**
+ * Allocates coroutine frames from size-classed free lists.  Freed
+ * frames are not returned to the global heap, but are kept for the
+ * next coroutine of the same size class, which makes creating and
+ * destroying short-lived coroutines (e.g. one per request) cheap.
+ *
+ * There is one instance per thread (see GetThreadInstance()); it
+ * is not thread-safe.  A frame may be freed by a different thread
+ * than the one which allocated it; it then ends up in the other
+ * thread's free list.
+ *
+ * Recycled frames are poisoned (see util/Poison.hxx) while they
+ * are in a free list.
+ */
+class FrameAllocator {
+	/**
+	 * The granularity of size classes.  This is also the
+	 * alignment of the returned memory.
+	 */
+	static constexpr std::size_t GRANULARITY = 64;
+
+	static constexpr std::size_t N_CLASSES = 16;
+
+	/**
+	 * Frames larger than this are not recycled.
+	 */
+	static constexpr std::size_t MAX_SIZE = GRANULARITY * N_CLASSES;
+
+	/**
+	 * Keep at most this number of frames per size class; excess
+	 * frames are freed.
+	 */
+	static constexpr std::size_t MAX_CACHED = 256;
+
+	struct FreeFrame {
+		FreeFrame *next;
+	};
+
+	struct SizeClass {
+		FreeFrame *head = nullptr;
+		std::size_t n_cached = 0;
+	};
+
+	std::array<SizeClass, N_CLASSES> classes;
+
+	FrameAllocatorStats stats;
+
+public:
+	FrameAllocator() noexcept = default;
+
+	~FrameAllocator() noexcept {
+		for (std::size_t i = 0; i < N_CLASSES; ++i) {
+			auto &c = classes[i];
+			while (c.head != nullptr) {
+				auto *f = c.head;
+				c.head = f->next;
+				FreeUncached(f, ClassToSize(i));
+			}
+		}
+	}
+
+	FrameAllocator(const FrameAllocator &) = delete;
+	FrameAllocator &operator=(const FrameAllocator &) = delete;
+
+	/**
+	 * Returns the calling thread's instance, or nullptr if it has
+	 * already been destroyed.  That happens during thread exit
+	 * (and on the main thread, before static objects are
+	 * destroyed), so coroutine frames freed after that must be
+	 * passed to FreeUncached().
+	 */
+	static FrameAllocator *GetThreadInstance() noexcept {
+		static constinit thread_local bool destroyed = false;
+		if (destroyed) [[unlikely]]
+			return nullptr;
+
+		static thread_local struct Instance {
+			FrameAllocator allocator;
+
+			~Instance() noexcept {
+				destroyed = true;
+			}
+		} instance;
+
+		return &instance.allocator;
+	}
+
+	const FrameAllocatorStats &GetStats() const noexcept {
+		return stats;
+	}
+
+	/**
+	 * Throws std::bad_alloc on error.
+	 */
+	[[gnu::malloc]] [[gnu::returns_nonnull]]
+	void *Allocate(std::size_t size) {
+		++stats.n_allocations;
+
+		if (size > MAX_SIZE) {
+			++stats.n_large;
+			return AllocateUncached(size);
+		}
+
+		const std::size_t i = SizeToClass(size);
+		auto &c = classes[i];
+		if (c.head != nullptr) {
+			++stats.n_recycled;
+			--stats.n_cached;
+			--c.n_cached;
+
+			auto *f = c.head;
+			c.head = f->next;
+
+			PoisonUndefined(f, ClassToSize(i));
+			return f;
+		}
+
+		return AllocateUncached(size);
+	}
+
+	/**
+	 * @param size the size which was passed to Allocate()
+	 */
+	void Free(void *p, std::size_t size) noexcept {
+		if (size > MAX_SIZE) {
+			FreeUncached(p, size);
+			return;
+		}
+
+		const std::size_t i = SizeToClass(size);
+		auto &c = classes[i];
+		if (c.n_cached >= MAX_CACHED) {
+			FreeUncached(p, size);
+			return;
+		}
+
+		++stats.n_cached;
+		++c.n_cached;
+
+		PoisonInaccessible(p, ClassToSize(i));
+		PoisonUndefined(p, sizeof(FreeFrame));
+
+		auto *f = ::new(p) FreeFrame{c.head};
+		c.head = f;
+	}
+
+	/**
+	 * Allocate memory which is compatible with Free(), but
+	 * without using (or needing) a #FrameAllocator instance.
+	 *
+	 * Throws std::bad_alloc on error.
+	 */
+	[[gnu::malloc]] [[gnu::returns_nonnull]]
+	static void *AllocateUncached(std::size_t size) {
+		if (size > MAX_SIZE)
+			return ::operator new(size);
+
+		return ::operator new(ClassToSize(SizeToClass(size)),
+				      std::align_val_t{GRANULARITY});
+	}
+
+	/**
+	 * Free memory returned by Allocate() or AllocateUncached()
+	 * without using a #FrameAllocator instance.
+	 *
+	 * @param size the size which was passed to Allocate()
+	 */
+	static void FreeUncached(void *p, std::size_t size) noexcept {
+		if (size > MAX_SIZE)
+			::operator delete(p, size);
+		else
+			::operator delete(p, std::align_val_t{GRANULARITY});
+	}
+
+private:
+	static constexpr std::size_t SizeToClass(std::size_t size) noexcept {
+		return size > 0 ? (size - 1) / GRANULARITY : 0;
+	}
+
+	static constexpr std::size_t ClassToSize(std::size_t i) noexcept {
+		return (i + 1) * GRANULARITY;
+	}
+};
+
+/**
+ * Returns the statistics of the calling thread's #FrameAllocator.
+ */
+inline const FrameAllocatorStats &
+GetFrameAllocatorStats() noexcept
+{
+	if (const auto *allocator = FrameAllocator::GetThreadInstance())
+		return allocator->GetStats();
+
+	static constexpr FrameAllocatorStats empty{};
+	return empty;
+}
+
+namespace detail {
+
+/**
+ * A base class for promise types which allocates the coroutine
+ * frame from the thread's #FrameAllocator.
+ */
+struct RecyclingFramePromise {
+	static void *operator new(std::size_t size) {
+		if (auto *allocator = FrameAllocator::GetThreadInstance()) [[likely]]
+			return allocator->Allocate(size);
+
+		return FrameAllocator::AllocateUncached(size);
+	}
+
+	static void operator delete(void *p, std::size_t size) noexcept {
+		if (auto *allocator = FrameAllocator::GetThreadInstance()) [[likely]]
+			allocator->Free(p, size);
+		else
+			FrameAllocator::FreeUncached(p, size);
+	}
+};
+
+} // namespace Co::detail
+
+} // namespace Co
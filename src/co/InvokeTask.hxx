@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "FrameAllocator.hxx"
 #include "UniqueHandle.hxx"
 #include "Compat.hxx"
 #include "util/BindMethod.hxx"
@@ -17,7 +18,7 @@ namespace Co {
 namespace detail {
 
 template<typename Task, bool lazy>
-class InvokePromise {
+class InvokePromise : public RecyclingFramePromise {
 	friend Task;
 
 	using Callback = BoundMethod<void(std::exception_ptr error) noexcept>;
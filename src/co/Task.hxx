@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "FrameAllocator.hxx"
 #include "UniqueHandle.hxx"
 #include "Compat.hxx"
 #include "util/ReturnValue.hxx"
@@ -40,7 +41,10 @@ public:
 };
 
 template<typename T, typename Task, bool lazy>
-class promise final : public detail::promise_result_manager<T> {
+class promise final
+	: public detail::promise_result_manager<T>,
+	  public RecyclingFramePromise
+{
 	std::coroutine_handle<> continuation;
 
 	std::exception_ptr error;
@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// author: Max Kellermann <max.kellermann@gmail.com>
+
+#include "InjectEvent.hxx"
+#include "Loop.hxx"
+
+void
+InjectEvent::Schedule() noexcept
+{
+	loop.AddInject(*this);
+}
+
+void
+InjectEvent::Cancel() noexcept
+{
+	loop.RemoveInject(*this);
+}
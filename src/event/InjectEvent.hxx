@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// author: Max Kellermann <max.kellermann@gmail.com>
+
+#pragma once
+
+#include "util/BindMethod.hxx"
+#include "util/IntrusiveList.hxx"
+
+#include <atomic>
+
+class EventLoop;
+
+/**
+ * Invoke a method call in the #EventLoop.
+ *
+ * This class is thread-safe, i.e. Schedule() and Cancel() may be
+ * called from any thread.  Scheduling does not take a lock; the
+ * #EventLoop collects pending instances from a lock-free list.
+ * Cancel() takes a lock to unlink the object.
+ */
+class InjectEvent final : SafeLinkIntrusiveListHook
+{
+	friend class EventLoop;
+	friend struct IntrusiveListBaseHookTraits<InjectEvent>;
+
+	EventLoop &loop;
+
+	using Callback = BoundMethod<void() noexcept>;
+	const Callback callback;
+
+	/**
+	 * The next item in the #EventLoop's lock-free stack.  Only
+	 * valid while #stacked is set.
+	 */
+	InjectEvent *next;
+
+	/**
+	 * Shall the callback be invoked?  Set by Schedule(), cleared
+	 * by Cancel() and by the #EventLoop right before invoking the
+	 * callback.
+	 */
+	std::atomic_bool pending{false};
+
+	/**
+	 * Is this object currently linked in the #EventLoop's
+	 * lock-free stack?  Set by the thread which pushes it, cleared
+	 * by the #EventLoop after it has moved the object to its
+	 * private list.
+	 */
+	std::atomic_bool stacked{false};
+
+public:
+	InjectEvent(EventLoop &_loop, Callback _callback) noexcept
+		:loop(_loop), callback(_callback) {}
+
+	/**
+	 * The object may be destroyed in any thread, but not while
+	 * its callback is running.
+	 */
+	~InjectEvent() noexcept {
+		Cancel();
+	}
+
+	InjectEvent(const InjectEvent &) = delete;
+	InjectEvent &operator=(const InjectEvent &) = delete;
+
+	auto &GetEventLoop() const noexcept {
+		return loop;
+	}
+
+	bool IsPending() const noexcept {
+		return pending.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Schedule the callback.  This method is thread-safe and
+	 * lock-free.
+	 */
+	void Schedule() noexcept;
+
+	/**
+	 * Cancel a pending call.  This method is thread-safe, but if
+	 * called outside of the #EventLoop thread, the callback may
+	 * already be running.
+	 */
+	void Cancel() noexcept;
+
+};
@@ -3,6 +3,7 @@
 // author: Max Kellermann <mk@cm4all.com>
 
 #include "Loop.hxx"
+#include "LoopStats.hxx"
 #include "DeferEvent.hxx"
 #include "SocketEvent.hxx"
 #include "util/ScopeExit.hxx"
@@ -12,6 +13,7 @@
 #endif
 
 #include <array>
+#include <cerrno>
 
 EventLoop::EventLoop(
 #ifdef HAVE_THREADED_EVENT_LOOP
@@ -36,9 +38,11 @@ EventLoop::~EventLoop() noexcept
 	assert(idle.empty());
 #ifdef HAVE_THREADED_EVENT_LOOP
 	assert(inject.empty());
+	assert(inject_stack.load() == nullptr);
 #endif
 	assert(sockets.empty());
 	assert(ready_sockets.empty());
+	assert(modified_sockets.empty());
 }
 
 bool
@@ -52,19 +56,26 @@ EventLoop::AddFD(int fd, unsigned events, SocketEvent &event) noexcept
 	if (!poll_backend.Add(fd, events, &event))
 		return false;
 
+	event.registered_flags = events;
 	sockets.push_back(event);
 	return true;
 }
 
-bool
-EventLoop::ModifyFD(int fd, unsigned events, SocketEvent &event) noexcept
+void
+EventLoop::ModifyFD(SocketEvent &event) noexcept
 {
 #ifdef HAVE_THREADED_EVENT_LOOP
 	assert(!IsAlive() || IsInside());
 #endif
-	assert(events != 0);
-
-	return poll_backend.Modify(fd, events, &event);
+	assert(event.scheduled_flags != 0);
+	assert(event.registered_flags != 0);
+
+	if (event.scheduled_flags == event.registered_flags) {
+		/* the modification has been reverted */
+		if (event.modified_siblings.is_linked())
+			event.modified_siblings.unlink();
+	} else if (!event.modified_siblings.is_linked())
+		modified_sockets.push_back(event);
 }
 
 bool
@@ -75,6 +86,10 @@ EventLoop::RemoveFD(int fd, SocketEvent &event) noexcept
 #endif
 
 	event.unlink();
+	if (event.modified_siblings.is_linked())
+		event.modified_siblings.unlink();
+	event.registered_flags = 0;
+
 	return poll_backend.Remove(fd);
 }
 
@@ -87,6 +102,9 @@ EventLoop::AbandonFD(SocketEvent &event) noexcept
 	assert(event.IsDefined());
 
 	event.unlink();
+	if (event.modified_siblings.is_linked())
+		event.modified_siblings.unlink();
+	event.registered_flags = 0;
 }
 
 void
@@ -127,6 +145,9 @@ inline Event::Duration
 EventLoop::HandleTimers() noexcept
 {
 	const auto now = SteadyNow();
+	const auto start = stats != nullptr
+		? Event::Clock::now()
+		: Event::TimePoint{};
 
 #ifndef NO_FINE_TIMER_EVENT
 	auto fine_timeout = timers.Run(now);
@@ -135,6 +156,14 @@ EventLoop::HandleTimers() noexcept
 #endif // NO_FINE_TIMER_EVENT
 	auto coarse_timeout = coarse_timers.Run(now);
 
+	if (stats != nullptr) [[unlikely]] {
+		/* individual timer callbacks are not measured;
+		   TimerList and TimerWheel invoke them directly */
+		const auto duration = Event::Clock::now() - start;
+		stats->timers.Add(duration);
+		stats->CheckSlow("timer", nullptr, duration);
+	}
+
 	return GetEarlierTimeout(coarse_timeout, fine_timeout);
 }
 
@@ -168,9 +197,39 @@ EventLoop::AddIdle(DeferEvent &e) noexcept
 #endif
 }
 
+void
+EventLoop::RunDeferredMeasured() noexcept
+{
+	const auto batch_start = Event::Clock::now();
+
+	while (!defer.empty() && !quit) {
+		defer.pop_front_and_dispose([this](DeferEvent *e){
+			/* obtain the address before invoking the
+			   callback, which may destroy the object */
+			const void *function = e->callback.GetFunctionAddress();
+			const auto start = Event::Clock::now();
+
+			e->Run();
+
+			/* the callback may have called SetStats() */
+			if (stats != nullptr) [[likely]]
+				stats->CheckSlow("defer", function,
+						 Event::Clock::now() - start);
+		});
+	}
+
+	if (stats != nullptr) [[likely]]
+		stats->defer.Add(Event::Clock::now() - batch_start);
+}
+
 void
 EventLoop::RunDeferred() noexcept
 {
+	if (stats != nullptr && !defer.empty()) [[unlikely]] {
+		RunDeferredMeasured();
+		return;
+	}
+
 	while (!defer.empty() && !quit) {
 		defer.pop_front_and_dispose([](DeferEvent *e){
 			e->Run();
@@ -216,13 +275,102 @@ ExportTimeoutMS(Event::Duration timeout) noexcept
 		: -1;
 }
 
+/**
+ * Convert the given timeout specification to a timespec for
+ * epoll_pwait2().  Any negative value (= never times out) is
+ * translated to nullptr.
+ */
+static const struct __kernel_timespec *
+ExportTimeoutTS(Event::Duration timeout,
+		struct __kernel_timespec &buffer) noexcept
+{
+	if (timeout < timeout.zero())
+		return nullptr;
+
+	const auto s = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+	buffer.tv_sec = s.count();
+	buffer.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout - s).count();
+	return &buffer;
+}
+
+inline void
+EventLoop::FlushModifiedSockets() noexcept
+{
+	modified_sockets.clear_and_dispose([this](SocketEvent *_event){
+		auto &event = *_event;
+		assert(event.scheduled_flags != 0);
+		assert(event.registered_flags != 0);
+
+		if (event.scheduled_flags == event.registered_flags)
+			return;
+
+		if (poll_backend.Modify(event.GetSocket().Get(),
+					event.scheduled_flags, &event)) {
+			event.registered_flags = event.scheduled_flags;
+		} else {
+			/* SocketEvent::Schedule() has already returned
+			   true, so report the error to the handler; this
+			   includes EBADF and ENOENT (the socket was
+			   probably closed by somebody else), which the
+			   handler would otherwise never learn about,
+			   waiting forever for the new flags */
+			event.SetReadyFlags(SocketEvent::ERROR);
+			event.unlink();
+			ready_sockets.push_back(event);
+		}
+	});
+}
+
+inline void
+EventLoop::DispatchMeasured(SocketEvent &socket_event) noexcept
+{
+	/* obtain the address before invoking the callback, which
+	   may destroy the object */
+	const void *function = socket_event.callback.GetFunctionAddress();
+	const auto start = Event::Clock::now();
+
+	socket_event.Dispatch();
+
+	/* the callback may have called SetStats() */
+	if (stats == nullptr) [[unlikely]]
+		return;
+
+	const auto duration = Event::Clock::now() - start;
+	stats->socket.Add(duration);
+	stats->CheckSlow("socket", function, duration);
+}
+
 inline bool
 EventLoop::Wait(Event::Duration timeout) noexcept
 {
+	FlushModifiedSockets();
+	if (!ready_sockets.empty())
+		/* FlushModifiedSockets() has reported an error */
+		return true;
+
 	std::array<struct epoll_event, 256> received_events;
-	int ret = poll_backend.Wait(received_events.data(),
-				    received_events.size(),
-				    ExportTimeoutMS(timeout));
+	int ret = -1;
+
+	if (use_epoll_pwait2) {
+		struct __kernel_timespec ts;
+		ret = poll_backend.Wait(received_events.data(),
+					received_events.size(),
+					ExportTimeoutTS(timeout, ts));
+		if (ret < 0 && (errno == ENOSYS || errno == EPERM))
+			/* not supported by the kernel (or forbidden by
+			   a seccomp filter): fall back to
+			   epoll_wait() with millisecond resolution */
+			use_epoll_pwait2 = false;
+	}
+
+	if (!use_epoll_pwait2)
+		ret = poll_backend.Wait(received_events.data(),
+					received_events.size(),
+					ExportTimeoutMS(timeout));
+
+	if (stats != nullptr && ret >= 0) [[unlikely]]
+		stats->ready_sockets.Add(uint_least64_t(ret));
+
 	for (int i = 0; i < ret; ++i) {
 		const auto &e = received_events[i];
 		auto &socket_event = *(SocketEvent *)e.data.ptr;
@@ -247,7 +395,7 @@ EventLoop::Run() noexcept
 	assert(IsInside());
 #ifdef HAVE_THREADED_EVENT_LOOP
 	assert(alive || quit_injected);
-	assert(busy);
+	assert(!sleeping);
 
 	wake_event.Schedule(SocketEvent::READ);
 #endif
@@ -265,6 +413,18 @@ EventLoop::Run() noexcept
 	do {
 		again = false;
 
+		/* the time spent in Wait() is subtracted from the
+		   iteration duration */
+		const auto iteration_start = stats != nullptr
+			? Event::Clock::now()
+			: Event::TimePoint{};
+		Event::Duration wait_duration{};
+
+		AtScopeExit(this, iteration_start, &wait_duration) {
+			if (stats != nullptr) [[unlikely]]
+				stats->iteration.Add(Event::Clock::now() - iteration_start - wait_duration);
+		};
+
 		/* invoke timers */
 
 		const auto timeout = HandleTimers();
@@ -283,23 +443,18 @@ EventLoop::Run() noexcept
 			continue;
 
 #ifdef HAVE_THREADED_EVENT_LOOP
-		/* try to handle DeferEvents without WakeFD
+		/* try to handle InjectEvents without WakeFD
 		   overhead */
-		{
-			const std::scoped_lock lock{mutex};
-			HandleInject();
+		HandleInject();
+		if (quit)
+			break;
 #endif
 
-			if (again)
-				/* re-evaluate timers because one of
-				   the DeferEvents may have added a
-				   new timeout */
-				continue;
-
-#ifdef HAVE_THREADED_EVENT_LOOP
-			busy = false;
-		}
-#endif
+		if (again)
+			/* re-evaluate timers because one of the
+			   DeferEvents may have added a new
+			   timeout */
+			continue;
 
 		/* wait for new event */
 
@@ -307,17 +462,26 @@ EventLoop::Run() noexcept
 			return;
 
 		if (ready_sockets.empty()) {
-			Wait(timeout);
-			FlushClockCaches();
-		}
+#ifdef HAVE_THREADED_EVENT_LOOP
+			if (!PrepareSleep())
+				continue;
+#endif
+
+			if (stats != nullptr) [[unlikely]] {
+				const auto wait_start = Event::Clock::now();
+				Wait(timeout);
+				wait_duration = Event::Clock::now() - wait_start;
+				stats->wait.Add(wait_duration);
+			} else
+				Wait(timeout);
 
 #ifdef HAVE_THREADED_EVENT_LOOP
-		{
-			const std::scoped_lock lock{mutex};
-			busy = true;
-		}
+			sleeping.store(false, std::memory_order_relaxed);
 #endif
 
+			FlushClockCaches();
+		}
+
 		/* invoke sockets */
 		while (!ready_sockets.empty() && !quit) {
 			auto &socket_event = ready_sockets.front();
@@ -326,7 +490,10 @@ EventLoop::Run() noexcept
 			socket_event.unlink();
 			sockets.push_back(socket_event);
 
-			socket_event.Dispatch();
+			if (stats != nullptr) [[unlikely]]
+				DispatchMeasured(socket_event);
+			else
+				socket_event.Dispatch();
 		}
 
 		RunPost();
@@ -344,48 +511,138 @@ EventLoop::Run() noexcept
 void
 EventLoop::AddInject(InjectEvent &d) noexcept
 {
-	bool must_wake;
-
-	{
-		const std::scoped_lock lock{mutex};
-		if (d.IsPending())
-			return;
-
-		/* we don't need to wake up the EventLoop if another
-		   InjectEvent has already done it */
-		must_wake = !busy && inject.empty();
+	if (d.pending.exchange(true))
+		/* already pending */
+		return;
 
-		inject.push_back(d);
-		again = true;
-	}
+	if (d.stacked.exchange(true))
+		/* still in the stack (canceled while another thread
+		   was pushing it); MoveInjected() will pick it up */
+		return;
 
-	if (must_wake)
+	auto *head = inject_stack.load(std::memory_order_relaxed);
+	do {
+		d.next = head;
+	} while (!inject_stack.compare_exchange_weak(head, &d));
+
+	/* only the first InjectEvent pushed onto an empty stack
+	   needs to wake up the EventLoop, and only if it is going to
+	   sleep; if it is busy, it will check the stack before
+	   sleeping (see PrepareSleep()) */
+	if (head == nullptr && sleeping.exchange(false))
 		wake_fd.Write();
 }
 
 void
 EventLoop::RemoveInject(InjectEvent &d) noexcept
 {
-	const std::scoped_lock protect{mutex};
+	const std::scoped_lock lock{inject_mutex};
 
-	if (d.IsPending())
+	if (d.stacked.load(std::memory_order_acquire))
+		/* the lock-free stack cannot be searched; move it
+		   (including this item) to the list */
+		MoveInjected();
+
+	if (d.is_linked())
 		inject.erase(inject.iterator_to(d));
+
+	/* clear the flag last; a concurrent AddInject() which still
+	   sees it set will not push the item again */
+	d.pending.store(false);
+
+	inject_queued.store(!inject.empty(), std::memory_order_relaxed);
+
+	/* if another thread did this, it may have moved other
+	   items from the stack which PrepareSleep() cannot see
+	   anymore; wake up the EventLoop to make sure they get
+	   handled */
+	if (!inject.empty() && !IsInside())
+		wake_fd.Write();
+}
+
+void
+EventLoop::MoveInjected() noexcept
+{
+	auto *i = inject_stack.exchange(nullptr, std::memory_order_acquire);
+
+	/* the stack is in LIFO order; reverse it to invoke the
+	   callbacks in the order they were scheduled */
+	InjectEvent *reversed = nullptr;
+	while (i != nullptr) {
+		auto *next = i->next;
+		i->next = reversed;
+		reversed = i;
+		i = next;
+	}
+
+	while (reversed != nullptr) {
+		auto &m = *reversed;
+
+		/* read the "next" pointer before clearing the
+		   "stacked" flag, because after that, another thread
+		   may push it again */
+		reversed = m.next;
+
+		if (!m.is_linked())
+			inject.push_back(m);
+
+		m.stacked.store(false, std::memory_order_release);
+	}
 }
 
 void
 EventLoop::HandleInject() noexcept
 {
+	if (inject_stack.load(std::memory_order_relaxed) == nullptr &&
+	    !inject_queued.load(std::memory_order_relaxed))
+		/* fast path: nothing was injected, no need to lock
+		   the mutex */
+		return;
+
+	std::unique_lock lock{inject_mutex};
+
+	AtScopeExit(this) {
+		inject_queued.store(!inject.empty(), std::memory_order_relaxed);
+	};
+
+	if (inject_stack.load(std::memory_order_relaxed) != nullptr)
+		MoveInjected();
+
 	while (!inject.empty() && !quit) {
-		auto &m = inject.front();
-		assert(m.IsPending());
+		auto &m = inject.pop_front();
 
-		inject.pop_front();
+		/* canceled items are skipped */
+		if (!m.pending.exchange(false))
+			continue;
 
-		const ScopeUnlock unlock(mutex);
-		m.Run();
+		/* copy the callback while the mutex is locked,
+		   because after unlocking, another thread may cancel
+		   and destroy the InjectEvent */
+		const auto callback = m.callback;
+
+		lock.unlock();
+		callback();
+		lock.lock();
 	}
 }
 
+inline bool
+EventLoop::PrepareSleep() noexcept
+{
+	sleeping.store(true);
+
+	/* check the stack after setting the flag; this pairs with
+	   the compare_exchange and the exchange in AddInject(), so
+	   either we see the new item here, or the producer sees the
+	   flag and wakes us */
+	if (inject_stack.load() != nullptr) {
+		sleeping.store(false, std::memory_order_relaxed);
+		return false;
+	}
+
+	return true;
+}
+
 void
 EventLoop::OnSocketReady([[maybe_unused]] unsigned flags) noexcept
 {
@@ -393,12 +650,11 @@ EventLoop::OnSocketReady([[maybe_unused]] unsigned flags) noexcept
 
 	wake_fd.Read();
 
-	if (quit_injected) {
+	if (quit_injected.load()) {
 		Break();
 		return;
 	}
 
-	const std::scoped_lock lock{mutex};
 	HandleInject();
 }
 
@@ -14,11 +14,14 @@
 #include "TimerList.hxx"
 #endif // NO_FINE_TIMER_EVENT
 
+#include "SocketEvent.hxx"
+
 #ifdef HAVE_THREADED_EVENT_LOOP
 #include "WakeFD.hxx"
-#include "SocketEvent.hxx"
 #include "thread/Id.hxx"
-#include "thread/Mutex.hxx"
+
+#include <atomic>
+#include <mutex>
 #endif
 
 #ifndef NDEBUG
@@ -26,7 +29,8 @@
 #endif
 
 class DeferEvent;
-class SocketEvent;
+class InjectEvent;
+class EventLoopStats;
 
 /**
  * A non-blocking I/O event loop.
@@ -56,10 +60,27 @@ class EventLoop final
 	DeferList idle;
 
 #ifdef HAVE_THREADED_EVENT_LOOP
-	Mutex mutex;
+	/**
+	 * Protects #inject and the draining of #inject_stack.
+	 * Producers never lock it; it is only contended if
+	 * RemoveInject() is called from another thread.
+	 */
+	std::mutex inject_mutex;
 
+	/**
+	 * #InjectEvent instances which have been moved out of
+	 * #inject_stack, in the order they were scheduled.  Protected
+	 * by #inject_mutex.
+	 */
 	using InjectList = IntrusiveList<InjectEvent>;
 	InjectList inject;
+
+	/**
+	 * Is #inject non-empty?  Updated while #inject_mutex is
+	 * locked; this allows HandleInject() to skip locking if there
+	 * is nothing to do.
+	 */
+	std::atomic_bool inject_queued{false};
 #endif
 
 	using SocketList = IntrusiveList<SocketEvent>;
@@ -76,11 +97,26 @@ class EventLoop final
 	 */
 	SocketList ready_sockets;
 
+	/**
+	 * A list of #SocketEvent instances whose
+	 * SocketEvent::scheduled_flags have been modified, but the
+	 * modification has not yet been applied to epoll.  See
+	 * FlushModifiedSockets().
+	 */
+	IntrusiveList<SocketEvent,
+		      IntrusiveListMemberHookTraits<&SocketEvent::modified_siblings>> modified_sockets;
+
 #ifndef NDEBUG
 	using PostCallback = BoundMethod<void() noexcept>;
 	PostCallback post_callback = nullptr;
 #endif
 
+	/**
+	 * If set, then the durations of loop iterations and
+	 * callbacks are measured and recorded here.
+	 */
+	EventLoopStats *stats = nullptr;
+
 #ifdef HAVE_THREADED_EVENT_LOOP
 	/**
 	 * A reference to the thread that is currently inside Run().
@@ -104,16 +140,33 @@ class EventLoop final
 	 */
 	bool again;
 
+	/**
+	 * Shall we use epoll_pwait2()?  This is cleared if the kernel
+	 * doesn't support it.
+	 */
+	bool use_epoll_pwait2 = true;
+
 #ifdef HAVE_THREADED_EVENT_LOOP
-	bool quit_injected = false;
+	std::atomic_bool quit_injected{false};
 
 	/**
-	 * True when handling callbacks, false when waiting for I/O or
-	 * timeout.
+	 * A lock-free stack of #InjectEvent instances scheduled by
+	 * other threads (linked with InjectEvent::next, most recent
+	 * first).  The #EventLoop thread takes the whole stack at
+	 * once.
 	 *
-	 * Protected with #mutex.
+	 * This is written by other threads, so it is kept on a
+	 * separate cache line.
 	 */
-	bool busy = true;
+	alignas(64) std::atomic<InjectEvent *> inject_stack{nullptr};
+
+	/**
+	 * True while the #EventLoop is (about to be) waiting for I/O
+	 * or timeout.  The first thread which pushes onto an empty
+	 * #inject_stack while this is set clears it and writes to
+	 * #wake_fd.
+	 */
+	std::atomic_bool sleeping{false};
 #endif
 
 	ClockCache<std::chrono::steady_clock> steady_clock_cache;
@@ -143,6 +196,21 @@ public:
 	}
 #endif
 
+	/**
+	 * Enable (or disable with nullptr) instrumentation.  This
+	 * costs a few clock_gettime() calls per iteration and per
+	 * callback.  The object is owned by the caller and must
+	 * remain valid until it is unregistered.  This may be called
+	 * from inside a callback.
+	 */
+	void SetStats(EventLoopStats *_stats) noexcept {
+		stats = _stats;
+	}
+
+	EventLoopStats *GetStats() const noexcept {
+		return stats;
+	}
+
 	const auto &GetSteadyClockCache() const noexcept {
 		return steady_clock_cache;
 	}
@@ -197,11 +265,7 @@ public:
 	 * has really stopped.
 	 */
 	void InjectBreak() noexcept {
-		{
-			const std::scoped_lock lock{mutex};
-			quit_injected = true;
-		}
-
+		quit_injected.store(true);
 		wake_fd.Write();
 	}
 #endif // HAVE_THREADED_EVENT_LOOP
@@ -216,7 +280,13 @@ public:
 	}
 
 	bool AddFD(int fd, unsigned events, SocketEvent &event) noexcept;
-	bool ModifyFD(int fd, unsigned events, SocketEvent &event) noexcept;
+
+	/**
+	 * SocketEvent::scheduled_flags has been modified.  The
+	 * epoll_ctl() call will be made by FlushModifiedSockets().
+	 */
+	void ModifyFD(SocketEvent &event) noexcept;
+
 	bool RemoveFD(int fd, SocketEvent &event) noexcept;
 
 	/**
@@ -239,13 +309,15 @@ public:
 	/**
 	 * Schedule a call to the InjectEvent.
 	 *
-	 * This method is thread-safe.
+	 * This method is thread-safe and lock-free.
 	 */
 	void AddInject(InjectEvent &d) noexcept;
 
 	/**
-	 * Cancel a pending call to the InjectEvent.
-	 * However after returning, the call may still be running.
+	 * Cancel a pending call to the InjectEvent.  After
+	 * returning, the #EventLoop does not refer to the object
+	 * anymore (but if called from another thread, the callback
+	 * may still be running).
 	 *
 	 * This method is thread-safe.
 	 */
@@ -257,6 +329,18 @@ public:
 private:
 	void RunDeferred() noexcept;
 
+	/**
+	 * Like RunDeferred(), but measure each callback and record
+	 * it in #stats.
+	 */
+	void RunDeferredMeasured() noexcept;
+
+	/**
+	 * Call SocketEvent::Dispatch() and record its duration in
+	 * #stats.
+	 */
+	void DispatchMeasured(SocketEvent &socket_event) noexcept;
+
 	/**
 	 * Invoke one "idle" #DeferEvent.
 	 *
@@ -266,11 +350,24 @@ private:
 
 #ifdef HAVE_THREADED_EVENT_LOOP
 	/**
-	 * Invoke all pending InjectEvents.
+	 * Move all items from #inject_stack to #inject.
 	 *
-	 * Caller must lock the mutex.
+	 * Caller must lock #inject_mutex.
+	 */
+	void MoveInjected() noexcept;
+
+	/**
+	 * Invoke all pending InjectEvents.
 	 */
 	void HandleInject() noexcept;
+
+	/**
+	 * Announce that the #EventLoop is going to sleep.
+	 *
+	 * @return false if an #InjectEvent has been scheduled
+	 * meanwhile and the #EventLoop must not sleep
+	 */
+	bool PrepareSleep() noexcept;
 #endif
 
 	/**
@@ -280,6 +377,12 @@ private:
 	 */
 	Event::Duration HandleTimers() noexcept;
 
+	/**
+	 * Apply all pending SocketEvent::scheduled_flags changes to
+	 * epoll (unless they have been reverted meanwhile).
+	 */
+	void FlushModifiedSockets() noexcept;
+
 	/**
 	 * Call epoll_wait() and pass all returned events to
 	 * SocketEvent::SetReadyFlags().
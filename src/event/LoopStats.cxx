@@ -0,0 +1,130 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "LoopStats.hxx"
+#include "io/Logger.hxx"
+
+#include <fmt/format.h>
+
+#include <cstddef>
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <stdlib.h> // for free()
+
+/**
+ * Describe the code at the given address: the (demangled) name of
+ * the symbol containing it.  For #BoundMethod callbacks, this is the
+ * name of the wrapper function which includes the method name as
+ * template argument.
+ *
+ * If the symbol is unknown (e.g. because the executable was not
+ * linked with "-rdynamic"), this returns the object file name and the
+ * offset within it, which can be resolved with addr2line.
+ */
+static std::string
+DescribeFunction(const void *address) noexcept
+try {
+	Dl_info info;
+	if (dladdr(address, &info) == 0)
+		return fmt::format("{}", address);
+
+	if (info.dli_sname == nullptr)
+		return fmt::format("{}+{:#x}",
+				   info.dli_fname != nullptr ? info.dli_fname : "?",
+				   (const std::byte *)address - (const std::byte *)info.dli_fbase);
+
+	int status;
+	char *demangled = abi::__cxa_demangle(info.dli_sname,
+					      nullptr, nullptr, &status);
+	if (demangled == nullptr)
+		return info.dli_sname;
+
+	std::string result{demangled};
+	free(demangled);
+	return result;
+} catch (...) {
+	return {};
+}
+
+void
+EventLoopStats::OnSlow(const char *kind, const void *function,
+		       Event::Duration duration) noexcept
+{
+	++n_slow_callbacks;
+
+	const auto ms = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(duration).count();
+
+	if (function != nullptr)
+		LogFmt(2, "EventLoop", "Slow {} callback {} took {:.3f} ms",
+		       kind, DescribeFunction(function), ms);
+	else
+		/* unknown callback (e.g. a batch of timers) */
+		LogFmt(2, "EventLoop", "Slow {} callback took {:.3f} ms",
+		       kind, ms);
+}
+
+template<const auto &bounds>
+static void
+WriteHistogram(std::string &buffer, std::string_view prefix,
+	       std::string_view name, std::string_view help,
+	       const Histogram<bounds> &h, double unit)
+{
+	auto out = std::back_inserter(buffer);
+
+	fmt::format_to(out,
+		       "# HELP {0}{1} {2}\n"
+		       "# TYPE {0}{1} histogram\n",
+		       prefix, name, help);
+
+	/* Prometheus buckets are cumulative */
+	uint_least64_t cumulative = 0;
+	const auto &buckets = h.GetBuckets();
+	for (std::size_t i = 0; i < bounds.size(); ++i) {
+		cumulative += buckets[i];
+		fmt::format_to(out, "{}{}_bucket{{le=\"{}\"}} {}\n",
+			       prefix, name, bounds[i] / unit, cumulative);
+	}
+
+	cumulative += buckets.back();
+	fmt::format_to(out,
+		       "{0}{1}_bucket{{le=\"+Inf\"}} {2}\n"
+		       "{0}{1}_sum {3}\n"
+		       "{0}{1}_count {2}\n",
+		       prefix, name, cumulative, h.GetSum() / unit);
+}
+
+void
+EventLoopStats::WritePrometheus(std::string &buffer,
+				std::string_view prefix) const
+{
+	/* durations are stored in nanoseconds, but Prometheus
+	   wants seconds */
+	static constexpr double NS = 1e9;
+
+	WriteHistogram(buffer, prefix, "event_loop_iteration_seconds",
+		       "Time spent in each event loop iteration, excluding epoll_wait()",
+		       iteration, NS);
+	WriteHistogram(buffer, prefix, "event_loop_wait_seconds",
+		       "Time spent in epoll_wait()",
+		       wait, NS);
+	WriteHistogram(buffer, prefix, "event_loop_ready_sockets",
+		       "Number of sockets reported by each epoll_wait() call",
+		       ready_sockets, 1);
+	WriteHistogram(buffer, prefix, "event_loop_timers_seconds",
+		       "Duration of all expired timer callbacks in one iteration",
+		       timers, NS);
+	WriteHistogram(buffer, prefix, "event_loop_defer_seconds",
+		       "Duration of all deferred callbacks in one iteration",
+		       defer, NS);
+	WriteHistogram(buffer, prefix, "event_loop_socket_callback_seconds",
+		       "Duration of each socket callback",
+		       socket, NS);
+
+	fmt::format_to(std::back_inserter(buffer),
+		       "# HELP {0}event_loop_slow_callbacks_total Number of callbacks exceeding the slow callback threshold\n"
+		       "# TYPE {0}event_loop_slow_callbacks_total counter\n"
+		       "{0}event_loop_slow_callbacks_total {1}\n",
+		       prefix, n_slow_callbacks);
+}
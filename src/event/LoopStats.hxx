@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "Chrono.hxx"
+#include "util/Histogram.hxx"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * Bucket bounds for durations (in nanoseconds): 1us, 4us, 16us, ...,
+ * ~1s.
+ */
+inline constexpr auto EVENT_LOOP_DURATION_BOUNDS =
+	MakeExponentialBounds<11>(1000, 2);
+
+/**
+ * Bucket bounds for counters: 0, 1, 2, 4, ..., 256.
+ */
+inline constexpr auto EVENT_LOOP_COUNT_BOUNDS = []{
+	std::array<uint_least64_t, 10> result{};
+	for (std::size_t i = 1; i < result.size(); ++i)
+		result[i] = uint_least64_t{1} << (i - 1);
+	return result;
+}();
+
+/**
+ * Optional instrumentation for an #EventLoop; enable it with
+ * EventLoop::SetStats().  All durations are in nanoseconds.
+ */
+class EventLoopStats {
+	/**
+	 * Callbacks which take longer than this are logged.  A
+	 * negative value disables this.
+	 */
+	Event::Duration slow_threshold{-1};
+
+public:
+	using DurationHistogram = Histogram<EVENT_LOOP_DURATION_BOUNDS>;
+	using CountHistogram = Histogram<EVENT_LOOP_COUNT_BOUNDS>;
+
+	/**
+	 * The time spent in each loop iteration, excluding
+	 * epoll_wait().
+	 */
+	DurationHistogram iteration;
+
+	/**
+	 * The time spent in epoll_wait().
+	 */
+	DurationHistogram wait;
+
+	/**
+	 * The number of sockets reported as ready by each
+	 * epoll_wait() call.
+	 */
+	CountHistogram ready_sockets;
+
+	/**
+	 * The duration of all expired timer callbacks in one
+	 * iteration.
+	 */
+	DurationHistogram timers;
+
+	/**
+	 * The duration of all #DeferEvent callbacks in one
+	 * iteration.
+	 */
+	DurationHistogram defer;
+
+	/**
+	 * The duration of each #SocketEvent callback.
+	 */
+	DurationHistogram socket;
+
+	/**
+	 * The number of callbacks which exceeded the slow callback
+	 * threshold.
+	 */
+	uint_least64_t n_slow_callbacks = 0;
+
+	/**
+	 * Log all callbacks which take longer than the given
+	 * duration.  A negative value disables this.
+	 */
+	void SetSlowThreshold(Event::Duration _slow_threshold) noexcept {
+		slow_threshold = _slow_threshold;
+	}
+
+	/**
+	 * Check whether a callback was slow and log it if so.
+	 *
+	 * @param kind a short description of the callback type
+	 * (e.g. "socket")
+	 * @param function the address of the callback (see
+	 * BoundMethod::GetFunctionAddress()) or nullptr if unknown
+	 */
+	void CheckSlow(const char *kind, const void *function,
+		       Event::Duration duration) noexcept {
+		if (slow_threshold.count() >= 0 && duration > slow_threshold)
+			OnSlow(kind, function, duration);
+	}
+
+	/**
+	 * Append all metrics in the Prometheus text format to the
+	 * given buffer.  This is meant to be used by an
+	 * implementation of
+	 * PrometheusExporterHandler::OnPrometheusExporterRequest().
+	 *
+	 * Throws on out-of-memory.
+	 *
+	 * @param prefix a prefix for all metric names
+	 * (e.g. "myapp_")
+	 */
+	void WritePrometheus(std::string &buffer,
+			     std::string_view prefix) const;
+
+private:
+	void OnSlow(const char *kind, const void *function,
+		    Event::Duration duration) noexcept;
+};
@@ -3,36 +3,174 @@
 // author: Max Kellermann <mk@cm4all.com>
 
 #include "PipeLineReader.hxx"
-#include "util/ExtractLine.hxx"
+#include "util/StaticVector.hxx"
 
+#include <algorithm> // for std::min()
 #include <cerrno>
+#include <cstring> // for std::memchr()
+
+/**
+ * Limit the number of read() calls per wakeup to avoid starving
+ * other events while a child process is flooding the pipe.
+ */
+static constexpr unsigned MAX_READS_PER_WAKEUP = 16;
+
+/**
+ * The maximum number of lines passed to one
+ * PipeLineReaderHandler::OnPipeLines() call.
+ */
+static constexpr std::size_t MAX_LINES_PER_BATCH = 64;
+
+inline bool
+PipeLineReader::HasNewline() noexcept
+{
+	const auto r = buffer.Read();
+	assert(scan_position <= r.size());
+
+	if (std::memchr(r.data() + scan_position, '\n',
+			r.size() - scan_position) != nullptr)
+		return true;
+
+	scan_position = r.size();
+	return false;
+}
+
+inline bool
+PipeLineReader::GrowBuffer() noexcept
+{
+	assert(buffer.IsFull());
+
+	const std::size_t capacity = buffer.GetCapacity();
+	if (capacity >= max_line_length)
+		return false;
+
+	buffer.Grow(std::min(capacity * 2, max_line_length));
+	return true;
+}
+
+inline void
+PipeLineReader::ShrinkBuffer() noexcept
+{
+	if (buffer.empty() && buffer.GetCapacity() > INITIAL_CAPACITY)
+		buffer.Shrink(INITIAL_CAPACITY);
+}
+
+inline bool
+PipeLineReader::SubmitLines(bool flush) noexcept
+{
+	StaticVector<std::span<char>, MAX_LINES_PER_BATCH> lines;
+
+	/* add a line to the batch, submitting the batch first if
+	   it is full */
+	const auto add = [this, &lines](std::span<char> line) noexcept {
+		if (lines.full()) {
+			if (!handler.OnPipeLines(lines))
+				return false;
+
+			lines.clear();
+		}
+
+		lines.push_back(line);
+		return true;
+	};
+
+	while (true) {
+		const auto r = buffer.Read();
+		if (r.empty())
+			break;
+
+		/* a newline beyond the maximum line length does not
+		   count; such a line is split */
+		const std::size_t limit = std::min(r.size(), max_line_length);
+		const std::size_t scan_start = std::min(scan_position, limit);
+
+		char *const data = r.data();
+		char *newline = static_cast<char *>(std::memchr(data + scan_start, '\n',
+								limit - scan_start));
+		if (newline == nullptr) {
+			std::size_t length;
+			if (r.size() >= max_line_length)
+				/* split an overlong line */
+				length = max_line_length;
+			else if (flush)
+				/* pass the partial line */
+				length = r.size();
+			else {
+				scan_position = r.size();
+				break;
+			}
+
+			/* Consume() only moves the head; the line
+			   data remains valid until the next Write()
+			   call */
+			buffer.Consume(length);
+			scan_position = 0;
+
+			if (!add({data, length}))
+				return false;
+
+			continue;
+		}
+
+		buffer.Consume(newline + 1 - data);
+		scan_position = 0;
+
+		while (newline > data && newline[-1] == '\r')
+			--newline;
+
+		if (!add({data, static_cast<std::size_t>(newline - data)}))
+			return false;
+	}
+
+	return lines.empty() || handler.OnPipeLines(lines);
+}
 
 void
 PipeLineReader::TryRead(bool flush) noexcept
 {
-	assert(!buffer.IsFull());
+	bool end = false;
 
-	auto w = buffer.Write();
-	assert(!w.empty());
+	for (unsigned i = 0; i < MAX_READS_PER_WAKEUP; ++i) {
+		auto w = buffer.Write();
+		if (w.empty()) {
+			/* the buffer is full: if it contains complete
+			   lines, submit them to make room; grow it
+			   only for a single long line, and split the
+			   line if it is too long */
+			if (HasNewline() || !GrowBuffer()) {
+				if (!SubmitLines(false))
+					return;
+			}
 
-	auto nbytes = event.GetFileDescriptor().Read(std::as_writable_bytes(w));
-	if (nbytes < 0 && errno == EAGAIN)
-		return;
+			w = buffer.Write();
+		}
 
-	if (nbytes <= 0) {
-		event.Close();
-		handler.OnPipeEnd();
-		return;
-	}
+		assert(!w.empty());
 
-	buffer.Append(nbytes);
+		auto nbytes = event.GetFileDescriptor().Read(std::as_writable_bytes(w));
+		if (nbytes < 0 && errno == EAGAIN)
+			break;
 
-	while (true) {
-		auto r = ExtractLine(buffer, flush);
-		if (r.data() == nullptr)
+		if (nbytes <= 0) {
+			end = true;
+			break;
+		}
+
+		buffer.Append(nbytes);
+
+		if (static_cast<std::size_t>(nbytes) < w.size())
+			/* short read: the pipe is probably empty
+			   now; don't waste another system call */
 			break;
+	}
+
+	if (!SubmitLines(flush || end))
+		return;
 
-		if (!handler.OnPipeLine(r))
-			return;
+	ShrinkBuffer();
+
+	if (end) {
+		event.Close();
+		handler.OnPipeEnd();
 	}
 }
@@ -6,8 +6,10 @@
 
 #include "PipeEvent.hxx"
 #include "io/UniqueFileDescriptor.hxx"
-#include "util/StaticFifoBuffer.hxx"
+#include "util/DynamicFifoBuffer.hxx"
 
+#include <cassert>
+#include <cstddef>
 #include <span>
 
 class PipeLineReaderHandler {
@@ -17,6 +19,23 @@ public:
 	 * #PipeLineReader has been destroyed
 	 */
 	virtual bool OnPipeLine(std::span<char> line) noexcept = 0;
+
+	/**
+	 * A batch of lines has been received.  The default
+	 * implementation passes each one to OnPipeLine(); override
+	 * this to amortize per-line overhead.
+	 *
+	 * @return true to continue reading lines, false if the
+	 * #PipeLineReader has been destroyed
+	 */
+	virtual bool OnPipeLines(std::span<const std::span<char>> lines) noexcept {
+		for (const auto line : lines)
+			if (!OnPipeLine(line))
+				return false;
+
+		return true;
+	}
+
 	virtual void OnPipeEnd() noexcept = 0;
 };
 
@@ -24,13 +43,31 @@ public:
  * Read text lines from a (non-blocking) pipe.  Whenever a newline
  * character is found, the line (without trailing NL/CR characters) is
  * passed to the callback.
+ *
+ * Each wakeup drains the pipe with several read() calls, and all
+ * complete lines are passed to the handler in batches.  The buffer
+ * only grows if a single line does not fit (up to the configured
+ * maximum line length; longer lines are split), and it shrinks back
+ * when it runs empty.
  */
 class PipeLineReader {
+	static constexpr std::size_t INITIAL_CAPACITY = 8192;
+
 	PipeEvent event;
 
 	PipeLineReaderHandler &handler;
 
-	StaticFifoBuffer<char, 8192> buffer;
+	DynamicFifoBuffer<char> buffer{INITIAL_CAPACITY};
+
+	std::size_t max_line_length = INITIAL_CAPACITY;
+
+	/**
+	 * The number of bytes at the beginning of #buffer which are
+	 * known to contain no newline character.  This avoids
+	 * scanning a partial line again after more data has been
+	 * appended.
+	 */
+	std::size_t scan_position = 0;
 
 public:
 	/**
@@ -57,6 +94,26 @@ public:
 		return event.GetEventLoop();
 	}
 
+	/**
+	 * Allow lines up to this length (in bytes, including the
+	 * newline character); the buffer grows on demand.  Longer
+	 * lines are split into chunks of this length.  The default is
+	 * 8 kB.
+	 */
+	void SetMaxLineLength(std::size_t _max_line_length) noexcept {
+		assert(_max_line_length > 0);
+
+		max_line_length = _max_line_length;
+	}
+
+	/**
+	 * Returns the current capacity of the input buffer (for
+	 * diagnostics).
+	 */
+	std::size_t GetBufferCapacity() const noexcept {
+		return buffer.GetCapacity();
+	}
+
 	/**
 	 * Attempt to read again, and pass all data to the callback.  If
 	 * the last line isn't finalized with a newline character, it is
@@ -69,6 +126,35 @@ public:
 	}
 
 private:
+	/**
+	 * Does the buffer contain a newline character (i.e. at least
+	 * one complete line)?
+	 */
+	bool HasNewline() noexcept;
+
+	/**
+	 * Try to make room in the (full) buffer.  This is only
+	 * called if the buffer contains one partial line.
+	 *
+	 * @return false if the buffer has reached the maximum line
+	 * length
+	 */
+	bool GrowBuffer() noexcept;
+
+	/**
+	 * Release the memory allocated by GrowBuffer() after the
+	 * long line has been consumed.
+	 */
+	void ShrinkBuffer() noexcept;
+
+	/**
+	 * Pass all complete lines in the buffer to the handler.
+	 *
+	 * @param flush pass the trailing partial line as well
+	 * @return false if the #PipeLineReader has been destroyed
+	 */
+	bool SubmitLines(bool flush) noexcept;
+
 	void TryRead(bool flush) noexcept;
 
 	void OnPipeReadable(unsigned) noexcept {
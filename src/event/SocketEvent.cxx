@@ -75,13 +75,19 @@ SocketEvent::Schedule(unsigned flags) noexcept
 
 	assert(IsDefined());
 
+	if (scheduled_flags != 0 && flags != 0) {
+		/* the epoll_ctl() call is postponed until the
+		   EventLoop is about to sleep */
+		scheduled_flags = flags;
+		loop.ModifyFD(*this);
+		return true;
+	}
+
 	bool success;
 	if (scheduled_flags == 0)
 		success = loop.AddFD(fd.Get(), flags, *this);
-	else if (flags == 0)
-		success = loop.RemoveFD(fd.Get(), *this);
 	else
-		success = loop.ModifyFD(fd.Get(), flags, *this);
+		success = loop.RemoveFD(fd.Get(), *this);
 
 	if (success)
 		scheduled_flags = flags;
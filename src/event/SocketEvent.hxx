@@ -43,6 +43,13 @@ class SocketEvent final
 	 */
 	unsigned scheduled_flags = 0;
 
+	/**
+	 * A bit mask of events that are currently registered in
+	 * epoll.  This differs from #scheduled_flags while a
+	 * modification is pending (see #modified_siblings).
+	 */
+	unsigned registered_flags = 0;
+
 	/**
 	 * A bit mask of events which have been reported as "ready" by
 	 * epoll_wait().  If non-zero, then the #EventLoop will call
@@ -50,6 +57,15 @@ class SocketEvent final
 	 */
 	unsigned ready_flags = 0;
 
+	/**
+	 * Hook for EventLoop::modified_sockets.  Changes of
+	 * #scheduled_flags (but not adding or removing the socket)
+	 * are applied with epoll_ctl() only right before the
+	 * #EventLoop goes to sleep, so toggling the flags several
+	 * times in one iteration costs at most one system call.
+	 */
+	IntrusiveListHook<IntrusiveHookMode::TRACK> modified_siblings;
+
 public:
 	/**
 	 * These flags are always reported by epoll_wait() and don't
@@ -119,6 +135,10 @@ public:
 	}
 
 	/**
+	 * Modifications of an already scheduled socket are applied
+	 * lazily, right before the #EventLoop goes to sleep; errors
+	 * from that are reported to the callback as #ERROR.
+	 *
 	 * @return true on success, false on error (with errno set if
 	 * USE_EPOLL is defined)
 	 */
@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// author: Max Kellermann <max.kellermann@gmail.com>
+
+#pragma once
+
+#include "net/SocketDescriptor.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+#include "system/LinuxFD.hxx"
+
+#include <cstdint>
+
+/**
+ * A class which can wake up an #EventLoop from another thread, based
+ * on an eventfd.
+ */
+class WakeFD {
+	UniqueFileDescriptor fd;
+
+public:
+	/**
+	 * Throws on error.
+	 */
+	WakeFD()
+		:fd(CreateEventFD()) {}
+
+	WakeFD(const WakeFD &) = delete;
+	WakeFD &operator=(const WakeFD &) = delete;
+
+	SocketDescriptor GetSocket() const noexcept {
+		return SocketDescriptor::FromFileDescriptor(fd);
+	}
+
+	/**
+	 * Clear the wakeup.
+	 */
+	bool Read() noexcept {
+		uint64_t value;
+		return fd.Read(&value, sizeof(value)) == (ssize_t)sizeof(value);
+	}
+
+	/**
+	 * Wake up the #EventLoop.  This method is thread-safe.
+	 */
+	void Write() noexcept {
+		static constexpr uint64_t value = 1;
+		(void)fd.Write(&value, sizeof(value));
+	}
+};
@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "event/Chrono.hxx"
+
+#include <concepts>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace BengControl {
+
+/**
+ * A pre-serialized reply payload (e.g. for Command::STATS) which is
+ * shared by all requests and regenerated at most once per interval.
+ * This prevents a flood of requests from collecting the same
+ * statistics over and over.
+ */
+class CachedReply {
+	std::vector<std::byte> payload;
+
+	Event::TimePoint expires = Event::TimePoint::min();
+
+	const Event::Duration interval;
+
+public:
+	explicit CachedReply(Event::Duration _interval) noexcept
+		:interval(_interval) {}
+
+	/**
+	 * Force regeneration on the next Get() call.
+	 */
+	void Invalidate() noexcept {
+		expires = Event::TimePoint::min();
+	}
+
+	/**
+	 * Obtain the payload, regenerating it if it has expired.
+	 *
+	 * @param now the current time (e.g. EventLoop::SteadyNow())
+	 * @param serialize a function returning the fresh payload;
+	 * its return value must be convertible to std::span<const
+	 * std::byte>
+	 * @return the payload; it remains valid until the next
+	 * Get() call
+	 */
+	template<typename F>
+	requires std::invocable<F>
+	std::span<const std::byte> Get(Event::TimePoint now, F &&serialize) {
+		if (now >= expires) {
+			/* keep the return value alive while copying
+			   it; it may be a temporary container */
+			auto &&fresh = serialize();
+			const std::span<const std::byte> src{fresh};
+			payload.assign(src.begin(), src.end());
+			expires = now + interval;
+		}
+
+		return payload;
+	}
+};
+
+} // namespace BengControl
@@ -10,14 +10,34 @@
 #include "net/SocketAddress.hxx"
 #include "net/SendMessage.hxx"
 #include "net/UniqueSocketDescriptor.hxx"
+#include "net/MultiReceiveMessage.hxx"
 #include "io/Iovec.hxx"
 #include "util/ByteOrder.hxx"
 
 namespace BengControl {
 
+/**
+ * The number of datagrams received with one recvmmsg() call.
+ */
+static constexpr std::size_t MULTI_DATAGRAMS = 64;
+
+/**
+ * The maximum size of one datagram; this is the same as
+ * UdpListener's receive buffer.
+ */
+static constexpr std::size_t MAX_PAYLOAD_SIZE = 4096;
+
+static constexpr std::size_t MAX_CMSG_SIZE = 1024;
+static constexpr std::size_t MAX_FDS = 64;
+
 Server::Server(EventLoop &event_loop, UniqueSocketDescriptor s,
-	       Handler &_handler) noexcept
-	:handler(_handler), socket(event_loop, std::move(s), *this)
+	       Handler &_handler)
+	:handler(_handler),
+	 socket(event_loop, std::move(s),
+		MultiReceiveMessage{MULTI_DATAGRAMS, MAX_PAYLOAD_SIZE,
+				    MAX_CMSG_SIZE, MAX_FDS},
+		*this),
+	 coalesce_reset_event(event_loop, BIND_THIS_METHOD(OnCoalesceReset))
 {
 }
 
@@ -27,56 +47,89 @@ Server::Server(EventLoop &event_loop, Handler &_handler,
 {
 }
 
-static void
-control_server_decode(Server &control_server,
-		      const void *data, size_t length,
-		      std::span<UniqueFileDescriptor> fds,
-		      SocketAddress address, int uid,
-		      Handler &handler)
+inline bool
+Server::IsCoalescible(Command command) noexcept
+{
+	switch (command) {
+	case Command::TCACHE_INVALIDATE:
+	case Command::FLUSH_FILTER_CACHE:
+	case Command::DISCARD_SESSION:
+	case Command::FLUSH_HTTP_CACHE:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+inline bool
+Server::CheckDuplicate(Command command, std::span<const std::byte> payload,
+		       int uid)
+{
+	/* the uid is part of the key because the handler may
+	   authorize commands based on it */
+	const uint16_t command_value = uint16_t(command);
+
+	std::string key;
+	key.reserve(sizeof(command_value) + sizeof(uid) + payload.size());
+	key.append((const char *)&command_value, sizeof(command_value));
+	key.append((const char *)&uid, sizeof(uid));
+	key.append((const char *)payload.data(), payload.size());
+
+	if (!coalesce_keys.emplace(std::move(key)).second)
+		return true;
+
+	coalesce_reset_event.Schedule();
+	return false;
+}
+
+inline void
+Server::Decode(std::span<const std::byte> data,
+	       std::span<UniqueFileDescriptor> fds,
+	       SocketAddress address, int uid)
 {
 	/* verify the magic number */
 
-	const uint32_t *magic = (const uint32_t *)data;
+	const uint32_t *magic = (const uint32_t *)data.data();
 
-	if (length < sizeof(*magic) || FromBE32(*magic) != MAGIC)
+	if (data.size() < sizeof(*magic) || FromBE32(*magic) != MAGIC)
 		throw std::runtime_error("wrong magic");
 
-	data = magic + 1;
-	length -= sizeof(*magic);
+	data = data.subspan(sizeof(*magic));
 
-	if (!IsSizePadded(length))
-		throw FmtRuntimeError("odd control packet (length={})", length);
+	if (!IsSizePadded(data.size()))
+		throw FmtRuntimeError("odd control packet (length={})", data.size());
 
 	/* now decode all commands */
 
-	while (length > 0) {
-		const auto *header = (const Header *)data;
-		if (length < sizeof(*header))
+	while (!data.empty()) {
+		const auto *header = (const Header *)data.data();
+		if (data.size() < sizeof(*header))
 			throw FmtRuntimeError("partial header (length={})",
-					      length);
+					      data.size());
 
 		size_t payload_length = FromBE16(header->length);
 		const auto command = static_cast<Command>(FromBE16(header->command));
 
-		data = header + 1;
-		length -= sizeof(*header);
+		data = data.subspan(sizeof(*header));
 
-		const std::byte *payload = (const std::byte *)data;
-		if (length < payload_length)
+		if (data.size() < payload_length)
 			throw FmtRuntimeError("partial payload (length={}, expected={})",
-					      length, payload_length);
+					      data.size(), payload_length);
 
-		/* this command is ok, pass it to the callback */
+		const auto payload = data.first(payload_length);
 
-		handler.OnControlPacket(control_server, command,
-					{payload_length > 0 ? payload : nullptr, payload_length},
-					fds,
-					address, uid);
+		/* this command is ok, pass it to the callback (unless
+		   it is a duplicate) */
 
-		payload_length = PadSize(payload_length);
+		if (!fds.empty() || !IsCoalescible(command) ||
+		    !CheckDuplicate(command, payload, uid))
+			handler.OnControlPacket(*this, command,
+						{payload_length > 0 ? payload.data() : nullptr, payload_length},
+						fds,
+						address, uid);
 
-		data = payload + payload_length;
-		length -= payload_length;
+		data = data.subspan(PadSize(payload_length));
 	}
 }
 
@@ -85,8 +138,12 @@ Server::OnUdpDatagram(std::span<const std::byte> payload,
 		      std::span<UniqueFileDescriptor> fds,
 		      SocketAddress address, int uid)
 try {
-	control_server_decode(*this, payload.data(), payload.size(),
-			      fds, address, uid, handler);
+	if (payload.empty())
+		/* end of file (or an empty datagram): there are no
+		   commands to decode */
+		return true;
+
+	Decode(payload, fds, address, uid);
 	return true;
 } catch (...) {
 	handler.OnControlError(std::current_exception());
@@ -4,13 +4,19 @@
 
 #pragma once
 
+#include "CachedReply.hxx"
 #include "net/control/Protocol.hxx"
 #include "event/net/UdpHandler.hxx"
-#include "event/net/UdpListener.hxx"
+#include "event/net/MultiUdpListener.hxx"
+#include "event/DeferEvent.hxx"
+#include "event/Loop.hxx"
+
+#include <string>
+#include <utility> // for std::forward()
+#include <unordered_set>
 
 class SocketAddress;
 class UniqueSocketDescriptor;
-class EventLoop;
 struct SocketConfig;
 
 namespace BengControl {
@@ -19,15 +25,34 @@ class Handler;
 
 /**
  * Server side part of the "control" protocol.
+ *
+ * Datagrams are received in batches with recvmmsg().  Duplicate
+ * invalidation commands (see IsCoalescible()) received within one
+ * event loop iteration are passed to the #Handler only once.
  */
 class Server final : UdpHandler {
 	Handler &handler;
 
-	UdpListener socket;
+	MultiUdpListener socket;
+
+	/**
+	 * Keys (command, uid and payload; see CheckDuplicate()) of
+	 * all coalescible commands which have been passed to the
+	 * #Handler in this event loop iteration.
+	 */
+	std::unordered_set<std::string> coalesce_keys;
+
+	/**
+	 * Clears #coalesce_keys in the next event loop iteration.
+	 */
+	DeferEvent coalesce_reset_event;
 
 public:
+	/**
+	 * Throws on error.
+	 */
 	Server(EventLoop &event_loop, UniqueSocketDescriptor s,
-	       Handler &_handler) noexcept;
+	       Handler &_handler);
 
 	Server(EventLoop &event_loop, Handler &_handler,
 	       const SocketConfig &config);
@@ -51,7 +76,48 @@ public:
 		   Command command,
 		   std::span<const std::byte> payload);
 
+	/**
+	 * Reply with a payload from the given #CachedReply,
+	 * regenerating it first if it has expired.
+	 *
+	 * Throws on error.
+	 *
+	 * @param serialize see CachedReply::Get()
+	 */
+	template<typename F>
+	void ReplyCached(SocketAddress address, Command command,
+			 CachedReply &cache, F &&serialize) {
+		Reply(address, command,
+		      cache.Get(GetEventLoop().SteadyNow(),
+				std::forward<F>(serialize)));
+	}
+
 private:
+	/**
+	 * Shall duplicates of this command be dropped?  This is
+	 * only true for idempotent commands where executing them
+	 * once has the same effect as executing them repeatedly.
+	 */
+	[[gnu::const]]
+	static bool IsCoalescible(Command command) noexcept;
+
+	/**
+	 * Was an identical command already handled in this event
+	 * loop iteration?  If not, remember it.
+	 *
+	 * Throws std::bad_alloc on out-of-memory.
+	 */
+	bool CheckDuplicate(Command command, std::span<const std::byte> payload,
+			    int uid);
+
+	void OnCoalesceReset() noexcept {
+		coalesce_keys.clear();
+	}
+
+	void Decode(std::span<const std::byte> data,
+		    std::span<UniqueFileDescriptor> fds,
+		    SocketAddress address, int uid);
+
 	/* virtual methods from class UdpHandler */
 	bool OnUdpDatagram(std::span<const std::byte> payload,
 			   std::span<UniqueFileDescriptor> fds,
@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "SpillSender.hxx"
+#include "event/Loop.hxx"
+#include "net/log/Send.hxx"
+#include "net/log/Serializer.hxx"
+#include "net/log/Parser.hxx"
+#include "net/log/Datagram.hxx"
+#include "net/SocketError.hxx"
+#include "time/Cast.hxx"
+
+#include <array>
+
+#include <sys/socket.h>
+
+namespace Net::Log {
+
+static constexpr Event::Duration DRAIN_INTERVAL = std::chrono::seconds{1};
+
+/**
+ * Is this a socket error which may go away by itself, i.e. shall the
+ * datagram be kept for retrying?
+ */
+[[gnu::const]]
+static bool
+IsTransientSendError(socket_error_t code) noexcept
+{
+	return IsSocketErrorSendWouldBlock(code) ||
+		code == ECONNREFUSED || code == ENOBUFS ||
+		code == EHOSTUNREACH || code == ENETUNREACH;
+}
+
+SpillSender::SpillSender(EventLoop &event_loop, SocketDescriptor _socket,
+			 const char *journal_path, std::size_t journal_size)
+	:socket(_socket),
+	 journal(journal_path, journal_size),
+	 drain_timer(event_loop, BIND_THIS_METHOD(OnDrainTimer))
+{
+	if (!journal.empty())
+		/* replay what was left over by the previous
+		   process */
+		drain_timer.Schedule(Event::Duration{});
+}
+
+void
+SpillSender::Spill(const Datagram &d) noexcept
+{
+	std::array<std::byte, 16384> buffer;
+
+	std::size_t size;
+	try {
+		size = Serialize(buffer.data(), buffer.size(), d);
+	} catch (BufferTooSmall) {
+		++n_dropped;
+		return;
+	}
+
+	if (!journal.Push(std::span{buffer}.first(size))) {
+		++n_dropped;
+		return;
+	}
+
+	++n_spilled;
+	drain_timer.ScheduleEarlier(DRAIN_INTERVAL);
+}
+
+void
+SpillSender::Send(const Datagram &d)
+{
+	if (!journal.empty()) {
+		/* don't overtake older datagrams */
+		Spill(d);
+		return;
+	}
+
+	try {
+		Net::Log::Send(socket, d);
+	} catch (const std::system_error &e) {
+		if (!IsSocketError(e) ||
+		    !IsTransientSendError(e.code().value()))
+			throw;
+
+		Spill(d);
+	}
+}
+
+inline Event::Duration
+SpillSender::Drain() noexcept
+{
+	const auto float_now = ToFloatSeconds(GetEventLoop().SteadyNow().time_since_epoch());
+
+	while (!journal.empty()) {
+		if (rate_limit > 0) {
+			const double available =
+				token_bucket.GetAvailable(float_now, rate_limit, burst);
+			if (available < 1)
+				/* wait until the next token is due */
+				return std::chrono::ceil<Event::Duration>(
+					std::chrono::duration<double>{(1 - available) / rate_limit});
+		}
+
+		const auto datagram = journal.Front();
+		if (datagram.data() == nullptr)
+			/* the journal was found to be corrupt and
+			   has been reset */
+			break;
+
+		try {
+			/* verify the CRC; a record damaged in the
+			   journal file will not be replayed */
+			ParseDatagram(datagram);
+		} catch (ProtocolError) {
+			++n_dropped;
+			journal.Pop();
+			continue;
+		}
+
+		if (socket.Send(datagram, MSG_DONTWAIT|MSG_NOSIGNAL) < 0) {
+			const auto code = GetSocketError();
+			if (IsTransientSendError(code))
+				/* retry later */
+				return DRAIN_INTERVAL;
+
+			/* this datagram cannot be sent at all */
+			++n_dropped;
+		} else {
+			/* only a datagram which was really sent
+			   consumes a token */
+			if (rate_limit > 0)
+				token_bucket.Update(float_now, rate_limit, burst, 1);
+
+			++n_replayed;
+		}
+
+		journal.Pop();
+	}
+
+	return DRAIN_INTERVAL;
+}
+
+void
+SpillSender::OnDrainTimer() noexcept
+{
+	const auto delay = Drain();
+
+	if (!journal.empty())
+		drain_timer.Schedule(delay);
+}
+
+} // namespace Net::Log
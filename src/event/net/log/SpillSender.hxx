@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "net/SocketDescriptor.hxx"
+#include "net/log/SpillJournal.hxx"
+#include "event/FineTimerEvent.hxx"
+#include "util/TokenBucket.hxx"
+
+#include <cstddef>
+
+namespace Net::Log {
+
+struct Datagram;
+
+/**
+ * Sends log datagrams to a Pond server like Net::Log::Send(), but
+ * if the socket would block or the server is unreachable, the
+ * datagram is stored in a #SpillJournal instead of being discarded.
+ * A timer replays the journal later, optionally limited by a token
+ * bucket, so a recovering server is not flooded.
+ *
+ * While the journal is not empty, new datagrams are appended to it
+ * to preserve their order.
+ */
+class SpillSender {
+	SocketDescriptor socket;
+
+	SpillJournal journal;
+
+	FineTimerEvent drain_timer;
+
+	TokenBucket token_bucket;
+
+	double rate_limit = -1, burst;
+
+	std::size_t n_spilled = 0, n_replayed = 0, n_dropped = 0;
+
+public:
+	/**
+	 * Throws if the journal file cannot be opened.
+	 *
+	 * @param _socket a datagram socket connected to a Pond server
+	 * (owned by caller)
+	 * @param journal_path the path of the #SpillJournal file
+	 * @param journal_size the size of the journal file in bytes
+	 */
+	SpillSender(EventLoop &event_loop, SocketDescriptor _socket,
+		    const char *journal_path, std::size_t journal_size);
+
+	EventLoop &GetEventLoop() const noexcept {
+		return drain_timer.GetEventLoop();
+	}
+
+	/**
+	 * Limit the rate of replayed datagrams.
+	 *
+	 * @param _rate_limit datagrams per second
+	 */
+	void SetRateLimit(double _rate_limit, double _burst) noexcept {
+		rate_limit = _rate_limit;
+		burst = _burst;
+	}
+
+	/**
+	 * Send a datagram or spill it into the journal.  This method
+	 * never blocks.
+	 *
+	 * Throws on (non-transient) error.
+	 */
+	void Send(const Datagram &d);
+
+	bool IsJournalEmpty() const noexcept {
+		return journal.empty();
+	}
+
+	/**
+	 * The number of datagrams which have been added to the
+	 * journal.
+	 */
+	std::size_t GetSpilledCount() const noexcept {
+		return n_spilled;
+	}
+
+	/**
+	 * The number of datagrams which have been replayed from the
+	 * journal.
+	 */
+	std::size_t GetReplayedCount() const noexcept {
+		return n_replayed;
+	}
+
+	/**
+	 * The number of datagrams which have been discarded because
+	 * the journal was full or because they were corrupt.
+	 */
+	std::size_t GetDroppedCount() const noexcept {
+		return n_dropped;
+	}
+
+private:
+	void Spill(const Datagram &d) noexcept;
+
+	/**
+	 * Replay datagrams from the journal until it is empty, the
+	 * socket would block or the rate limit is reached.
+	 *
+	 * @return the time to wait before the next attempt (only
+	 * meaningful if the journal is not empty)
+	 */
+	Event::Duration Drain() noexcept;
+
+	void OnDrainTimer() noexcept;
+};
+
+} // namespace Net::Log
@@ -5,8 +5,56 @@
 #include "Manager.hxx"
 #include "util/PrintException.hxx"
 
+#include <stdexcept>
+
 namespace Uring {
 
+/**
+ * Throws on error.
+ */
+static struct io_uring_params
+MakeParams(const ManagerConfig &config)
+{
+	if (config.sqpoll && config.coop_taskrun)
+		/* the kernel would fail with EINVAL */
+		throw std::runtime_error{"io_uring: sqpoll and coop_taskrun are mutually exclusive"};
+
+	struct io_uring_params params{};
+
+	if (config.cq_entries > 0) {
+		params.flags |= IORING_SETUP_CQSIZE;
+		params.cq_entries = config.cq_entries;
+	}
+
+	if (config.sqpoll) {
+		params.flags |= IORING_SETUP_SQPOLL;
+		params.sq_thread_idle = config.sqpoll_idle_ms;
+
+		if (config.sqpoll_cpu >= 0) {
+			params.flags |= IORING_SETUP_SQ_AFF;
+			params.sq_thread_cpu = config.sqpoll_cpu;
+		}
+	}
+
+	if (config.coop_taskrun)
+		params.flags |= IORING_SETUP_COOP_TASKRUN;
+
+	if (config.single_issuer)
+		params.flags |= IORING_SETUP_SINGLE_ISSUER;
+
+	return params;
+}
+
+Manager::Manager(EventLoop &event_loop, const ManagerConfig &config)
+	:Queue(config.entries, MakeParams(config)),
+	 event(event_loop, BIND_THIS_METHOD(OnReady),
+	       GetFileDescriptor()),
+	 defer_submit_event(event_loop,
+			    BIND_THIS_METHOD(DeferredSubmit))
+{
+	event.ScheduleRead();
+}
+
 void
 Manager::OnReady(unsigned) noexcept
 {
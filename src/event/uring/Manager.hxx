@@ -10,6 +10,57 @@
 
 namespace Uring {
 
+/**
+ * Setup parameters for #Manager.
+ */
+struct ManagerConfig {
+	/**
+	 * The size of the submission queue.
+	 */
+	unsigned entries = 1024;
+
+	/**
+	 * The size of the completion queue; 0 means the kernel
+	 * default (twice #entries).
+	 */
+	unsigned cq_entries = 0;
+
+	/**
+	 * Let a kernel thread poll the submission queue
+	 * (IORING_SETUP_SQPOLL), which saves the io_uring_enter()
+	 * system call for submissions while the thread is awake.
+	 */
+	bool sqpoll = false;
+
+	/**
+	 * Pin the SQPOLL thread to this CPU (IORING_SETUP_SQ_AFF);
+	 * -1 means no affinity.
+	 */
+	int sqpoll_cpu = -1;
+
+	/**
+	 * The SQPOLL thread goes to sleep after being idle for this
+	 * number of milliseconds; 0 means the kernel default.
+	 */
+	unsigned sqpoll_idle_ms = 0;
+
+	/**
+	 * Don't interrupt this thread for completions
+	 * (IORING_SETUP_COOP_TASKRUN, Linux 5.19).  Completions are
+	 * then only posted when the thread enters the kernel, which
+	 * is cheaper for busy event loops, but may add latency if it
+	 * is blocked in epoll_wait().  Not compatible with #sqpoll.
+	 */
+	bool coop_taskrun = false;
+
+	/**
+	 * Promise that only this thread submits
+	 * (IORING_SETUP_SINGLE_ISSUER, Linux 6.0), which allows the
+	 * kernel to skip some synchronization.
+	 */
+	bool single_issuer = false;
+};
+
 class Manager final : public Queue {
 	PipeEvent event;
 
@@ -33,6 +84,12 @@ public:
 		event.ScheduleRead();
 	}
 
+	/**
+	 * Throws on error, e.g. if the kernel does not support one
+	 * of the requested features.
+	 */
+	Manager(EventLoop &event_loop, const ManagerConfig &config);
+
 	void SetVolatile() noexcept {
 		volatile_event = true;
 		CheckVolatileEvent();
@@ -6,78 +6,297 @@
 #include "FileDescriptor.hxx"
 #include "lib/fmt/SystemError.hxx"
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
+#include <cstdint>
+
+#include <assert.h>
 
 #include <fcntl.h> // for posix_fadvise(), fallocate()
+#include <linux/fs.h> // for FICLONE
+#include <sys/ioctl.h>
+#include <unistd.h> // for lseek(), pread(), pwrite()
+
+namespace {
+
+class RegularFileCopy {
+	const FileDescriptor src, dst;
+	const off_t size;
+
+	const CopyRegularFileOptions &options;
+
+	/**
+	 * The position which was last reported to the progress
+	 * callback.
+	 */
+	off_t reported = 0;
+
+	enum class Method {
+		/**
+		 * copy_file_range() has not been tried yet.
+		 */
+		UNKNOWN,
+
+		COPY_FILE_RANGE,
+		READ_WRITE,
+	} method = Method::UNKNOWN;
+
+	bool sparse;
+
+public:
+	RegularFileCopy(FileDescriptor _src, FileDescriptor _dst, off_t _size,
+			const CopyRegularFileOptions &_options) noexcept
+		:src(_src), dst(_dst), size(_size), options(_options),
+		 sparse(options.sparse)
+	{
+		assert(options.chunk_size > 0);
+	}
+
+	/**
+	 * Throws on error.
+	 *
+	 * @return false if canceled
+	 */
+	bool Run();
+
+private:
+	/**
+	 * @return true if the file has been cloned, false if that is
+	 * not possible (no data has been copied)
+	 */
+	bool TryClone() noexcept {
+		return ioctl(dst.Get(), FICLONE, src.Get()) == 0;
+	}
+
+	/**
+	 * Throw if the source file is shorter than #size.  This is
+	 * needed where the end of the file is not detected by a
+	 * short read, i.e. with SEEK_DATA and FICLONE.
+	 *
+	 * @return the size of the source file
+	 */
+	off_t CheckSourceSize() const;
+
+	/**
+	 * Find the next data extent in the source file.  If
+	 * #sparse is disabled (or not supported), the rest of the file
+	 * is one extent.
+	 *
+	 * Throws on error.
+	 *
+	 * @return the start and end offset of the extent; both are
+	 * #size if there is no more data
+	 */
+	std::pair<off_t, off_t> FindData(off_t position);
+
+	/**
+	 * Throws on error.
+	 *
+	 * @return false if canceled
+	 */
+	bool CopyExtent(off_t position, off_t end);
+
+	/**
+	 * Copy (up to) the given number of bytes.
+	 *
+	 * Throws on error.
+	 *
+	 * @return the number of bytes copied (always positive)
+	 */
+	std::size_t CopyChunk(off_t position, std::size_t length);
+
+	std::size_t CopyChunkReadWrite(off_t position, std::size_t length);
+
+	/**
+	 * Switch to pread()/pwrite().
+	 */
+	void FallbackReadWrite() noexcept {
+		method = Method::READ_WRITE;
+
+		posix_fadvise(src.Get(), 0, size, POSIX_FADV_SEQUENTIAL);
 
-/**
- * Throws on error.
- *
- * @return true on success (all data has been copied), false if
- * copy_file_range() is not supported (no data has been copied)
- */
-static bool
-CopyFileRange(FileDescriptor src, FileDescriptor dst, off_t size)
+		if (!sparse)
+			fallocate(dst.Get(), FALLOC_FL_KEEP_SIZE, 0, size);
+	}
+
+	bool Progress(off_t position) noexcept {
+		reported = position;
+		return !options.progress || options.progress(position);
+	}
+};
+
+off_t
+RegularFileCopy::CheckSourceSize() const
+{
+	const off_t end = lseek(src.Get(), 0, SEEK_END);
+	if (end < 0)
+		throw MakeErrno("Failed to seek file");
+
+	if (end < size)
+		throw std::runtime_error{"Unexpected end of file"};
+
+	return end;
+}
+
+inline std::pair<off_t, off_t>
+RegularFileCopy::FindData(off_t position)
 {
-	/* check if copy_file_range() works */
-	auto nbytes = copy_file_range(src.Get(), nullptr, dst.Get(), nullptr,
-				      size, 0);
-	if (nbytes <= 0)
-		/* nah */
-		return false;
-
-	/* hooray, copy_file_range() works */
-	size -= nbytes;
-
-	while (size > 0) {
-		nbytes = copy_file_range(src.Get(), nullptr,
-					 dst.Get(), nullptr,
-					 size, 0);
-		if (nbytes <= 0) [[unlikely]] {
+	if (!sparse)
+		return {position, size};
+
+	const off_t data = lseek(src.Get(), position, SEEK_DATA);
+	if (data < 0) {
+		switch (const int e = errno; e) {
+		case ENXIO:
+			/* the rest of the file is a hole, or we're
+			   at the end of the file */
+			CheckSourceSize();
+			return {size, size};
+
+		case EINVAL:
+			/* SEEK_DATA not supported */
+			sparse = false;
+			return {position, size};
+
+		default:
+			throw MakeErrno(e, "Failed to seek file");
+		}
+	}
+
+	if (data >= size)
+		return {size, size};
+
+	const off_t hole = lseek(src.Get(), data, SEEK_HOLE);
+	if (hole < 0)
+		throw MakeErrno("Failed to seek file");
+
+	return {data, std::min(hole, size)};
+}
+
+inline std::size_t
+RegularFileCopy::CopyChunkReadWrite(off_t position, std::size_t length)
+{
+	std::array<std::byte, 65536> buffer;
+	const auto nbytes1 = pread(src.Get(), buffer.data(),
+				   std::min(length, buffer.size()),
+				   position);
+	if (nbytes1 <= 0) [[unlikely]] {
+		if (nbytes1 == 0)
+			throw std::runtime_error{"Unexpected end of file"};
+
+		throw MakeErrno("Failed to read file");
+	}
+
+	const auto nbytes2 = pwrite(dst.Get(), buffer.data(), nbytes1,
+				    position);
+	if (nbytes2 < nbytes1) [[unlikely]] {
+		if (nbytes2 < 0)
+			throw MakeErrno("Failed to write file");
+
+		throw std::runtime_error{"Short write"};
+	}
+
+	return nbytes2;
+}
+
+inline std::size_t
+RegularFileCopy::CopyChunk(off_t position, std::size_t length)
+{
+	if (method != Method::READ_WRITE) {
+		off_t in_offset = position, out_offset = position;
+		const auto nbytes = copy_file_range(src.Get(), &in_offset,
+						    dst.Get(), &out_offset,
+						    length, 0);
+		if (nbytes > 0) [[likely]] {
+			method = Method::COPY_FILE_RANGE;
+			return nbytes;
+		}
+
+		if (method == Method::COPY_FILE_RANGE) [[unlikely]] {
 			if (nbytes == 0)
 				throw std::runtime_error{"Unexpected end of file"};
 
 			throw MakeErrno("Failed to copy file data");
 		}
 
-		size -= nbytes;
+		/* copy_file_range() does not work for these files
+		   (e.g. EXDEV, or 0 from a pseudo filesystem) */
+		FallbackReadWrite();
+	}
+
+	return CopyChunkReadWrite(position, length);
+}
+
+inline bool
+RegularFileCopy::CopyExtent(off_t position, off_t end)
+{
+	while (position < end) {
+		const std::size_t length =
+			std::min<uint_least64_t>(end - position,
+						 options.chunk_size);
+		position += CopyChunk(position, length);
+
+		if (!Progress(position))
+			return false;
 	}
 
 	return true;
 }
 
-void
-CopyRegularFile(FileDescriptor src, FileDescriptor dst, off_t size)
+bool
+RegularFileCopy::Run()
 {
-	if (size <= 0)
-		return;
+	if (options.reflink && TryClone()) {
+		/* FICLONE has cloned the whole source file; cut off
+		   everything after the requested size */
+		if (CheckSourceSize() > size &&
+		    ftruncate(dst.Get(), size) < 0)
+			throw MakeErrno("Failed to truncate file");
 
-	if (CopyFileRange(src, dst, size))
-		return;
+		/* the copy is already complete; cancellation is not
+		   possible anymore */
+		Progress(size);
+		return true;
+	}
 
-	posix_fadvise(src.Get(), 0, size, POSIX_FADV_SEQUENTIAL);
+	off_t position = 0;
+	while (position < size) {
+		const auto [data, hole] = FindData(position);
+		if (data >= size)
+			break;
 
-	fallocate(dst.Get(), FALLOC_FL_KEEP_SIZE, 0, size);
+		if (!CopyExtent(data, hole))
+			return false;
 
-	while (size > 0) {
-		std::array<std::byte, 65536> buffer;
-		const auto nbytes1 = src.Read(buffer);
-		if (nbytes1 <= 0) [[unlikely]] {
-			if (nbytes1 == 0)
-				throw std::runtime_error{"Unexpected end of file"};
+		position = hole;
+	}
 
-			throw MakeErrno("Failed to read file");
-		}
+	/* extend the file to its full size if it ends with a hole */
+	if (sparse && ftruncate(dst.Get(), size) < 0)
+		throw MakeErrno("Failed to truncate file");
 
-		ssize_t nbytes2 = dst.Write(std::span<const std::byte>{buffer}.first(nbytes1));
-		if (nbytes2 < nbytes1) [[unlikely]] {
-			if (nbytes2 < 0)
-				throw MakeErrno("Failed to write file");
+	if (reported < size)
+		Progress(size);
 
-			throw std::runtime_error{"Short write"};
-		}
+	return true;
+}
 
-		size -= nbytes2;
-	}
+} // anonymous namespace
+
+bool
+CopyRegularFile(FileDescriptor src, FileDescriptor dst, off_t size,
+		const CopyRegularFileOptions &options)
+{
+	if (size <= 0)
+		return true;
+
+	RegularFileCopy copy{src, dst, size, options};
+	return copy.Run();
+}
+
+void
+CopyRegularFile(FileDescriptor src, FileDescriptor dst, off_t size)
+{
+	CopyRegularFile(src, dst, size, CopyRegularFileOptions{});
 }
@@ -4,12 +4,75 @@
 
 #pragma once
 
+#include "util/BindMethod.hxx"
+
+#include <cstddef>
+
 #include <sys/types.h> // for off_t
 
 class FileDescriptor;
 
+struct CopyRegularFileOptions {
+	/**
+	 * Invoked after each chunk with the number of bytes processed
+	 * so far (including skipped holes).  Return false to cancel
+	 * the copy.
+	 *
+	 * The callback is invoked in the calling thread.  To copy
+	 * from an #EventLoop, run CopyRegularFile() in a #ThreadJob
+	 * and let this callback publish the progress and check an
+	 * atomic cancellation flag.
+	 */
+	using ProgressCallback = BoundMethod<bool(off_t position) noexcept>;
+
+	ProgressCallback progress = nullptr;
+
+	/**
+	 * The maximum number of bytes copied between two progress
+	 * callback invocations.
+	 */
+	std::size_t chunk_size = 16 * 1024 * 1024;
+
+	/**
+	 * Attempt to share all data blocks with the source file (ioctl
+	 * FICLONE, i.e. a "reflink") before copying?  This is only
+	 * possible within one filesystem which supports it (e.g.
+	 * btrfs, XFS).
+	 */
+	bool reflink = true;
+
+	/**
+	 * Skip holes in the source file (SEEK_DATA/SEEK_HOLE), leaving
+	 * holes in the destination file?  If enabled, the
+	 * destination file must be empty.
+	 */
+	bool sparse = true;
+};
+
+/**
+ * Copy all data from one file to the other.  The destination file
+ * should be empty.
+ *
+ * The copy engine tries these methods, in this order:
+ *
+ * - clone the whole file (see CopyRegularFileOptions::reflink)
+ * - copy the data extents (see CopyRegularFileOptions::sparse) with
+ *   copy_file_range(), which lets the kernel/filesystem pick the
+ *   best method (e.g. server-side copy on NFS)
+ * - copy the data extents with pread()/pwrite()
+ *
+ * Throws on error.
+ *
+ * @return true on success, false if the progress callback has
+ * canceled the copy (the destination file is incomplete)
+ */
+bool
+CopyRegularFile(FileDescriptor src, FileDescriptor dst, off_t size,
+		const CopyRegularFileOptions &options);
+
 /**
- * Copy all data from one file to the other.
+ * Copy all data from one file to the other (with the default
+ * #CopyRegularFileOptions).
  *
  * Throws on error.
  */
@@ -8,12 +8,15 @@
 #include "MakeDirectory.hxx"
 #include "DirectoryReader.hxx"
 #include "Open.hxx"
+#include "thread/ParallelWorkQueue.hxx"
 #include "lib/fmt/RuntimeError.hxx"
 #include "lib/fmt/SystemError.hxx"
 
 #include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <string>
 
 #include <errno.h>
 #include <fcntl.h>
@@ -237,10 +240,19 @@ CopySymlink(FileDescriptor src_parent, const char *src_filename,
 	CreateSymlink(dst_parent, dst_filename, buffer, overwrite);
 }
 
-static void
-RecursiveCopy(RecursiveCopyContext &ctx,
-	      FileDescriptor src_parent, const char *src_filename,
-	      FileDescriptor dst_parent, const char *dst_filename)
+/**
+ * Open the source file and obtain its attributes.  Symlinks are
+ * copied right away.
+ *
+ * @return the source file or an undefined file descriptor if there
+ * is nothing more to do (the source is a symlink or is on a
+ * different filesystem)
+ */
+static UniqueFileDescriptor
+OpenSource(RecursiveCopyContext &ctx,
+	   FileDescriptor src_parent, const char *src_filename,
+	   FileDescriptor dst_parent, const char *dst_filename,
+	   struct statx &stx)
 {
 	UniqueFileDescriptor src;
 
@@ -254,7 +266,7 @@ RecursiveCopy(RecursiveCopyContext &ctx,
 			CopySymlink(src_parent, src_filename,
 				    dst_parent, dst_filename,
 				    ctx.overwrite);
-			return;
+			return {};
 
 		default:
 			throw FmtErrno(e, "Failed to open {:?}",
@@ -262,7 +274,6 @@ RecursiveCopy(RecursiveCopyContext &ctx,
 		}
 	}
 
-	struct statx stx;
 	if (statx(src.Get(), "",
 		  AT_EMPTY_PATH|AT_SYMLINK_NOFOLLOW|AT_STATX_SYNC_AS_STAT,
 		  ctx.statx_mask, &stx) < 0)
@@ -276,10 +287,23 @@ RecursiveCopy(RecursiveCopyContext &ctx,
 		else if (stx.stx_mnt_id != ctx.mnt_id)
 			/* this is on a different device (filesystem);
 			   ignore it */
-			return;
+			return {};
 	}
 
-	RecursiveCopy(ctx, std::move(src), stx, dst_parent, dst_filename);
+	return src;
+}
+
+static void
+RecursiveCopy(RecursiveCopyContext &ctx,
+	      FileDescriptor src_parent, const char *src_filename,
+	      FileDescriptor dst_parent, const char *dst_filename)
+{
+	struct statx stx;
+	auto src = OpenSource(ctx, src_parent, src_filename,
+			      dst_parent, dst_filename, stx);
+	if (src.IsDefined())
+		RecursiveCopy(ctx, std::move(src), stx,
+			      dst_parent, dst_filename);
 }
 
 void
@@ -292,3 +316,183 @@ RecursiveCopy(FileDescriptor src_parent, const char *src_filename,
 		      src_parent, src_filename,
 		      dst_parent, dst_filename);
 }
+
+/**
+ * A directory being copied by ParallelRecursiveCopy().  It is freed
+ * (and its attributes are preserved) after its own contents and all
+ * queued subdirectories have been copied.
+ */
+struct ParallelCopyDirectory {
+	ParallelCopyDirectory *const parent;
+
+	/**
+	 * The number of unfinished tasks: copying this directory's
+	 * entries plus one for each queued subdirectory.
+	 */
+	std::atomic_uint pending{1};
+
+	/**
+	 * The source directory; it is closed after all entries have
+	 * been read.
+	 */
+	UniqueFileDescriptor src;
+
+	UniqueFileDescriptor dst;
+
+	const struct statx stx;
+
+	/**
+	 * The destination name (for error messages).
+	 */
+	const std::string dst_filename;
+
+	ParallelCopyDirectory(ParallelCopyDirectory *_parent,
+			      UniqueFileDescriptor &&_src,
+			      const struct statx &_stx,
+			      UniqueFileDescriptor &&_dst,
+			      const char *_dst_filename) noexcept
+		:parent(_parent),
+		 src(std::move(_src)), dst(std::move(_dst)),
+		 stx(_stx), dst_filename(_dst_filename) {}
+};
+
+struct ParallelCopy {
+	RecursiveCopyContext ctx;
+
+	/**
+	 * Each queued directory holds two file descriptors; if there
+	 * are more than this number already, subdirectories are
+	 * copied synchronously.
+	 */
+	static constexpr std::size_t MAX_QUEUED = 256;
+
+	ParallelWorkQueue<ParallelCopyDirectory *> queue{MAX_QUEUED};
+
+	explicit ParallelCopy(unsigned options) noexcept
+		:ctx(options) {}
+
+	void Process(ParallelCopyDirectory *dir) noexcept;
+
+private:
+	void CopyEntries(ParallelCopyDirectory &dir);
+	void Release(ParallelCopyDirectory *dir) noexcept;
+};
+
+inline void
+ParallelCopy::CopyEntries(ParallelCopyDirectory &dir)
+{
+	DirectoryReader src{std::move(dir.src)};
+
+	while (auto *name = src.Read()) {
+		if (IsSpecialFilename(name))
+			continue;
+
+		if (queue.IsFailed())
+			break;
+
+		struct statx stx;
+		auto child_src = OpenSource(ctx, src.GetFileDescriptor(), name,
+					    dir.dst, name, stx);
+		if (!child_src.IsDefined())
+			continue;
+
+		if (!S_ISDIR(stx.stx_mode)) {
+			RecursiveCopy(ctx, std::move(child_src), stx,
+				      dir.dst, name);
+			continue;
+		}
+
+		auto *child = new ParallelCopyDirectory(&dir, std::move(child_src),
+							stx,
+							MakeDirectory(dir.dst, name),
+							name);
+		/* increment before pushing, because another thread
+		   may finish (and release) the new item right away */
+		++dir.pending;
+
+		bool queued;
+		try {
+			queued = queue.TryPush(std::move(child));
+		} catch (...) {
+			/* not queued; this cannot drop the counter to
+			   zero, because this task is still running */
+			--dir.pending;
+			delete child;
+			throw;
+		}
+
+		if (!queued)
+			Process(child);
+	}
+}
+
+inline void
+ParallelCopy::Release(ParallelCopyDirectory *dir) noexcept
+{
+	while (dir != nullptr && --dir->pending == 0) {
+		if (!queue.IsFailed()) {
+			try {
+				Preserve(ctx, dir->stx, dir->dst,
+					 dir->dst_filename.c_str());
+			} catch (...) {
+				queue.Fail(std::current_exception());
+			}
+		}
+
+		auto *parent = dir->parent;
+		delete dir;
+		dir = parent;
+	}
+}
+
+void
+ParallelCopy::Process(ParallelCopyDirectory *dir) noexcept
+{
+	if (!queue.IsFailed()) {
+		try {
+			CopyEntries(*dir);
+		} catch (...) {
+			queue.Fail(std::current_exception());
+		}
+	}
+
+	Release(dir);
+}
+
+void
+ParallelRecursiveCopy(FileDescriptor src_parent, const char *src_filename,
+		      FileDescriptor dst_parent, const char *dst_filename,
+		      unsigned options, unsigned n_threads)
+{
+	ParallelCopy pc{options};
+
+	struct statx stx;
+	auto src = OpenSource(pc.ctx, src_parent, src_filename,
+			      dst_parent, dst_filename, stx);
+	if (!src.IsDefined())
+		return;
+
+	if (!S_ISDIR(stx.stx_mode)) {
+		RecursiveCopy(pc.ctx, std::move(src), stx,
+			      dst_parent, dst_filename);
+		return;
+	}
+
+	UniqueFileDescriptor dst;
+	if (*dst_filename == 0) {
+		dst = dst_parent.Duplicate();
+		if (!dst.IsDefined())
+			throw MakeErrno("Failed to duplicate file descriptor");
+
+		dst_filename = "?";
+	} else
+		dst = MakeDirectory(dst_parent, dst_filename);
+
+	auto *root = new ParallelCopyDirectory(nullptr, std::move(src), stx,
+					       std::move(dst), dst_filename);
+
+	pc.queue.Push(std::move(root));
+	pc.queue.Run(n_threads, [&pc](ParallelCopyDirectory *dir){
+		pc.Process(dir);
+	});
+}
@@ -47,3 +47,20 @@ void
 RecursiveCopy(FileDescriptor src_parent, const char *src_filename,
 	      FileDescriptor dst_parent, const char *dst_filename,
 	      unsigned options=0);
+
+/**
+ * Like RecursiveCopy(), but copy subdirectories concurrently in
+ * several threads.  This is faster for large trees, especially on
+ * storage with high latency or parallelism.
+ *
+ * If an error occurs, the remaining work is canceled and the first
+ * error is thrown; other threads may have copied more files by then
+ * than RecursiveCopy() would have.
+ *
+ * @param n_threads the number of threads (including the calling
+ * thread); 0 means one per CPU
+ */
+void
+ParallelRecursiveCopy(FileDescriptor src_parent, const char *src_filename,
+		      FileDescriptor dst_parent, const char *dst_filename,
+		      unsigned options=0, unsigned n_threads=0);
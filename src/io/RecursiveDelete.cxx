@@ -6,8 +6,12 @@
 #include "DirectoryReader.hxx"
 #include "Open.hxx"
 #include "UniqueFileDescriptor.hxx"
+#include "thread/ParallelWorkQueue.hxx"
 #include "lib/fmt/SystemError.hxx"
 
+#include <atomic>
+#include <string>
+
 #include <fcntl.h>
 #include <unistd.h>
 
@@ -28,11 +32,12 @@ ClearDirectory(UniqueFileDescriptor &&fd)
 			RecursiveDelete(r.GetFileDescriptor(), child);
 }
 
+/**
+ * Remove an empty directory.
+ */
 static void
-RecursiveDeleteDirectory(FileDescriptor parent, const char *filename)
+RemoveDirectory(FileDescriptor parent, const char *filename)
 {
-	ClearDirectory(OpenDirectory(parent, filename, O_NOFOLLOW));
-
 	if (unlinkat(parent.Get(), filename, AT_REMOVEDIR) == 0)
 		return;
 
@@ -46,6 +51,13 @@ RecursiveDeleteDirectory(FileDescriptor parent, const char *filename)
 	}
 }
 
+static void
+RecursiveDeleteDirectory(FileDescriptor parent, const char *filename)
+{
+	ClearDirectory(OpenDirectory(parent, filename, O_NOFOLLOW));
+	RemoveDirectory(parent, filename);
+}
+
 void
 RecursiveDelete(FileDescriptor parent, const char *filename)
 {
@@ -66,3 +78,169 @@ RecursiveDelete(FileDescriptor parent, const char *filename)
 		throw FmtErrno(e, "Failed to delete {}", filename);
 	}
 }
+
+/**
+ * A directory being deleted by ParallelRecursiveDelete().  It is
+ * removed (and freed) after all of its entries and all queued
+ * subdirectories have been deleted.
+ */
+struct ParallelDeleteDirectory {
+	ParallelDeleteDirectory *const parent;
+
+	/**
+	 * The number of unfinished tasks: deleting this directory's
+	 * entries plus one for each queued subdirectory.
+	 */
+	std::atomic_uint pending{1};
+
+	/**
+	 * The directory which contains this one.  This is either the
+	 * one owned by #parent or the one passed to
+	 * ParallelRecursiveDelete().
+	 */
+	const FileDescriptor parent_fd;
+
+	/**
+	 * This directory; it stays open until all queued
+	 * subdirectories have been removed from it.
+	 */
+	DirectoryReader reader;
+
+	const std::string name;
+
+	ParallelDeleteDirectory(ParallelDeleteDirectory *_parent,
+				FileDescriptor _parent_fd,
+				UniqueFileDescriptor &&fd,
+				const char *_name)
+		:parent(_parent), parent_fd(_parent_fd),
+		 reader(std::move(fd)), name(_name) {}
+};
+
+struct ParallelDelete {
+	/**
+	 * Each queued directory holds a file descriptor; if there are
+	 * more than this number already, subdirectories are deleted
+	 * synchronously.
+	 */
+	static constexpr std::size_t MAX_QUEUED = 512;
+
+	ParallelWorkQueue<ParallelDeleteDirectory *> queue{MAX_QUEUED};
+
+	void Process(ParallelDeleteDirectory *dir) noexcept;
+
+private:
+	void DeleteEntries(ParallelDeleteDirectory &dir);
+	void Release(ParallelDeleteDirectory *dir) noexcept;
+};
+
+inline void
+ParallelDelete::DeleteEntries(ParallelDeleteDirectory &dir)
+{
+	const FileDescriptor fd = dir.reader.GetFileDescriptor();
+
+	while (const char *child = dir.reader.Read()) {
+		if (IsSpecialFilename(child))
+			continue;
+
+		if (queue.IsFailed())
+			break;
+
+		if (unlinkat(fd.Get(), child, 0) == 0)
+			continue;
+
+		switch (const int e = errno; e) {
+		case EISDIR:
+			break;
+
+		case ENOENT:
+			continue;
+
+		default:
+			throw FmtErrno(e, "Failed to delete {}", child);
+		}
+
+		auto *sub = new ParallelDeleteDirectory(&dir, fd,
+							OpenDirectory(fd, child,
+								      O_NOFOLLOW),
+							child);
+		/* increment before pushing, because another thread
+		   may finish (and release) the new item right away */
+		++dir.pending;
+
+		bool queued;
+		try {
+			queued = queue.TryPush(std::move(sub));
+		} catch (...) {
+			/* not queued; this cannot drop the counter to
+			   zero, because this task is still running */
+			--dir.pending;
+			delete sub;
+			throw;
+		}
+
+		if (!queued)
+			Process(sub);
+	}
+}
+
+inline void
+ParallelDelete::Release(ParallelDeleteDirectory *dir) noexcept
+{
+	while (dir != nullptr && --dir->pending == 0) {
+		if (!queue.IsFailed()) {
+			try {
+				RemoveDirectory(dir->parent_fd, dir->name.c_str());
+			} catch (...) {
+				queue.Fail(std::current_exception());
+			}
+		}
+
+		auto *parent = dir->parent;
+		delete dir;
+		dir = parent;
+	}
+}
+
+void
+ParallelDelete::Process(ParallelDeleteDirectory *dir) noexcept
+{
+	if (!queue.IsFailed()) {
+		try {
+			DeleteEntries(*dir);
+		} catch (...) {
+			queue.Fail(std::current_exception());
+		}
+	}
+
+	Release(dir);
+}
+
+void
+ParallelRecursiveDelete(FileDescriptor parent, const char *filename,
+			unsigned n_threads)
+{
+	if (unlinkat(parent.Get(), filename, 0) == 0)
+		return;
+
+	switch (const int e = errno; e) {
+	case EISDIR:
+		/* switch to directory mode */
+		break;
+
+	case ENOENT:
+		/* does not exist, nothing to do */
+		return;
+
+	default:
+		throw FmtErrno(e, "Failed to delete {}", filename);
+	}
+
+	ParallelDelete pd;
+	pd.queue.Push(new ParallelDeleteDirectory(nullptr, parent,
+						  OpenDirectory(parent, filename,
+								O_NOFOLLOW),
+						  filename));
+	pd.queue.Run(n_threads, [&pd](ParallelDeleteDirectory *dir){
+		pd.Process(dir);
+	});
+}
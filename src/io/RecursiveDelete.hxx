@@ -13,3 +13,17 @@ class FileDescriptor;
  */
 void
 RecursiveDelete(FileDescriptor parent, const char *filename);
+
+/**
+ * Like RecursiveDelete(), but clear subdirectories concurrently in
+ * several threads.
+ *
+ * If an error occurs, the remaining work is canceled and the first
+ * error is thrown.
+ *
+ * @param n_threads the number of threads (including the calling
+ * thread); 0 means one per CPU
+ */
+void
+ParallelRecursiveDelete(FileDescriptor parent, const char *filename,
+			unsigned n_threads=0);
@@ -8,15 +8,27 @@
 #include "io/FileAt.hxx"
 #include "io/Open.hxx"
 #include "io/UniqueFileDescriptor.hxx"
+#include "system/linux/listmount.h"
+#include "system/linux/statmount.h"
 #include "util/IterableSplitString.hxx"
+#include "util/StringSplit.hxx"
 
 #include <fmt/format.h>
 
 #include <array>
+#include <atomic>
+#include <charconv>
+#include <optional>
+#include <vector>
 
+#include <errno.h>
 #include <fcntl.h> // for AT_*
 #include <sys/stat.h> // for statx()
 
+#ifndef STATX_MNT_ID_UNIQUE
+#define STATX_MNT_ID_UNIQUE 0x00004000U
+#endif
+
 using std::string_view_literals::operator""sv;
 
 template<std::size_t N>
@@ -142,9 +154,367 @@ public:
 	}
 };
 
+#ifdef STATMOUNT_SB_SOURCE
+
+/**
+ * Cleared when statmount() or listmount() turn out to be
+ * unavailable (or lacking features we need).
+ */
+static std::atomic_bool use_mount_syscalls{true};
+
+/**
+ * The attributes needed to fill a #MountInfo.
+ */
+static constexpr uint_least64_t STATMOUNT_MOUNT_INFO =
+	STATMOUNT_MNT_BASIC|STATMOUNT_MNT_ROOT|STATMOUNT_MNT_POINT|
+	STATMOUNT_FS_TYPE|STATMOUNT_FS_SUBTYPE|STATMOUNT_SB_SOURCE;
+
+/**
+ * Called after statmount() or listmount() have failed.  If they are
+ * not implemented, they will not be used again.
+ */
+static void
+OnMountSyscallError(int e) noexcept
+{
+	if (e == ENOSYS)
+		use_mount_syscalls.store(false, std::memory_order_relaxed);
+}
+
+/**
+ * A buffer for statmount() results.  It grows as needed.
+ */
+class StatMountBuffer {
+	/* uint64_t for alignment */
+	std::vector<uint_least64_t> buffer = std::vector<uint_least64_t>(512);
+
+public:
+	/**
+	 * @return the result or nullptr on error (with errno set)
+	 */
+	const struct statmount *Query(uint_least64_t mnt_id,
+				      uint_least64_t mask) noexcept {
+		const struct mnt_id_req req{
+			.size = sizeof(req),
+			.spare = 0,
+			.mnt_id = mnt_id,
+			.param = mask,
+		};
+
+		while (true) {
+			auto *sm = reinterpret_cast<struct statmount *>(buffer.data());
+			if (do_statmount(&req, sm,
+					 buffer.size() * sizeof(buffer.front()), 0) == 0)
+				return sm;
+
+			if (errno != EOVERFLOW)
+				return nullptr;
+
+			buffer.resize(buffer.size() * 2);
+		}
+	}
+};
+
+/**
+ * Look up a string in the variable-size part of a statmount()
+ * result.
+ */
+static const char *
+GetString(const struct statmount &sm, uint_least32_t offset) noexcept
+{
+	return reinterpret_cast<const char *>(&sm + 1) + offset;
+}
+
+/**
+ * Convert a statmount() result to a #MountInfo.
+ *
+ * @return the #MountInfo or std::nullopt if the kernel did not
+ * provide all attributes
+ */
+static std::optional<MountInfo>
+ToMountInfo(const struct statmount &sm) noexcept
+{
+	constexpr uint_least64_t required = STATMOUNT_MOUNT_INFO & ~STATMOUNT_FS_SUBTYPE;
+	if ((sm.mask & required) != required) {
+		/* this kernel is too old */
+		use_mount_syscalls.store(false, std::memory_order_relaxed);
+		return std::nullopt;
+	}
+
+	/* like /proc/PID/mountinfo, append the subtype (e.g. "fuse.sshfs") */
+	std::string filesystem{GetString(sm, sm.fs_type)};
+	if ((sm.mask & STATMOUNT_FS_SUBTYPE) != 0) {
+		if (const char *subtype = GetString(sm, sm.fs_subtype);
+		    *subtype != 0) {
+			filesystem.push_back('.');
+			filesystem.append(subtype);
+		}
+	}
+
+	const char *source = GetString(sm, sm.sb_source);
+	if (*source == 0)
+		/* this is what /proc/PID/mountinfo shows */
+		source = "none";
+
+	return MountInfo{
+		sm.mnt_id_old,
+		GetString(sm, sm.mnt_root),
+		std::move(filesystem),
+		source,
+	};
+}
+
+/**
+ * Invoke a function for each mount id (the unique 64 bit id, not
+ * the one shown in /proc/PID/mountinfo) in the current mount
+ * namespace until it returns true.
+ *
+ * @return false if listmount() has failed
+ */
+template<typename F>
+static bool
+ForEachMountId(F &&f)
+{
+	struct mnt_id_req req{
+		.size = sizeof(req),
+		.spare = 0,
+		.mnt_id = LSMT_ROOT,
+		.param = 0,
+	};
+
+	std::array<__u64, 256> ids;
+
+	while (true) {
+		const int n = listmount(&req, ids.data(), ids.size(), 0);
+		if (n < 0) {
+			OnMountSyscallError(errno);
+			return false;
+		}
+
+		for (int i = 0; i < n; ++i)
+			if (f(ids[i]))
+				return true;
+
+		if (static_cast<std::size_t>(n) < ids.size())
+			return true;
+
+		/* continue after the last one */
+		req.param = ids.back();
+	}
+}
+
+/**
+ * Find the first mount whose statmount() result (only the given
+ * attributes) matches the given predicate.
+ *
+ * @return the #MountInfo (undefined if not found) or std::nullopt
+ * if the caller shall fall back to /proc/PID/mountinfo
+ */
+template<typename P>
+static std::optional<MountInfo>
+StatMountFind(uint_least64_t mask, P &&predicate)
+{
+	StatMountBuffer buffer;
+	std::optional<MountInfo> result;
+	bool found = false, failed = false;
+
+	const bool success = ForEachMountId([&](uint_least64_t id){
+		const auto *sm = buffer.Query(id, mask);
+		if (sm == nullptr) {
+			if (errno == ENOENT)
+				/* was just unmounted */
+				return false;
+
+			OnMountSyscallError(errno);
+			failed = true;
+			return true;
+		}
+
+		if (!predicate(*sm))
+			return false;
+
+		sm = buffer.Query(id, STATMOUNT_MOUNT_INFO);
+		if (sm == nullptr) {
+			if (errno == ENOENT)
+				return false;
+
+			OnMountSyscallError(errno);
+			failed = true;
+			return true;
+		}
+
+		found = true;
+		result = ToMountInfo(*sm);
+		return true;
+	});
+
+	if (!success || failed)
+		return std::nullopt;
+
+	if (!found)
+		return MountInfo{};
+
+	/* std::nullopt if ToMountInfo() has failed */
+	return result;
+}
+
+/**
+ * Obtain the unique mount id of the given path.
+ *
+ * @return the mount id or 0 on error
+ */
+static uint_least64_t
+GetUniqueMountId(FileAt path, int flags=0) noexcept
+{
+	struct statx stx;
+	if (statx(path.directory.Get(), path.name,
+		  AT_EMPTY_PATH|AT_SYMLINK_NOFOLLOW|flags,
+		  STATX_MNT_ID_UNIQUE, &stx) < 0 ||
+	    (stx.stx_mask & STATX_MNT_ID_UNIQUE) == 0)
+		return 0;
+
+	return stx.stx_mnt_id;
+}
+
+/**
+ * Query the #MountInfo of the mount with the given unique id.
+ *
+ * @return the #MountInfo (undefined if there is no such mount) or
+ * std::nullopt if the caller shall fall back to
+ * /proc/PID/mountinfo
+ */
+static std::optional<MountInfo>
+StatMountById(StatMountBuffer &buffer, uint_least64_t id) noexcept
+{
+	const auto *sm = buffer.Query(id, STATMOUNT_MOUNT_INFO);
+	if (sm == nullptr) {
+		if (errno == ENOENT)
+			return MountInfo{};
+
+		OnMountSyscallError(errno);
+		return std::nullopt;
+	}
+
+	return ToMountInfo(*sm);
+}
+
+static std::optional<MountInfo>
+StatMountReadMount(const char *mountpoint)
+{
+	/* only the mount id is needed: don't trigger an automount
+	   (the caller wants to know what is mounted there now) and
+	   don't let network filesystems revalidate attributes */
+	const uint_least64_t id =
+		GetUniqueMountId(FileAt{FileDescriptor{AT_FDCWD}, mountpoint},
+				 AT_NO_AUTOMOUNT|AT_STATX_DONT_SYNC);
+	if (id == 0)
+		return std::nullopt;
+
+	StatMountBuffer buffer;
+	const auto *sm = buffer.Query(id, STATMOUNT_MOUNT_INFO);
+	if (sm == nullptr) {
+		OnMountSyscallError(errno);
+		return std::nullopt;
+	}
+
+	if (std::string_view{GetString(*sm, sm->mnt_point)} != mountpoint)
+		/* the path is inside this mount, but it is not the
+		   mount point */
+		return MountInfo{};
+
+	return ToMountInfo(*sm);
+}
+
+/*
+ * The kernel has no way to look up a mount by its device number or
+ * by its old (non-unique) mount id; statmount() rejects old ids
+ * with EINVAL.  These lookups therefore need to scan all mounts
+ * with a minimal attribute mask.  With many mounts, this measured
+ * about as fast as parsing /proc/PID/mountinfo, sometimes somewhat
+ * faster.
+ */
+
+static std::optional<MountInfo>
+StatMountFindByDevice(std::string_view device)
+{
+	const auto [major_s, minor_s] = Split(device, ':');
+
+	unsigned major, minor;
+	if (std::from_chars(major_s.data(), major_s.data() + major_s.size(), major).ec != std::errc{} ||
+	    std::from_chars(minor_s.data(), minor_s.data() + minor_s.size(), minor).ec != std::errc{})
+		/* let the old code deal with malformed strings */
+		return std::nullopt;
+
+	return StatMountFind(STATMOUNT_SB_BASIC,
+			     [major, minor](const struct statmount &sm){
+				     return sm.sb_dev_major == major &&
+					     sm.sb_dev_minor == minor;
+			     });
+}
+
+/**
+ * Unique mount ids (STATX_MNT_ID_UNIQUE) start at this value; all
+ * smaller values are old mount ids.
+ */
+static constexpr uint_least64_t MNT_UNIQUE_ID_OFFSET = 1ULL << 31;
+
+static std::optional<MountInfo>
+StatMountFindById(uint_least64_t mnt_id)
+{
+	if (mnt_id > MNT_UNIQUE_ID_OFFSET) {
+		StatMountBuffer buffer;
+		return StatMountById(buffer, mnt_id);
+	}
+
+	return StatMountFind(STATMOUNT_MNT_BASIC,
+			     [mnt_id](const struct statmount &sm){
+				     return sm.mnt_id_old == mnt_id;
+			     });
+}
+
+static std::optional<MountInfo>
+StatMountFindByPath(FileAt path)
+{
+	const uint_least64_t id = GetUniqueMountId(path);
+	if (id == 0)
+		return std::nullopt;
+
+	StatMountBuffer buffer;
+	auto result = StatMountById(buffer, id);
+	if (result && !result->IsDefined())
+		/* was just unmounted; let the old code deal with
+		   it */
+		return std::nullopt;
+
+	return result;
+}
+
+static bool
+UseMountSyscalls(unsigned pid) noexcept
+{
+	/* statmount() and listmount() only see our own mount
+	   namespace */
+	return pid == 0 && use_mount_syscalls.load(std::memory_order_relaxed);
+}
+
+#endif // STATMOUNT_SB_SOURCE
+
+void
+DisableMountInfoSyscalls() noexcept
+{
+#ifdef STATMOUNT_SB_SOURCE
+	use_mount_syscalls.store(false, std::memory_order_relaxed);
+#endif
+}
+
 MountInfo
 ReadProcessMount(unsigned pid, const char *_mountpoint)
 {
+#ifdef STATMOUNT_SB_SOURCE
+	if (UseMountSyscalls(pid))
+		if (auto result = StatMountReadMount(_mountpoint))
+			return std::move(*result);
+#endif
+
 	const std::string_view mountpoint(_mountpoint);
 
 	for (const auto &i : MountInfoReader{pid})
@@ -157,6 +527,12 @@ ReadProcessMount(unsigned pid, const char *_mountpoint)
 MountInfo
 FindMountInfoByDevice(unsigned pid, const char *_device)
 {
+#ifdef STATMOUNT_SB_SOURCE
+	if (UseMountSyscalls(pid))
+		if (auto result = StatMountFindByDevice(_device))
+			return std::move(*result);
+#endif
+
 	const std::string_view device{_device};
 
 	for (const auto &i : MountInfoReader{pid})
@@ -169,6 +545,12 @@ FindMountInfoByDevice(unsigned pid, const char *_device)
 MountInfo
 FindMountInfoById(unsigned pid, const uint_least64_t mnt_id)
 {
+#ifdef STATMOUNT_SB_SOURCE
+	if (UseMountSyscalls(pid))
+		if (auto result = StatMountFindById(mnt_id))
+			return std::move(*result);
+#endif
+
 	const fmt::format_int mnt_id_buffer{mnt_id};
 	const std::string_view mnt_id_s{
 		mnt_id_buffer.data(),
@@ -185,6 +567,12 @@ FindMountInfoById(unsigned pid, const uint_least64_t mnt_id)
 MountInfo
 FindMountInfoByPath(FileAt path)
 {
+#ifdef STATMOUNT_SB_SOURCE
+	if (UseMountSyscalls(0))
+		if (auto result = StatMountFindByPath(path))
+			return std::move(*result);
+#endif
+
 	struct statx stx;
 	if (statx(path.directory.Get(), path.name,
 		  AT_EMPTY_PATH|AT_SYMLINK_NOFOLLOW|AT_STATX_SYNC_AS_STAT,
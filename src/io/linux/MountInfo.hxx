@@ -36,6 +36,21 @@ struct MountInfo {
 	}
 };
 
+/*
+ * If the kernel supports statmount() and listmount() (Linux 6.13 or
+ * newer), the functions below use them to query the current
+ * process's mount namespace (pid=0); otherwise, and for other
+ * processes, they parse /proc/PID/mountinfo.
+ */
+
+/**
+ * Never use statmount() and listmount(); always parse
+ * /proc/PID/mountinfo.  This is mostly useful for testing and
+ * benchmarking.
+ */
+void
+DisableMountInfoSyscalls() noexcept;
+
 /**
  * Determine which file system is mounted at the given mount point
  * path (exact match required).
@@ -70,7 +85,10 @@ FindMountInfoByDevice(unsigned pid, const char *major_minor);
  * @param pid a process id or 0 to obtain information about the
  * current process
  *
- * @param mnt_id a mount id
+ * @param mnt_id a mount id as shown in /proc/PID/mountinfo
+ * (#MountInfo::mnt_id); if statmount() is available, this may also
+ * be a unique mount id (STATX_MNT_ID_UNIQUE), which is looked up
+ * directly instead of scanning all mounts
  */
 MountInfo
 FindMountInfoById(unsigned pid, const uint_least64_t mnt_id);
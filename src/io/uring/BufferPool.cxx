@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "BufferPool.hxx"
+#include "Queue.hxx"
+#include "memory/SlicePool.hxx"
+
+#include <sys/uio.h>
+
+namespace Uring {
+
+RegisteredBufferPool::RegisteredBufferPool(Queue &queue,
+					   SlicePool &slice_pool,
+					   unsigned n)
+	:ring(queue.GetRing())
+{
+	assert(n > 0);
+
+	allocations.reserve(n);
+	free_indices.reserve(n);
+
+	std::vector<struct iovec> iov;
+	iov.reserve(n);
+
+	for (unsigned i = 0; i < n; ++i) {
+		auto &a = allocations.emplace_back(slice_pool.Alloc());
+		iov.push_back({a.data, a.size});
+	}
+
+	ring.RegisterBuffers(iov);
+
+	/* hand out the lowest indices first */
+	for (unsigned i = n; i > 0;)
+		free_indices.push_back(--i);
+}
+
+RegisteredBufferPool::~RegisteredBufferPool() noexcept
+{
+	assert(free_indices.size() == allocations.size());
+
+	ring.UnregisterBuffers();
+}
+
+} // namespace Uring
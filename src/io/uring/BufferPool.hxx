@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "memory/SliceAllocation.hxx"
+
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include <utility>
+#include <vector>
+
+class SlicePool;
+
+namespace Uring {
+
+class Ring;
+class Queue;
+class RegisteredBufferPool;
+
+/**
+ * A buffer obtained from a #RegisteredBufferPool.  It is returned to
+ * the pool when this object is destroyed.  Pass GetIndex() to
+ * #CoReadFixed / #CoWriteFixed.
+ */
+class RegisteredBuffer {
+	RegisteredBufferPool *pool = nullptr;
+
+	std::span<std::byte> buffer;
+
+	unsigned index;
+
+public:
+	RegisteredBuffer() noexcept = default;
+
+	RegisteredBuffer(RegisteredBufferPool &_pool,
+			 std::span<std::byte> _buffer,
+			 unsigned _index) noexcept
+		:pool(&_pool), buffer(_buffer), index(_index) {}
+
+	RegisteredBuffer(RegisteredBuffer &&src) noexcept
+		:pool(std::exchange(src.pool, nullptr)),
+		 buffer(src.buffer), index(src.index) {}
+
+	~RegisteredBuffer() noexcept {
+		if (pool != nullptr)
+			Release();
+	}
+
+	RegisteredBuffer &operator=(RegisteredBuffer &&src) noexcept {
+		using std::swap;
+		swap(pool, src.pool);
+		swap(buffer, src.buffer);
+		swap(index, src.index);
+		return *this;
+	}
+
+	operator bool() const noexcept {
+		return pool != nullptr;
+	}
+
+	/**
+	 * The index of this buffer in the registered buffer table.
+	 */
+	unsigned GetIndex() const noexcept {
+		assert(pool != nullptr);
+
+		return index;
+	}
+
+	std::span<std::byte> GetBuffer() const noexcept {
+		assert(pool != nullptr);
+
+		return buffer;
+	}
+
+private:
+	void Release() noexcept;
+};
+
+/**
+ * A pool of equally-sized buffers which are registered with an
+ * io_uring (IORING_REGISTER_BUFFERS), allowing the kernel to skip
+ * pinning and mapping the pages for each read/write operation.
+ *
+ * The buffers are allocated from a #SlicePool once, in the
+ * constructor, because changing the registration is expensive.
+ * Only one instance may exist per io_uring.
+ */
+class RegisteredBufferPool {
+	friend class RegisteredBuffer;
+
+	Ring &ring;
+
+	std::vector<SliceAllocation> allocations;
+
+	/**
+	 * A stack of indices of buffers which are not in use.
+	 */
+	std::vector<unsigned> free_indices;
+
+public:
+	/**
+	 * Throws on error.
+	 *
+	 * @param n the number of buffers; each is as large as one
+	 * slice of the #SlicePool
+	 */
+	RegisteredBufferPool(Queue &queue, SlicePool &slice_pool, unsigned n);
+
+	/**
+	 * All #RegisteredBuffer instances must have been destructed
+	 * before this object, and no operation may be using them.
+	 */
+	~RegisteredBufferPool() noexcept;
+
+	RegisteredBufferPool(const RegisteredBufferPool &) = delete;
+	RegisteredBufferPool &operator=(const RegisteredBufferPool &) = delete;
+
+	std::size_t GetBufferSize() const noexcept {
+		return allocations.front().size;
+	}
+
+	std::size_t GetFreeCount() const noexcept {
+		return free_indices.size();
+	}
+
+	/**
+	 * Obtain a buffer.
+	 *
+	 * @return the buffer or an empty instance if all buffers are
+	 * in use
+	 */
+	RegisteredBuffer Get() noexcept {
+		if (free_indices.empty())
+			return {};
+
+		const unsigned index = free_indices.back();
+		free_indices.pop_back();
+
+		const auto &a = allocations[index];
+		return {*this, {(std::byte *)a.data, a.size}, index};
+	}
+
+private:
+	void Put(unsigned index) noexcept {
+		assert(index < allocations.size());
+		assert(free_indices.size() < allocations.size());
+
+		free_indices.push_back(index);
+	}
+};
+
+inline void
+RegisteredBuffer::Release() noexcept
+{
+	pool->Put(index);
+}
+
+} // namespace Uring
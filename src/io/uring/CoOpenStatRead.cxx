@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "CoOpenStatRead.hxx"
+#include "FixedFiles.hxx"
+#include "Operation.hxx"
+#include "Queue.hxx"
+#include "system/Error.hxx"
+
+#include <stdexcept>
+
+#include <fcntl.h>
+
+namespace Uring {
+
+class CoOpenStatRead::State final {
+	class Step final : public Operation {
+		State &state;
+
+	public:
+		int result;
+
+		explicit Step(State &_state) noexcept
+			:state(_state) {}
+
+	private:
+		/* virtual methods from class Uring::Operation */
+		void OnUringCompletion(int res) noexcept override {
+			result = res;
+			state.OnStepCompletion();
+		}
+	};
+
+	/**
+	 * The object which awaits the result, or nullptr if it has
+	 * been destroyed.
+	 */
+	CoOpenStatRead *parent;
+
+	FixedFileTable &files;
+
+public:
+	Step open_step{*this}, statx_step{*this}, read_step{*this};
+
+	struct statx stx;
+
+	unsigned slot;
+
+private:
+	unsigned n_pending = 3;
+
+	/**
+	 * Has TakeValue() taken over the slot?
+	 */
+	bool taken = false;
+
+public:
+	State(CoOpenStatRead &_parent, FixedFileTable &_files,
+	      unsigned _slot) noexcept
+		:parent(&_parent), files(_files), slot(_slot) {}
+
+	FixedFileTable &GetFiles() const noexcept {
+		return files;
+	}
+
+	bool IsReady() const noexcept {
+		return n_pending == 0;
+	}
+
+	void SetTaken() noexcept {
+		taken = true;
+	}
+
+	/**
+	 * The #CoOpenStatRead is being destroyed.  Delete this
+	 * object, or let it delete itself after the last
+	 * completion.
+	 */
+	void Abandon() noexcept {
+		if (!IsReady()) {
+			parent = nullptr;
+			return;
+		}
+
+		ReleaseSlot();
+		delete this;
+	}
+
+private:
+	/**
+	 * Release the slot unless TakeValue() has taken it over.
+	 */
+	void ReleaseSlot() noexcept {
+		if (taken)
+			return;
+
+		if (open_step.result >= 0)
+			files.Remove(slot);
+		else
+			files.FreeSlot(slot);
+	}
+
+	void OnStepCompletion() noexcept {
+		if (--n_pending > 0)
+			return;
+
+		if (parent == nullptr) {
+			ReleaseSlot();
+			delete this;
+			return;
+		}
+
+		parent->OnCompletion();
+	}
+};
+
+CoOpenStatRead::CoOpenStatRead(Queue &queue, FixedFileTable &files,
+			       FileAt file, std::span<std::byte> dest,
+			       unsigned mask)
+{
+	const int slot = files.AllocateSlot();
+	if (slot < 0)
+		throw std::runtime_error{"No free io_uring file slot"};
+
+	/* the chain must not be split by Queue::Submit() */
+	try {
+		queue.ReserveSubmitEntries(3);
+	} catch (...) {
+		files.FreeSlot(slot);
+		throw;
+	}
+
+	state = new State(*this, files, slot);
+
+	auto &open_sqe = *queue.GetSubmitEntry();
+	io_uring_prep_openat_direct(&open_sqe, file.directory.Get(), file.name,
+				    O_RDONLY|O_NOCTTY|O_CLOEXEC, 0, slot);
+	open_sqe.flags |= IOSQE_IO_LINK;
+	queue.PushWithoutSubmit(open_sqe, state->open_step);
+
+	/* IORING_OP_STATX does not support fixed files, therefore
+	   this uses the path; thanks to the link, it runs after the
+	   file has been opened */
+	auto &statx_sqe = *queue.GetSubmitEntry();
+	io_uring_prep_statx(&statx_sqe, file.directory.Get(), file.name,
+			    AT_STATX_SYNC_AS_STAT, mask, &state->stx);
+	statx_sqe.flags |= IOSQE_IO_LINK;
+	queue.PushWithoutSubmit(statx_sqe, state->statx_step);
+
+	auto &read_sqe = *queue.GetSubmitEntry();
+	io_uring_prep_read(&read_sqe, slot, dest.data(), dest.size(), 0);
+	read_sqe.flags |= IOSQE_FIXED_FILE;
+	queue.Push(read_sqe, state->read_step);
+}
+
+CoOpenStatRead::~CoOpenStatRead() noexcept
+{
+	state->Abandon();
+}
+
+bool
+CoOpenStatRead::IsReady() const noexcept
+{
+	return state->IsReady();
+}
+
+CoOpenStatRead::Result
+CoOpenStatRead::TakeValue()
+{
+	auto &files = state->GetFiles();
+	const unsigned slot = state->slot;
+
+	/* from here on, the slot is released by this method (on
+	   error) or by the caller */
+	state->SetTaken();
+
+	if (state->open_step.result < 0) {
+		files.FreeSlot(slot);
+		throw MakeErrno(-state->open_step.result, "Failed to open file");
+	}
+
+	if (state->statx_step.result < 0) {
+		files.Remove(slot);
+		throw MakeErrno(-state->statx_step.result, "Failed to stat file");
+	}
+
+	if (state->read_step.result < 0) {
+		files.Remove(slot);
+		throw MakeErrno(-state->read_step.result, "Failed to read file");
+	}
+
+	return {slot, state->stx, std::size_t(state->read_step.result)};
+}
+
+} // namespace Uring
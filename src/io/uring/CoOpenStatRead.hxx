@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "co/AwaitableHelper.hxx"
+#include "io/FileAt.hxx"
+
+#include <cstddef>
+#include <span>
+
+#include <sys/stat.h>
+
+namespace Uring {
+
+class Queue;
+class FixedFileTable;
+
+/**
+ * Open a file, obtain its metadata and read the beginning of its
+ * contents with one chain of linked io_uring operations (openat,
+ * statx, read).  All three are submitted at once, i.e. there is no
+ * round trip between the steps, and if one fails, the following ones
+ * are canceled by the kernel.
+ *
+ * The file is opened "direct" into a slot of the #FixedFileTable
+ * (requires Linux 5.15), which allows further reads with
+ * IOSQE_FIXED_FILE.  On success, the caller owns that slot and must
+ * call FixedFileTable::Remove().
+ *
+ * The awaitable throws on error.
+ *
+ * This object may be destroyed before the operations have finished
+ * (e.g. when the awaiting coroutine is canceled); the state which
+ * the kernel writes to then stays alive until all completions have
+ * arrived, and the slot is released.  The #Queue must not be
+ * destroyed before that.
+ */
+class CoOpenStatRead final {
+	class State;
+
+	/**
+	 * Allocated on the heap, because it may outlive this object.
+	 */
+	State *state;
+
+	std::coroutine_handle<> continuation;
+
+	using Awaitable = Co::AwaitableHelper<CoOpenStatRead, false>;
+	friend Awaitable;
+
+public:
+	struct Result {
+		/**
+		 * The #FixedFileTable slot containing the file.
+		 */
+		unsigned slot;
+
+		struct statx stx;
+
+		/**
+		 * The number of bytes read into the buffer.
+		 */
+		std::size_t nbytes;
+	};
+
+	/**
+	 * Throws on error (e.g. if the #FixedFileTable is full).
+	 *
+	 * @param dest the buffer for the beginning of the file; it
+	 * must remain valid until the operation has finished, even
+	 * if this object is destroyed earlier
+	 * @param mask the statx() mask
+	 */
+	CoOpenStatRead(Queue &queue, FixedFileTable &files,
+		       FileAt file, std::span<std::byte> dest,
+		       unsigned mask=STATX_TYPE|STATX_MODE|STATX_SIZE|STATX_MTIME);
+
+	~CoOpenStatRead() noexcept;
+
+	CoOpenStatRead(const CoOpenStatRead &) = delete;
+	CoOpenStatRead &operator=(const CoOpenStatRead &) = delete;
+
+	Awaitable operator co_await() noexcept {
+		return *this;
+	}
+
+private:
+	void OnCompletion() noexcept {
+		if (continuation)
+			continuation.resume();
+	}
+
+	bool IsReady() const noexcept;
+
+	Result TakeValue();
+};
+
+} // namespace Uring
@@ -130,4 +130,62 @@ CoWriteOperation::GetValue(int value) const
 	return value;
 }
 
+CoReadvOperation::CoReadvOperation(struct io_uring_sqe &s,
+				   FileDescriptor fd,
+				   std::span<const struct iovec> dest,
+				   off_t offset, int flags) noexcept
+{
+	io_uring_prep_readv(&s, fd.Get(), dest.data(), dest.size(), offset);
+	s.flags = flags;
+}
+
+std::size_t
+CoReadvOperation::GetValue(int value) const
+{
+	if (value < 0)
+		throw MakeErrno(-value, "Failed to read");
+
+	return value;
+}
+
+CoReadFixedOperation::CoReadFixedOperation(struct io_uring_sqe &s,
+					   FileDescriptor fd,
+					   std::span<std::byte> dest,
+					   unsigned buffer_index,
+					   off_t offset, int flags) noexcept
+{
+	io_uring_prep_read_fixed(&s, fd.Get(), dest.data(), dest.size(),
+				 offset, buffer_index);
+	s.flags = flags;
+}
+
+std::size_t
+CoReadFixedOperation::GetValue(int value) const
+{
+	if (value < 0)
+		throw MakeErrno(-value, "Failed to read");
+
+	return value;
+}
+
+CoWriteFixedOperation::CoWriteFixedOperation(struct io_uring_sqe &s,
+					     FileDescriptor fd,
+					     std::span<const std::byte> src,
+					     unsigned buffer_index,
+					     off_t offset, int flags) noexcept
+{
+	io_uring_prep_write_fixed(&s, fd.Get(), src.data(), src.size(),
+				  offset, buffer_index);
+	s.flags = flags;
+}
+
+std::size_t
+CoWriteFixedOperation::GetValue(int value) const
+{
+	if (value < 0)
+		throw MakeErrno(-value, "Failed to write");
+
+	return value;
+}
+
 } // namespace Uring
@@ -14,6 +14,7 @@
 #include <sys/types.h>
 
 struct io_uring_sqe;
+struct iovec;
 class FileDescriptor;
 class UniqueFileDescriptor;
 
@@ -116,6 +117,13 @@ public:
 
 using CoClose = CoOperation<CoCloseOperation>;
 
+/*
+ * The following read/write operations accept a #FileDescriptor;
+ * to use a file registered in a #FixedFileTable, pass the slot
+ * index (see FixedFileTable::GetFileDescriptor()) and add
+ * IOSQE_FIXED_FILE to the flags.
+ */
+
 class CoReadOperation final {
 public:
 	CoReadOperation(struct io_uring_sqe &sqe, FileDescriptor fd,
@@ -138,4 +146,54 @@ public:
 
 using CoWrite = CoOperation<CoWriteOperation>;
 
+/**
+ * Read into multiple buffers (like preadv()).  The #iovec array
+ * must remain valid until the operation has been submitted.
+ */
+class CoReadvOperation final {
+public:
+	CoReadvOperation(struct io_uring_sqe &sqe, FileDescriptor fd,
+			 std::span<const struct iovec> dest,
+			 off_t offset, int flags=0) noexcept;
+
+	std::size_t GetValue(int value) const;
+};
+
+using CoReadv = CoOperation<CoReadvOperation>;
+
+/**
+ * Read into a registered buffer (see #RegisteredBufferPool).
+ *
+ * @param buffer_index the index of the registered buffer
+ * containing #dest
+ */
+class CoReadFixedOperation final {
+public:
+	CoReadFixedOperation(struct io_uring_sqe &sqe, FileDescriptor fd,
+			     std::span<std::byte> dest, unsigned buffer_index,
+			     off_t offset, int flags=0) noexcept;
+
+	std::size_t GetValue(int value) const;
+};
+
+using CoReadFixed = CoOperation<CoReadFixedOperation>;
+
+/**
+ * Write from a registered buffer (see #RegisteredBufferPool).
+ *
+ * @param buffer_index the index of the registered buffer
+ * containing #src
+ */
+class CoWriteFixedOperation final {
+public:
+	CoWriteFixedOperation(struct io_uring_sqe &sqe, FileDescriptor fd,
+			      std::span<const std::byte> src,
+			      unsigned buffer_index,
+			      off_t offset, int flags=0) noexcept;
+
+	std::size_t GetValue(int value) const;
+};
+
+using CoWriteFixed = CoOperation<CoWriteFixedOperation>;
+
 } // namespace Uring
@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "FixedFiles.hxx"
+#include "Queue.hxx"
+
+namespace Uring {
+
+FixedFileTable::FixedFileTable(Queue &queue, unsigned n)
+	:ring(queue.GetRing()), n_slots(n)
+{
+	assert(n > 0);
+
+	ring.RegisterFilesSparse(n);
+
+	free_slots.reserve(n);
+	for (unsigned i = n; i > 0;)
+		free_slots.push_back(--i);
+}
+
+FixedFileTable::~FixedFileTable() noexcept
+{
+	ring.UnregisterFiles();
+}
+
+int
+FixedFileTable::Add(FileDescriptor fd)
+{
+	const int slot = AllocateSlot();
+	if (slot < 0)
+		return -1;
+
+	const int fds[] = {fd.Get()};
+
+	try {
+		ring.UpdateFiles(slot, fds);
+	} catch (...) {
+		FreeSlot(slot);
+		throw;
+	}
+
+	return slot;
+}
+
+void
+FixedFileTable::Remove(unsigned slot) noexcept
+{
+	static constexpr int fds[] = {-1};
+
+	try {
+		ring.UpdateFiles(slot, fds);
+	} catch (...) {
+		/* this can only fail if the slot is invalid, which
+		   is a bug */
+		assert(false);
+	}
+
+	FreeSlot(slot);
+}
+
+} // namespace Uring
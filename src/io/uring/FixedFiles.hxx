@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "io/FileDescriptor.hxx"
+
+#include <cassert>
+#include <vector>
+
+namespace Uring {
+
+class Ring;
+class Queue;
+
+/**
+ * Manages the registered file table of an io_uring
+ * (IORING_REGISTER_FILES).  Operations on registered ("fixed")
+ * files skip the file descriptor lookup and reference counting in
+ * the kernel, which helps with descriptors that are used by many
+ * operations.
+ *
+ * To use a slot, pass GetFileDescriptor(slot) as file descriptor
+ * and IOSQE_FIXED_FILE in the SQE flags.
+ *
+ * Only one instance may exist per io_uring.
+ */
+class FixedFileTable {
+	Ring &ring;
+
+	/**
+	 * A stack of slots which are not in use.
+	 */
+	std::vector<unsigned> free_slots;
+
+	const unsigned n_slots;
+
+public:
+	/**
+	 * Register a sparse file table (requires Linux 5.19).
+	 *
+	 * Throws on error.
+	 */
+	FixedFileTable(Queue &queue, unsigned n);
+
+	~FixedFileTable() noexcept;
+
+	FixedFileTable(const FixedFileTable &) = delete;
+	FixedFileTable &operator=(const FixedFileTable &) = delete;
+
+	static constexpr FileDescriptor GetFileDescriptor(unsigned slot) noexcept {
+		return FileDescriptor(slot);
+	}
+
+	/**
+	 * Register a file descriptor.  The kernel holds its own
+	 * reference, i.e. the caller may close the file descriptor
+	 * afterwards.
+	 *
+	 * Throws on error.
+	 *
+	 * @return the slot or -1 if the table is full
+	 */
+	int Add(FileDescriptor fd);
+
+	/**
+	 * Allocate a slot for io_uring_prep_openat_direct() (see
+	 * #CoOpenStatRead).  The kernel installs the file there;
+	 * Remove() must be called when it is no longer needed.
+	 *
+	 * @return the slot or -1 if the table is full
+	 */
+	int AllocateSlot() noexcept {
+		if (free_slots.empty())
+			return -1;
+
+		const unsigned slot = free_slots.back();
+		free_slots.pop_back();
+		return slot;
+	}
+
+	/**
+	 * Unregister a file (closing the kernel's reference) and
+	 * free the slot.
+	 */
+	void Remove(unsigned slot) noexcept;
+
+	/**
+	 * Free a slot which is known to be empty (e.g. because
+	 * io_uring_prep_openat_direct() has failed).
+	 */
+	void FreeSlot(unsigned slot) noexcept {
+		assert(slot < n_slots);
+		assert(free_slots.size() < n_slots);
+
+		free_slots.push_back(slot);
+	}
+};
+
+} // namespace Uring
@@ -15,6 +15,11 @@ Queue::Queue(unsigned entries, unsigned flags)
 {
 }
 
+Queue::Queue(unsigned entries, const struct io_uring_params &params)
+	:ring(entries, params)
+{
+}
+
 Queue::~Queue() noexcept
 {
 	operations.clear_and_dispose(DeleteDisposer{});
@@ -27,16 +32,34 @@ Queue::RequireSubmitEntry()
 	if (sqe == nullptr) {
 		/* the submit queue is full; submit it to the kernel
 		   and try again */
-		ring.Submit();
-
-		sqe = GetSubmitEntry();
-		if (sqe == nullptr)
-			throw std::runtime_error{"io_uring_get_sqe() failed"};
+		++stats.n_sq_full;
+		SubmitNow();
+
+		/* with SQPOLL, the kernel thread may not have
+		   consumed any entries yet */
+		while ((sqe = GetSubmitEntry()) == nullptr)
+			if (!ring.WaitSubmitSpace())
+				throw std::runtime_error{"io_uring_get_sqe() failed"};
 	}
 
 	return *sqe;
 }
 
+void
+Queue::ReserveSubmitEntries(unsigned n)
+{
+	if (ring.GetSubmitSpace() < n) {
+		++stats.n_sq_full;
+		SubmitNow();
+
+		/* with SQPOLL, the kernel thread may not have
+		   consumed enough entries yet */
+		while (ring.GetSubmitSpace() < n)
+			if (!ring.WaitSubmitSpace())
+				throw std::runtime_error{"io_uring submit queue is too small"};
+	}
+}
+
 void
 Queue::AddPending(struct io_uring_sqe &sqe,
 		  Operation &operation) noexcept
@@ -46,18 +69,62 @@ Queue::AddPending(struct io_uring_sqe &sqe,
 	io_uring_sqe_set_data(&sqe, c);
 }
 
-void
-Queue::DispatchOneCompletion(struct io_uring_cqe &cqe) noexcept
+inline void
+Queue::DispatchCompletion(void *data, int res) noexcept
 {
-	void *data = io_uring_cqe_get_data(&cqe);
+	++stats.n_completions;
+
 	if (data != nullptr) {
 		auto *c = (CancellableOperation *)data;
-		c->OnUringCompletion(cqe.res);
+		c->OnUringCompletion(res);
 		c->unlink();
 		delete c;
 	}
+}
 
+void
+Queue::DispatchOneCompletion(struct io_uring_cqe &cqe) noexcept
+{
+	void *data = io_uring_cqe_get_data(&cqe);
+	const int res = cqe.res;
+
+	/* mark the entry as seen before invoking the handler,
+	   because the handler may dispatch more completions */
 	ring.SeenCompletion(cqe);
+
+	DispatchCompletion(data, res);
+}
+
+void
+Queue::DispatchCompletions() noexcept
+{
+	static constexpr unsigned BATCH_SIZE = 64;
+
+	while (true) {
+		struct io_uring_cqe *cqes[BATCH_SIZE];
+		const unsigned n = ring.PeekBatchCompletions(cqes);
+		if (n == 0)
+			break;
+
+		/* copy the relevant fields and release all entries
+		   at once; this also makes it safe for handlers to
+		   dispatch more completions */
+		struct {
+			void *data;
+			int res;
+		} completions[BATCH_SIZE];
+
+		for (unsigned i = 0; i < n; ++i)
+			completions[i] = {io_uring_cqe_get_data(cqes[i]), cqes[i]->res};
+
+		ring.AdvanceCompletions(n);
+
+		for (unsigned i = 0; i < n; ++i)
+			DispatchCompletion(completions[i].data, completions[i].res);
+
+		if (n < BATCH_SIZE)
+			break;
+	}
 }
 
 bool
@@ -9,11 +9,36 @@
 
 #include <liburing.h>
 
+#include <cstdint>
+
 namespace Uring {
 
 class Operation;
 class CancellableOperation;
 
+struct QueueStats {
+	/**
+	 * The number of io_uring_submit() calls.
+	 */
+	uint_least64_t n_submit_calls = 0;
+
+	/**
+	 * The number of submitted entries.
+	 */
+	uint_least64_t n_submitted = 0;
+
+	/**
+	 * The number of dispatched completions.
+	 */
+	uint_least64_t n_completions = 0;
+
+	/**
+	 * The number of times the submit queue was full and had to be
+	 * submitted early.
+	 */
+	uint_least64_t n_sq_full = 0;
+};
+
 /**
  * High-level C++ wrapper for a `struct io_uring`.  It supports a
  * handler class, cancellation, ...
@@ -23,14 +48,34 @@ class Queue {
 
 	IntrusiveList<CancellableOperation> operations;
 
+	QueueStats stats;
+
 public:
 	Queue(unsigned entries, unsigned flags);
+
+	/**
+	 * @see Ring::Ring(unsigned, const struct io_uring_params &)
+	 */
+	Queue(unsigned entries, const struct io_uring_params &params);
+
 	~Queue() noexcept;
 
+	const QueueStats &GetStats() const noexcept {
+		return stats;
+	}
+
 	FileDescriptor GetFileDescriptor() const noexcept {
 		return ring.GetFileDescriptor();
 	}
 
+	/**
+	 * Access to the low-level #Ring, e.g. to register buffers
+	 * or files.
+	 */
+	Ring &GetRing() noexcept {
+		return ring;
+	}
+
 	struct io_uring_sqe *GetSubmitEntry() noexcept {
 		return ring.GetSubmitEntry();
 	}
@@ -43,6 +88,16 @@ public:
 	 */
 	struct io_uring_sqe &RequireSubmitEntry();
 
+	/**
+	 * Ensure that the submit queue has room for the given number
+	 * of entries, submitting the queue if necessary.  This is
+	 * needed before preparing a chain of linked entries, because
+	 * a chain must not be split by Submit().
+	 *
+	 * May throw exceptions if Submit() fails.
+	 */
+	void ReserveSubmitEntries(unsigned n);
+
 	bool HasPending() const noexcept {
 		return !operations.empty();
 	}
@@ -58,15 +113,27 @@ public:
 		Submit();
 	}
 
+	/**
+	 * Like Push(), but don't submit.  This is used to prepare a
+	 * chain of linked entries; the caller invokes Push() for the
+	 * last one.
+	 */
+	void PushWithoutSubmit(struct io_uring_sqe &sqe,
+			       Operation &operation) noexcept {
+		AddPending(sqe, operation);
+	}
+
 	virtual void Submit() {
-		ring.Submit();
+		SubmitNow();
 	}
 
 	bool DispatchOneCompletion();
 
-	void DispatchCompletions() {
-		while (DispatchOneCompletion()) {}
-	}
+	/**
+	 * Dispatch all completions which are available now.  They
+	 * are obtained from the kernel in batches.
+	 */
+	void DispatchCompletions() noexcept;
 
 	bool WaitDispatchOneCompletion();
 
@@ -74,8 +141,19 @@ public:
 		while (WaitDispatchOneCompletion()) {}
 	}
 
+protected:
+	/**
+	 * Submit all prepared entries to the kernel now (unlike
+	 * Submit(), which may be overridden to defer this).
+	 */
+	void SubmitNow() {
+		++stats.n_submit_calls;
+		stats.n_submitted += ring.Submit();
+	}
+
 private:
 	void DispatchOneCompletion(struct io_uring_cqe &cqe) noexcept;
+	void DispatchCompletion(void *data, int res) noexcept;
 };
 
 } // namespace Uring
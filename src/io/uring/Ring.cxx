@@ -14,12 +14,61 @@ Ring::Ring(unsigned entries, unsigned flags)
 		throw MakeErrno(-error, "io_uring_queue_init() failed");
 }
 
-void
+Ring::Ring(unsigned entries, const struct io_uring_params &_params)
+{
+	/* io_uring_queue_init_params() writes into the struct */
+	auto params = _params;
+	int error = io_uring_queue_init_params(entries, &ring, &params);
+	if (error < 0)
+		throw MakeErrno(-error, "io_uring_queue_init_params() failed");
+}
+
+unsigned
 Ring::Submit()
 {
-	int error = io_uring_submit(&ring);
+	int result = io_uring_submit(&ring);
+	if (result < 0)
+		throw MakeErrno(-result, "io_uring_submit() failed");
+
+	return result;
+}
+
+bool
+Ring::WaitSubmitSpace()
+{
+	if ((ring.flags & IORING_SETUP_SQPOLL) == 0)
+		return false;
+
+	int result = io_uring_sqring_wait(&ring);
+	if (result < 0)
+		throw MakeErrno(-result, "io_uring_sqring_wait() failed");
+
+	return true;
+}
+
+void
+Ring::RegisterBuffers(std::span<const struct iovec> iov)
+{
+	int error = io_uring_register_buffers(&ring, iov.data(), iov.size());
+	if (error < 0)
+		throw MakeErrno(-error, "io_uring_register_buffers() failed");
+}
+
+void
+Ring::RegisterFilesSparse(unsigned n)
+{
+	int error = io_uring_register_files_sparse(&ring, n);
+	if (error < 0)
+		throw MakeErrno(-error, "io_uring_register_files_sparse() failed");
+}
+
+void
+Ring::UpdateFiles(unsigned offset, std::span<const int> fds)
+{
+	int error = io_uring_register_files_update(&ring, offset,
+						   fds.data(), fds.size());
 	if (error < 0)
-		throw MakeErrno(-error, "io_uring_submit() failed");
+		throw MakeErrno(-error, "io_uring_register_files_update() failed");
 }
 
 struct io_uring_cqe *
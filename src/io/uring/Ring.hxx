@@ -8,6 +8,8 @@
 
 #include <liburing.h>
 
+#include <span>
+
 namespace Uring {
 
 /**
@@ -21,6 +23,13 @@ class Ring {
 public:
 	Ring(unsigned entries, unsigned flags);
 
+	/**
+	 * Construct with io_uring_queue_init_params(), which allows
+	 * specifying more setup parameters (e.g. the SQPOLL thread
+	 * or the completion queue size).
+	 */
+	Ring(unsigned entries, const struct io_uring_params &params);
+
 	~Ring() noexcept {
 		io_uring_queue_exit(&ring);
 	}
@@ -36,7 +45,63 @@ public:
 		return io_uring_get_sqe(&ring);
 	}
 
-	void Submit();
+	/**
+	 * Returns the number of free entries in the submit queue.
+	 */
+	unsigned GetSubmitSpace() const noexcept {
+		return io_uring_sq_space_left(&ring);
+	}
+
+	/**
+	 * @return the number of submitted entries
+	 */
+	unsigned Submit();
+
+	/**
+	 * With IORING_SETUP_SQPOLL, Submit() only wakes up the
+	 * kernel thread, and the submit queue entries are consumed
+	 * asynchronously.  This method waits until there is free
+	 * space in the submit queue.
+	 *
+	 * Throws on error.
+	 *
+	 * @return false if this ring does not use SQPOLL (i.e.
+	 * waiting would not help)
+	 */
+	bool WaitSubmitSpace();
+
+	/**
+	 * Register buffers for IORING_OP_READ_FIXED and
+	 * IORING_OP_WRITE_FIXED.  The buffer index used by those
+	 * operations is the index in the given array.
+	 *
+	 * Throws on error.
+	 */
+	void RegisterBuffers(std::span<const struct iovec> iov);
+
+	void UnregisterBuffers() noexcept {
+		io_uring_unregister_buffers(&ring);
+	}
+
+	/**
+	 * Register an empty ("sparse") file table with the given
+	 * number of slots for IOSQE_FIXED_FILE (requires Linux 5.19).
+	 *
+	 * Throws on error.
+	 */
+	void RegisterFilesSparse(unsigned n);
+
+	/**
+	 * Replace entries of the registered file table; -1 clears
+	 * a slot.
+	 *
+	 * Throws on error.
+	 */
+	void UpdateFiles(unsigned offset, std::span<const int> fds);
+
+	void UnregisterFiles() noexcept {
+		io_uring_unregister_files(&ring);
+	}
 
 	struct io_uring_cqe *WaitCompletion();
 
@@ -48,6 +113,26 @@ public:
 	void SeenCompletion(struct io_uring_cqe &cqe) noexcept {
 		io_uring_cqe_seen(&ring, &cqe);
 	}
+
+	/**
+	 * Obtain pointers to all available completion queue entries
+	 * (up to the size of the given array) without waiting.  The
+	 * caller must call AdvanceCompletions() after it is done with
+	 * them.
+	 *
+	 * @return the number of entries
+	 */
+	unsigned PeekBatchCompletions(std::span<struct io_uring_cqe *> cqes) noexcept {
+		return io_uring_peek_batch_cqe(&ring, cqes.data(), cqes.size());
+	}
+
+	/**
+	 * Mark the given number of entries (returned by
+	 * PeekBatchCompletions()) as seen.
+	 */
+	void AdvanceCompletions(unsigned n) noexcept {
+		io_uring_cq_advance(&ring, n);
+	}
 };
 
 } // namespace Uring
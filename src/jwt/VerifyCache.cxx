@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "VerifyCache.hxx"
+#include "EdDSA.hxx"
+#include "lib/sodium/Base64.hxx"
+#include "lib/sodium/GenericHash.hxx"
+#include "util/AllocatedArray.hxx"
+#include "util/StringSplit.hxx"
+
+#include <algorithm> // for std::min()
+
+namespace JWT {
+
+inline VerifyCache::Digest
+VerifyCache::MakeDigest(CryptoSignPublicKeyView key,
+			std::string_view token) noexcept
+{
+	GenericHashState state{sizeof(Digest)};
+	state.Update(key);
+	state.Update(token);
+	return state.GetFinalT<Digest>();
+}
+
+void
+VerifyCache::Expire(Expiry now) noexcept
+{
+	cache.RemoveIf([now](const Digest &, const Expiry &expires){
+		return expires.IsExpired(now);
+	});
+}
+
+bool
+VerifyCache::Check(CryptoSignPublicKeyView key,
+		   std::string_view header_dot_payload_dot_signature_b64,
+		   Expiry now) noexcept
+{
+	const auto digest = MakeDigest(key, header_dot_payload_dot_signature_b64);
+
+	Expiry *expires = cache.Get(digest);
+	if (expires == nullptr)
+		return false;
+
+	if (expires->IsExpired(now)) {
+		cache.RemoveItem(*expires);
+		return false;
+	}
+
+	return true;
+}
+
+void
+VerifyCache::Add(CryptoSignPublicKeyView key,
+		 std::string_view header_dot_payload_dot_signature_b64,
+		 Expiry now, Expiry expires) noexcept
+{
+	expires = std::min(expires, Expiry::Touched(now, max_age));
+	if (expires.IsExpired(now))
+		return;
+
+	cache.PutOrReplace(MakeDigest(key, header_dot_payload_dot_signature_b64),
+			   expires);
+}
+
+bool
+VerifyCache::VerifyEdDSA(CryptoSignPublicKeyView key,
+			 std::string_view header_dot_payload_dot_signature_b64,
+			 Expiry now) noexcept
+{
+	if (Check(key, header_dot_payload_dot_signature_b64, now))
+		return true;
+
+	if (!JWT::VerifyEdDSA(key, header_dot_payload_dot_signature_b64))
+		return false;
+
+	Add(key, header_dot_payload_dot_signature_b64, now);
+	return true;
+}
+
+AllocatedArray<std::byte>
+VerifyCache::VerifyDecodeEdDSA(CryptoSignPublicKeyView key,
+			       std::string_view header_dot_payload_dot_signature_b64,
+			       Expiry now) noexcept
+{
+	if (!VerifyEdDSA(key, header_dot_payload_dot_signature_b64, now))
+		return nullptr;
+
+	const auto header_dot_payload_b64 =
+		SplitLast(header_dot_payload_dot_signature_b64, '.').first;
+	const auto payload_b64 = Split(header_dot_payload_b64, '.').second;
+	return DecodeUrlSafeBase64(payload_b64);
+}
+
+} // namespace JWT
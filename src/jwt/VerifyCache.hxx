@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "lib/sodium/SignKey.hxx"
+#include "util/Expiry.hxx"
+#include "util/StaticCache.hxx"
+
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <string_view>
+
+template<typename T> class AllocatedArray;
+
+namespace JWT {
+
+/**
+ * A bounded cache of JWTs whose signature has already been verified
+ * successfully.  Only a digest of the public key and the token is
+ * stored; the token itself is not copied.  Each entry expires after a
+ * configurable duration (or earlier, if the caller knows the token's
+ * "exp" claim), and the least recently used entry is evicted when the
+ * cache is full.
+ *
+ * This class is not thread-safe.
+ */
+class VerifyCache {
+	/**
+	 * A BLAKE2b digest (crypto_generichash_BYTES) of public key
+	 * and token.
+	 */
+	using Digest = std::array<std::byte, 32>;
+
+	struct DigestHash {
+		[[gnu::pure]]
+		std::size_t operator()(const Digest &digest) const noexcept {
+			/* the digest is already uniformly distributed,
+			   so its first bytes make a good hash */
+			std::size_t result;
+			std::memcpy(&result, digest.data(), sizeof(result));
+			return result;
+		}
+	};
+
+	StaticCache<Digest, Expiry, 4096, 4093, DigestHash> cache;
+
+	const std::chrono::steady_clock::duration max_age;
+
+public:
+	/**
+	 * @param _max_age the maximum duration a verification result
+	 * is remembered
+	 */
+	explicit VerifyCache(std::chrono::steady_clock::duration _max_age) noexcept
+		:max_age(_max_age) {}
+
+	VerifyCache(const VerifyCache &) = delete;
+	VerifyCache &operator=(const VerifyCache &) = delete;
+
+	void Clear() noexcept {
+		cache.Clear();
+	}
+
+	/**
+	 * Remove all expired entries.  This is optional (expired
+	 * entries are never returned and will eventually be evicted),
+	 * but may be called periodically to free slots early.
+	 */
+	void Expire(Expiry now) noexcept;
+
+	/**
+	 * Was this token verified with this key recently?
+	 *
+	 * @param header_dot_payload_dot_signature_b64 the complete
+	 * JWT (compact serialization)
+	 *
+	 * This is not a pure function: an expired entry is removed.
+	 */
+	bool Check(CryptoSignPublicKeyView key,
+		   std::string_view header_dot_payload_dot_signature_b64,
+		   Expiry now) noexcept;
+
+	/**
+	 * Remember that this token has been verified successfully
+	 * with this key.
+	 *
+	 * @param expires the time when this entry expires; it is
+	 * clamped to the configured maximum age; pass the token's
+	 * "exp" claim here if known
+	 */
+	void Add(CryptoSignPublicKeyView key,
+		 std::string_view header_dot_payload_dot_signature_b64,
+		 Expiry now, Expiry expires=Expiry::Never()) noexcept;
+
+	/**
+	 * Like JWT::VerifyEdDSA(), but consult the cache first and
+	 * add successfully verified tokens to it.
+	 */
+	bool VerifyEdDSA(CryptoSignPublicKeyView key,
+			 std::string_view header_dot_payload_dot_signature_b64,
+			 Expiry now) noexcept;
+
+	/**
+	 * Like JWT::VerifyDecodeEdDSA(), but consult the cache first
+	 * and add successfully verified tokens to it.
+	 *
+	 * @return the base64-decoded payload on success or nullptr on error
+	 */
+	AllocatedArray<std::byte>
+	VerifyDecodeEdDSA(CryptoSignPublicKeyView key,
+			  std::string_view header_dot_payload_dot_signature_b64,
+			  Expiry now) noexcept;
+
+private:
+	[[gnu::pure]]
+	static Digest MakeDigest(CryptoSignPublicKeyView key,
+				 std::string_view token) noexcept;
+};
+
+} // namespace JWT
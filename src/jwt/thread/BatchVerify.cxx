@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "BatchVerify.hxx"
+#include "jwt/EdDSA.hxx"
+#include "jwt/VerifyCache.hxx"
+#include "thread/Queue.hxx"
+#include "event/Loop.hxx"
+
+#include <algorithm> // for std::copy()
+#include <cassert>
+
+namespace JWT {
+
+EdDSABatchVerifier::~EdDSABatchVerifier() noexcept
+{
+	assert(IsIdle());
+}
+
+void
+EdDSABatchVerifier::Start(CryptoSignPublicKeyView _key,
+			  std::span<const std::string_view> _tokens) noexcept
+{
+	assert(IsIdle());
+
+	std::copy(_key.begin(), _key.end(), key.begin());
+	tokens = _tokens;
+	results.ResizeDiscard(tokens.size());
+	misses.clear();
+
+	const Expiry now = queue.GetEventLoop().SteadyNow();
+
+	for (std::size_t i = 0; i < tokens.size(); ++i) {
+		if (cache != nullptr && cache->Check(key, tokens[i], now))
+			results[i] = true;
+		else
+			misses.push_back(i);
+	}
+
+	if (misses.empty()) {
+		/* everything was served from the cache, no need to
+		   bother a worker thread */
+		handler.OnJWTBatchVerified(results);
+		return;
+	}
+
+	queue.Add(*this);
+}
+
+bool
+EdDSABatchVerifier::Cancel() noexcept
+{
+	return IsIdle() || queue.Cancel(*this);
+}
+
+void
+EdDSABatchVerifier::Run() noexcept
+{
+	for (const std::size_t i : misses)
+		results[i] = VerifyEdDSA(key, tokens[i]);
+}
+
+void
+EdDSABatchVerifier::Done() noexcept
+{
+	if (cache != nullptr) {
+		const Expiry now = queue.GetEventLoop().SteadyNow();
+
+		for (const std::size_t i : misses)
+			if (results[i])
+				cache->Add(key, tokens[i], now);
+	}
+
+	handler.OnJWTBatchVerified(results);
+}
+
+} // namespace JWT
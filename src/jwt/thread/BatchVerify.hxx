@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "lib/sodium/SignKey.hxx"
+#include "thread/Job.hxx"
+#include "util/AllocatedArray.hxx"
+
+#include <span>
+#include <string_view>
+#include <vector>
+
+class ThreadQueue;
+
+namespace JWT {
+
+class VerifyCache;
+
+class BatchVerifyHandler {
+public:
+	/**
+	 * All tokens of the batch have been verified.
+	 *
+	 * @param results one element per token (in the order passed
+	 * to EdDSABatchVerifier::Start()); true if the signature is
+	 * valid
+	 */
+	virtual void OnJWTBatchVerified(std::span<const bool> results) noexcept = 0;
+};
+
+/**
+ * Verify many EdDSA-signed JWTs at once.  Tokens which are found in
+ * the (optional) #VerifyCache are answered immediately; the signature
+ * checks for all others are performed in a worker thread, and
+ * successfully verified tokens are added to the cache afterwards.
+ *
+ * Each instance runs on one worker thread; to spread a huge batch
+ * over several threads, split it into several instances.
+ */
+class EdDSABatchVerifier final : ThreadJob {
+	ThreadQueue &queue;
+
+	VerifyCache *const cache;
+
+	BatchVerifyHandler &handler;
+
+	CryptoSignPublicKey key;
+
+	std::span<const std::string_view> tokens;
+
+	/**
+	 * Indexes into #tokens which were not found in the cache
+	 * and need to be verified by Run().
+	 */
+	std::vector<std::size_t> misses;
+
+	AllocatedArray<bool> results;
+
+public:
+	/**
+	 * @param _cache an optional #VerifyCache (may be nullptr);
+	 * it is only accessed from the main thread
+	 */
+	EdDSABatchVerifier(ThreadQueue &_queue, VerifyCache *_cache,
+			   BatchVerifyHandler &_handler) noexcept
+		:queue(_queue), cache(_cache), handler(_handler) {}
+
+	~EdDSABatchVerifier() noexcept;
+
+	EdDSABatchVerifier(const EdDSABatchVerifier &) = delete;
+	EdDSABatchVerifier &operator=(const EdDSABatchVerifier &) = delete;
+
+	bool IsIdle() const noexcept {
+		return ThreadJob::IsIdle();
+	}
+
+	/**
+	 * Start verifying a batch of tokens.  This object must be
+	 * idle.  If all tokens are found in the cache, then the
+	 * handler is invoked before this method returns.
+	 *
+	 * @param _tokens the complete JWTs (compact serialization);
+	 * the caller owns the array and the strings it points to and
+	 * must keep them valid until the handler is invoked or
+	 * Cancel() succeeds
+	 */
+	void Start(CryptoSignPublicKeyView _key,
+		   std::span<const std::string_view> _tokens) noexcept;
+
+	/**
+	 * Cancel the operation.
+	 *
+	 * @return true if the operation is now canceled, false if a
+	 * worker thread is currently processing it (the handler will
+	 * be invoked later)
+	 */
+	bool Cancel() noexcept;
+
+private:
+	/* virtual methods from class ThreadJob */
+	void Run() noexcept override;
+	void Done() noexcept override;
+};
+
+} // namespace JWT
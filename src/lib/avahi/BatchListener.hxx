@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "Snapshot.hxx"
+
+#include <string>
+#include <vector>
+
+namespace Avahi {
+
+/**
+ * The changes collected by #ServiceBatcher during one interval.
+ */
+struct ServiceChangeSet {
+	/**
+	 * New members and members whose address has changed, sorted
+	 * by key.  The pointers refer to members of #snapshot.
+	 */
+	std::vector<const ServiceSnapshot::Member *> added;
+
+	/**
+	 * Keys of members which have disappeared, sorted.
+	 */
+	std::vector<std::string> removed;
+
+	/**
+	 * All active members after applying these changes.
+	 */
+	ServiceSnapshotPtr snapshot;
+};
+
+class ServiceBatchListener {
+public:
+	/**
+	 * The set of active services has changed.  This is called
+	 * at most once per #ServiceBatcher interval, and only if
+	 * there are effective changes.
+	 */
+	virtual void OnAvahiChanges(const ServiceChangeSet &changes) noexcept = 0;
+
+	/**
+	 * The initial list of services is complete.  Pending changes
+	 * have been delivered right before this call.
+	 */
+	virtual void OnAvahiAllForNow() noexcept {}
+};
+
+} // namespace Avahi
@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "Batcher.hxx"
+#include "BatchListener.hxx"
+
+namespace Avahi {
+
+ServiceBatcher::ServiceBatcher(EventLoop &event_loop,
+			       Event::Duration _interval,
+			       ServiceBatchListener &_listener) noexcept
+	:listener(_listener),
+	 timer(event_loop, BIND_THIS_METHOD(Flush)),
+	 interval(_interval),
+	 snapshot(std::make_shared<const ServiceSnapshot>())
+{
+}
+
+void
+ServiceBatcher::Flush() noexcept
+{
+	timer.Cancel();
+
+	ServiceChangeSet changes;
+
+	std::vector<ServiceSnapshot::Member> members;
+	members.reserve(current.size());
+
+	/* walk both sorted lists in parallel to find the
+	   differences */
+	auto old_i = snapshot->begin();
+	const auto old_end = snapshot->end();
+
+	/* indexes into "members", converted to pointers after the
+	   vector has been moved into the new snapshot */
+	std::vector<std::size_t> added;
+
+	for (const auto &[key, address] : current) {
+		while (old_i != old_end && old_i->key < key)
+			changes.removed.emplace_back((old_i++)->key);
+
+		if (old_i != old_end && old_i->key == key) {
+			if (old_i->address != (SocketAddress)address)
+				added.push_back(members.size());
+			++old_i;
+		} else
+			added.push_back(members.size());
+
+		members.push_back({key, address});
+	}
+
+	while (old_i != old_end)
+		changes.removed.emplace_back((old_i++)->key);
+
+	if (added.empty() && changes.removed.empty())
+		/* nothing has changed effectively */
+		return;
+
+	changes.snapshot = snapshot =
+		std::make_shared<const ServiceSnapshot>(std::move(members));
+
+	if (!added.empty()) {
+		const auto *base = &*snapshot->begin();
+		changes.added.reserve(added.size());
+		for (const std::size_t i : added)
+			changes.added.push_back(base + i);
+	}
+
+	listener.OnAvahiChanges(changes);
+}
+
+void
+ServiceBatcher::OnAvahiNewObject(const std::string &key,
+				 SocketAddress address) noexcept
+{
+	current.insert_or_assign(key, AllocatedSocketAddress{address});
+	ScheduleFlush();
+}
+
+void
+ServiceBatcher::OnAvahiRemoveObject(const std::string &key) noexcept
+{
+	if (auto i = current.find(key); i != current.end()) {
+		current.erase(i);
+		ScheduleFlush();
+	}
+}
+
+void
+ServiceBatcher::OnAvahiAllForNow() noexcept
+{
+	/* deliver the initial list right away */
+	Flush();
+
+	listener.OnAvahiAllForNow();
+}
+
+} // namespace Avahi
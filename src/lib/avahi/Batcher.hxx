@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "ExplorerListener.hxx"
+#include "Snapshot.hxx"
+#include "event/FineTimerEvent.hxx"
+#include "net/AllocatedSocketAddress.hxx"
+
+#include <functional> // for std::less
+#include <map>
+#include <string>
+
+namespace Avahi {
+
+class ServiceBatchListener;
+
+/**
+ * A #ServiceExplorerListener implementation which collects the
+ * individual add/remove notifications of a #ServiceExplorer and
+ * delivers them as one #ServiceChangeSet per interval to a
+ * #ServiceBatchListener, together with an immutable
+ * #ServiceSnapshot.
+ *
+ * Changes which cancel each other out within one interval (e.g. a
+ * node which disappears and reappears with the same address) are
+ * not reported at all.
+ */
+class ServiceBatcher final : public ServiceExplorerListener {
+	ServiceBatchListener &listener;
+
+	FineTimerEvent timer;
+
+	const Event::Duration interval;
+
+	/**
+	 * The current set of active services, updated by each
+	 * notification.
+	 */
+	std::map<std::string, AllocatedSocketAddress, std::less<>> current;
+
+	/**
+	 * The snapshot which was last delivered to the listener.
+	 */
+	ServiceSnapshotPtr snapshot;
+
+public:
+	/**
+	 * @param _interval the maximum delay between a change and
+	 * its delivery to the listener
+	 */
+	ServiceBatcher(EventLoop &event_loop, Event::Duration _interval,
+		       ServiceBatchListener &_listener) noexcept;
+
+	ServiceBatcher(const ServiceBatcher &) = delete;
+	ServiceBatcher &operator=(const ServiceBatcher &) = delete;
+
+	/**
+	 * Returns the snapshot which was last delivered to the
+	 * listener.
+	 */
+	const ServiceSnapshotPtr &GetSnapshot() const noexcept {
+		return snapshot;
+	}
+
+	/**
+	 * Deliver pending changes right now.
+	 */
+	void Flush() noexcept;
+
+private:
+	void ScheduleFlush() noexcept {
+		/* don't postpone an already scheduled flush, or
+		   constant flapping would delay delivery forever */
+		if (!timer.IsPending())
+			timer.Schedule(interval);
+	}
+
+	/* virtual methods from class ServiceExplorerListener */
+	void OnAvahiNewObject(const std::string &key,
+			      SocketAddress address) noexcept override;
+	void OnAvahiRemoveObject(const std::string &key) noexcept override;
+	void OnAvahiAllForNow() noexcept override;
+};
+
+} // namespace Avahi
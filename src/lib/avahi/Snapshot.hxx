@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "net/AllocatedSocketAddress.hxx"
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Avahi {
+
+/**
+ * An immutable list of active services, sorted by key.  It is
+ * usually passed around as #ServiceSnapshotPtr; consumers can keep
+ * a reference to an old snapshot while a new one is being built,
+ * and replace it with a single pointer assignment.
+ */
+class ServiceSnapshot {
+public:
+	struct Member {
+		std::string key;
+		AllocatedSocketAddress address;
+	};
+
+private:
+	std::vector<Member> members;
+
+public:
+	ServiceSnapshot() noexcept = default;
+
+	/**
+	 * @param _members a list sorted by key
+	 */
+	explicit ServiceSnapshot(std::vector<Member> &&_members) noexcept
+		:members(std::move(_members))
+	{
+		assert(std::is_sorted(members.begin(), members.end(),
+				      [](const Member &a, const Member &b){
+					      return a.key < b.key;
+				      }));
+	}
+
+	ServiceSnapshot(const ServiceSnapshot &) = delete;
+	ServiceSnapshot &operator=(const ServiceSnapshot &) = delete;
+
+	bool empty() const noexcept {
+		return members.empty();
+	}
+
+	std::size_t size() const noexcept {
+		return members.size();
+	}
+
+	auto begin() const noexcept {
+		return members.begin();
+	}
+
+	auto end() const noexcept {
+		return members.end();
+	}
+
+	/**
+	 * Look up a member by its key (binary search).  Returns
+	 * nullptr if there is no such member.
+	 */
+	[[gnu::pure]]
+	const Member *Find(std::string_view key) const noexcept {
+		auto i = std::lower_bound(members.begin(), members.end(), key,
+					  [](const Member &m, std::string_view k){
+						  return m.key < k;
+					  });
+		if (i == members.end() || i->key != key)
+			return nullptr;
+
+		return &*i;
+	}
+};
+
+using ServiceSnapshotPtr = std::shared_ptr<const ServiceSnapshot>;
+
+} // namespace Avahi
@@ -90,7 +90,7 @@ IsResponseBoundaryHeader(std::string_view s) noexcept
 }
 
 inline void
-CurlResponseHandlerAdapter::HeaderFunction(std::string_view s) noexcept
+CurlResponseHandlerAdapter::HeaderFunction(std::string_view s)
 {
 	if (state > State::HEADERS)
 		return;
@@ -106,11 +106,13 @@ CurlResponseHandlerAdapter::HeaderFunction(std::string_view s) noexcept
 	if (_name.empty() || value.data() == nullptr)
 		return;
 
-	std::string name{_name};
-	std::transform(name.begin(), name.end(), name.begin(),
+	/* reuse this buffer for all headers to avoid one
+	   allocation per header */
+	lower_name.resize(_name.size());
+	std::transform(_name.begin(), _name.end(), lower_name.begin(),
 		       static_cast<char(*)(char)>(ToLowerASCII));
 
-	headers.emplace(std::move(name), StripLeft(value));
+	headers.emplace(lower_name, StripLeft(value));
 }
 
 std::size_t
@@ -122,8 +124,16 @@ CurlResponseHandlerAdapter::_HeaderFunction(char *ptr, std::size_t size,
 
 	size *= nmemb;
 
-	c.HeaderFunction({ptr, size});
-	return size;
+	try {
+		c.HeaderFunction({ptr, size});
+		return size;
+	} catch (...) {
+		/* abort the response with CURLE_WRITE_ERROR and
+		   report the exception from Done() (see
+		   DataReceived()) */
+		c.postponed_error = std::current_exception();
+		return 0;
+	}
 }
 
 inline std::size_t
@@ -9,6 +9,7 @@
 
 #include <cstddef>
 #include <exception>
+#include <string>
 #include <string_view>
 
 class CurlEasy;
@@ -21,6 +22,11 @@ class CurlResponseHandlerAdapter {
 
 	Curl::Headers headers;
 
+	/**
+	 * A buffer for converting a header name to lower case.
+	 */
+	std::string lower_name;
+
 	/**
 	 * An exception caught from within the WriteFunction() which
 	 * will later be handled by Done().
@@ -49,7 +55,10 @@ private:
 	void FinishHeaders();
 	void FinishBody();
 
-	void HeaderFunction(std::string_view s) noexcept;
+	/**
+	 * Throws on error.
+	 */
+	void HeaderFunction(std::string_view s);
 
 	/** called by curl when a new header is available */
 	static std::size_t _HeaderFunction(char *ptr,
@@ -3,6 +3,7 @@
 // author: Max Kellermann <mk@cm4all.com>
 
 #include "CoRequest.hxx"
+#include "StringResponse.hxx"
 #include "util/SpanCast.hxx"
 
 namespace Curl {
@@ -13,17 +14,31 @@ CoRequest::CoRequest(CurlGlobal &global, CurlEasy easy)
 	request.Start();
 }
 
+CoRequest::CoRequest(CurlGlobal &global, CurlEasy easy,
+		     FileDescriptor _body_fd)
+	:request(global, std::move(easy), *this),
+	 body_fd(_body_fd)
+{
+	request.Start();
+}
+
 void
 CoRequest::OnHeaders(HttpStatus status, Headers &&headers)
 {
 	response.status = status;
 	response.headers = std::move(headers);
+
+	if (!body_fd.IsDefined())
+		ReserveBody(response.body, response.headers);
 }
 
 void
 CoRequest::OnData(std::span<const std::byte> data)
 {
-	response.body.append(ToStringView(data));
+	if (body_fd.IsDefined())
+		body_fd.FullWrite(data);
+	else
+		response.body.append(ToStringView(data));
 }
 
 void
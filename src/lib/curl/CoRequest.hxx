@@ -7,6 +7,7 @@
 #include "Request.hxx"
 #include "Handler.hxx"
 #include "co/AwaitableHelper.hxx"
+#include "io/FileDescriptor.hxx"
 
 #include <exception>
 
@@ -17,6 +18,10 @@ struct CoResponse {
 
 	Headers headers;
 
+	/**
+	 * The response body.  This is empty if the body was written
+	 * to a file descriptor.
+	 */
 	std::string body;
 };
 
@@ -29,6 +34,12 @@ class CoRequest final : CurlResponseHandler {
 	CoResponse response;
 	std::exception_ptr error;
 
+	/**
+	 * If defined, then the response body is written to this file
+	 * descriptor instead of #CoResponse::body.
+	 */
+	const FileDescriptor body_fd = FileDescriptor::Undefined();
+
 	std::coroutine_handle<> continuation;
 
 	bool ready = false;
@@ -39,6 +50,15 @@ class CoRequest final : CurlResponseHandler {
 public:
 	CoRequest(CurlGlobal &global, CurlEasy easy);
 
+	/**
+	 * Write the response body to the given file descriptor
+	 * (e.g. a regular file) as it arrives instead of collecting
+	 * it in memory.  The file descriptor is owned by the caller.
+	 * Writing is blocking, so this is not suitable for pipes or
+	 * sockets which may fill up.
+	 */
+	CoRequest(CurlGlobal &global, CurlEasy easy, FileDescriptor _body_fd);
+
 	Awaitable operator co_await() noexcept {
 		return *this;
 	}
@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "CoStreamRequest.hxx"
+#include "Global.hxx"
+
+#include <cassert>
+
+namespace Curl {
+
+CoStreamRequest::CoStreamRequest(CurlGlobal &global, CurlEasy easy,
+				 std::size_t buffer_size)
+	:request(global, std::move(easy), *this),
+	 defer_resume(global.GetEventLoop(),
+		      BIND_THIS_METHOD(OnDeferredResume)),
+	 buffer(buffer_size), chunk(buffer_size)
+{
+	request.Start();
+}
+
+std::span<const std::byte>
+CoStreamRequest::TakeChunk()
+{
+	assert(chunk.empty());
+
+	if (!buffer.empty()) {
+		/* hand the received data to the coroutine; libcurl
+		   may now fill the other (empty) buffer */
+		swap(buffer, chunk);
+
+		if (paused && state == State::BODY && !error) {
+			/* this may invoke OnData() synchronously with
+			   the data libcurl has held back */
+			paused = false;
+			request.Resume();
+		}
+
+		return chunk.Read();
+	}
+
+	if (error)
+		std::rethrow_exception(error);
+
+	return {};
+}
+
+void
+CoStreamRequest::OnHeaders(HttpStatus _status, Headers &&_headers)
+{
+	status = _status;
+	headers = std::move(_headers);
+	state = State::BODY;
+
+	WakeUp();
+}
+
+void
+CoStreamRequest::OnData(std::span<const std::byte> data)
+{
+	if (!buffer.empty() &&
+	    buffer.GetAvailable() + data.size() > buffer.GetCapacity()) {
+		/* the buffer is full: let libcurl hold back this data
+		   until the coroutine takes the buffer */
+		paused = true;
+		throw Pause{};
+	}
+
+	/* this may grow the buffer if libcurl delivers a chunk
+	   larger than its capacity; that is fine, because #chunk is
+	   not affected */
+	buffer.Append(data);
+
+	WakeUp();
+}
+
+void
+CoStreamRequest::OnEnd()
+{
+	state = State::END;
+
+	WakeUp();
+}
+
+void
+CoStreamRequest::OnError(std::exception_ptr e) noexcept
+{
+	error = std::move(e);
+
+	WakeUp();
+}
+
+} // namespace Curl
@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "Request.hxx"
+#include "Handler.hxx"
+#include "event/DeferEvent.hxx"
+#include "util/DynamicFifoBuffer.hxx"
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <span>
+
+namespace Curl {
+
+/**
+ * A CURL HTTP request whose response body can be read in chunks by
+ * a C++20 coroutine, without buffering the whole body in memory.
+ *
+ * Received data is collected in one buffer while the coroutine
+ * works on the previous chunk in a second one, so both can proceed
+ * in parallel.  Only if the coroutine doesn't read fast enough and
+ * the receive buffer fills up, the transfer is paused
+ * (#CurlResponseHandler::Pause) until the next Read() call.
+ *
+ * Example:
+ *
+ *     Curl::CoStreamRequest request(global, CurlEasy(url));
+ *     const HttpStatus status = co_await request.ReadHeaders();
+ *     while (true) {
+ *       const auto chunk = co_await request.Read();
+ *       if (chunk.empty())
+ *         break;
+ *       ...
+ *     }
+ */
+class CoStreamRequest final : CurlResponseHandler {
+	CurlRequest request;
+
+	/**
+	 * Resumes the coroutine outside of libcurl callbacks.
+	 */
+	DeferEvent defer_resume;
+
+	/**
+	 * Data received from libcurl which has not yet been passed
+	 * to the coroutine.
+	 */
+	DynamicFifoBuffer<std::byte> buffer;
+
+	/**
+	 * The chunk returned by the last Read() call.  It is kept
+	 * separate from #buffer, because its data must not be moved
+	 * while the coroutine may access it; the two are swapped by
+	 * TakeChunk().
+	 */
+	DynamicFifoBuffer<std::byte> chunk;
+
+	Headers headers;
+
+	std::exception_ptr error;
+
+	std::coroutine_handle<> continuation;
+
+	HttpStatus status{};
+
+	enum class State : uint8_t {
+		HEADERS,
+		BODY,
+		END,
+	} state = State::HEADERS;
+
+	/**
+	 * Has the transfer been paused because the buffer is full?
+	 */
+	bool paused = false;
+
+public:
+	/**
+	 * @param buffer_size the maximum amount of data buffered
+	 * before the transfer is paused (this is allocated twice)
+	 */
+	CoStreamRequest(CurlGlobal &global, CurlEasy easy,
+			std::size_t buffer_size=65536);
+
+	CoStreamRequest(const CoStreamRequest &) = delete;
+	CoStreamRequest &operator=(const CoStreamRequest &) = delete;
+
+	/**
+	 * Provides access to the response headers after
+	 * ReadHeaders() has completed.
+	 */
+	const Headers &GetHeaders() const noexcept {
+		return headers;
+	}
+
+	/**
+	 * Wait for the response status and headers.
+	 *
+	 * The awaitable throws on error.
+	 */
+	auto ReadHeaders() noexcept {
+		struct Awaitable final {
+			CoStreamRequest &r;
+
+			bool await_ready() const noexcept {
+				return r.state != State::HEADERS || r.error;
+			}
+
+			void await_suspend(std::coroutine_handle<> _continuation) const noexcept {
+				r.continuation = _continuation;
+			}
+
+			HttpStatus await_resume() const {
+				r.continuation = {};
+
+				if (r.state == State::HEADERS)
+					std::rethrow_exception(r.error);
+
+				return r.status;
+			}
+		};
+
+		return Awaitable{*this};
+	}
+
+	/**
+	 * Wait for the next chunk of the response body.  The
+	 * returned span is valid until the next Read() call.  An
+	 * empty span means the response body is complete.
+	 *
+	 * The awaitable throws on error.
+	 */
+	auto Read() noexcept {
+		Consume();
+
+		struct Awaitable final {
+			CoStreamRequest &r;
+
+			bool await_ready() const noexcept {
+				return r.IsReadable();
+			}
+
+			void await_suspend(std::coroutine_handle<> _continuation) const noexcept {
+				r.continuation = _continuation;
+			}
+
+			std::span<const std::byte> await_resume() const {
+				r.continuation = {};
+				return r.TakeChunk();
+			}
+		};
+
+		return Awaitable{*this};
+	}
+
+private:
+	bool IsReadable() const noexcept {
+		return !buffer.empty() || state == State::END || error;
+	}
+
+	/**
+	 * Consume the chunk returned by the previous Read() call.
+	 */
+	void Consume() noexcept {
+		chunk.Clear();
+	}
+
+	/**
+	 * Move the received data to #chunk and resume a paused
+	 * transfer.
+	 */
+	std::span<const std::byte> TakeChunk();
+
+	void WakeUp() noexcept {
+		if (continuation)
+			defer_resume.Schedule();
+	}
+
+	void OnDeferredResume() noexcept {
+		continuation.resume();
+	}
+
+	/* virtual methods from CurlResponseHandler */
+	void OnHeaders(HttpStatus status, Headers &&headers) override;
+	void OnData(std::span<const std::byte> data) override;
+	void OnEnd() override;
+	void OnError(std::exception_ptr e) noexcept override;
+};
+
+} // namespace Curl
@@ -8,6 +8,9 @@
 #include "util/Compiler.h"
 
 #include <cassert>
+#include <new> // for std::bad_alloc
+
+using std::string_view_literals::operator""sv;
 
 /**
  * Monitor for one socket created by CURL.
@@ -80,15 +83,51 @@ private:
 	}
 };
 
-CurlGlobal::CurlGlobal(EventLoop &_loop)
+CurlGlobal::CurlGlobal(EventLoop &_loop, const CurlGlobalConfig &config)
 	:defer_read_info(_loop, BIND_THIS_METHOD(ReadInfo)),
-	 timeout_event(_loop, BIND_THIS_METHOD(OnTimeout))
+	 timeout_event(_loop, BIND_THIS_METHOD(OnTimeout)),
+	 max_host_stats(config.max_host_stats),
+	 multiplex(config.multiplex),
+	 collect_host_stats(config.host_stats)
 {
 	multi.SetOption(CURLMOPT_SOCKETFUNCTION, CurlSocket::SocketFunction);
 	multi.SetOption(CURLMOPT_SOCKETDATA, this);
 
 	multi.SetOption(CURLMOPT_TIMERFUNCTION, TimerFunction);
 	multi.SetOption(CURLMOPT_TIMERDATA, this);
+
+#ifdef CURLPIPE_MULTIPLEX
+	if (config.multiplex)
+		multi.SetOption(CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
+
+	if (config.max_host_connections > 0)
+		multi.SetOption(CURLMOPT_MAX_HOST_CONNECTIONS,
+				(long)config.max_host_connections);
+
+	if (config.max_total_connections > 0)
+		multi.SetOption(CURLMOPT_MAX_TOTAL_CONNECTIONS,
+				(long)config.max_total_connections);
+
+	if (config.max_cached_connections > 0)
+		multi.SetOption(CURLMOPT_MAXCONNECTS,
+				(long)config.max_cached_connections);
+
+	if (config.share_dns || config.share_ssl_sessions ||
+	    config.share_connections) {
+		share = CurlShare{};
+
+		if (config.share_dns)
+			share.Share(CURL_LOCK_DATA_DNS);
+
+		if (config.share_ssl_sessions)
+			share.Share(CURL_LOCK_DATA_SSL_SESSION);
+
+#if LIBCURL_VERSION_NUM >= 0x073900
+		if (config.share_connections)
+			share.Share(CURL_LOCK_DATA_CONNECT);
+#endif
+	}
 }
 
 int
@@ -131,6 +170,18 @@ CurlGlobal::Add(CurlRequest &r)
 {
 	assert(GetEventLoop().IsInside());
 
+	auto &easy = r.GetEasy();
+
+	if (share)
+		easy.SetOption(CURLOPT_SHARE, share.Get());
+
+#if LIBCURL_VERSION_NUM >= 0x072b00
+	if (multiplex)
+		/* prefer waiting for a connection which can be
+		   multiplexed over opening a new one */
+		easy.SetOption(CURLOPT_PIPEWAIT, 1L);
+#endif
+
 	multi.Add(r.Get());
 
 	InvalidateSockets();
@@ -168,6 +219,10 @@ CurlGlobal::ReadInfo() noexcept
 
 	while ((msg = multi.InfoRead()) != nullptr) {
 		if (msg->msg == CURLMSG_DONE) {
+			if (collect_host_stats)
+				UpdateHostStats(msg->easy_handle,
+						msg->data.result);
+
 			auto *request = ToRequest(msg->easy_handle);
 			if (request != nullptr)
 				request->Done(msg->data.result);
@@ -175,6 +230,68 @@ CurlGlobal::ReadInfo() noexcept
 	}
 }
 
+/**
+ * Extract the "authority" (host and port, but without user info)
+ * from a URL.
+ */
+[[gnu::pure]]
+static std::string_view
+GetUrlAuthority(std::string_view url) noexcept
+{
+	if (const auto scheme = url.find("://"sv); scheme != url.npos)
+		url = url.substr(scheme + 3);
+
+	url = url.substr(0, url.find_first_of("/?#"sv));
+
+	if (const auto at = url.rfind('@'); at != url.npos)
+		url = url.substr(at + 1);
+
+	return url;
+}
+
+inline void
+CurlGlobal::UpdateHostStats(CURL *easy, CURLcode result) noexcept
+{
+	const char *url = nullptr;
+	curl_easy_getinfo(easy, CURLINFO_EFFECTIVE_URL, &url);
+	if (url == nullptr)
+		return;
+
+	const auto authority = GetUrlAuthority(url);
+
+	auto i = host_stats.find(authority);
+	if (i == host_stats.end()) {
+		if (host_stats.size() >= max_host_stats)
+			/* don't let the map grow without bounds */
+			return;
+
+		try {
+			i = host_stats.emplace(authority, CurlHostStats{}).first;
+		} catch (const std::bad_alloc &) {
+			/* skip this update */
+			return;
+		}
+	}
+
+	auto &stats = i->second;
+	++stats.n_requests;
+
+	if (result != CURLE_OK)
+		++stats.n_errors;
+
+	long n_connects = 0;
+	curl_easy_getinfo(easy, CURLINFO_NUM_CONNECTS, &n_connects);
+	if (n_connects > 0)
+		++stats.n_new_connections;
+
+#if LIBCURL_VERSION_NUM >= 0x073200
+	long http_version = 0;
+	curl_easy_getinfo(easy, CURLINFO_HTTP_VERSION, &http_version);
+	if (http_version >= CURL_HTTP_VERSION_2_0)
+		++stats.n_http2;
+#endif
+}
+
 void
 CurlGlobal::SocketAction(curl_socket_t fd, int ev_bitmask) noexcept
 {
@@ -4,23 +4,116 @@
 #pragma once
 
 #include "Multi.hxx"
+#include "Share.hxx"
 #include "event/CoarseTimerEvent.hxx"
 #include "event/DeferEvent.hxx"
 
+#include <cstddef>
+#include <cstdint>
+#include <functional> // for std::less
+#include <map>
+#include <string>
+
 class CurlSocket;
 class CurlRequest;
 
+struct CurlGlobalConfig {
+	/**
+	 * Multiplex requests over HTTP/2 connections
+	 * (CURLPIPE_MULTIPLEX), and let new requests wait for a
+	 * connection which can be multiplexed instead of opening
+	 * another one (CURLOPT_PIPEWAIT).  If this is disabled,
+	 * libcurl's defaults are used.
+	 */
+	bool multiplex = false;
+
+	/**
+	 * Limits for CURLMOPT_MAX_HOST_CONNECTIONS,
+	 * CURLMOPT_MAX_TOTAL_CONNECTIONS and CURLMOPT_MAXCONNECTS
+	 * (the size of the connection cache).  Zero means libcurl's
+	 * default.
+	 */
+	unsigned max_host_connections = 0;
+	unsigned max_total_connections = 0;
+	unsigned max_cached_connections = 0;
+
+	/**
+	 * Share the DNS cache, TLS sessions and/or the connection
+	 * cache among all requests with a "curl_share" object.
+	 */
+	bool share_dns = false;
+	bool share_ssl_sessions = false;
+	bool share_connections = false;
+
+	/**
+	 * Collect #CurlHostStats?
+	 */
+	bool host_stats = false;
+
+	/**
+	 * The maximum number of hosts for which #CurlHostStats are
+	 * collected.  Requests to additional hosts are not counted.
+	 */
+	std::size_t max_host_stats = 1024;
+};
+
+struct CurlHostStats {
+	/**
+	 * The number of finished requests.
+	 */
+	uint_least64_t n_requests = 0;
+
+	/**
+	 * The number of requests which had to establish a new
+	 * connection (i.e. could not reuse one).
+	 */
+	uint_least64_t n_new_connections = 0;
+
+	/**
+	 * The number of requests which used HTTP/2 or later.
+	 */
+	uint_least64_t n_http2 = 0;
+
+	/**
+	 * The number of requests which have failed.
+	 */
+	uint_least64_t n_errors = 0;
+};
+
 /**
  * Manager for the global CURLM object.
  */
 class CurlGlobal final {
+	/**
+	 * Shared caches for all requests; may be empty.  Declared
+	 * before #multi so it gets destroyed after it.
+	 */
+	CurlShare share{nullptr};
+
 	CurlMulti multi;
 
 	DeferEvent defer_read_info;
 	CoarseTimerEvent timeout_event;
 
+	using HostStatsMap =
+		std::map<std::string, CurlHostStats, std::less<>>;
+
+	/**
+	 * Per-host statistics, keyed by the authority (host name and
+	 * port, if specified) of the effective URL.
+	 */
+	HostStatsMap host_stats;
+
+	const std::size_t max_host_stats;
+
+	const bool multiplex, collect_host_stats;
+
 public:
-	explicit CurlGlobal(EventLoop &_loop);
+	/**
+	 * Throws on error.
+	 */
+	explicit CurlGlobal(EventLoop &_loop,
+			    const CurlGlobalConfig &config=CurlGlobalConfig{});
 
 	auto &GetEventLoop() const noexcept {
 		return timeout_event.GetEventLoop();
@@ -39,6 +132,14 @@ public:
 		SocketAction(CURL_SOCKET_TIMEOUT, 0);
 	}
 
+	/**
+	 * Returns the per-host statistics collected so far (only if
+	 * enabled with CurlGlobalConfig::host_stats).
+	 */
+	const HostStatsMap &GetHostStats() const noexcept {
+		return host_stats;
+	}
+
 private:
 	/**
 	 * Check for finished HTTP responses.
@@ -47,6 +148,8 @@ private:
 	 */
 	void ReadInfo() noexcept;
 
+	void UpdateHostStats(CURL *easy, CURLcode result) noexcept;
+
 	void UpdateTimeout(long timeout_ms) noexcept;
 	static int TimerFunction(CURLM *multi, long timeout_ms,
 				 void *userp) noexcept;
@@ -4,11 +4,172 @@
 
 #pragma once
 
-#include <map>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace Curl {
 
-using Headers = std::multimap<std::string, std::string, std::less<>>;
+/**
+ * A list of HTTP response headers.  All names and values are
+ * stored in one contiguous string buffer ("arena"), so adding a
+ * header usually doesn't allocate memory, and moving the whole
+ * container is cheap.
+ *
+ * Lookups are linear, which is fast for the typical number of
+ * response headers.  Duplicate names are allowed (like with
+ * std::multimap) and are kept in the order they were received.
+ */
+class Headers {
+	/**
+	 * Names and values, each null-terminated.
+	 */
+	std::string arena;
+
+	struct Item {
+		uint_least32_t name_offset, name_size;
+		uint_least32_t value_offset, value_size;
+	};
+
+	std::vector<Item> items;
+
+public:
+	using value_type = std::pair<std::string_view, std::string_view>;
+
+	class const_iterator {
+		const Headers *headers;
+		std::vector<Item>::const_iterator i;
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using difference_type = std::ptrdiff_t;
+		using value_type = Headers::value_type;
+		using pointer = void;
+		using reference = value_type;
+
+		const_iterator() noexcept = default;
+
+		const_iterator(const Headers &_headers,
+			       std::vector<Item>::const_iterator _i) noexcept
+			:headers(&_headers), i(_i) {}
+
+		bool operator==(const const_iterator &other) const noexcept {
+			return i == other.i;
+		}
+
+		value_type operator*() const noexcept {
+			return headers->Make(*i);
+		}
+
+		const_iterator &operator++() noexcept {
+			++i;
+			return *this;
+		}
+
+		const_iterator operator++(int) noexcept {
+			auto old = *this;
+			++i;
+			return old;
+		}
+	};
+
+	using iterator = const_iterator;
+
+	bool empty() const noexcept {
+		return items.empty();
+	}
+
+	std::size_t size() const noexcept {
+		return items.size();
+	}
+
+	void clear() noexcept {
+		arena.clear();
+		items.clear();
+	}
+
+	/**
+	 * Add a header.  The name is stored as-is; callers are
+	 * expected to normalize it to lower case.
+	 *
+	 * Throws std::bad_alloc on out-of-memory.
+	 */
+	void emplace(std::string_view name, std::string_view value) {
+		if (items.empty()) {
+			/* typical response headers fit into this
+			   without reallocating */
+			arena.reserve(1024);
+			items.reserve(16);
+		}
+
+		const auto name_offset = arena.size();
+		arena.append(name);
+		arena.push_back('\0');
+
+		const auto value_offset = arena.size();
+		arena.append(value);
+		arena.push_back('\0');
+
+		items.push_back({
+			uint_least32_t(name_offset), uint_least32_t(name.size()),
+			uint_least32_t(value_offset), uint_least32_t(value.size()),
+		});
+	}
+
+	const_iterator begin() const noexcept {
+		return {*this, items.begin()};
+	}
+
+	const_iterator end() const noexcept {
+		return {*this, items.end()};
+	}
+
+	/**
+	 * Find the first header with the given name.
+	 */
+	[[gnu::pure]]
+	const_iterator find(std::string_view name) const noexcept {
+		for (auto i = items.begin(); i != items.end(); ++i)
+			if (GetName(*i) == name)
+				return {*this, i};
+
+		return end();
+	}
+
+	[[gnu::pure]]
+	bool contains(std::string_view name) const noexcept {
+		return find(name) != end();
+	}
+
+	/**
+	 * Returns the value of the first header with the given name
+	 * (null-terminated) or nullptr if there is no such header.
+	 */
+	[[gnu::pure]]
+	const char *Get(std::string_view name) const noexcept {
+		for (const auto &i : items)
+			if (GetName(i) == name)
+				return arena.data() + i.value_offset;
+
+		return nullptr;
+	}
+
+private:
+	std::string_view GetName(const Item &item) const noexcept {
+		return {arena.data() + item.name_offset, item.name_size};
+	}
+
+	std::string_view GetValue(const Item &item) const noexcept {
+		return {arena.data() + item.value_offset, item.value_size};
+	}
+
+	value_type Make(const Item &item) const noexcept {
+		return {GetName(item), GetValue(item)};
+	}
+};
 
 } // namespace Curl
@@ -35,6 +35,7 @@ public:
 	void OnHeaders(HttpStatus status, Curl::Headers &&headers) override {
 		response.status = status;
 		response.headers = std::move(headers);
+		Curl::ReserveBody(response.body, response.headers);
 	}
 
 	void OnData(std::span<const std::byte> data) override {
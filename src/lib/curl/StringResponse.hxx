@@ -5,7 +5,9 @@
 #pragma once
 
 #include "Headers.hxx"
+#include "util/NumberParser.hxx"
 
+#include <algorithm>
 #include <cstdint>
 #include <string>
 
@@ -16,3 +18,26 @@ struct StringCurlResponse {
 	Curl::Headers headers;
 	std::string body;
 };
+
+namespace Curl {
+
+/**
+ * Reserve space in the body string according to the
+ * "content-length" response header, to avoid repeated
+ * reallocations while the body is received.  The reservation is
+ * capped, because the header comes from an untrusted peer.
+ */
+inline void
+ReserveBody(std::string &body, const Headers &headers) noexcept
+{
+	constexpr std::size_t MAX_RESERVE = 16 * 1024 * 1024;
+
+	const char *content_length = headers.Get("content-length");
+	if (content_length == nullptr)
+		return;
+
+	if (const auto size = ParseInteger<std::size_t>(content_length))
+		body.reserve(std::min(*size, MAX_RESERVE));
+}
+
+} // namespace Curl
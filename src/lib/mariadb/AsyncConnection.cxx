@@ -0,0 +1,324 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "AsyncConnection.hxx"
+#include "Result.hxx"
+#include "Error.hxx"
+
+#include <errmsg.h>
+
+#include <cassert>
+
+MysqlAsyncConnection::MysqlAsyncConnection(EventLoop &event_loop,
+					   MysqlAsyncConnectionHandler &_handler) noexcept
+	:socket_event(event_loop, BIND_THIS_METHOD(OnSocketReady)),
+	 timeout_event(event_loop, BIND_THIS_METHOD(OnTimeout)),
+	 handler(_handler)
+{
+	mysql_init(&mysql);
+	mysql_options(&mysql, MYSQL_OPT_NONBLOCK, 0);
+}
+
+MysqlAsyncConnection::~MysqlAsyncConnection() noexcept
+{
+	/* the socket is owned by libmariadb; unregister it from
+	   epoll before mysql_close() closes it */
+	socket_event.ReleaseSocket();
+
+	mysql_close(&mysql);
+}
+
+/**
+ * Was the given error caused by a broken connection?
+ */
+[[gnu::const]]
+static bool
+IsConnectionError(unsigned code) noexcept
+{
+	return code == CR_SERVER_GONE_ERROR || code == CR_SERVER_LOST;
+}
+
+bool
+MysqlAsyncConnection::CheckStatus(int status) noexcept
+{
+	if (status == 0) {
+		/* keep READ scheduled: if the connection becomes
+		   idle, ScheduleIdle() needs it, and this saves two
+		   epoll_ctl() calls per query */
+		socket_event.CancelWrite();
+		timeout_event.Cancel();
+		return true;
+	}
+
+	if (!socket_event.IsDefined())
+		/* the socket is created by the first
+		   mysql_real_connect_start() call */
+		socket_event.Open(SocketDescriptor(mysql_get_socket(&mysql)));
+
+	unsigned flags = 0;
+	if (status & MYSQL_WAIT_READ)
+		flags |= SocketEvent::READ;
+	if (status & MYSQL_WAIT_WRITE)
+		flags |= SocketEvent::WRITE;
+
+	/* MYSQL_WAIT_EXCEPT is covered by
+	   SocketEvent::IMPLICIT_FLAGS */
+
+	socket_event.Schedule(flags);
+
+	if (status & MYSQL_WAIT_TIMEOUT)
+		timeout_event.Schedule(std::chrono::milliseconds{mysql_get_timeout_value_ms(&mysql)});
+	else
+		timeout_event.Cancel();
+
+	return false;
+}
+
+void
+MysqlAsyncConnection::Connect(const char *host,
+			      const char *user, const char *passwd,
+			      const char *db, unsigned int port,
+			      const char *unix_socket,
+			      unsigned long clientflag) noexcept
+{
+	assert(state == State::INITIAL);
+
+	state = State::CONNECTING;
+	ContinueConnect(mysql_real_connect_start(&connect_return, &mysql,
+						 host, user, passwd, db, port,
+						 unix_socket, clientflag));
+}
+
+inline void
+MysqlAsyncConnection::ContinueConnect(int status) noexcept
+{
+	assert(state == State::CONNECTING);
+
+	if (!CheckStatus(status))
+		return;
+
+	if (connect_return == nullptr) {
+		socket_event.Cancel();
+		state = State::BROKEN;
+		handler.OnMysqlError(std::make_exception_ptr(MysqlError{mysql, "Failed to connect to MariaDB"}));
+		return;
+	}
+
+	state = State::READY;
+	ScheduleIdle();
+	handler.OnMysqlConnect();
+}
+
+void
+MysqlAsyncConnection::SendQuery(MysqlResultHandler &_handler,
+				std::string_view sql) noexcept
+{
+	assert(state == State::READY);
+	assert(result_handler == nullptr);
+
+	result_handler = &_handler;
+	query = sql;
+
+	state = State::QUERY;
+	ContinueQuery(mysql_real_query_start(&int_return, &mysql,
+					     query.data(), query.size()));
+}
+
+inline void
+MysqlAsyncConnection::ContinueQuery(int status) noexcept
+{
+	assert(state == State::QUERY);
+
+	if (!CheckStatus(status))
+		return;
+
+	if (int_return != 0) {
+		OnQueryError();
+		return;
+	}
+
+	StartStoreResult();
+}
+
+inline void
+MysqlAsyncConnection::StartStoreResult() noexcept
+{
+	state = State::STORE_RESULT;
+	ContinueStoreResult(mysql_store_result_start(&result_return, &mysql));
+}
+
+inline void
+MysqlAsyncConnection::ContinueStoreResult(int status) noexcept
+{
+	assert(state == State::STORE_RESULT);
+
+	if (!CheckStatus(status))
+		return;
+
+	if (result_return == nullptr && mysql_errno(&mysql) != 0) {
+		OnQueryError();
+		return;
+	}
+
+	MysqlResult result{result_return};
+
+	if (result_handler != nullptr)
+		result_handler->OnMysqlResult(std::move(result));
+
+	if (mysql_more_results(&mysql))
+		StartNextResult();
+	else
+		OnQueryFinished();
+}
+
+inline void
+MysqlAsyncConnection::StartNextResult() noexcept
+{
+	state = State::NEXT_RESULT;
+	ContinueNextResult(mysql_next_result_start(&int_return, &mysql));
+}
+
+inline void
+MysqlAsyncConnection::ContinueNextResult(int status) noexcept
+{
+	assert(state == State::NEXT_RESULT);
+
+	if (!CheckStatus(status))
+		return;
+
+	if (int_return > 0)
+		OnQueryError();
+	else if (int_return == 0)
+		StartStoreResult();
+	else
+		/* no more results */
+		OnQueryFinished();
+}
+
+inline void
+MysqlAsyncConnection::ScheduleIdle() noexcept
+{
+	assert(state == State::READY);
+
+	/* the server never sends anything while no query is in
+	   flight, so readiness means that it has closed the
+	   connection (e.g. because "wait_timeout" has expired);
+	   watching the socket detects this before the next query
+	   fails */
+
+	if (!socket_event.IsDefined())
+		/* connecting has finished without waiting */
+		socket_event.Open(SocketDescriptor(mysql_get_socket(&mysql)));
+
+	socket_event.ScheduleRead();
+}
+
+void
+MysqlAsyncConnection::OnQueryFinished() noexcept
+{
+	state = State::READY;
+	query = {};
+	ScheduleIdle();
+
+	if (auto *h = std::exchange(result_handler, nullptr))
+		h->OnMysqlResultEnd();
+	else
+		handler.OnMysqlIdle();
+}
+
+void
+MysqlAsyncConnection::OnQueryError() noexcept
+{
+	const bool broken = IsConnectionError(mysql_errno(&mysql));
+	auto error = std::make_exception_ptr(MysqlError{mysql, "MariaDB query failed"});
+
+	state = broken ? State::BROKEN : State::READY;
+	query = {};
+
+	if (broken)
+		socket_event.Cancel();
+	else
+		ScheduleIdle();
+
+	if (auto *h = std::exchange(result_handler, nullptr))
+		h->OnMysqlResultError(error);
+	else if (!broken)
+		handler.OnMysqlIdle();
+
+	if (broken)
+		handler.OnMysqlError(std::move(error));
+}
+
+inline void
+MysqlAsyncConnection::Continue(int status) noexcept
+{
+	switch (state) {
+	case State::INITIAL:
+	case State::READY:
+	case State::BROKEN:
+		/* no operation in progress */
+		assert(false);
+		break;
+
+	case State::CONNECTING:
+		ContinueConnect(mysql_real_connect_cont(&connect_return, &mysql,
+							status));
+		break;
+
+	case State::QUERY:
+		ContinueQuery(mysql_real_query_cont(&int_return, &mysql,
+						    status));
+		break;
+
+	case State::STORE_RESULT:
+		ContinueStoreResult(mysql_store_result_cont(&result_return,
+							    &mysql, status));
+		break;
+
+	case State::NEXT_RESULT:
+		ContinueNextResult(mysql_next_result_cont(&int_return, &mysql,
+							  status));
+		break;
+	}
+}
+
+inline void
+MysqlAsyncConnection::OnIdleSocketReady() noexcept
+{
+	assert(state == State::READY);
+
+	socket_event.Cancel();
+	state = State::BROKEN;
+
+	handler.OnMysqlError(std::make_exception_ptr(MysqlError{"MariaDB server has closed the connection",
+								CR_SERVER_LOST}));
+}
+
+void
+MysqlAsyncConnection::OnSocketReady(unsigned events) noexcept
+{
+	if (state == State::READY) {
+		OnIdleSocketReady();
+		return;
+	}
+
+	int status = 0;
+	if (events & SocketEvent::READ)
+		status |= MYSQL_WAIT_READ;
+	if (events & SocketEvent::WRITE)
+		status |= MYSQL_WAIT_WRITE;
+	if (events & SocketEvent::IMPLICIT_FLAGS)
+		/* let libmariadb find out what went wrong */
+		status |= MYSQL_WAIT_EXCEPT|MYSQL_WAIT_READ;
+
+	timeout_event.Cancel();
+	Continue(status);
+}
+
+void
+MysqlAsyncConnection::OnTimeout() noexcept
+{
+	socket_event.Cancel();
+	Continue(MYSQL_WAIT_TIMEOUT);
+}
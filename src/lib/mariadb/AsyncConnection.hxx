@@ -0,0 +1,239 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "event/SocketEvent.hxx"
+#include "event/FineTimerEvent.hxx"
+
+#include <mysql.h>
+
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <string_view>
+
+class MysqlResult;
+
+class MysqlAsyncConnectionHandler {
+public:
+	/**
+	 * The connection has been established.
+	 */
+	virtual void OnMysqlConnect() noexcept = 0;
+
+	/**
+	 * Connecting has failed or the connection has been lost
+	 * (this is also detected while the connection is idle).  The
+	 * #MysqlAsyncConnection cannot be used anymore.
+	 */
+	virtual void OnMysqlError(std::exception_ptr error) noexcept = 0;
+
+	/**
+	 * A query which was discarded with
+	 * MysqlAsyncConnection::DiscardQuery() has finished, and the
+	 * connection is idle again.
+	 */
+	virtual void OnMysqlIdle() noexcept {}
+};
+
+/**
+ * Receives the results of MysqlAsyncConnection::SendQuery().  None
+ * of these methods may destroy the #MysqlAsyncConnection.
+ */
+class MysqlResultHandler {
+public:
+	/**
+	 * A result set has been received.  For statements without
+	 * a result set (e.g. INSERT), this is an empty #MysqlResult.
+	 *
+	 * This may be called more than once if the query returns
+	 * more than one result (e.g. with CLIENT_MULTI_STATEMENTS).
+	 */
+	virtual void OnMysqlResult(MysqlResult &&result) noexcept = 0;
+
+	/**
+	 * The query has finished and all results have been
+	 * delivered.
+	 */
+	virtual void OnMysqlResultEnd() noexcept = 0;
+
+	/**
+	 * The query has failed.  If the connection has been lost,
+	 * MysqlAsyncConnectionHandler::OnMysqlError() will be
+	 * called afterwards.
+	 */
+	virtual void OnMysqlResultError(std::exception_ptr error) noexcept = 0;
+};
+
+/**
+ * A MariaDB connection which uses the non-blocking client API
+ * (mysql_*_start() and mysql_*_cont()), driven by a #SocketEvent.
+ * Unlike #MysqlConnection, no method blocks the calling thread.
+ *
+ * Only one query can be in flight at a time.
+ */
+class MysqlAsyncConnection final {
+	MYSQL mysql;
+
+	SocketEvent socket_event;
+
+	/**
+	 * Implements MYSQL_WAIT_TIMEOUT.
+	 */
+	FineTimerEvent timeout_event;
+
+	MysqlAsyncConnectionHandler &handler;
+
+	/**
+	 * The handler of the current query.  This is nullptr if
+	 * there is no query or if it has been discarded.
+	 */
+	MysqlResultHandler *result_handler = nullptr;
+
+	/**
+	 * A copy of the current query string; the library may
+	 * access it in each mysql_real_query_cont() call.
+	 */
+	std::string query;
+
+	enum class State : uint8_t {
+		/**
+		 * Connect() has not been called yet.
+		 */
+		INITIAL,
+
+		CONNECTING,
+
+		/**
+		 * The connection is established and no query is in
+		 * flight.
+		 */
+		READY,
+
+		QUERY,
+		STORE_RESULT,
+		NEXT_RESULT,
+
+		/**
+		 * Connecting has failed or the connection has been
+		 * lost.
+		 */
+		BROKEN,
+	} state = State::INITIAL;
+
+	/**
+	 * Return values of the pending mysql_*_start() call.
+	 */
+	MYSQL *connect_return;
+	MYSQL_RES *result_return;
+	int int_return;
+
+public:
+	MysqlAsyncConnection(EventLoop &event_loop,
+			     MysqlAsyncConnectionHandler &_handler) noexcept;
+
+	~MysqlAsyncConnection() noexcept;
+
+	MysqlAsyncConnection(const MysqlAsyncConnection &) = delete;
+	MysqlAsyncConnection &operator=(const MysqlAsyncConnection &) = delete;
+
+	auto &GetEventLoop() const noexcept {
+		return socket_event.GetEventLoop();
+	}
+
+	/**
+	 * May only be called before Connect().
+	 */
+	void SetOption(enum mysql_option option, const void *arg) noexcept {
+		mysql_options(&mysql, option, arg);
+	}
+
+	/**
+	 * Start connecting to the server.  On completion, the
+	 * #MysqlAsyncConnectionHandler will be invoked.
+	 *
+	 * All string parameters must remain valid until the
+	 * connection has been established (or has failed).
+	 */
+	void Connect(const char *host, const char *user, const char *passwd,
+		     const char *db, unsigned int port=3306,
+		     const char *unix_socket=nullptr,
+		     unsigned long clientflag=0) noexcept;
+
+	bool IsConnecting() const noexcept {
+		return state == State::INITIAL || state == State::CONNECTING;
+	}
+
+	bool IsBroken() const noexcept {
+		return state == State::BROKEN;
+	}
+
+	/**
+	 * Is a query in flight (possibly a discarded one)?
+	 */
+	bool IsBusy() const noexcept {
+		return state == State::QUERY ||
+			state == State::STORE_RESULT ||
+			state == State::NEXT_RESULT;
+	}
+
+	bool IsReady() const noexcept {
+		return state == State::READY;
+	}
+
+	/**
+	 * Send a query.  The connection must be ready (see
+	 * IsReady()).  Results will be delivered to the given
+	 * #MysqlResultHandler.
+	 */
+	void SendQuery(MysqlResultHandler &_handler,
+		       std::string_view sql) noexcept;
+
+	/**
+	 * Stop delivering results of the current query to its
+	 * #MysqlResultHandler.  The query cannot be aborted in the
+	 * middle of the protocol; it continues in the background,
+	 * and MysqlAsyncConnectionHandler::OnMysqlIdle() is called
+	 * when it has finished.
+	 */
+	void DiscardQuery() noexcept {
+		result_handler = nullptr;
+	}
+
+private:
+	/**
+	 * Evaluate the status returned by a mysql_*_start() or
+	 * mysql_*_cont() call: wait for the given events, or return
+	 * true if the operation has finished.
+	 */
+	bool CheckStatus(int status) noexcept;
+
+	/**
+	 * The connection has become idle (#State::READY): monitor
+	 * the socket for an unexpected hangup.
+	 */
+	void ScheduleIdle() noexcept;
+
+	void StartStoreResult() noexcept;
+	void StartNextResult() noexcept;
+
+	void ContinueConnect(int status) noexcept;
+	void ContinueQuery(int status) noexcept;
+	void ContinueStoreResult(int status) noexcept;
+	void ContinueNextResult(int status) noexcept;
+	void Continue(int status) noexcept;
+
+	void OnQueryFinished() noexcept;
+	void OnQueryError() noexcept;
+
+	/**
+	 * The socket has become readable (or was hung up) while the
+	 * connection was idle: the server has closed it.
+	 */
+	void OnIdleSocketReady() noexcept;
+
+	void OnSocketReady(unsigned events) noexcept;
+	void OnTimeout() noexcept;
+};
@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "AsyncConnection.hxx"
+#include "Result.hxx"
+#include "event/DeferEvent.hxx"
+#include "co/Compat.hxx"
+
+#include <string_view>
+
+/**
+ * Asynchronous MariaDB query.  If the query returns more than one
+ * result set, only the first one is returned.
+ *
+ * Example:
+ *
+ *     MysqlResult result = co_await
+ *       MysqlCoQuery(connection, "SELECT foo FROM bar");
+ */
+class MysqlCoQuery final : MysqlResultHandler {
+	MysqlAsyncConnection &connection;
+
+	/**
+	 * This moves resuming the coroutine onto a new stack frame,
+	 * out of the #MysqlResultHandler method calls.  Inside those,
+	 * it is unsafe to use the #MysqlAsyncConnection.
+	 */
+	DeferEvent defer_resume;
+
+	MysqlResult result;
+
+	std::exception_ptr error;
+
+	std::coroutine_handle<> continuation;
+
+	bool ready = false, have_result = false;
+
+public:
+	MysqlCoQuery(MysqlAsyncConnection &_connection,
+		     std::string_view sql) noexcept
+		:connection(_connection),
+		 defer_resume(connection.GetEventLoop(),
+			      BIND_THIS_METHOD(OnDeferredResume))
+	{
+		connection.SendQuery(*this, sql);
+	}
+
+	~MysqlCoQuery() noexcept {
+		if (!ready)
+			connection.DiscardQuery();
+	}
+
+	auto operator co_await() noexcept {
+		struct Awaitable final {
+			MysqlCoQuery &query;
+
+			bool await_ready() const noexcept {
+				return query.ready;
+			}
+
+			void await_suspend(std::coroutine_handle<> _continuation) const noexcept {
+				query.continuation = _continuation;
+			}
+
+			MysqlResult await_resume() const {
+				query.defer_resume.Cancel();
+
+				if (query.error)
+					std::rethrow_exception(query.error);
+
+				return std::move(query.result);
+			}
+		};
+
+		return Awaitable{*this};
+	}
+
+private:
+	void OnDeferredResume() noexcept {
+		continuation.resume();
+	}
+
+	void SetReady() noexcept {
+		ready = true;
+
+		if (continuation)
+			defer_resume.Schedule();
+	}
+
+	/* virtual methods from MysqlResultHandler */
+	void OnMysqlResult(MysqlResult &&_result) noexcept override {
+		if (!have_result) {
+			result = std::move(_result);
+			have_result = true;
+		}
+	}
+
+	void OnMysqlResultEnd() noexcept override {
+		SetReady();
+	}
+
+	void OnMysqlResultError(std::exception_ptr _error) noexcept override {
+		error = std::move(_error);
+		SetReady();
+	}
+};
@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "Stock.hxx"
+#include "CoQuery.hxx"
+#include "stock/CoGet.hxx"
+#include "co/Task.hxx"
+#include "util/ScopeExit.hxx"
+
+#include <string>
+
+/**
+ * Obtain a MariaDB connection from a #MysqlStock, send the given
+ * query, return the connection to the stock and return the
+ * #MysqlResult.
+ */
+inline Co::EagerTask<MysqlResult>
+MysqlCoStockQuery(MysqlStock &stock, std::string_view sql) noexcept
+{
+	/* copy the query string here (and return an EagerTask) to
+	   avoid a dangling reference, just in case the task gets
+	   passed around */
+	const std::string query{sql};
+
+	auto *item = co_await CoStockGet(stock, {});
+	AtScopeExit(item) { item->Put(PutAction::REUSE); };
+
+	co_return co_await MysqlCoQuery(stock.GetConnection(*item), query);
+}
@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "Stock.hxx"
+#include "AsyncConnection.hxx"
+#include "stock/Item.hxx"
+#include "event/DeferEvent.hxx"
+#include "util/Cancellable.hxx"
+
+#include <cassert>
+
+static const char *
+NullIfEmpty(const std::string &s) noexcept
+{
+	return s.empty() ? nullptr : s.c_str();
+}
+
+class MysqlStock::Item final
+	: public StockItem, Cancellable, MysqlAsyncConnectionHandler
+{
+	StockGetHandler &handler;
+
+	MysqlAsyncConnection connection;
+
+	bool initialized = false, idle;
+
+	DeferEvent defer_initialized;
+
+	std::exception_ptr error;
+
+public:
+	Item(CreateStockItem c, StockGetHandler &_handler,
+	     EventLoop &event_loop) noexcept
+		:StockItem(c),
+		 handler(_handler),
+		 connection(event_loop, *this),
+		 defer_initialized(event_loop,
+				   BIND_THIS_METHOD(OnDeferredInitialized))
+	{
+	}
+
+	void Connect(const MysqlStock &stock,
+		     CancellablePointer &cancel_ptr) noexcept {
+		assert(!initialized);
+
+		cancel_ptr = *this;
+		connection.Connect(NullIfEmpty(stock.host),
+				   NullIfEmpty(stock.user),
+				   NullIfEmpty(stock.passwd),
+				   NullIfEmpty(stock.db),
+				   stock.port,
+				   NullIfEmpty(stock.unix_socket),
+				   stock.clientflag);
+	}
+
+	auto &GetConnection() noexcept {
+		return connection;
+	}
+
+private:
+	void OnDeferredInitialized() noexcept {
+		assert(initialized);
+
+		if (error) {
+			InvokeCreateError(handler, std::move(error));
+		} else {
+			idle = false;
+			InvokeCreateSuccess(handler);
+		}
+	}
+
+	/* virtual methods from class StockItem */
+	bool Borrow() noexcept override {
+		assert(initialized);
+		assert(idle);
+
+		idle = false;
+		return true;
+	}
+
+	bool Release() noexcept override {
+		assert(initialized);
+		assert(!idle);
+
+		if (connection.IsBroken())
+			return false;
+
+		idle = true;
+
+		/* a discarded query may still be running; the item
+		   becomes available again in OnMysqlIdle() */
+		unclean = connection.IsBusy();
+		return true;
+	}
+
+	/* virtual methods from class Cancellable */
+	void Cancel() noexcept override {
+		assert(!initialized || defer_initialized.IsPending());
+
+		delete this;
+	}
+
+	/* virtual methods from class MysqlAsyncConnectionHandler */
+	void OnMysqlConnect() noexcept override {
+		assert(!initialized);
+
+		initialized = true;
+		defer_initialized.Schedule();
+	}
+
+	void OnMysqlError(std::exception_ptr e) noexcept override {
+		if (!initialized) {
+			error = std::move(e);
+			initialized = true;
+			defer_initialized.Schedule();
+		} else if (defer_initialized.IsPending()) {
+			if (!error)
+				error = std::move(e);
+		} else if (idle)
+			InvokeIdleDisconnect();
+		else
+			InvokeBusyDisconnect();
+	}
+
+	void OnMysqlIdle() noexcept override {
+		if (unclean)
+			ClearUncleanFlag();
+	}
+};
+
+void
+MysqlStock::Create(CreateStockItem c, StockRequest,
+		   StockGetHandler &handler, CancellablePointer &cancel_ptr)
+{
+	auto *item = new Item(c, handler, stock.GetEventLoop());
+	item->Connect(*this, cancel_ptr);
+}
+
+MysqlAsyncConnection &
+MysqlStock::GetConnection(StockItem &_item) noexcept
+{
+	auto &item = (Item &)_item;
+	return item.GetConnection();
+}
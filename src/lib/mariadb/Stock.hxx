@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "stock/Class.hxx"
+#include "stock/Stock.hxx"
+
+#include <string>
+
+class MysqlAsyncConnection;
+
+/**
+ * A #::Stock implementation which manages MariaDB connections
+ * (#MysqlAsyncConnection instances).
+ */
+class MysqlStock final : StockClass {
+	class Item;
+
+	::Stock stock;
+
+	/**
+	 * Connection parameters; empty strings are passed as
+	 * nullptr to libmariadb.
+	 */
+	const std::string host, user, passwd, db, unix_socket;
+	const unsigned port;
+	const unsigned long clientflag;
+
+public:
+	MysqlStock(EventLoop &event_loop,
+		   const char *_host, const char *_user, const char *_passwd,
+		   const char *_db, unsigned _port,
+		   const char *_unix_socket, unsigned long _clientflag,
+		   unsigned limit, unsigned max_idle) noexcept
+		:stock(event_loop, *this, "MysqlAsyncConnection",
+		       limit, max_idle, std::chrono::minutes(5)),
+		 host(_host != nullptr ? _host : ""),
+		 user(_user != nullptr ? _user : ""),
+		 passwd(_passwd != nullptr ? _passwd : ""),
+		 db(_db != nullptr ? _db : ""),
+		 unix_socket(_unix_socket != nullptr ? _unix_socket : ""),
+		 port(_port), clientflag(_clientflag)
+	{
+	}
+
+	operator ::Stock &() noexcept {
+		return stock;
+	}
+
+	/**
+	 * @see ::Stock::Shutdown()
+	 */
+	void Shutdown() noexcept {
+		stock.Shutdown();
+	}
+
+	/**
+	 * Cast a #StockItem obtained from this class to the
+	 * underlying #MysqlAsyncConnection.  Of course, this
+	 * reference is only valid until the #StockItem is returned
+	 * to the #::Stock.
+	 */
+	static MysqlAsyncConnection &GetConnection(StockItem &item) noexcept;
+
+private:
+	/* virtual methods from class StockClass */
+	void Create(CreateStockItem c, StockRequest request,
+		    StockGetHandler &handler,
+		    CancellablePointer &cancel_ptr) override;
+};
@@ -17,7 +17,12 @@ class MatchData {
 	pcre2_match_data_8 *match_data = nullptr;
 	const char *s;
 	PCRE2_SIZE *ovector;
-	std::size_t n;
+
+	/**
+	 * The number of captures (including the whole match); 0 if
+	 * there was no match.
+	 */
+	std::size_t n = 0;
 
 	explicit MatchData(pcre2_match_data_8 *_md, const char *_s) noexcept
 		:match_data(_md), s(_s),
@@ -46,8 +51,13 @@ public:
 		return *this;
 	}
 
+	/**
+	 * Was there a match?  An object which has no match may still
+	 * own a buffer which can be reused by
+	 * RegexPointer::Match(std::string_view, MatchData &).
+	 */
 	constexpr operator bool() const noexcept {
-		return match_data != nullptr;
+		return n > 0;
 	}
 
 	constexpr std::size_t size() const noexcept {
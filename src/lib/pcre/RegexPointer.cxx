@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "RegexPointer.hxx"
+
+namespace {
+
+/**
+ * A match data buffer with room for just the whole match, to be used
+ * by all patterns in one thread.  PCRE2 fills only as many captures
+ * as fit, and that is all we need for RegexPointer::Test().
+ */
+class ThreadMatchData {
+	pcre2_match_data_8 *const match_data =
+		pcre2_match_data_create_8(1, nullptr);
+
+public:
+	ThreadMatchData() noexcept = default;
+
+	~ThreadMatchData() noexcept {
+		if (match_data != nullptr)
+			pcre2_match_data_free_8(match_data);
+	}
+
+	ThreadMatchData(const ThreadMatchData &) = delete;
+	ThreadMatchData &operator=(const ThreadMatchData &) = delete;
+
+	pcre2_match_data_8 *get() const noexcept {
+		return match_data;
+	}
+};
+
+} // anonymous namespace
+
+bool
+RegexPointer::Test(std::string_view s) const noexcept
+{
+	static thread_local ThreadMatchData match_data;
+	if (match_data.get() == nullptr) [[unlikely]]
+		/* out of memory: fall back to allocating */
+		return Match(s);
+
+	/* a return value of 0 means the ovector was too small, but
+	   it's still a match */
+	return pcre2_match_8(re, (PCRE2_SPTR8)s.data(), s.size(),
+			     0, 0,
+			     match_data.get(), nullptr) >= 0;
+}
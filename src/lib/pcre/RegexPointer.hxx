@@ -23,17 +23,46 @@ public:
 
 	[[gnu::pure]]
 	MatchData Match(std::string_view s) const noexcept {
-		MatchData match_data{
-			pcre2_match_data_create_from_pattern_8(re, nullptr),
-			s.data(),
-		};
+		MatchData match_data;
+		Match(s, match_data);
+		return match_data;
+	}
+
+	/**
+	 * Like Match(std::string_view), but reuse the buffer owned by
+	 * the given #MatchData (e.g. from a previous call), which
+	 * avoids a heap allocation for each call.  The buffer is only
+	 * reallocated if it is too small for this pattern's captures.
+	 *
+	 * @return true on match
+	 */
+	bool Match(std::string_view s, MatchData &match_data) const noexcept {
+		const std::size_t n_ovector = n_capture + 1;
+		if (match_data.match_data == nullptr ||
+		    pcre2_get_ovector_count_8(match_data.match_data) < n_ovector) {
+			if (match_data.match_data != nullptr)
+				pcre2_match_data_free_8(match_data.match_data);
+
+			match_data.match_data = pcre2_match_data_create_8(n_ovector, nullptr);
+			if (match_data.match_data == nullptr) {
+				/* out of memory */
+				match_data.n = 0;
+				return false;
+			}
+
+			match_data.ovector = pcre2_get_ovector_pointer_8(match_data.match_data);
+		}
+
+		match_data.s = s.data();
 
 		int n = pcre2_match_8(re, (PCRE2_SPTR8)s.data(), s.size(),
 				      0, 0,
 				      match_data.match_data, nullptr);
-		if (n < 0)
+		if (n < 0) {
 			/* no match (or error) */
-			return {};
+			match_data.n = 0;
+			return false;
+		}
 
 		match_data.n = n;
 
@@ -44,6 +73,15 @@ public:
 			   this */
 			match_data.n = n_capture + 1;
 
-		return match_data;
+		return true;
 	}
+
+	/**
+	 * Check whether the string matches, without obtaining
+	 * captures.  This uses a per-thread match data buffer and
+	 * therefore never allocates memory (after the first call in
+	 * each thread).
+	 */
+	[[gnu::pure]]
+	bool Test(std::string_view s) const noexcept;
 };
@@ -0,0 +1,271 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "RegexSet.hxx"
+#include "util/CharUtil.hxx"
+
+#include <algorithm> // for std::transform()
+
+/**
+ * Is this an escape sequence (backslash and a letter) which matches
+ * a character type or an assertion and has no argument?
+ */
+static constexpr bool
+IsSimpleEscape(char ch) noexcept
+{
+	switch (ch) {
+	case 'd':
+	case 'D':
+	case 's':
+	case 'S':
+	case 'w':
+	case 'W':
+	case 'h':
+	case 'H':
+	case 'v':
+	case 'V':
+	case 'b':
+	case 'B':
+	case 'A':
+	case 'z':
+	case 'Z':
+	case 'G':
+	case 'R':
+	case 'X':
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+/**
+ * Skip a character class.
+ *
+ * @param i the position after the opening bracket
+ * @return the position after the closing bracket or
+ * std::string_view::npos if it is not closed
+ */
+static std::size_t
+SkipCharacterClass(std::string_view pattern, std::size_t i) noexcept
+{
+	if (i < pattern.size() && pattern[i] == '^')
+		++i;
+
+	/* a closing bracket at the beginning is a literal */
+	if (i < pattern.size() && pattern[i] == ']')
+		++i;
+
+	while (i < pattern.size()) {
+		switch (pattern[i]) {
+		case ']':
+			return i + 1;
+
+		case '\\':
+			i += 2;
+			break;
+
+		case '[':
+			if (i + 1 < pattern.size() && pattern[i + 1] == ':') {
+				/* POSIX class like "[:alpha:]" */
+				const auto end = pattern.find(":]", i + 2);
+				if (end == pattern.npos)
+					return pattern.npos;
+				i = end + 2;
+			} else
+				++i;
+			break;
+
+		default:
+			++i;
+		}
+	}
+
+	return pattern.npos;
+}
+
+std::string
+Pcre::ExtractRequiredLiteral(std::string_view pattern)
+{
+	/* the longest literal found so far */
+	std::string best;
+
+	/* the literal which is currently being parsed (at the top
+	   level) */
+	std::string current;
+
+	/* was the last top-level atom a literal character (which was
+	   appended to #current)? */
+	bool last_was_literal = false;
+
+	const auto Flush = [&]{
+		if (current.size() > best.size())
+			best = current;
+		current.clear();
+		last_was_literal = false;
+	};
+
+	/* the last atom may be repeated zero times: remove it from
+	   the literal */
+	const auto Optional = [&]{
+		if (last_was_literal)
+			current.pop_back();
+		Flush();
+	};
+
+	unsigned depth = 0;
+
+	for (std::size_t i = 0; i < pattern.size();) {
+		const char ch = pattern[i++];
+
+		switch (ch) {
+		case '\\':
+			if (i >= pattern.size())
+				return {};
+
+			if (const char e = pattern[i++]; IsAlphaNumericASCII(e)) {
+				/* escape sequences with arguments
+				   (e.g. "\x{..}", "\k<..>") are not
+				   supported, and neither is "\Q" */
+				if (!IsSimpleEscape(e))
+					return {};
+
+				if (depth == 0)
+					Flush();
+			} else if (depth == 0) {
+				/* an escaped punctuation character is a
+				   literal */
+				current.push_back(e);
+				last_was_literal = true;
+			}
+
+			break;
+
+		case '[':
+			i = SkipCharacterClass(pattern, i);
+			if (i == pattern.npos)
+				return {};
+
+			if (depth == 0)
+				Flush();
+			break;
+
+		case '(':
+			if (depth == 0) {
+				if (i < pattern.size() &&
+				    (pattern[i] == '*' ||
+				     (pattern[i] == '?' &&
+				      (i + 1 >= pattern.size() || pattern[i + 1] != ':'))))
+					/* verbs, inline options, lookaround
+					   assertions, named groups, ... */
+					return {};
+
+				Flush();
+			}
+
+			/* group contents are ignored */
+			++depth;
+			break;
+
+		case ')':
+			if (depth == 0)
+				return {};
+
+			--depth;
+			break;
+
+		case '|':
+			if (depth == 0)
+				/* an alternative at the top level: no
+				   literal is required */
+				return {};
+			break;
+
+		case '?':
+		case '*':
+			if (depth == 0) {
+				Optional();
+
+				/* skip the lazy/possessive modifier */
+				if (i < pattern.size() &&
+				    (pattern[i] == '?' || pattern[i] == '+'))
+					++i;
+			}
+			break;
+
+		case '+':
+			if (depth == 0) {
+				/* the last atom is required, but may be
+				   repeated */
+				Flush();
+
+				if (i < pattern.size() &&
+				    (pattern[i] == '?' || pattern[i] == '+'))
+					++i;
+			}
+			break;
+
+		case '{':
+			if (depth == 0) {
+				/* a counted repeat (or a literal brace);
+				   treat it conservatively like "*" */
+				Optional();
+
+				const auto end = pattern.find('}', i);
+				if (end == pattern.npos)
+					i = pattern.size();
+				else
+					i = end + 1;
+			}
+			break;
+
+		case '.':
+		case '^':
+		case '$':
+			if (depth == 0)
+				Flush();
+			break;
+
+		default:
+			if (depth == 0) {
+				current.push_back(ch);
+				last_was_literal = true;
+			}
+		}
+	}
+
+	Flush();
+	return best;
+}
+
+std::size_t
+RegexSet::Add(const char *pattern, Pcre::CompileOptions options)
+{
+	UniqueRegex regex{pattern, options};
+
+	auto literal = Pcre::ExtractRequiredLiteral(pattern);
+	if (options.caseless)
+		std::transform(literal.begin(), literal.end(), literal.begin(),
+			       ToLowerASCII);
+
+	items.push_back({std::move(regex), std::move(literal), options.caseless});
+	return items.size() - 1;
+}
+
+bool
+RegexSet::ContainsLowerCase(std::string_view haystack,
+			    std::string_view needle) noexcept
+{
+	if (needle.size() > haystack.size())
+		return false;
+
+	const std::size_t end = haystack.size() - needle.size();
+	for (std::size_t i = 0; i <= end; ++i)
+		if (std::equal(needle.begin(), needle.end(),
+			       haystack.begin() + i,
+			       [](char a, char b){ return a == ToLowerASCII(b); }))
+			return true;
+
+	return false;
+}
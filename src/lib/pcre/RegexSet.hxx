@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "UniqueRegex.hxx"
+
+#include <concepts> // for std::invocable
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * A list of regular expressions which are matched against the same
+ * string, e.g. a set of routing rules.
+ *
+ * Before running a pattern, a literal string which is required by
+ * this pattern (extracted at compile time) is looked up in the
+ * subject; patterns whose literal is missing are skipped without
+ * invoking PCRE.  Matching never allocates memory.
+ */
+class RegexSet {
+	struct Item {
+		UniqueRegex regex;
+
+		/**
+		 * A string which must occur in every matching subject,
+		 * or empty if none could be determined.  If
+		 * #caseless is set, this is lower case.
+		 */
+		std::string literal;
+
+		bool caseless;
+	};
+
+	std::vector<Item> items;
+
+public:
+	static constexpr std::size_t npos = ~std::size_t{};
+
+	bool empty() const noexcept {
+		return items.empty();
+	}
+
+	std::size_t size() const noexcept {
+		return items.size();
+	}
+
+	/**
+	 * Compile a pattern and add it to the set.
+	 *
+	 * Throws Pcre::Error on error.
+	 *
+	 * @return the index of the new pattern
+	 */
+	std::size_t Add(const char *pattern, Pcre::CompileOptions options={});
+
+	/**
+	 * Returns the literal string which was found to be required
+	 * by the given pattern (for debugging and unit tests).
+	 */
+	std::string_view GetLiteral(std::size_t i) const noexcept {
+		return items[i].literal;
+	}
+
+	/**
+	 * Returns the index of the first pattern which matches, or
+	 * #npos if none matches.
+	 */
+	[[gnu::pure]]
+	std::size_t MatchFirst(std::string_view s) const noexcept {
+		std::size_t result = npos;
+		ForEachCandidate(s, [&result](std::size_t i, const UniqueRegex &regex, std::string_view subject){
+			if (!regex.Test(subject))
+				return true;
+
+			result = i;
+			return false;
+		});
+		return result;
+	}
+
+	/**
+	 * Invoke the given function with the index of each pattern
+	 * which matches (in ascending order).
+	 */
+	void MatchAll(std::string_view s,
+		      std::invocable<std::size_t> auto f) const {
+		ForEachCandidate(s, [&f](std::size_t i, const UniqueRegex &regex, std::string_view subject){
+			if (regex.Test(subject))
+				f(i);
+			return true;
+		});
+	}
+
+	/**
+	 * Like MatchAll(), but return a vector which contains a
+	 * flag for each pattern.
+	 */
+	std::vector<bool> MatchAll(std::string_view s) const {
+		std::vector<bool> result(items.size());
+		MatchAll(s, [&result](std::size_t i){
+			result[i] = true;
+		});
+		return result;
+	}
+
+private:
+	/**
+	 * Invoke the function for each pattern whose literal occurs
+	 * in the subject, until it returns false.
+	 */
+	void ForEachCandidate(std::string_view s, auto f) const {
+		for (std::size_t i = 0; i < items.size(); ++i) {
+			const auto &item = items[i];
+
+			if (!item.literal.empty() &&
+			    !(item.caseless
+			      ? ContainsLowerCase(s, item.literal)
+			      : s.find(item.literal) != s.npos))
+				/* required literal not found: this
+				   pattern cannot match */
+				continue;
+
+			if (!f(i, item.regex, s))
+				break;
+		}
+	}
+
+	/**
+	 * Case-insensitive (ASCII only) substring search.
+	 *
+	 * @param needle a lower-case string
+	 */
+	[[gnu::pure]]
+	static bool ContainsLowerCase(std::string_view haystack,
+				      std::string_view needle) noexcept;
+};
+
+namespace Pcre {
+
+/**
+ * Determine a literal string which occurs in every string matched by
+ * the given pattern.  This is a conservative approximation: it
+ * returns an empty string if the pattern uses features which are
+ * not understood (e.g. alternatives at the top level, inline
+ * options or \Q...\E).
+ */
+[[gnu::pure]]
+std::string
+ExtractRequiredLiteral(std::string_view pattern);
+
+} // namespace Pcre
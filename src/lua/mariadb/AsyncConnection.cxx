@@ -0,0 +1,404 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "AsyncConnection.hxx"
+#include "Params.hxx"
+#include "Result.hxx"
+#include "lua/Assert.hxx"
+#include "lua/Class.hxx"
+#include "lua/Error.hxx"
+#include "lua/Resume.hxx"
+#include "lua/StringView.hxx"
+#include "lua/Util.hxx"
+#include "lib/mariadb/AsyncConnection.hxx"
+#include "lib/mariadb/Result.hxx"
+#include "event/DeferEvent.hxx"
+#include "util/IntrusiveList.hxx"
+
+extern "C" {
+#include <lauxlib.h>
+}
+
+#include <cassert>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Lua::MariaDB {
+
+class AsyncRequest;
+
+/**
+ * A MariaDB connection for Lua code running in a coroutine.
+ * Instead of blocking the #EventLoop, execute() yields until the
+ * results have arrived.
+ *
+ * The #MysqlAsyncConnection is established lazily by the first
+ * query, and a new one is created if it breaks.  Queries are
+ * queued and sent one at a time.
+ */
+class AsyncConnection final : MysqlAsyncConnectionHandler {
+	EventLoop &event_loop;
+
+	const std::string host, user, passwd, db, unix_socket;
+	const unsigned port;
+	const unsigned long clientflag;
+
+	std::unique_ptr<MysqlAsyncConnection> connection;
+
+	/**
+	 * Requests waiting to be sent.
+	 */
+	IntrusiveList<AsyncRequest> requests;
+
+	/**
+	 * The request whose query is currently in flight.
+	 */
+	AsyncRequest *current = nullptr;
+
+	/**
+	 * Sends the next request (and disposes a broken
+	 * connection) outside of #MysqlAsyncConnection callbacks.
+	 */
+	DeferEvent defer_next;
+
+	/**
+	 * Has #connection been established successfully?
+	 */
+	bool connected;
+
+public:
+	AsyncConnection(EventLoop &_event_loop, const Params &params) noexcept
+		:event_loop(_event_loop),
+		 host(params.host != nullptr ? params.host : ""),
+		 user(params.user != nullptr ? params.user : ""),
+		 passwd(params.passwd != nullptr ? params.passwd : ""),
+		 db(params.db != nullptr ? params.db : ""),
+		 unix_socket(params.unix_socket != nullptr ? params.unix_socket : ""),
+		 port(params.port), clientflag(params.clientflag),
+		 defer_next(event_loop, BIND_THIS_METHOD(OnDeferredNext)) {}
+
+	~AsyncConnection() noexcept;
+
+	EventLoop &GetEventLoop() const noexcept {
+		return event_loop;
+	}
+
+	int Execute(lua_State *L);
+
+	void Submit(AsyncRequest &request) noexcept;
+	void Cancel(AsyncRequest &request) noexcept;
+
+	/**
+	 * Called by #AsyncRequest when its query has finished.
+	 */
+	void OnRequestFinished(AsyncRequest &request) noexcept {
+		assert(current == &request);
+		(void)request;
+
+		current = nullptr;
+		defer_next.Schedule();
+	}
+
+private:
+	void Connect() noexcept;
+	void FailRequests(std::exception_ptr error) noexcept;
+
+	void OnDeferredNext() noexcept;
+
+	/* virtual methods from class MysqlAsyncConnectionHandler */
+	void OnMysqlConnect() noexcept override;
+	void OnMysqlError(std::exception_ptr error) noexcept override;
+	void OnMysqlIdle() noexcept override;
+};
+
+static constexpr char lua_async_connection[] = "MariaDB_AsyncConnection";
+using LuaAsyncConnection = Lua::Class<AsyncConnection, lua_async_connection>;
+
+/**
+ * One call to execute() on an #AsyncConnection.  This object lives
+ * on the stack of the Lua thread which called execute() and resumes
+ * it when the query has finished.
+ */
+class AsyncRequest final
+	: public IntrusiveListHook<IntrusiveHookMode::TRACK>,
+	  MysqlResultHandler
+{
+	lua_State *const L;
+
+	AsyncConnection *connection;
+
+	const std::string sql;
+
+	DeferEvent defer_resume;
+
+	std::vector<MysqlResult> results;
+
+	std::exception_ptr error;
+
+public:
+	AsyncRequest(lua_State *_L, AsyncConnection &_connection,
+		     StackIndex connection_idx, std::string_view _sql) noexcept
+		:L(_L), connection(&_connection), sql(_sql),
+		 defer_resume(connection->GetEventLoop(),
+			      BIND_THIS_METHOD(OnDeferredResume))
+	{
+		const ScopeCheckStack check_stack(L);
+
+		/* keep a reference to the connection object in fenv
+		   so it doesn't get garbage-collected while this
+		   request is pending */
+		lua_newtable(L);
+		SetTable(L, RelativeStackIndex{-1}, "connection",
+			 connection_idx);
+		lua_setfenv(L, -2);
+	}
+
+	~AsyncRequest() noexcept {
+		Cancel();
+	}
+
+	/**
+	 * Stop waiting for the query; the coroutine will not be
+	 * resumed.
+	 */
+	void Cancel() noexcept {
+		defer_resume.Cancel();
+
+		if (connection != nullptr)
+			connection->Cancel(*this);
+	}
+
+	/**
+	 * The #AsyncConnection is being destroyed.
+	 */
+	void Detach() noexcept {
+		connection = nullptr;
+	}
+
+	void Send(MysqlAsyncConnection &c) noexcept {
+		c.SendQuery(*this, sql);
+	}
+
+	void DeferResumeError(std::exception_ptr _error) noexcept {
+		error = std::move(_error);
+		defer_resume.Schedule();
+	}
+
+private:
+	void OnDeferredResume() noexcept;
+
+	/* virtual methods from MysqlResultHandler */
+	void OnMysqlResult(MysqlResult &&result) noexcept override {
+		results.emplace_back(std::move(result));
+	}
+
+	void OnMysqlResultEnd() noexcept override {
+		connection->OnRequestFinished(*this);
+		defer_resume.Schedule();
+	}
+
+	void OnMysqlResultError(std::exception_ptr _error) noexcept override {
+		connection->OnRequestFinished(*this);
+		DeferResumeError(std::move(_error));
+	}
+};
+
+static constexpr char lua_async_request[] = "MariaDB_AsyncRequest";
+using LuaAsyncRequest = Lua::Class<AsyncRequest, lua_async_request>;
+
+AsyncConnection::~AsyncConnection() noexcept
+{
+	if (current != nullptr) {
+		connection->DiscardQuery();
+		current->Detach();
+	}
+
+	requests.clear_and_dispose([](AsyncRequest *request){
+		request->Detach();
+	});
+}
+
+inline void
+AsyncConnection::Connect() noexcept
+{
+	assert(!connection);
+
+	auto NullIfEmpty = [](const std::string &s) noexcept {
+		return s.empty() ? nullptr : s.c_str();
+	};
+
+	connected = false;
+	connection = std::make_unique<MysqlAsyncConnection>(event_loop, *this);
+	connection->Connect(NullIfEmpty(host), NullIfEmpty(user),
+			    NullIfEmpty(passwd), NullIfEmpty(db), port,
+			    NullIfEmpty(unix_socket), clientflag);
+}
+
+void
+AsyncConnection::Submit(AsyncRequest &request) noexcept
+{
+	requests.push_back(request);
+
+	if (!connection)
+		Connect();
+	else
+		defer_next.Schedule();
+}
+
+void
+AsyncConnection::Cancel(AsyncRequest &request) noexcept
+{
+	if (current == &request) {
+		/* the query cannot be aborted; let it finish in the
+		   background and ignore its results */
+		current = nullptr;
+		connection->DiscardQuery();
+	} else if (request.is_linked())
+		requests.erase(requests.iterator_to(request));
+}
+
+void
+AsyncConnection::FailRequests(std::exception_ptr error) noexcept
+{
+	requests.clear_and_dispose([&error](AsyncRequest *request){
+		request->DeferResumeError(error);
+	});
+}
+
+void
+AsyncConnection::OnDeferredNext() noexcept
+{
+	if (connection && connection->IsBroken())
+		connection.reset();
+
+	if (requests.empty())
+		return;
+
+	if (!connection) {
+		Connect();
+		return;
+	}
+
+	if (!connection->IsReady() || current != nullptr)
+		return;
+
+	current = &requests.pop_front();
+	current->Send(*connection);
+}
+
+void
+AsyncConnection::OnMysqlConnect() noexcept
+{
+	connected = true;
+	defer_next.Schedule();
+}
+
+void
+AsyncConnection::OnMysqlError(std::exception_ptr error) noexcept
+{
+	if (!connected)
+		/* connecting has failed: fail all pending requests
+		   instead of retrying forever */
+		FailRequests(std::move(error));
+
+	/* dispose the broken connection; a new one will be
+	   established for the next request */
+	defer_next.Schedule();
+}
+
+void
+AsyncConnection::OnMysqlIdle() noexcept
+{
+	/* a discarded query has finished */
+	defer_next.Schedule();
+}
+
+inline int
+AsyncConnection::Execute(lua_State *L)
+{
+	if (lua_gettop(L) < 2)
+		return luaL_error(L, "Not enough parameters");
+	if (lua_gettop(L) > 2)
+		return luaL_error(L, "Query parameters are not supported by asynchronous connections");
+
+	luaL_checkstring(L, 2);
+
+	auto *request = LuaAsyncRequest::New(L, L, *this, StackIndex{1},
+					     ToStringView(L, 2));
+	Submit(*request);
+	return lua_yield(L, 1);
+}
+
+void
+AsyncRequest::OnDeferredResume() noexcept
+{
+	if (error) {
+		/* return [nil, error_message] for assert() */
+		Push(L, nullptr);
+		Push(L, std::move(error));
+		Resume(L, 2);
+	} else if (results.size() == 1) {
+		/* only one result: return it directly */
+		NewResult(L, std::move(results.front()));
+		Resume(L, 1);
+	} else {
+		/* return all results in a Lua array */
+		lua_newtable(L);
+
+		int n = 0;
+		for (auto &i : results) {
+			NewResult(L, std::move(i));
+			lua_rawseti(L, -2, ++n);
+		}
+
+		Resume(L, 1);
+	}
+}
+
+static constexpr struct luaL_Reg async_connection_methods[] = {
+	{"execute", LuaAsyncConnection::WrapMethod<&AsyncConnection::Execute>()},
+	{nullptr, nullptr}
+};
+
+void
+InitAsyncConnection(lua_State *L)
+{
+	const ScopeCheckStack check_stack{L};
+
+	LuaAsyncConnection::Register(L);
+	luaL_newlib(L, async_connection_methods);
+	lua_setfield(L, -2, "__index");
+	lua_pop(L, 1);
+
+	LuaAsyncRequest::Register(L);
+	SetField(L, RelativeStackIndex{-1}, "__close", [](auto _L){
+		auto &request = LuaAsyncRequest::Cast(_L, 1);
+		request.Cancel();
+		return 0;
+	});
+	lua_pop(L, 1);
+}
+
+int
+NewAsyncConnection(lua_State *L, EventLoop &event_loop)
+{
+	if (lua_gettop(L) != 2)
+		return luaL_error(L, "Invalid parameter count");
+
+	if (!lua_istable(L, 2))
+		luaL_argerror(L, 2, "table expected");
+
+	Params params;
+	try {
+		params.ApplyTable(L, 2);
+	} catch (const ArgError &e) {
+		luaL_argerror(L, 2, e.extramsg);
+	}
+
+	LuaAsyncConnection::New(L, event_loop, params);
+	return 1;
+}
+
+} // namespace Lua::MariaDB
@@ -0,0 +1,23 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+struct lua_State;
+class EventLoop;
+
+namespace Lua::MariaDB {
+
+void
+InitAsyncConnection(lua_State *L);
+
+/**
+ * Create a connection object whose execute() method yields the
+ * calling coroutine instead of blocking.  Expects the parameter
+ * table at stack index 2.
+ */
+int
+NewAsyncConnection(lua_State *L, EventLoop &event_loop);
+
+} // namespace Lua::MariaDB
@@ -3,6 +3,7 @@
 // author: Max Kellermann <mk@cm4all.com>
 
 #include "Connection.hxx"
+#include "Params.hxx"
 #include "Result.hxx"
 #include "SResult.hxx"
 #include "lua/Assert.hxx"
@@ -17,7 +18,6 @@
 #include "lib/mariadb/Statement.hxx"
 #include "lib/mariadb/Result.hxx"
 #include "util/ScopeExit.hxx"
-#include "util/StringAPI.hxx"
 
 extern "C" {
 #include <lauxlib.h>
@@ -25,8 +25,6 @@ extern "C" {
 
 namespace Lua::MariaDB {
 
-struct ArgError { const char *extramsg; };
-
 static constexpr char lua_connection[] = "MariaDB_Connection";
 using LuaConnection = Lua::Class<MysqlConnection, lua_connection>;
 
@@ -209,89 +207,6 @@ InitConnection(lua_State *L)
 	lua_pop(L, 1);
 }
 
-struct Params {
-	const char *host = nullptr, *user = nullptr, *passwd = nullptr;
-	const char *db = nullptr;
-	const char *unix_socket = nullptr;
-	unsigned port = 3306;
-	unsigned long clientflag = 0;
-
-	void Apply(lua_State *L, const char *name, int value_idx);
-	void Apply(lua_State *L, int key_idx, int value_idx);
-	void ApplyTable(lua_State *L, auto table_idx);
-};
-
-inline void
-Params::Apply(lua_State *L, const char *name, int value_idx)
-{
-	const ScopeCheckStack check_stack{L};
-
-	if (StringIsEqual(name, "host")) {
-		if (!lua_isstring(L, value_idx))
-			throw ArgError{"Bad host type"};
-
-		host = lua_tostring(L, value_idx);
-	} else if (StringIsEqual(name, "user")) {
-		if (!lua_isstring(L, value_idx))
-			throw ArgError{"Bad user type"};
-
-		user = lua_tostring(L, value_idx);
-	} else if (StringIsEqual(name, "passwd")) {
-		if (!lua_isstring(L, value_idx))
-			throw ArgError{"Bad passwd type"};
-
-		passwd = lua_tostring(L, value_idx);
-	} else if (StringIsEqual(name, "db")) {
-		if (!lua_isstring(L, value_idx))
-			throw ArgError{"Bad db type"};
-
-		db = lua_tostring(L, value_idx);
-	} else if (StringIsEqual(name, "unix_socket")) {
-		if (!lua_isstring(L, value_idx))
-			throw ArgError{"Bad unix_socket type"};
-
-		unix_socket = lua_tostring(L, value_idx);
-	} else if (StringIsEqual(name, "port")) {
-		if (!lua_isnumber(L, value_idx))
-			throw ArgError{"Bad port type"};
-
-		const auto _port = lua_tointeger(L, value_idx);
-		if (_port < 1 || _port > 65535)
-			throw ArgError{"Bad port value"};
-
-		port = (unsigned)_port;
-	} else if (StringIsEqual(name, "multi_statements")) {
-		if (!lua_isboolean(L, value_idx))
-			throw ArgError{"Bad multi_statements value"};
-
-		if (lua_toboolean(L, value_idx))
-			clientflag |= CLIENT_MULTI_STATEMENTS;
-	} else
-		throw ArgError{name};
-}
-
-inline void
-Params::Apply(lua_State *L, int key_idx, int value_idx)
-{
-	const ScopeCheckStack check_stack{L};
-
-	if (lua_type(L, key_idx) != LUA_TSTRING)
-		throw ArgError{"Bad key type"};
-
-	const char *key = lua_tostring(L, key_idx);
-	Apply(L, key, value_idx);
-}
-
-inline void
-Params::ApplyTable(lua_State *L, auto table_idx)
-{
-	ForEach(L, table_idx, [this, L](auto key_idx, auto value_idx){
-		/* explicitly using "this->" to work around bogus
-		   clang16 -Wunused-lambda-capture warning */
-		this->Apply(L, GetStackIndex(key_idx), GetStackIndex(value_idx));
-	});
-}
-
 int
 NewConnection(lua_State *L)
 {
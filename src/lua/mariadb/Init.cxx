@@ -3,10 +3,16 @@
 // author: Max Kellermann <mk@cm4all.com>
 
 #include "Init.hxx"
+#include "AsyncConnection.hxx"
 #include "Connection.hxx"
 #include "Result.hxx"
 #include "SResult.hxx"
 #include "lua/Util.hxx"
+#include "lua/PushCClosure.hxx"
+
+extern "C" {
+#include <lua.h>
+}
 
 namespace Lua::MariaDB {
 
@@ -22,4 +28,24 @@ Init(lua_State *L)
 	lua_setglobal(L, "mariadb");
 }
 
+static int
+NewAsync(lua_State *L)
+{
+	auto &event_loop = *(EventLoop *)lua_touserdata(L, lua_upvalueindex(1));
+	return NewAsyncConnection(L, event_loop);
+}
+
+void
+Init(lua_State *L, EventLoop &event_loop)
+{
+	InitAsyncConnection(L);
+	InitResult(L);
+
+	lua_newtable(L);
+	SetTable(L, RelativeStackIndex{-1}, "new",
+		 Lua::MakeCClosure(NewAsync,
+				   Lua::LightUserData(&event_loop)));
+	lua_setglobal(L, "mariadb");
+}
+
 } // namespace Lua::MariaDB
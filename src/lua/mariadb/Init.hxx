@@ -5,10 +5,22 @@
 #pragma once
 
 struct lua_State;
+class EventLoop;
 
 namespace Lua::MariaDB {
 
+/**
+ * Register the "mariadb" library with blocking connections.
+ */
 void
 Init(lua_State *L);
 
+/**
+ * Register the "mariadb" library with asynchronous connections:
+ * execute() yields the calling coroutine instead of blocking the
+ * #EventLoop.
+ */
+void
+Init(lua_State *L, EventLoop &event_loop);
+
 } // namespace Lua::MariaDB
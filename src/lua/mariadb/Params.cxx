@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "Params.hxx"
+#include "lua/Assert.hxx"
+#include "lua/ForEach.hxx"
+#include "lua/StackIndex.hxx"
+#include "util/StringAPI.hxx"
+
+extern "C" {
+#include <lua.h>
+}
+
+#include <mysql.h>
+
+namespace Lua::MariaDB {
+
+inline void
+Params::Apply(lua_State *L, const char *name, int value_idx)
+{
+	const ScopeCheckStack check_stack{L};
+
+	if (StringIsEqual(name, "host")) {
+		if (!lua_isstring(L, value_idx))
+			throw ArgError{"Bad host type"};
+
+		host = lua_tostring(L, value_idx);
+	} else if (StringIsEqual(name, "user")) {
+		if (!lua_isstring(L, value_idx))
+			throw ArgError{"Bad user type"};
+
+		user = lua_tostring(L, value_idx);
+	} else if (StringIsEqual(name, "passwd")) {
+		if (!lua_isstring(L, value_idx))
+			throw ArgError{"Bad passwd type"};
+
+		passwd = lua_tostring(L, value_idx);
+	} else if (StringIsEqual(name, "db")) {
+		if (!lua_isstring(L, value_idx))
+			throw ArgError{"Bad db type"};
+
+		db = lua_tostring(L, value_idx);
+	} else if (StringIsEqual(name, "unix_socket")) {
+		if (!lua_isstring(L, value_idx))
+			throw ArgError{"Bad unix_socket type"};
+
+		unix_socket = lua_tostring(L, value_idx);
+	} else if (StringIsEqual(name, "port")) {
+		if (!lua_isnumber(L, value_idx))
+			throw ArgError{"Bad port type"};
+
+		const auto _port = lua_tointeger(L, value_idx);
+		if (_port < 1 || _port > 65535)
+			throw ArgError{"Bad port value"};
+
+		port = (unsigned)_port;
+	} else if (StringIsEqual(name, "multi_statements")) {
+		if (!lua_isboolean(L, value_idx))
+			throw ArgError{"Bad multi_statements value"};
+
+		if (lua_toboolean(L, value_idx))
+			clientflag |= CLIENT_MULTI_STATEMENTS;
+	} else
+		throw ArgError{name};
+}
+
+inline void
+Params::Apply(lua_State *L, int key_idx, int value_idx)
+{
+	const ScopeCheckStack check_stack{L};
+
+	if (lua_type(L, key_idx) != LUA_TSTRING)
+		throw ArgError{"Bad key type"};
+
+	const char *key = lua_tostring(L, key_idx);
+	Apply(L, key, value_idx);
+}
+
+void
+Params::ApplyTable(lua_State *L, int table_idx)
+{
+	ForEach(L, table_idx, [this, L](auto key_idx, auto value_idx){
+		/* explicitly using "this->" to work around bogus
+		   clang16 -Wunused-lambda-capture warning */
+		this->Apply(L, GetStackIndex(key_idx), GetStackIndex(value_idx));
+	});
+}
+
+} // namespace Lua::MariaDB
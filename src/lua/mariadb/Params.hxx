@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+struct lua_State;
+
+namespace Lua::MariaDB {
+
+struct ArgError { const char *extramsg; };
+
+/**
+ * The connection parameters passed to mariadb.new().  The strings
+ * point into the Lua table and are only valid as long as it is.
+ */
+struct Params {
+	const char *host = nullptr, *user = nullptr, *passwd = nullptr;
+	const char *db = nullptr;
+	const char *unix_socket = nullptr;
+	unsigned port = 3306;
+	unsigned long clientflag = 0;
+
+	/**
+	 * Throws #ArgError on error.
+	 */
+	void ApplyTable(lua_State *L, int table_idx);
+
+private:
+	void Apply(lua_State *L, const char *name, int value_idx);
+	void Apply(lua_State *L, int key_idx, int value_idx);
+};
+
+} // namespace Lua::MariaDB
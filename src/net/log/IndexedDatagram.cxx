@@ -0,0 +1,258 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "IndexedDatagram.hxx"
+#include "Datagram.hxx"
+#include "Parser.hxx"
+#include "Crc.hxx"
+#include "http/Method.hxx"
+#include "http/Status.hxx"
+#include "util/ByteOrder.hxx"
+#include "util/PackedBigEndian.hxx"
+
+#include <cassert>
+#include <cstring> // for std::memchr()
+
+namespace Net::Log {
+
+/**
+ * Returns the size of the fixed-size payload of the given attribute,
+ * 0 if the attribute has no payload, or -1 if the payload is a
+ * null-terminated string.
+ */
+static constexpr int
+GetPayloadSize(Attribute attribute) noexcept
+{
+	switch (attribute) {
+	case Attribute::TIMESTAMP:
+	case Attribute::LENGTH:
+	case Attribute::DURATION:
+		return sizeof(PackedBE64);
+
+	case Attribute::TRAFFIC:
+		return 2 * sizeof(PackedBE64);
+
+	case Attribute::HTTP_STATUS:
+		return sizeof(PackedBE16);
+
+	case Attribute::HTTP_METHOD:
+	case Attribute::TYPE:
+	case Attribute::CONTENT_TYPE:
+		return 1;
+
+	case Attribute::REMOTE_HOST:
+	case Attribute::SITE:
+	case Attribute::HTTP_URI:
+	case Attribute::HTTP_REFERER:
+	case Attribute::USER_AGENT:
+	case Attribute::HOST:
+	case Attribute::MESSAGE:
+	case Attribute::FORWARDED_TO:
+	case Attribute::JSON:
+	case Attribute::ANALYTICS_ID:
+	case Attribute::GENERATOR:
+		return -1;
+
+	case Attribute::NOP:
+		break;
+	}
+
+	/* unknown attributes are skipped (like the NOP attribute)
+	   just like ParseDatagram() does */
+	return 0;
+}
+
+IndexedDatagram::IndexedDatagram(std::span<const std::byte> d)
+{
+	auto magic = (const uint32_t *)(const void *)d.data();
+	if (d.size() < sizeof(*magic))
+		throw ProtocolError();
+
+	d = d.subspan(sizeof(*magic));
+
+	const bool has_crc = *magic == ToBE32(MAGIC_V2);
+	Crc::value_type expected_crc = 0;
+	if (has_crc) {
+		if (d.size() < sizeof(expected_crc))
+			throw ProtocolError();
+
+		expected_crc = FromBE32(*(const Crc::value_type *)(const void *)
+					(d.data() + d.size() - sizeof(expected_crc)));
+		d = d.first(d.size() - sizeof(expected_crc));
+	}
+
+	base = d.data();
+
+	const std::byte *p = d.data(), *const end = p + d.size();
+
+	Crc crc;
+
+	while (p != end) {
+		const auto attribute = static_cast<Attribute>(*p);
+		const std::byte *const value = p + 1;
+
+		const int size = GetPayloadSize(attribute);
+		if (size < 0) {
+			const void *nul = std::memchr(value, 0, end - value);
+			if (nul == nullptr)
+				/* null terminator not found */
+				throw ProtocolError();
+
+			p = (const std::byte *)nul + 1;
+		} else {
+			if (end - value < size)
+				throw ProtocolError();
+
+			p = value + size;
+		}
+
+		switch (attribute) {
+		case Attribute::HTTP_METHOD:
+			if (!http_method_is_valid(static_cast<HttpMethod>(*value)))
+				throw ProtocolError();
+			break;
+
+		case Attribute::HTTP_STATUS:
+			if (!http_status_is_valid(static_cast<HttpStatus>(uint16_t(*(const PackedBE16 *)value))))
+				throw ProtocolError();
+			break;
+
+		default:
+			break;
+		}
+
+		if (size != 0) {
+			/* only known attributes have a payload size */
+			assert(std::size_t(attribute) < offsets.size());
+			offsets[std::size_t(attribute)] = value - base + 1;
+		}
+
+		/* calculate the CRC in the same pass, while the
+		   attribute is hot in the CPU cache */
+		if (has_crc)
+			crc.Update({value - 1, p});
+	}
+
+	if (has_crc && crc.Finish() != expected_crc)
+		throw ProtocolError();
+}
+
+TimePoint
+IndexedDatagram::GetTimestamp() const noexcept
+{
+	const auto *p = Get(Attribute::TIMESTAMP);
+	return p != nullptr
+		? TimePoint{Duration{*(const PackedBE64 *)p}}
+		: TimePoint{};
+}
+
+HttpMethod
+IndexedDatagram::GetHttpMethod() const noexcept
+{
+	const auto *p = Get(Attribute::HTTP_METHOD);
+	return p != nullptr
+		? static_cast<HttpMethod>(*p)
+		: HttpMethod{};
+}
+
+HttpStatus
+IndexedDatagram::GetHttpStatus() const noexcept
+{
+	const auto *p = Get(Attribute::HTTP_STATUS);
+	return p != nullptr
+		? static_cast<HttpStatus>(uint16_t(*(const PackedBE16 *)p))
+		: HttpStatus{};
+}
+
+std::optional<uint_least64_t>
+IndexedDatagram::GetLength() const noexcept
+{
+	const auto *p = Get(Attribute::LENGTH);
+	if (p == nullptr)
+		return std::nullopt;
+
+	return *(const PackedBE64 *)p;
+}
+
+std::optional<IndexedDatagram::Traffic>
+IndexedDatagram::GetTraffic() const noexcept
+{
+	const auto *p = (const PackedBE64 *)Get(Attribute::TRAFFIC);
+	if (p == nullptr)
+		return std::nullopt;
+
+	return Traffic{p[0], p[1]};
+}
+
+std::optional<Duration>
+IndexedDatagram::GetDuration() const noexcept
+{
+	const auto *p = Get(Attribute::DURATION);
+	if (p == nullptr)
+		return std::nullopt;
+
+	return Duration{*(const PackedBE64 *)p};
+}
+
+Type
+IndexedDatagram::GetType() const noexcept
+{
+	const auto *p = Get(Attribute::TYPE);
+	const Type type = p != nullptr
+		? static_cast<Type>(*p)
+		: Type::UNSPECIFIED;
+
+	if (type == Type::UNSPECIFIED && Has(Attribute::HTTP_URI))
+		/* old clients don't send a type; attempt to guess the
+		   type (see FixUp() in Parser.cxx) */
+		return Has(Attribute::MESSAGE)
+			? Type::HTTP_ERROR
+			: Type::HTTP_ACCESS;
+
+	return type;
+}
+
+ContentType
+IndexedDatagram::GetContentType() const noexcept
+{
+	const auto *p = Get(Attribute::CONTENT_TYPE);
+	return p != nullptr
+		? static_cast<ContentType>(*p)
+		: ContentType{};
+}
+
+Datagram
+IndexedDatagram::ToDatagram() const noexcept
+{
+	Datagram d;
+	d.timestamp = GetTimestamp();
+	d.remote_host = GetString(Attribute::REMOTE_HOST);
+	d.host = GetString(Attribute::HOST);
+	d.site = GetString(Attribute::SITE);
+	d.analytics_id = GetString(Attribute::ANALYTICS_ID);
+	d.generator = GetString(Attribute::GENERATOR);
+	d.forwarded_to = GetString(Attribute::FORWARDED_TO);
+	d.http_uri = GetString(Attribute::HTTP_URI);
+	d.http_referer = GetString(Attribute::HTTP_REFERER);
+	d.user_agent = GetString(Attribute::USER_AGENT);
+	d.message = GetStringView(Attribute::MESSAGE);
+	d.json = GetStringView(Attribute::JSON);
+
+	if (const auto length = GetLength())
+		d.SetLength(*length);
+
+	if (const auto traffic = GetTraffic())
+		d.SetTraffic(traffic->received, traffic->sent);
+
+	if (const auto duration = GetDuration())
+		d.SetDuration(*duration);
+
+	d.http_method = GetHttpMethod();
+	d.http_status = GetHttpStatus();
+	d.type = GetType();
+	d.content_type = GetContentType();
+	return d;
+}
+
+} // namespace Net::Log
@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "Protocol.hxx"
+#include "Chrono.hxx"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+enum class HttpMethod : uint_least8_t;
+enum class HttpStatus : uint_least16_t;
+
+namespace Net::Log {
+
+enum class ContentType : uint8_t;
+struct Datagram;
+
+/**
+ * A lazy alternative to ParseDatagram(): the constructor validates
+ * the datagram and locates all attributes in a single pass (which
+ * also calculates the CRC), but values are only decoded on demand.
+ * This is cheaper for consumers which are only interested in a few
+ * attributes of each datagram.
+ *
+ * The object refers to the buffer passed to the constructor, which
+ * must remain valid.
+ */
+class IndexedDatagram {
+	static constexpr std::size_t N_ATTRIBUTES =
+		std::size_t(Attribute::CONTENT_TYPE) + 1;
+
+	const std::byte *base;
+
+	/**
+	 * For each known attribute: the offset of its value
+	 * relative to #base plus one, or 0 if the attribute is not
+	 * present.
+	 */
+	std::array<uint32_t, N_ATTRIBUTES> offsets{};
+
+public:
+	/**
+	 * Throws #ProtocolError on error (just like ParseDatagram()).
+	 */
+	explicit IndexedDatagram(std::span<const std::byte> d);
+
+	/**
+	 * Is the given attribute present?  Attributes unknown to
+	 * this parser are skipped, so this returns false for them.
+	 */
+	[[gnu::pure]]
+	bool Has(Attribute attribute) const noexcept {
+		return GetOffset(attribute) != 0;
+	}
+
+	/**
+	 * Returns the value of a string attribute or nullptr if it is
+	 * not present.
+	 */
+	[[gnu::pure]]
+	const char *GetString(Attribute attribute) const noexcept {
+		return (const char *)Get(attribute);
+	}
+
+	[[gnu::pure]]
+	std::string_view GetStringView(Attribute attribute) const noexcept {
+		const char *s = GetString(attribute);
+		return s != nullptr ? std::string_view{s} : std::string_view{};
+	}
+
+	[[gnu::pure]]
+	TimePoint GetTimestamp() const noexcept;
+
+	[[gnu::pure]]
+	HttpMethod GetHttpMethod() const noexcept;
+
+	[[gnu::pure]]
+	HttpStatus GetHttpStatus() const noexcept;
+
+	[[gnu::pure]]
+	std::optional<uint_least64_t> GetLength() const noexcept;
+
+	struct Traffic {
+		uint_least64_t received, sent;
+	};
+
+	[[gnu::pure]]
+	std::optional<Traffic> GetTraffic() const noexcept;
+
+	[[gnu::pure]]
+	std::optional<Duration> GetDuration() const noexcept;
+
+	/**
+	 * Returns the record type; like ParseDatagram(), this guesses
+	 * the type of records from old clients which don't send it.
+	 */
+	[[gnu::pure]]
+	Type GetType() const noexcept;
+
+	[[gnu::pure]]
+	ContentType GetContentType() const noexcept;
+
+	/**
+	 * Decode all attributes.  The result is the same as
+	 * ParseDatagram()'s.
+	 */
+	[[gnu::pure]]
+	Datagram ToDatagram() const noexcept;
+
+private:
+	[[gnu::pure]]
+	uint32_t GetOffset(Attribute attribute) const noexcept {
+		/* the caller may pass an attribute which was added to
+		   the protocol after #N_ATTRIBUTES was defined (or a
+		   value received from a peer) */
+		return std::size_t(attribute) < offsets.size()
+			? offsets[std::size_t(attribute)]
+			: 0;
+	}
+
+	[[gnu::pure]]
+	const std::byte *Get(Attribute attribute) const noexcept {
+		const auto offset = GetOffset(attribute);
+		return offset > 0 ? base + offset - 1 : nullptr;
+	}
+};
+
+} // namespace Net::Log
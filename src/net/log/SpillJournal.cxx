@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "SpillJournal.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+#include "system/Error.hxx"
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace Net::Log {
+
+/**
+ * The header at the beginning of the journal file.  The positions
+ * are byte counters which are never wrapped; the offset within the
+ * ring buffer is obtained with the modulo operator.
+ */
+struct SpillJournal::Header {
+	static constexpr uint32_t MAGIC = 0x534a4c31; // "SJL1"
+
+	uint32_t magic;
+	uint32_t reserved;
+
+	uint64_t capacity;
+
+	/**
+	 * The position of the oldest record.
+	 */
+	uint64_t head;
+
+	/**
+	 * The position where the next record will be written.
+	 */
+	uint64_t tail;
+};
+
+/**
+ * A record length which means that the remaining bytes until the end
+ * of the ring buffer are unused, and the next record starts at
+ * offset 0.
+ */
+static constexpr uint32_t WRAP_MARKER = UINT32_MAX;
+
+static constexpr std::size_t
+PadSize(std::size_t size) noexcept
+{
+	return (size + 3) & ~std::size_t{3};
+}
+
+SpillJournal::SpillJournal(const char *path, std::size_t size)
+{
+	if (size < sizeof(Header) + 1024)
+		throw std::invalid_argument("Spill journal is too small");
+
+	capacity = (size - sizeof(Header)) & ~std::size_t{3};
+	size = sizeof(Header) + capacity;
+
+	UniqueFileDescriptor fd;
+	if (!fd.Open(path, O_RDWR|O_CREAT|O_NOCTTY, 0600))
+		throw MakeErrno("Failed to open spill journal");
+
+	const bool reset = fd.GetSize() != off_t(size);
+	if (reset && ftruncate(fd.Get(), size) < 0)
+		throw MakeErrno("Failed to resize spill journal");
+
+	void *p = mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_SHARED,
+		       fd.Get(), 0);
+	if (p == MAP_FAILED)
+		throw MakeErrno("Failed to map spill journal");
+
+	header = static_cast<Header *>(p);
+	data = reinterpret_cast<std::byte *>(header + 1);
+
+	if (reset || header->magic != Header::MAGIC ||
+	    header->capacity != capacity ||
+	    header->head > header->tail ||
+	    header->tail - header->head > capacity ||
+	    header->head % 4 != 0 || header->tail % 4 != 0) {
+		/* new or inconsistent file: start from scratch */
+		header->magic = Header::MAGIC;
+		header->reserved = 0;
+		header->capacity = capacity;
+		header->head = header->tail = 0;
+	}
+}
+
+SpillJournal::~SpillJournal() noexcept
+{
+	munmap(header, sizeof(*header) + capacity);
+}
+
+bool
+SpillJournal::empty() const noexcept
+{
+	return header->head == header->tail;
+}
+
+std::size_t
+SpillJournal::GetUsed() const noexcept
+{
+	return header->tail - header->head;
+}
+
+inline uint32_t &
+SpillJournal::LengthAt(std::size_t position) const noexcept
+{
+	assert(position % 4 == 0);
+	assert(position + sizeof(uint32_t) <= capacity);
+
+	return *reinterpret_cast<uint32_t *>(data + position);
+}
+
+void
+SpillJournal::Clear() noexcept
+{
+	header->head = header->tail;
+}
+
+bool
+SpillJournal::Push(std::span<const std::byte> datagram) noexcept
+{
+	const std::size_t need = sizeof(uint32_t) + PadSize(datagram.size());
+
+	std::size_t position = header->tail % capacity;
+	const std::size_t until_end = capacity - position;
+
+	/* if the record doesn't fit before the end of the ring
+	   buffer, the rest is skipped */
+	const std::size_t skip = need > until_end ? until_end : 0;
+
+	if (datagram.size() >= WRAP_MARKER ||
+	    need + skip > capacity - GetUsed())
+		return false;
+
+	if (skip > 0) {
+		LengthAt(position) = WRAP_MARKER;
+		position = 0;
+	}
+
+	LengthAt(position) = datagram.size();
+	std::memcpy(data + position + sizeof(uint32_t),
+		    datagram.data(), datagram.size());
+
+	/* update the tail only after the record has been written
+	   completely */
+	header->tail += skip + need;
+	return true;
+}
+
+std::span<const std::byte>
+SpillJournal::Front() noexcept
+{
+	if (empty())
+		return {};
+
+	std::size_t position = header->head % capacity;
+	uint32_t length = LengthAt(position);
+	if (length == WRAP_MARKER) {
+		header->head += capacity - position;
+		if (empty()) {
+			/* a wrap marker without a record after it */
+			Clear();
+			return {};
+		}
+
+		position = 0;
+		length = LengthAt(position);
+	}
+
+	if (sizeof(uint32_t) + PadSize(length) > capacity - position ||
+	    sizeof(uint32_t) + PadSize(length) > GetUsed()) {
+		/* corrupt */
+		Clear();
+		return {};
+	}
+
+	return {data + position + sizeof(uint32_t), length};
+}
+
+void
+SpillJournal::Pop() noexcept
+{
+	const auto datagram = Front();
+	if (datagram.data() == nullptr)
+		return;
+
+	header->head += sizeof(uint32_t) + PadSize(datagram.size());
+}
+
+} // namespace Net::Log
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace Net::Log {
+
+/**
+ * A persistent FIFO of serialized log datagrams (see Serialize()),
+ * stored in a memory-mapped ring file.  It is used to keep datagrams
+ * which could not be sent because the log server was slow or
+ * unavailable, until they can be replayed.
+ *
+ * The contents survive a restart of the process; a journal file
+ * whose header is inconsistent is reset.  Each datagram carries its
+ * own CRC, which the consumer should verify with ParseDatagram().
+ *
+ * This class is not thread-safe.
+ */
+class SpillJournal {
+	struct Header;
+
+	Header *header;
+
+	std::byte *data;
+
+	/**
+	 * The size of the ring buffer (#data) in bytes; a multiple
+	 * of 4.
+	 */
+	std::size_t capacity;
+
+public:
+	/**
+	 * Open (or create) the journal file.
+	 *
+	 * Throws on error.
+	 *
+	 * @param size the total size of the file in bytes; if an
+	 * existing file has a different size, it is reset
+	 */
+	SpillJournal(const char *path, std::size_t size);
+
+	~SpillJournal() noexcept;
+
+	SpillJournal(const SpillJournal &) = delete;
+	SpillJournal &operator=(const SpillJournal &) = delete;
+
+	[[gnu::pure]]
+	bool empty() const noexcept;
+
+	/**
+	 * @return the number of bytes occupied in the ring buffer
+	 */
+	[[gnu::pure]]
+	std::size_t GetUsed() const noexcept;
+
+	/**
+	 * Append a datagram to the end of the journal.
+	 *
+	 * @return false if the journal is full (the datagram is not
+	 * added)
+	 */
+	bool Push(std::span<const std::byte> datagram) noexcept;
+
+	/**
+	 * Return the oldest datagram without removing it.  Returns an
+	 * empty span if the journal is empty.  If corruption is
+	 * detected, the journal is reset.
+	 */
+	std::span<const std::byte> Front() noexcept;
+
+	/**
+	 * Remove the oldest datagram (returned by Front()).
+	 */
+	void Pop() noexcept;
+
+	/**
+	 * Discard all datagrams.
+	 */
+	void Clear() noexcept;
+
+private:
+	uint32_t &LengthAt(std::size_t position) const noexcept;
+};
+
+} // namespace Net::Log
@@ -6,22 +6,26 @@
 #include "ProcessHandle.hxx"
 #include "CompletionHandler.hxx"
 #include "IProtocol.hxx"
+#include "ExecBatch.hxx"
 #include "Builder.hxx"
 #include "Parser.hxx"
 #include "Prepared.hxx"
 #include "CgroupOptions.hxx"
 #include "Mount.hxx"
 #include "ExitListener.hxx"
+#include "event/Loop.hxx"
 #include "lib/fmt/ExceptionFormatter.hxx"
 #include "system/Error.hxx"
 #include "net/SocketPair.hxx"
 #include "util/Cancellable.hxx"
+#include "util/StaticVector.hxx"
 
 #include <fmt/core.h>
 
 #include <stdexcept>
 
 #include <assert.h>
+#include <fcntl.h> // for F_DUPFD_CLOEXEC
 #include <stdio.h>
 #include <sys/signal.h>
 
@@ -32,14 +36,21 @@ class SpawnServerClient::SpawnQueueItem final
 {
 	const EnqueueCallback callback;
 
+	const Event::TimePoint enqueue_time;
+
 public:
 	SpawnQueueItem(EnqueueCallback _callback,
+		       Event::TimePoint _enqueue_time,
 		       CancellablePointer &cancel_ptr) noexcept
-		:callback(_callback)
+		:callback(_callback), enqueue_time(_enqueue_time)
 	{
 		cancel_ptr = *this;
 	}
 
+	Event::TimePoint GetEnqueueTime() const noexcept {
+		return enqueue_time;
+	}
+
 	void RemoveAndInvoke() noexcept {
 		unlink();
 		auto _callback = callback;
@@ -61,12 +72,19 @@ struct SpawnServerClient::ChildProcess final
 
 	const unsigned pid;
 
+	/**
+	 * When was the EXEC request submitted?  Used to measure
+	 * the spawn latency.
+	 */
+	const Event::TimePoint exec_time;
+
 	SpawnCompletionHandler *completion_handler = nullptr;
 
 	ExitListener *listener = nullptr;
 
-	ChildProcess(SpawnServerClient &_client, unsigned _pid) noexcept
-		:client(_client), pid(_pid) {}
+	ChildProcess(SpawnServerClient &_client, unsigned _pid,
+		     Event::TimePoint _exec_time) noexcept
+		:client(_client), pid(_pid), exec_time(_exec_time) {}
 
 	~ChildProcess() noexcept override {
 		if (is_linked())
@@ -107,6 +125,8 @@ SpawnServerClient::SpawnServerClient(EventLoop &event_loop,
 	:config(_config),
 	 event(event_loop, BIND_THIS_METHOD(OnSocketEvent), _socket.Release()),
 	 defer_spawn_queue(event_loop, BIND_THIS_METHOD(OnDeferredSpawnQueue)),
+	 defer_flush_exec_batch(event_loop,
+				BIND_THIS_METHOD(OnDeferredFlushExecBatch)),
 	 cgroups(_cgroups),
 	 verify(_verify)
 {
@@ -165,6 +185,94 @@ SpawnServerClient::Send(const SpawnSerializer &s)
 	::Send<MAX_FDS>(event.GetSocket(), s);
 }
 
+inline void
+SpawnServerClient::QueueExec(const SpawnSerializer &s)
+{
+	/* strip the SpawnRequestCommand::EXEC byte */
+	const auto payload = s.GetPayload().subspan(1);
+	const auto fds = s.GetFds();
+
+	const std::size_t entry_size = sizeof(SpawnExecBatchHeader) + payload.size();
+	if (1 + entry_size > SPAWN_MAX_REQUEST_SIZE) {
+		/* too large for a batch; send it as a classic EXEC
+		   request (after all older requests) */
+		FlushExecBatch();
+		Send(s);
+		++stats.n_exec_datagrams;
+		return;
+	}
+
+	if (exec_batch.size() + entry_size > SPAWN_MAX_REQUEST_SIZE ||
+	    exec_batch_fds.size() + fds.size() > SPAWN_MAX_REQUEST_FDS)
+		FlushExecBatch();
+
+	/* duplicate the file descriptors first, because this may
+	   fail */
+	const std::size_t old_n_fds = exec_batch_fds.size();
+	for (const auto fd : fds) {
+		UniqueFileDescriptor copy{fcntl(fd.Get(), F_DUPFD_CLOEXEC, 0)};
+		if (!copy.IsDefined()) {
+			exec_batch_fds.resize(old_n_fds);
+			throw MakeErrno("Failed to duplicate file descriptor");
+		}
+
+		exec_batch_fds.emplace_back(std::move(copy));
+	}
+
+	if (exec_batch.empty()) {
+		exec_batch.reserve(SPAWN_MAX_REQUEST_SIZE);
+		exec_batch.push_back(static_cast<std::byte>(SpawnRequestCommand::EXEC_BATCH));
+	}
+
+	AppendExecBatchEntry(exec_batch, payload, fds.size());
+
+	/* send the batch at the end of this event loop iteration,
+	   giving other callers the chance to add more requests */
+	defer_flush_exec_batch.Schedule();
+}
+
+void
+SpawnServerClient::FlushExecBatch()
+{
+	if (exec_batch.empty())
+		return;
+
+	StaticVector<FileDescriptor, SPAWN_MAX_REQUEST_FDS> fds;
+	for (const auto &i : exec_batch_fds)
+		fds.push_back(i);
+
+	::Send<SPAWN_MAX_REQUEST_FDS>(event.GetSocket(), exec_batch, fds);
+	++stats.n_exec_datagrams;
+
+	exec_batch.clear();
+	exec_batch_fds.clear();
+	defer_flush_exec_batch.Cancel();
+}
+
+void
+SpawnServerClient::OnDeferredFlushExecBatch() noexcept
+{
+	if (!event.IsDefined())
+		return;
+
+	try {
+		FlushExecBatch();
+	} catch (const std::system_error &e) {
+		if (IsErrno(e, EAGAIN)) {
+			/* the socket buffer is full; try again as
+			   soon as it becomes writable */
+			event.ScheduleWrite();
+			return;
+		}
+
+		fmt::print(stderr, "Spawner error: {}\n", std::current_exception());
+		Close();
+	} catch (...) {
+		fmt::print(stderr, "Spawner error: {}\n", std::current_exception());
+		Close();
+	}
+}
+
 UniqueSocketDescriptor
 SpawnServerClient::Connect()
 {
@@ -454,16 +562,20 @@ SpawnServerClient::SpawnChildProcess(const char *name,
 	}
 
 	try {
-		Send(s.GetPayload(), s.GetFds());
+		QueueExec(s);
 	} catch (const std::runtime_error &e) {
 		std::throw_with_nested(std::runtime_error("Spawn server failed"));
 	}
 
 	++n_pending_execs;
-	if (IsUnderPressure())
+	++stats.n_execs;
+	if (IsUnderPressure()) {
 		defer_spawn_queue.Cancel();
+		throttle.SetSaturated();
+	}
 
-	auto handle = std::make_unique<ChildProcess>(*this, pid);
+	auto handle = std::make_unique<ChildProcess>(*this, pid,
+						     GetEventLoop().SteadyNow());
 	processes.insert(*handle);
 	return handle;
 }
@@ -472,7 +584,9 @@ void
 SpawnServerClient::Enqueue(EnqueueCallback callback, CancellablePointer &cancel_ptr) noexcept
 {
 	if (IsUnderPressure()) {
-		auto *item = new SpawnQueueItem(callback, cancel_ptr);
+		auto *item = new SpawnQueueItem(callback,
+						GetEventLoop().SteadyNow(),
+						cancel_ptr);
 		spawn_queue.push_back(*item);
 	} else
 		callback();
@@ -483,10 +597,17 @@ SpawnServerClient::OnDeferredSpawnQueue() noexcept
 {
 	assert(!IsUnderPressure());
 
-	if (spawn_queue.empty())
-		return;
+	const auto now = GetEventLoop().SteadyNow();
 
-	spawn_queue.front().RemoveAndInvoke();
+	/* invoke several callbacks at once, so their EXEC requests
+	   can be sent in one batch; the limit prevents blocking
+	   the event loop for too long */
+	for (unsigned n = 0; n < 64 && !spawn_queue.empty() &&
+		     !IsUnderPressure(); ++n) {
+		auto &item = spawn_queue.front();
+		stats.queue_latency.Add(now - item.GetEnqueueTime());
+		item.RemoveAndInvoke();
+	}
 
 	if (!IsUnderPressure() && !spawn_queue.empty())
 		defer_spawn_queue.Schedule();
@@ -522,7 +643,14 @@ SpawnServerClient::HandleExecCompleteMessage(SpawnPayload payload)
 		payload.ReadUnsigned(pid);
 		const char *error = payload.ReadString();
 
+		if (*error != 0)
+			++stats.n_errors;
+
 		if (const auto i = processes.find(pid); i != processes.end()) {
+			const auto latency = GetEventLoop().SteadyNow() - i->exec_time;
+			stats.exec_latency.Add(latency);
+			throttle.OnComplete(latency);
+
 			// TODO forward errors
 			if (i->completion_handler) {
 				if (*error == 0)
@@ -645,9 +773,12 @@ try {
 		throw std::runtime_error("Spawner hung up");
 
 	if (events & event.WRITE) {
+		/* EXEC requests must be sent before KILL requests
+		   which may refer to them */
+		FlushExecBatch();
 		FlushKillQueue();
 
-		if (kill_queue.empty())
+		if (kill_queue.empty() && exec_batch.empty())
 			event.CancelWrite();
 	}
 
@@ -6,6 +6,7 @@
 
 #include "Interface.hxx"
 #include "Config.hxx"
+#include "Throttle.hxx"
 #include "event/DeferEvent.hxx"
 #include "event/SocketEvent.hxx"
 #include "net/UniqueSocketDescriptor.hxx"
@@ -13,17 +14,62 @@
 #include "io/UniqueFileDescriptor.hxx"
 #include "util/IntrusiveHashSet.hxx"
 #include "util/IntrusiveList.hxx"
+#include "util/Histogram.hxx"
 #include "config.h"
 
+#include <cstdint>
 #include <forward_list>
 #include <map>
 #include <memory>
 #include <span>
+#include <vector>
 
 struct PreparedChildProcess;
 class SpawnPayload;
 class SpawnSerializer;
 
+/**
+ * Bucket bounds for spawn latencies (in nanoseconds): 100us, 200us,
+ * 400us, ..., ~0.8s.
+ */
+inline constexpr auto SPAWN_LATENCY_BOUNDS =
+	MakeExponentialBounds<14>(100000, 1);
+
+/**
+ * Statistics collected by #SpawnServerClient.
+ */
+struct SpawnClientStats {
+	using LatencyHistogram = Histogram<SPAWN_LATENCY_BOUNDS>;
+
+	/**
+	 * The duration from SpawnChildProcess() until the spawner
+	 * reported completion.
+	 */
+	LatencyHistogram exec_latency;
+
+	/**
+	 * The duration Enqueue() callbacks were delayed because the
+	 * spawner was under pressure.
+	 */
+	LatencyHistogram queue_latency;
+
+	/**
+	 * The number of EXEC requests.
+	 */
+	uint_least64_t n_execs = 0;
+
+	/**
+	 * The number of EXEC requests which have failed.
+	 */
+	uint_least64_t n_errors = 0;
+
+	/**
+	 * The number of datagrams carrying EXEC requests.  Compare
+	 * with #n_execs to see how well batching works.
+	 */
+	uint_least64_t n_exec_datagrams = 0;
+};
+
 class SpawnServerClient final : public SpawnService {
 	struct ChildProcess;
 
@@ -61,6 +107,11 @@ class SpawnServerClient final : public SpawnService {
 
 	DeferEvent defer_spawn_queue;
 
+	/**
+	 * Sends #exec_batch.
+	 */
+	DeferEvent defer_flush_exec_batch;
+
 	MultiReceiveMessage receive{16, 1024, CMSG_SPACE(sizeof(int)), 1};
 
 	unsigned last_pid = 0;
@@ -71,7 +122,26 @@ class SpawnServerClient final : public SpawnService {
 	 */
 	unsigned n_pending_execs = 0;
 
-	static constexpr unsigned THROTTLE_EXECS_THRESHOLD = 8;
+	/**
+	 * Decides how large #n_pending_execs may grow.
+	 */
+	SpawnThrottle throttle;
+
+	/**
+	 * EXEC requests which have not yet been sent, in the
+	 * #SpawnRequestCommand::EXEC_BATCH format.  Empty if there
+	 * are none.
+	 */
+	std::vector<std::byte> exec_batch;
+
+	/**
+	 * Duplicates of the file descriptors referenced by
+	 * #exec_batch (because the caller may close the originals
+	 * as soon as SpawnChildProcess() returns).
+	 */
+	std::vector<UniqueFileDescriptor> exec_batch_fds;
+
+	SpawnClientStats stats;
 
 	/**
 	 * An O_PATH file descriptor of the cgroup managed by the
@@ -113,6 +183,22 @@ public:
 		return cgroups;
 	}
 
+	const SpawnClientStats &GetStats() const noexcept {
+		return stats;
+	}
+
+	/**
+	 * The number of EXEC requests which may currently be in
+	 * flight before Enqueue() starts delaying callbacks.
+	 */
+	unsigned GetThrottleWindow() const noexcept {
+		return throttle.GetWindow();
+	}
+
+	unsigned GetPendingExecs() const noexcept {
+		return n_pending_execs;
+	}
+
 	void Shutdown() noexcept;
 
 	UniqueSocketDescriptor Connect();
@@ -146,6 +232,23 @@ private:
 		  std::span<const FileDescriptor> fds);
 	void Send(const SpawnSerializer &s);
 
+	/**
+	 * Add an EXEC request to #exec_batch (or send it right away
+	 * if it is too large for a batch).
+	 *
+	 * Throws on error.
+	 */
+	void QueueExec(const SpawnSerializer &s);
+
+	/**
+	 * Send #exec_batch (if not empty).
+	 *
+	 * Throws on error.
+	 */
+	void FlushExecBatch();
+
+	void OnDeferredFlushExecBatch() noexcept;
+
 	void HandleExecCompleteMessage(SpawnPayload payload);
 	void HandleOneExit(SpawnPayload &payload);
 	void HandleExitMessage(SpawnPayload payload);
@@ -163,7 +266,7 @@ private:
 	void ReceiveAndHandle();
 
 	bool IsUnderPressure() noexcept {
-		return n_pending_execs >= THROTTLE_EXECS_THRESHOLD;
+		return n_pending_execs >= throttle.GetWindow();
 	}
 
 	void OnDeferredSpawnQueue() noexcept;
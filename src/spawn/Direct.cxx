@@ -25,7 +25,7 @@
 #include "util/ScopeExit.hxx"
 
 #ifdef HAVE_LIBSECCOMP
-#include "SeccompFilter.hxx"
+#include "SeccompProgram.hxx"
 #include "SyscallFilter.hxx"
 #endif
 
@@ -51,6 +51,8 @@
 #define PR_SET_NO_NEW_PRIVS 38
 #endif
 
+namespace Seccomp { class Program; }
+
 static void
 CheckedDup2(FileDescriptor oldfd, FileDescriptor newfd) noexcept
 {
@@ -138,6 +140,7 @@ static void
 Exec(const char *path, PreparedChildProcess &&p,
      const bool skip_uid_gid,
      const char *name,
+     [[maybe_unused]] const Seccomp::Program *seccomp_program,
      UniqueFileDescriptor &&userns_map_pipe_r,
      UniqueFileDescriptor &&userns_create_pipe_w,
      UniqueFileDescriptor &&wait_pipe_r,
@@ -260,38 +263,20 @@ try {
 		prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0);
 
 #ifdef HAVE_LIBSECCOMP
-	try {
-		Seccomp::Filter sf(SCMP_ACT_ALLOW);
-
-#ifdef PR_SET_NO_NEW_PRIVS
-		/* don't enable PR_SET_NO_NEW_PRIVS unless the feature
-		   was explicitly enabled */
-		if (!p.no_new_privs)
-			sf.SetAttributeNoThrow(SCMP_FLTATR_CTL_NNP, 0);
-#endif
-
-		sf.AddSecondaryArchs();
-
-		BuildSyscallFilter(sf);
-
-		if (p.forbid_user_ns)
-			ForbidUserNamespace(sf);
-
-		if (p.forbid_multicast)
-			ForbidMulticast(sf);
-
-		if (p.forbid_bind)
-			ForbidBind(sf);
-
-		sf.Load();
-	} catch (const std::runtime_error &e) {
-		if (p.HasSyscallFilter())
-			/* filter options have been explicitly enabled, and thus
-			   failure to set up the filter are fatal */
-			throw;
-
-		fmt::print(stderr, "Failed to setup seccomp filter for {:?}: {}\n",
-			   path, e.what());
+	/* the filter has been compiled by the parent process; all
+	   that's left to do is a single seccomp() system call */
+	if (seccomp_program != nullptr) {
+		try {
+			seccomp_program->Load();
+		} catch (const std::runtime_error &e) {
+			if (p.HasSyscallFilter())
+				/* filter options have been explicitly enabled, and thus
+				   failure to set up the filter are fatal */
+				throw;
+
+			fmt::print(stderr, "Failed to setup seccomp filter for {:?}: {}\n",
+				   path, e.what());
+		}
 	}
 #endif // HAVE_LIBSECCOMP
 
@@ -400,6 +385,27 @@ SpawnChildProcess(PreparedChildProcess &&params,
 
 	const char *path = params.Finish();
 
+	const Seccomp::Program *seccomp_program = nullptr;
+
+#ifdef HAVE_LIBSECCOMP
+	/* compile the seccomp filter here (or obtain it from the
+	   cache) instead of letting each child process run the
+	   libseccomp compiler */
+	try {
+		seccomp_program = &GetSyscallFilterProgram(params.forbid_user_ns,
+							   params.forbid_multicast,
+							   params.forbid_bind);
+	} catch (const std::runtime_error &e) {
+		if (params.HasSyscallFilter())
+			/* filter options have been explicitly enabled, and thus
+			   failure to set up the filter are fatal */
+			throw;
+
+		fmt::print(stderr, "Failed to setup seccomp filter for {:?}: {}\n",
+			   path, e.what());
+	}
+#endif // HAVE_LIBSECCOMP
+
 	/**
 	 * If an error occurs during setup, the child process will
 	 * write an error message to this pipe.
@@ -549,6 +555,7 @@ SpawnChildProcess(PreparedChildProcess &&params,
 		Exec(path, std::move(params),
 		     skip_uid_gid,
 		     name,
+		     seccomp_program,
 		     std::move(userns_map_pipe_r),
 		     std::move(userns_create_pipe_w),
 		     std::move(wait_pipe_r),
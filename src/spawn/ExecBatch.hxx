@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "IProtocol.hxx"
+#include "Parser.hxx"
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+/*
+ * Helpers for the framing of SpawnRequestCommand::EXEC_BATCH
+ * payloads, shared by #SpawnServerClient and #SpawnServerConnection.
+ */
+
+/**
+ * Append one EXEC request to an EXEC_BATCH payload.
+ *
+ * Throws on out-of-memory.
+ *
+ * @param payload the payload of the EXEC request (without the
+ * command byte)
+ * @param n_fds the number of file descriptors consumed by this
+ * request
+ */
+inline void
+AppendExecBatchEntry(std::vector<std::byte> &batch,
+		     std::span<const std::byte> payload, std::size_t n_fds)
+{
+	assert(payload.size() <= UINT16_MAX);
+	assert(n_fds <= UINT8_MAX);
+
+	SpawnExecBatchHeader header{};
+	header.size = payload.size();
+	header.n_fds = n_fds;
+
+	const auto header_bytes = std::as_bytes(std::span{&header, 1});
+	batch.insert(batch.end(), header_bytes.begin(), header_bytes.end());
+	batch.insert(batch.end(), payload.begin(), payload.end());
+}
+
+/**
+ * Validate the framing of a whole EXEC_BATCH payload (without the
+ * command byte): each entry must be complete and begin with a
+ * request id, and the number of file descriptors must match.  This
+ * does not look inside the EXEC payloads.
+ *
+ * Throws #MalformedSpawnPayloadError on error.
+ */
+inline void
+CheckExecBatch(SpawnPayload payload, std::size_t n_fds)
+{
+	std::size_t total_fds = 0;
+	while (!payload.empty()) {
+		SpawnExecBatchHeader header;
+		payload.ReadT(header);
+
+		unsigned id;
+		payload.Split(header.size).ReadUnsigned(id);
+
+		total_fds += header.n_fds;
+	}
+
+	if (total_fds != n_fds)
+		throw MalformedSpawnPayloadError();
+}
+
+/**
+ * Invoke a function for each entry of an EXEC_BATCH payload which
+ * has already been validated with CheckExecBatch().
+ *
+ * If @a f throws #MalformedSpawnPayloadError, then @a on_malformed
+ * is invoked with the request id and the remaining entries are
+ * still handled, because the client expects a reply for each of
+ * them.
+ *
+ * @param f a function which gets the EXEC payload (a
+ * #SpawnPayload) and the number of file descriptors (unsigned)
+ * @param on_malformed a function which gets the request id
+ * (unsigned)
+ */
+template<typename F, typename M>
+void
+ForEachExecBatchEntry(SpawnPayload payload, F &&f, M &&on_malformed)
+{
+	while (!payload.empty()) {
+		SpawnExecBatchHeader header;
+		payload.ReadT(header);
+
+		const auto exec_payload = payload.Split(header.size);
+
+		try {
+			f(exec_payload, unsigned{header.n_fds});
+		} catch (MalformedSpawnPayloadError) {
+			unsigned id;
+			SpawnPayload{exec_payload}.ReadUnsigned(id);
+			on_malformed(id);
+		}
+	}
+}
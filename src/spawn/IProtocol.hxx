@@ -6,6 +6,8 @@
 
 #include "spawn/config.h"
 
+#include <cstddef>
+
 #include <stdint.h>
 
 /*
@@ -16,12 +18,53 @@
  * as root).
  */
 
+/**
+ * The maximum size of one datagram sent to the spawner.
+ */
+static constexpr std::size_t SPAWN_MAX_REQUEST_SIZE = 8192;
+
+/**
+ * The maximum number of file descriptors in one datagram sent to
+ * the spawner.
+ */
+static constexpr std::size_t SPAWN_MAX_REQUEST_FDS = 32;
+
 enum class SpawnRequestCommand : uint8_t {
 	CONNECT,
 	EXEC,
 	KILL,
+
+	/**
+	 * Multiple EXEC requests in one datagram.  Each one is
+	 * prefixed with a #SpawnExecBatchHeader, followed by the
+	 * payload of an EXEC request (without the command byte).
+	 * The file descriptors of all requests are concatenated in
+	 * the same order.
+	 */
+	EXEC_BATCH,
 };
 
+struct SpawnExecBatchHeader {
+	/**
+	 * The size of the EXEC payload following this header.
+	 */
+	uint16_t size;
+
+	/**
+	 * The number of file descriptors consumed by this EXEC
+	 * request.
+	 */
+	uint8_t n_fds;
+
+	/**
+	 * Unused; always zero.  This makes the padding explicit, so
+	 * no uninitialized byte gets sent to the spawner.
+	 */
+	uint8_t reserved;
+};
+
+static_assert(sizeof(SpawnExecBatchHeader) == 4);
+
 enum class SpawnExecCommand : uint8_t {
 	EXEC_FUNCTION,
 	EXEC_PATH,
@@ -58,6 +58,19 @@ public:
 		ReadT(value_r);
 	}
 
+	/**
+	 * Split the next #size bytes off this payload and return
+	 * them as a separate #SpawnPayload.
+	 */
+	SpawnPayload Split(std::size_t size) {
+		if (GetSize() < size)
+			throw MalformedSpawnPayloadError();
+
+		SpawnPayload result{{begin, size}};
+		begin += size;
+		return result;
+	}
+
 	const char *ReadString() {
 		auto n = std::find(begin, end, std::byte{0});
 		if (n == end)
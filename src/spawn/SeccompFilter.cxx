@@ -3,6 +3,14 @@
 // author: Max Kellermann <mk@cm4all.com>
 
 #include "SeccompFilter.hxx"
+#include "SeccompProgram.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+
+#include <sys/mman.h> // for memfd_create()
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/seccomp.h>
 
 namespace Seccomp {
 
@@ -29,6 +37,66 @@ Filter::Load() const
 		throw MakeErrno(-error, "seccomp_load() failed");
 }
 
+#if SCMP_VER_MAJOR > 2 || (SCMP_VER_MAJOR == 2 && SCMP_VER_MINOR >= 6)
+
+Program
+Filter::Export() const
+{
+	size_t size;
+	int error = seccomp_export_bpf_mem(ctx, nullptr, &size);
+	if (error < 0)
+		throw MakeErrno(-error, "seccomp_export_bpf_mem() failed");
+
+	std::vector<struct sock_filter> instructions(size / sizeof(struct sock_filter));
+	error = seccomp_export_bpf_mem(ctx, instructions.data(), &size);
+	if (error < 0)
+		throw MakeErrno(-error, "seccomp_export_bpf_mem() failed");
+
+	instructions.resize(size / sizeof(struct sock_filter));
+	return Program{std::move(instructions)};
+}
+
+#else
+
+Program
+Filter::Export() const
+{
+	/* libseccomp < 2.6 can only export to a file descriptor */
+	UniqueFileDescriptor fd{memfd_create("seccomp", MFD_CLOEXEC)};
+	if (!fd.IsDefined())
+		throw MakeErrno("memfd_create() failed");
+
+	int error = seccomp_export_bpf(ctx, fd.Get());
+	if (error < 0)
+		throw MakeErrno(-error, "seccomp_export_bpf() failed");
+
+	struct stat st;
+	if (fstat(fd.Get(), &st) < 0)
+		throw MakeErrno("fstat() failed");
+
+	std::vector<struct sock_filter> instructions(st.st_size / sizeof(struct sock_filter));
+	const std::size_t nbytes = instructions.size() * sizeof(struct sock_filter);
+
+	if (fd.ReadAt(0, instructions.data(), nbytes) != static_cast<ssize_t>(nbytes))
+		throw std::runtime_error("Failed to read the exported seccomp filter");
+
+	return Program{std::move(instructions)};
+}
+
+#endif
+
+void
+Program::Load() const
+{
+	const struct sock_fprog prog{
+		.len = static_cast<unsigned short>(instructions.size()),
+		.filter = const_cast<struct sock_filter *>(instructions.data()),
+	};
+
+	if (syscall(__NR_seccomp, SECCOMP_SET_MODE_FILTER, 0, &prog) < 0)
+		throw MakeErrno("seccomp(SECCOMP_SET_MODE_FILTER) failed");
+}
+
 void
 Filter::AddArch(uint32_t arch_token)
 {
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include <linux/filter.h> // for struct sock_filter
+
+#include <vector>
+
+namespace Seccomp {
+
+/**
+ * A compiled seccomp BPF program, e.g. exported from a
+ * #Seccomp::Filter by Filter::Export().  Unlike a #Seccomp::Filter,
+ * loading it does not need to run the libseccomp compiler, which
+ * makes it cheap to load the same program into many (freshly
+ * cloned) processes.
+ */
+class Program {
+	std::vector<struct sock_filter> instructions;
+
+public:
+	explicit Program(std::vector<struct sock_filter> &&_instructions) noexcept
+		:instructions(std::move(_instructions)) {}
+
+	bool empty() const noexcept {
+		return instructions.empty();
+	}
+
+	/**
+	 * Install this program as a seccomp filter for the current
+	 * thread with a single seccomp() system call.  This does not
+	 * set #PR_SET_NO_NEW_PRIVS; without it, the caller needs
+	 * #CAP_SYS_ADMIN.
+	 *
+	 * This method does not allocate memory, and is therefore
+	 * safe to call in a child process created with clone().
+	 *
+	 * Throws std::system_error on error.
+	 */
+	void Load() const;
+};
+
+} // namespace Seccomp
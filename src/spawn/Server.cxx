@@ -5,6 +5,7 @@
 #include "Server.hxx"
 #include "Config.hxx"
 #include "IProtocol.hxx"
+#include "ExecBatch.hxx"
 #include "Parser.hxx"
 #include "Builder.hxx"
 #include "Prepared.hxx"
@@ -193,6 +194,7 @@ private:
 			PreparedChildProcess &&p);
 
 	void HandleExecMessage(SpawnPayload payload, SpawnFdList &&fds);
+	void HandleExecBatchMessage(SpawnPayload payload, SpawnFdList &&fds);
 	void HandleOneKill(SpawnPayload &payload);
 	void HandleKillMessage(SpawnPayload payload, SpawnFdList &&fds);
 	void HandleMessage(std::span<const std::byte> payload, SpawnFdList &&fds);
@@ -834,6 +836,34 @@ SpawnServerConnection::HandleExecMessage(SpawnPayload payload,
 	}
 }
 
+inline void
+SpawnServerConnection::HandleExecBatchMessage(SpawnPayload payload,
+					      SpawnFdList &&fds)
+{
+	/* validate the framing of the whole batch before starting
+	   anything, so a malformed datagram is rejected as a whole */
+	CheckExecBatch(payload, fds.size());
+
+	ForEachExecBatchEntry(payload, [this, &fds](SpawnPayload exec_payload, unsigned n_fds){
+		/* move this request's file descriptors to a
+		   separate list, so they get closed right after the
+		   child process has been spawned */
+		std::vector<UniqueFileDescriptor> exec_fds;
+		exec_fds.reserve(n_fds);
+		for (unsigned i = 0; i < n_fds; ++i)
+			exec_fds.emplace_back(fds.Get());
+
+		HandleExecMessage(exec_payload, std::move(exec_fds));
+	}, [this](unsigned id){
+		/* don't let one malformed entry drop the following
+		   ones; the client still expects an EXEC_COMPLETE
+		   for this one */
+		logger(3, "Malformed spawn payload");
+		SendExecComplete(id, "Malformed spawn payload");
+		SendExit(id, W_EXITCODE(0xff, 0));
+	});
+}
+
 inline void
 SpawnServerConnection::HandleOneKill(SpawnPayload &payload)
 {
@@ -886,6 +916,10 @@ SpawnServerConnection::HandleMessage(std::span<const std::byte> payload,
 	case SpawnRequestCommand::KILL:
 		HandleKillMessage(SpawnPayload(payload), std::move(fds));
 		break;
+
+	case SpawnRequestCommand::EXEC_BATCH:
+		HandleExecBatchMessage(SpawnPayload(payload), std::move(fds));
+		break;
 	}
 }
 
@@ -898,7 +932,8 @@ SpawnServerConnection::HandleMessage(ReceiveMessageResult &&result)
 inline void
 SpawnServerConnection::ReceiveAndHandle()
 {
-	ReceiveMessageBuffer<8192, CMSG_SPACE(sizeof(int) * 32)> rmb;
+	ReceiveMessageBuffer<SPAWN_MAX_REQUEST_SIZE,
+			     CMSG_SPACE(sizeof(int) * SPAWN_MAX_REQUEST_FDS)> rmb;
 
 	auto result = ReceiveMessage(socket, rmb, MSG_DONTWAIT);
 	if (result.payload.empty()) {
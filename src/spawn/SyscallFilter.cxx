@@ -4,7 +4,11 @@
 
 #include "SyscallFilter.hxx"
 #include "SeccompFilter.hxx"
+#include "SeccompProgram.hxx"
 
+#include <array>
+#include <memory>
+#include <mutex>
 #include <set>
 
 #include <sys/socket.h>
@@ -246,3 +250,58 @@ ForbidBind(Seccomp::Filter &sf)
 	sf.AddRule(SCMP_ACT_ERRNO(EACCES), SCMP_SYS(bind));
 	sf.AddRule(SCMP_ACT_ERRNO(EACCES), SCMP_SYS(listen));
 }
+
+static Seccomp::Program
+CompileSyscallFilter(bool forbid_user_ns, bool forbid_multicast,
+		     bool forbid_bind)
+{
+	Seccomp::Filter sf(SCMP_ACT_ALLOW);
+
+	/* PR_SET_NO_NEW_PRIVS is not part of the BPF program; the
+	   child process sets it if desired */
+	sf.SetAttributeNoThrow(SCMP_FLTATR_CTL_NNP, 0);
+
+	sf.AddSecondaryArchs();
+
+	BuildSyscallFilter(sf);
+
+	if (forbid_user_ns)
+		ForbidUserNamespace(sf);
+
+	if (forbid_multicast)
+		ForbidMulticast(sf);
+
+	if (forbid_bind)
+		ForbidBind(sf);
+
+	return sf.Export();
+}
+
+/**
+ * The cache for GetSyscallFilterProgram(), one slot for each
+ * combination of options.  These are namespace-scope variables with
+ * constant initialization because this library is built with
+ * "-fno-threadsafe-statics", which would make the initialization of
+ * function-local statics racy.
+ */
+static constinit std::array<std::unique_ptr<const Seccomp::Program>, 8> syscall_filter_cache;
+static constinit std::mutex syscall_filter_cache_mutex;
+
+const Seccomp::Program &
+GetSyscallFilterProgram(bool forbid_user_ns, bool forbid_multicast,
+			bool forbid_bind)
+{
+	const std::size_t i = (forbid_user_ns ? 1 : 0) |
+		(forbid_multicast ? 2 : 0) |
+		(forbid_bind ? 4 : 0);
+
+	const std::scoped_lock lock{syscall_filter_cache_mutex};
+
+	auto &slot = syscall_filter_cache[i];
+	if (!slot)
+		slot = std::make_unique<const Seccomp::Program>(CompileSyscallFilter(forbid_user_ns,
+											 forbid_multicast,
+											 forbid_bind));
+
+	return *slot;
+}
@@ -4,7 +4,7 @@
 
 #pragma once
 
-namespace Seccomp { class Filter; }
+namespace Seccomp { class Filter; class Program; }
 
 /**
  * Build a standard system call filter.
@@ -33,3 +33,18 @@ ForbidMulticast(Seccomp::Filter &sf);
  */
 void
 ForbidBind(Seccomp::Filter &sf);
+
+/**
+ * Build a standard system call filter (see BuildSyscallFilter())
+ * plus the given optional rules and compile it to a BPF program.
+ * Each combination of options is compiled only once; the result is
+ * cached for the lifetime of the process, which allows the spawner
+ * to hand the same program to all of its children.
+ *
+ * This function is thread-safe.
+ *
+ * Throws on error.
+ */
+const Seccomp::Program &
+GetSyscallFilterProgram(bool forbid_user_ns, bool forbid_multicast,
+			bool forbid_bind);
@@ -0,0 +1,130 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "event/Chrono.hxx"
+
+#include <algorithm>
+
+/**
+ * Calculates how many EXEC requests may be in flight at a time,
+ * based on the observed latency of completed requests.
+ *
+ * The lowest latency observed recently is used as the baseline (the
+ * "unloaded" spawner).  After each window's worth of completions,
+ * the window grows if the smoothed latency is close to the
+ * baseline (and the window was actually exhausted), and shrinks if
+ * the latency indicates that the spawner is overloaded.
+ */
+class SpawnThrottle {
+	static constexpr unsigned MIN_WINDOW = 4;
+	static constexpr unsigned MAX_WINDOW = 256;
+
+	/**
+	 * This was the static threshold before the window became
+	 * adaptive.
+	 */
+	static constexpr unsigned INITIAL_WINDOW = 8;
+
+	/**
+	 * The baseline is the minimum latency of the current and the
+	 * previous period of this number of samples.  This forgets
+	 * old minimums to adapt to changed conditions (e.g. a
+	 * different mix of child processes), but a period's minimum
+	 * is never derived from latencies of an overloaded spawner
+	 * alone.
+	 */
+	static constexpr unsigned BASELINE_SAMPLES = 4096;
+
+	/**
+	 * The lowest latency of the previous period.
+	 */
+	Event::Duration previous_minimum = Event::Duration::max();
+
+	/**
+	 * The lowest latency of the current period.
+	 */
+	Event::Duration current_minimum = Event::Duration::max();
+
+	/**
+	 * The exponentially weighted moving average of the latency
+	 * (alpha = 1/8).
+	 */
+	Event::Duration smoothed = Event::Duration::zero();
+
+	unsigned window = INITIAL_WINDOW;
+
+	/**
+	 * The number of samples since the last window adjustment.
+	 */
+	unsigned n_samples = 0;
+
+	/**
+	 * The number of samples in the current baseline period.
+	 */
+	unsigned n_baseline_samples = 0;
+
+	/**
+	 * Has the window been exhausted since the last adjustment?
+	 */
+	bool saturated = false;
+
+public:
+	/**
+	 * The maximum number of EXEC requests which may be pending.
+	 */
+	unsigned GetWindow() const noexcept {
+		return window;
+	}
+
+	Event::Duration GetSmoothedLatency() const noexcept {
+		return smoothed;
+	}
+
+	/**
+	 * Notify this object that the window has been exhausted,
+	 * i.e. requests had to be delayed.  Only then will the
+	 * window grow.
+	 */
+	void SetSaturated() noexcept {
+		saturated = true;
+	}
+
+	/**
+	 * An EXEC request has completed after the given duration.
+	 */
+	void OnComplete(Event::Duration latency) noexcept {
+		if (++n_baseline_samples >= BASELINE_SAMPLES) {
+			previous_minimum = current_minimum;
+			current_minimum = Event::Duration::max();
+			n_baseline_samples = 0;
+		}
+
+		current_minimum = std::min(current_minimum, latency);
+		const auto baseline = std::min(previous_minimum,
+					       current_minimum);
+
+		if (smoothed == Event::Duration::zero())
+			smoothed = latency;
+		else
+			smoothed += (latency - smoothed) / 8;
+
+		if (++n_samples < window)
+			return;
+
+		n_samples = 0;
+
+		if (smoothed > baseline * 4) {
+			/* the spawner is overloaded: shrink */
+			window = std::max(window * 3 / 4, MIN_WINDOW);
+		} else if (smoothed <= baseline * 2 && saturated) {
+			/* the spawner keeps up, but we had to delay
+			   requests: grow */
+			window = std::min(window + window / 4 + 1, MAX_WINDOW);
+		}
+
+		saturated = false;
+	}
+};
@@ -5,8 +5,10 @@
 #include "BasicStock.hxx"
 #include "Class.hxx"
 #include "GetHandler.hxx"
+#include "event/Loop.hxx"
 #include "util/Cancellable.hxx"
 
+#include <algorithm> // for std::min()
 #include <cassert>
 
 struct BasicStock::Create final
@@ -21,17 +23,32 @@ struct BasicStock::Create final
 
 	CancellablePointer cancel_ptr;
 
+	/**
+	 * When was this create operation started?  Used for
+	 * #StockStats::create_duration.
+	 */
+	const Event::TimePoint start_time;
+
 	const bool continue_on_cancel;
 
 	Create(BasicStock &_stock,
 	       bool _continue_on_cancel,
 	       StockGetHandler &_handler, CancellablePointer &_cancel_ptr) noexcept
 		:stock(_stock), handler(&_handler),
+		 start_time(_stock.GetEventLoop().SteadyNow()),
 		 continue_on_cancel(_continue_on_cancel)
 	{
 		_cancel_ptr = *this;
 	}
 
+	/**
+	 * Construct a detached instance (for pre-warming).
+	 */
+	explicit Create(BasicStock &_stock) noexcept
+		:stock(_stock), handler(nullptr),
+		 start_time(_stock.GetEventLoop().SteadyNow()),
+		 continue_on_cancel(true) {}
+
 	bool IsDetached() const noexcept {
 		return handler == nullptr;
 	}
@@ -89,6 +106,7 @@ BasicStock::Shutdown() noexcept
 
 	cleanup_event.Cancel();
 	clear_event.Cancel();
+	prewarm.Disable();
 }
 
 /*
@@ -141,11 +159,30 @@ BasicStock::ClearIdle() noexcept
 	idle.clear_and_dispose(DeleteDisposer());
 }
 
+void
+BasicStock::TrimIdle(std::size_t keep) noexcept
+{
+	if (idle.size() <= keep)
+		return;
+
+	/* the least recently used items are at the back */
+	while (idle.size() > keep) {
+		auto &item = idle.back();
+		idle.pop_back();
+		delete &item;
+	}
+
+	if (idle.size() <= max_idle)
+		UnscheduleCleanup();
+}
+
 void
 BasicStock::ClearEventCallback() noexcept
 {
 	if (may_clear)
-		ClearIdle();
+		/* keep the items which pre-warming would create
+		   again */
+		TrimIdle(prewarm.GetTarget());
 
 	may_clear = true;
 	ScheduleClear();
@@ -166,7 +203,8 @@ BasicStock::BasicStock(EventLoop &event_loop, StockClass &_cls,
 	 max_idle(_max_idle),
 	 clear_interval(_clear_interval),
 	 cleanup_event(event_loop, BIND_THIS_METHOD(CleanupEventCallback)),
-	 clear_event(event_loop, BIND_THIS_METHOD(ClearEventCallback))
+	 clear_event(event_loop, BIND_THIS_METHOD(ClearEventCallback)),
+	 prewarm(event_loop, BIND_THIS_METHOD(OnPrewarm))
 {
 	assert(max_idle > 0);
 
@@ -277,6 +315,51 @@ BasicStock::GetCreate(StockRequest request,
 	}
 }
 
+inline bool
+BasicStock::PrewarmCreate() noexcept
+{
+	auto *c = new Create(*this);
+	create.push_front(*c);
+
+	try {
+		cls.Create({*this}, cls.MakePrewarmRequest(GetName()),
+			   *c, c->cancel_ptr);
+		return true;
+	} catch (...) {
+		ItemCreateError(*c, std::current_exception());
+		return false;
+	}
+}
+
+inline std::size_t
+BasicStock::CountDetachedCreates() const noexcept
+{
+	std::size_t n = 0;
+	for (const auto &c : create)
+		if (c.IsDetached())
+			++n;
+	return n;
+}
+
+void
+BasicStock::OnPrewarm(std::size_t target) noexcept
+{
+	target = std::min(target, max_idle);
+
+	/* detached create operations will end up in the idle
+	   list */
+	const std::size_t available = idle.size() + CountDetachedCreates();
+	if (available >= target)
+		return;
+
+	for (std::size_t n = std::min(target - available, GetPrewarmHeadroom());
+	     n > 0; --n)
+		if (!PrewarmCreate())
+			/* don't retry immediately; wait for the next
+			   timer tick */
+			break;
+}
+
 void
 BasicStock::ItemCreateSuccess(StockGetHandler &_handler,
 			      StockItem &item) noexcept
@@ -284,6 +367,8 @@ BasicStock::ItemCreateSuccess(StockGetHandler &_handler,
 	auto &c = static_cast<Create &>(_handler);
 	auto *get_handler = c.handler;
 
+	create_duration.Add(GetEventLoop().SteadyNow() - c.start_time);
+
 	DeleteCreate(c);
 
 	if (get_handler != nullptr) {
@@ -300,6 +385,8 @@ BasicStock::ItemCreateError(StockGetHandler &_handler,
 	auto &c = static_cast<Create &>(_handler);
 	auto *get_handler = c.handler;
 
+	++create_errors;
+
 	DeleteCreate(c);
 
 	CheckEmpty();
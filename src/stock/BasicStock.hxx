@@ -6,6 +6,7 @@
 
 #include "AbstractStock.hxx"
 #include "Item.hxx"
+#include "Prewarm.hxx"
 #include "Request.hxx"
 #include "Stats.hxx"
 #include "event/CoarseTimerEvent.hxx"
@@ -45,6 +46,8 @@ private:
 	CoarseTimerEvent cleanup_event;
 	CoarseTimerEvent clear_event;
 
+	StockPrewarm prewarm;
+
 	using ItemList = StockItem::List;
 
 	/**
@@ -72,6 +75,10 @@ private:
 		IntrusiveListBaseHookTraits<Create>,
 		IntrusiveListOptions{.constant_time_size = true}> create;
 
+	StockStats::DurationHistogram create_duration;
+
+	uint_least64_t create_errors = 0;
+
 protected:
 	bool may_clear = false;
 
@@ -117,6 +124,15 @@ public:
 	void AddStats(StockStats &data) const noexcept {
 		data.busy += busy.size();
 		data.idle += idle.size();
+		data.create_duration += create_duration;
+		data.create_errors += create_errors;
+	}
+
+	/**
+	 * Enable (or disable) creating idle items ahead of time.
+	 */
+	void SetPrewarm(const StockPrewarmOptions &options) noexcept {
+		prewarm.Configure(options);
 	}
 
 	/**
@@ -160,6 +176,21 @@ protected:
 		return busy.size() + create.size();
 	}
 
+	/**
+	 * Account for one request (for #StockPrewarm).
+	 */
+	void AddDemand() noexcept {
+		prewarm.AddDemand();
+	}
+
+	/**
+	 * How many more items may be created by #StockPrewarm?
+	 */
+	[[gnu::pure]]
+	virtual std::size_t GetPrewarmHeadroom() const noexcept {
+		return SIZE_MAX;
+	}
+
 	virtual void OnCreateCanceled() noexcept {}
 
 	/**
@@ -181,6 +212,12 @@ private:
 
 	void ClearIdle() noexcept;
 
+	/**
+	 * Destroy idle items until there are no more than the
+	 * given number.
+	 */
+	void TrimIdle(std::size_t keep) noexcept;
+
 	void ClearIdleIf(std::predicate<const StockItem &> auto predicate) noexcept {
 		idle.remove_and_dispose_if(predicate,
 					   DeleteDisposer());
@@ -242,6 +279,20 @@ public:
 			     std::exception_ptr ep) noexcept override;
 
 private:
+	/**
+	 * Start creating an item without a handler; it will be added
+	 * to #idle, unless GetCanceled() attaches a request to it
+	 * first.
+	 *
+	 * @return false if creating the item has failed
+	 */
+	bool PrewarmCreate() noexcept;
+
+	[[gnu::pure]]
+	std::size_t CountDetachedCreates() const noexcept;
+
+	void OnPrewarm(std::size_t target) noexcept;
+
 	void DeleteCreate(Create &c) noexcept;
 	void CreateCanceled(Create &c) noexcept;
 
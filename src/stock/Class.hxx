@@ -44,4 +44,18 @@ public:
 	virtual uint_fast64_t GetFairnessHash([[maybe_unused]] const void *request) const noexcept {
 		return 0;
 	}
+
+	/**
+	 * Create a request for an item which is created ahead of
+	 * time, without a caller (see #StockPrewarm).  The default
+	 * implementation returns nullptr, which is good enough for
+	 * classes which ignore the request.
+	 *
+	 * Throws on error.
+	 *
+	 * @param name the name of the stock (e.g. the #StockMap key)
+	 */
+	virtual StockRequest MakePrewarmRequest([[maybe_unused]] const char *name) {
+		return nullptr;
+	}
 };
@@ -62,6 +62,8 @@ StockMap::GetStock(const char *uri, void *request) noexcept
 				      GetLimit(request, limit),
 				      max_idle,
 				      GetClearInterval(request));
+		if (prewarm_options.IsEnabled())
+			item->SetPrewarm(prewarm_options);
 		map.insert_commit(position, *item);
 		return *item;
 	} else
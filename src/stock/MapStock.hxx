@@ -83,6 +83,11 @@ class StockMap {
 
 	const Event::Duration clear_interval;
 
+	/**
+	 * Applied to each new #Stock.
+	 */
+	StockPrewarmOptions prewarm_options;
+
 	Map map;
 
 public:
@@ -120,6 +125,20 @@ public:
 		});
 	}
 
+	/**
+	 * Enable (or disable) creating idle items ahead of time in
+	 * each #Stock.  Note that a #Stock is deleted as soon as it
+	 * becomes empty (unless it is "sticky"), and with it its
+	 * demand history.
+	 */
+	void SetPrewarm(const StockPrewarmOptions &options) noexcept {
+		prewarm_options = options;
+
+		map.for_each([&options](auto &i){
+			i.SetPrewarm(options);
+		});
+	}
+
 	/**
 	 * Obtain statistics.
 	 */
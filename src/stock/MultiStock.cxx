@@ -47,6 +47,12 @@ MultiStock::OuterItem::ShouldDelete() const noexcept
 void
 MultiStock::OuterItem::OnCleanupTimer() noexcept
 {
+	if (IsEmpty() && parent.ShouldKeepUnused(*this)) {
+		/* pre-warming wants to keep it */
+		ScheduleCleanupTimer();
+		return;
+	}
+
 	if (IsEmpty()) {
 		/* if this item was unused for one cleanup_timer
 		   period, let parent.OnLeaseReleased() discard it */
@@ -280,7 +286,8 @@ MultiStock::MapItem::MapItem(EventLoop &_event_loop, StockClass &_outer_class,
 	 name(_name),
 	 limit(_limit),
 	 clear_interval(_clear_interval),
-	 retry_event(_event_loop, BIND_THIS_METHOD(RetryWaiting))
+	 retry_event(_event_loop, BIND_THIS_METHOD(RetryWaiting)),
+	 prewarm(_event_loop, BIND_THIS_METHOD(OnPrewarm))
 {
 }
 
@@ -330,6 +337,8 @@ MultiStock::MapItem::Get(StockRequest request, std::size_t concurrency,
 			 StockGetHandler &get_handler,
 			 CancellablePointer &cancel_ptr) noexcept
 {
+	prewarm.AddDemand();
+
 	if (auto *i = FindUsable()) {
 		i->GetLease(inner_class, get_handler);
 		return;
@@ -347,6 +356,47 @@ MultiStock::MapItem::Get(StockRequest request, std::size_t concurrency,
 		Create(std::move(w->request));
 }
 
+inline std::size_t
+MultiStock::MapItem::CountUnused() const noexcept
+{
+	std::size_t n = 0;
+	for (const auto &i : items)
+		if (!i.IsBusy() && !i.IsFading())
+			++n;
+	return n;
+}
+
+bool
+MultiStock::MapItem::ShouldKeepUnused(const OuterItem &item) const noexcept
+{
+	return !item.IsFading() && CountUnused() <= prewarm.GetTarget();
+}
+
+void
+MultiStock::MapItem::OnPrewarm(std::size_t target) noexcept
+{
+	if (!waiting.empty() || get_cancel_ptr || IsFull())
+		/* RetryWaiting() takes care of creating items, or
+		   one is already being created */
+		return;
+
+	if (CountUnused() >= target)
+		return;
+
+	/* there can be only one create operation at a time; the
+	   next one will be started by the next timer tick */
+
+	StockRequest request;
+	try {
+		request = outer_class.MakePrewarmRequest(GetName());
+	} catch (...) {
+		return;
+	}
+
+	/* this may delete the MapItem on error */
+	Create(std::move(request));
+}
+
 inline void
 MultiStock::MapItem::RemoveItem(OuterItem &item) noexcept
 {
@@ -451,7 +501,6 @@ MultiStock::MapItem::ScheduleRetryWaiting() noexcept
 void
 MultiStock::MapItem::OnStockItemReady(StockItem &stock_item) noexcept
 {
-	assert(!waiting.empty());
 	get_cancel_ptr = nullptr;
 
 	retry_event.Cancel();
@@ -460,13 +509,21 @@ MultiStock::MapItem::OnStockItemReady(StockItem &stock_item) noexcept
 				   clear_interval);
 	items.push_back(*item);
 
+	if (waiting.empty()) {
+		/* this item was created by OnPrewarm(); keep it
+		   unused until somebody asks for it */
+		item->ScheduleCleanupTimer();
+		return;
+	}
+
 	FinishWaiting(*item);
 }
 
 void
 MultiStock::MapItem::OnStockItemError(std::exception_ptr error) noexcept
 {
-	assert(!waiting.empty());
+	/* the waiting list may be empty if the failed item was
+	   created by OnPrewarm() */
 	get_cancel_ptr = nullptr;
 
 	retry_event.Cancel();
@@ -587,6 +644,16 @@ MultiStock::~MultiStock() noexcept
 	assert(map.empty());
 }
 
+void
+MultiStock::SetPrewarm(const StockPrewarmOptions &options) noexcept
+{
+	prewarm_options = options;
+
+	map.for_each([&options](auto &i){
+		i.SetPrewarm(options);
+	});
+}
+
 std::size_t
 MultiStock::DiscardUnused() noexcept
 {
@@ -633,6 +700,8 @@ MultiStock::MakeMapItem(const char *uri, void *request) noexcept
 					 inner_class.GetLimit(request, limit),
 					 inner_class.GetClearInterval(request),
 					 inner_class);
+		if (prewarm_options.IsEnabled())
+			item->SetPrewarm(prewarm_options);
 		map.insert_commit(i, *item);
 		chronological_list.push_back(*item);
 		return *item;
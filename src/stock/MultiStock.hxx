@@ -8,6 +8,7 @@
 #include "GetHandler.hxx"
 #include "AbstractStock.hxx"
 #include "Item.hxx"
+#include "Prewarm.hxx"
 #include "event/DeferEvent.hxx"
 #include "event/CoarseTimerEvent.hxx"
 #include "util/Cancellable.hxx"
@@ -118,6 +119,14 @@ class MultiStock {
 		void GetLease(MultiStockClass &_cls,
 			      StockGetHandler &handler) noexcept;
 
+		/**
+		 * Start the timer which discards this item if it
+		 * remains unused.
+		 */
+		void ScheduleCleanupTimer() noexcept {
+			cleanup_timer.Schedule(cleanup_interval);
+		}
+
 	private:
 		StockItem *GetIdle() noexcept;
 
@@ -125,10 +134,6 @@ class MultiStock {
 
 		void OnCleanupTimer() noexcept;
 
-		void ScheduleCleanupTimer() noexcept {
-			cleanup_timer.Schedule(cleanup_interval);
-		}
-
 		void ScheduleCleanupNow() noexcept {
 			cleanup_timer.Schedule(Event::Duration::zero());
 		}
@@ -195,6 +200,8 @@ class MultiStock {
 
 		std::size_t get_concurrency;
 
+		StockPrewarm prewarm;
+
 	public:
 		/**
 		 * For MultiStock::chronological_list.
@@ -232,6 +239,18 @@ class MultiStock {
 
 		void RemoveWaiting(Waiting &w) noexcept;
 
+		void SetPrewarm(const StockPrewarmOptions &options) noexcept {
+			prewarm.Configure(options);
+		}
+
+		/**
+		 * Shall the given unused item be kept (and not be
+		 * discarded by its cleanup timer) because pre-warming
+		 * would create it again?
+		 */
+		[[gnu::pure]]
+		bool ShouldKeepUnused(const OuterItem &item) const noexcept;
+
 		void RemoveItem(OuterItem &item) noexcept;
 		void OnLeaseReleased(OuterItem &item) noexcept;
 
@@ -272,6 +291,11 @@ class MultiStock {
 
 		void Create(StockRequest request) noexcept;
 
+		[[gnu::pure]]
+		std::size_t CountUnused() const noexcept;
+
+		void OnPrewarm(std::size_t target) noexcept;
+
 		/* virtual methods from class StockGetHandler */
 		void OnStockItemReady(StockItem &item) noexcept override;
 		void OnStockItemError(std::exception_ptr error) noexcept override;
@@ -323,6 +347,11 @@ class MultiStock {
 
 	MultiStockClass &inner_class;
 
+	/**
+	 * Applied to each new #MapItem.
+	 */
+	StockPrewarmOptions prewarm_options;
+
 	static constexpr size_t N_BUCKETS = 251;
 	using Map =
 		IntrusiveHashSet<MapItem, N_BUCKETS,
@@ -373,6 +402,14 @@ public:
 	 */
 	std::size_t DiscardOldestIdle(std::size_t n) noexcept;
 
+	/**
+	 * Enable (or disable) creating "outer" items ahead of time.
+	 * The #StockPrewarmOptions numbers refer to unused outer
+	 * items (i.e. ones without any leases), and the demand is
+	 * counted in Get() calls.
+	 */
+	void SetPrewarm(const StockPrewarmOptions &options) noexcept;
+
 	/**
 	 * @see Stock::FadeAll()
 	 */
@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "Prewarm.hxx"
+
+#include <algorithm> // for std::max()
+#include <cmath> // for std::ceil()
+
+void
+StockPrewarm::Configure(const StockPrewarmOptions &_options) noexcept
+{
+	options = _options;
+
+	if (IsEnabled())
+		/* run the callback soon to establish #min_idle */
+		timer.Schedule(Event::Duration::zero());
+	else {
+		timer.Cancel();
+		n_requests = 0;
+		average = 0;
+	}
+}
+
+std::size_t
+StockPrewarm::GetTarget() const noexcept
+{
+	if (!IsEnabled())
+		return 0;
+
+	const std::size_t by_demand = std::ceil(average * options.demand_factor);
+	return std::max(options.min_idle, by_demand);
+}
+
+void
+StockPrewarm::OnTimer() noexcept
+{
+	average = options.alpha * n_requests + (1 - options.alpha) * average;
+	n_requests = 0;
+
+	const std::size_t target = GetTarget();
+
+	/* keep the timer running while there is (recent) demand or
+	   a minimum; if the demand has decayed, the next AddDemand()
+	   call restarts it */
+	if (options.min_idle > 0 || average >= 0.01)
+		timer.Schedule(options.interval);
+	else
+		average = 0;
+
+	/* this may delete the owner, so it must be the last thing
+	   we do */
+	callback(target);
+}
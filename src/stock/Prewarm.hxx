@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "event/CoarseTimerEvent.hxx"
+#include "util/BindMethod.hxx"
+
+#include <cstddef>
+
+/**
+ * Configuration for #StockPrewarm.  The default value disables
+ * pre-warming.
+ */
+struct StockPrewarmOptions {
+	/**
+	 * Always keep at least this many idle items, even if there
+	 * was no demand recently.
+	 */
+	std::size_t min_idle = 0;
+
+	/**
+	 * Keep this many idle items for each request per #interval
+	 * (according to the moving average of the demand).  Zero
+	 * disables demand-based pre-warming.
+	 */
+	double demand_factor = 0;
+
+	/**
+	 * The weight of the most recent #interval in the exponentially
+	 * weighted moving average; must be between 0 and 1.
+	 */
+	double alpha = 0.3;
+
+	/**
+	 * How often is the demand sampled and are new items
+	 * created?
+	 */
+	Event::Duration interval = std::chrono::seconds{1};
+
+	constexpr bool IsEnabled() const noexcept {
+		return min_idle > 0 || demand_factor > 0;
+	}
+};
+
+/**
+ * Tracks the demand of a stock with an exponentially weighted moving
+ * average and periodically asks its owner to create items ahead of
+ * time, so a burst of requests does not have to wait for new items
+ * (e.g. new connections or child processes) to be created.
+ *
+ * The owner calls AddDemand() for each request and implements the
+ * callback which creates items until the given number of idle items
+ * is available.
+ */
+class StockPrewarm {
+	CoarseTimerEvent timer;
+
+	/**
+	 * Invoked periodically with the desired number of idle
+	 * items.
+	 */
+	using Callback = BoundMethod<void(std::size_t target) noexcept>;
+	const Callback callback;
+
+	StockPrewarmOptions options;
+
+	/**
+	 * The number of requests in the current interval.
+	 */
+	std::size_t n_requests = 0;
+
+	/**
+	 * The moving average of #n_requests.
+	 */
+	double average = 0;
+
+public:
+	StockPrewarm(EventLoop &event_loop, Callback _callback) noexcept
+		:timer(event_loop, BIND_THIS_METHOD(OnTimer)),
+		 callback(_callback) {}
+
+	bool IsEnabled() const noexcept {
+		return options.IsEnabled();
+	}
+
+	/**
+	 * Enable, disable or reconfigure pre-warming.
+	 */
+	void Configure(const StockPrewarmOptions &_options) noexcept;
+
+	/**
+	 * Stop pre-warming (e.g. during shutdown).
+	 */
+	void Disable() noexcept {
+		Configure({});
+	}
+
+	/**
+	 * Account for one request.
+	 */
+	void AddDemand() noexcept {
+		if (!IsEnabled())
+			return;
+
+		++n_requests;
+
+		if (!timer.IsPending())
+			timer.Schedule(options.interval);
+	}
+
+	/**
+	 * Returns the number of idle items which shall be kept
+	 * available, or 0 if pre-warming is disabled.
+	 */
+	[[gnu::pure]]
+	std::size_t GetTarget() const noexcept;
+
+private:
+	void OnTimer() noexcept;
+};
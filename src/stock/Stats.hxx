@@ -4,8 +4,50 @@
 
 #pragma once
 
+#include "util/Histogram.hxx"
+
 #include <cstddef>
+#include <cstdint>
+
+/**
+ * Bucket bounds for stock durations (in nanoseconds): 100us, 400us,
+ * 1.6ms, ..., ~26s.
+ */
+inline constexpr auto STOCK_DURATION_BOUNDS =
+	MakeExponentialBounds<10>(100000, 2);
 
 struct StockStats {
+	using DurationHistogram = Histogram<STOCK_DURATION_BOUNDS>;
+
 	std::size_t busy, idle;
+
+	/**
+	 * The number of requests currently waiting for an item
+	 * because the stock is full.
+	 */
+	std::size_t waiting;
+
+	/**
+	 * How long did requests wait for an item because the stock
+	 * was full?  Only requests which were served are counted.
+	 */
+	DurationHistogram wait_duration;
+
+	/**
+	 * How long did it take to create new items?  Only
+	 * successful creations are counted.
+	 */
+	DurationHistogram create_duration;
+
+	/**
+	 * The number of waiting requests which were canceled by the
+	 * caller (e.g. because the caller's timeout expired) before
+	 * an item became available.
+	 */
+	uint_least64_t canceled_waits;
+
+	/**
+	 * The number of failed item creations.
+	 */
+	uint_least64_t create_errors;
 };
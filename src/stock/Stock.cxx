@@ -5,7 +5,9 @@
 #include "Stock.hxx"
 #include "Class.hxx"
 #include "GetHandler.hxx"
+#include "event/Loop.hxx"
 #include "util/Cancellable.hxx"
+#include "util/DeleteDisposer.hxx"
 
 #include <cassert>
 
@@ -22,6 +24,17 @@ struct Stock::Waiting final
 
 	CancellablePointer &cancel_ptr;
 
+	/**
+	 * The #WaitingQueue this request is linked in.
+	 */
+	WaitingQueue *queue;
+
+	/**
+	 * When was this request added?  Used for
+	 * #StockStats::wait_duration.
+	 */
+	const Event::TimePoint since;
+
 	Waiting(Stock &_stock, StockRequest &&_request,
 		StockGetHandler &_handler,
 		CancellablePointer &_cancel_ptr) noexcept;
@@ -32,6 +45,27 @@ struct Stock::Waiting final
 	void Cancel() noexcept override;
 };
 
+/**
+ * All waiting requests with the same fairness hash.
+ */
+struct Stock::WaitingQueue final
+	: IntrusiveHashSetHook<IntrusiveHookMode::NORMAL>,
+	  IntrusiveListHook<IntrusiveHookMode::NORMAL>
+{
+	const uint_least64_t fairness_hash;
+
+	IntrusiveList<Waiting> requests;
+
+	explicit WaitingQueue(uint_least64_t _fairness_hash) noexcept
+		:fairness_hash(_fairness_hash) {}
+};
+
+inline uint_least64_t
+Stock::WaitingQueueGetKey::operator()(const WaitingQueue &queue) const noexcept
+{
+	return queue.fairness_hash;
+}
+
 inline
 Stock::Waiting::Waiting(Stock &_stock, StockRequest &&_request,
 			StockGetHandler &_handler,
@@ -39,7 +73,8 @@ Stock::Waiting::Waiting(Stock &_stock, StockRequest &&_request,
 	:stock(_stock), request(std::move(_request)),
 	 fairness_hash(_stock.cls.GetFairnessHash(request.get())),
 	 handler(_handler),
-	 cancel_ptr(_cancel_ptr)
+	 cancel_ptr(_cancel_ptr),
+	 since(_stock.GetEventLoop().SteadyNow())
 {
 	cancel_ptr = *this;
 }
@@ -58,27 +93,86 @@ Stock::Waiting::Destroy() noexcept
 void
 Stock::Waiting::Cancel() noexcept
 {
-	auto &list = stock.waiting;
-	const auto i = list.iterator_to(*this);
-	list.erase_and_dispose(i, [](Stock::Waiting *w){ w->Destroy(); });
+	++stock.canceled_waits;
+	stock.RemoveWaiting(*this);
+	Destroy();
+}
+
+inline void
+Stock::AddWaiting(Waiting &w) noexcept
+{
+	auto [position, inserted] = waiting_queues.insert_check(w.fairness_hash);
+	if (inserted) {
+		auto *queue = new WaitingQueue(w.fairness_hash);
+		waiting_queues.insert_commit(position, *queue);
+		waiting_rotation.push_back(*queue);
+		w.queue = queue;
+	} else
+		w.queue = &*position;
+
+	w.queue->requests.push_back(w);
+	++n_waiting;
 }
 
-inline Stock::WaitingList::iterator
-Stock::PickWaiting() noexcept
+void
+Stock::RemoveWaiting(Waiting &w) noexcept
 {
-	if (last_fairness_hash == 0 || waiting.empty())
-		/* fairness disabled or nobody is waiting */
-		return waiting.begin();
+	assert(n_waiting > 0);
 
-	/* find the first "waiting" entry with a different
-	   fairness_hash than the last one */
-	const uint_fast64_t lfh = last_fairness_hash;
-	for (auto &i : waiting)
-		if (i.fairness_hash != lfh)
-			return waiting.iterator_to(i);
+	auto &queue = *w.queue;
+	queue.requests.erase(queue.requests.iterator_to(w));
+	--n_waiting;
 
-	/* there is none: use an arbitrary waiting */
-	return waiting.begin();
+	if (queue.requests.empty()) {
+		waiting_rotation.erase(waiting_rotation.iterator_to(queue));
+		waiting_queues.erase_and_dispose(waiting_queues.iterator_to(queue),
+						 DeleteDisposer{});
+	}
+}
+
+inline Stock::Waiting &
+Stock::PopWaiting() noexcept
+{
+	assert(HasWaiting());
+	assert(!waiting_rotation.empty());
+
+	/* this queue has its turn now; the next one gets the next
+	   item (if this queue becomes empty, RemoveWaiting() deletes
+	   it) */
+	auto &queue = waiting_rotation.pop_front();
+	waiting_rotation.push_back(queue);
+
+	auto &w = queue.requests.front();
+	RemoveWaiting(w);
+	return w;
+}
+
+inline void
+Stock::UnpopWaiting(Waiting &w) noexcept
+{
+	/* re-add the request to the front of its queue, and move
+	   the queue to the front of the rotation, so it is the next
+	   one to be picked, just like before */
+	auto [position, inserted] = waiting_queues.insert_check(w.fairness_hash);
+	if (inserted) {
+		auto *queue = new WaitingQueue(w.fairness_hash);
+		waiting_queues.insert_commit(position, *queue);
+		w.queue = queue;
+	} else {
+		w.queue = &*position;
+		waiting_rotation.erase(waiting_rotation.iterator_to(*w.queue));
+	}
+
+	waiting_rotation.push_front(*w.queue);
+	w.queue->requests.push_front(w);
+	++n_waiting;
+}
+
+inline void
+Stock::DisposeServedWaiting(Waiting &w) noexcept
+{
+	wait_duration.Add(GetEventLoop().SteadyNow() - w.since);
+	w.Destroy();
 }
 
 void
@@ -90,44 +184,36 @@ Stock::RetryWaiting() noexcept
 
 	/* first try to serve existing idle items */
 
-	while (HasIdle()) {
-		const auto i = PickWaiting();
-		if (i == waiting.end())
-			return;
-
-		auto &w = *i;
-
-		last_fairness_hash = w.fairness_hash;
-
-		waiting.erase(i);
+	while (HasIdle() && HasWaiting()) {
+		auto &w = PopWaiting();
 
 		if (!GetIdle(w.request, w.handler)) {
 			/* didn't work (probably because borrowing the item has
 			   failed) - re-add to "waiting" list */
-			waiting.push_back(w);
+			UnpopWaiting(w);
 			break;
 		}
 
-		w.Destroy();
+		DisposeServedWaiting(w);
 	}
 
 	/* if we're below the limit, create a bunch of new items */
 
 	for (std::size_t i = limit - GetActiveCount();
-	     GetActiveCount() < limit && i > 0 && !waiting.empty();
+	     GetActiveCount() < limit && i > 0 && HasWaiting();
 	     --i) {
-		auto &w = waiting.pop_front();
+		auto &w = PopWaiting();
 		GetCreate(std::move(w.request),
 			  w.handler,
 			  w.cancel_ptr);
-		w.Destroy();
+		DisposeServedWaiting(w);
 	}
 }
 
 void
 Stock::ScheduleRetryWaiting() noexcept
 {
-	if (!waiting.empty() && !IsFull())
+	if (HasWaiting() && !IsFull())
 		retry_event.Schedule();
 }
 
@@ -147,7 +233,11 @@ Stock::Stock(EventLoop &event_loop, StockClass &_cls,
 {
 }
 
-Stock::~Stock() noexcept = default;
+Stock::~Stock() noexcept
+{
+	waiting_rotation.clear();
+	waiting_queues.clear_and_dispose(DeleteDisposer{});
+}
 
 void
 Stock::Get(StockRequest request,
@@ -156,6 +246,8 @@ Stock::Get(StockRequest request,
 {
 	may_clear = false;
 
+	AddDemand();
+
 	if (GetIdle(request, get_handler) ||
 	    GetCanceled(get_handler, cancel_ptr))
 		return;
@@ -164,7 +256,7 @@ Stock::Get(StockRequest request,
 		/* item limit reached: wait for an item to return */
 		auto w = new Waiting(*this, std::move(request),
 				     get_handler, cancel_ptr);
-		waiting.push_back(*w);
+		AddWaiting(*w);
 		return;
 	}
 
@@ -225,16 +317,17 @@ Stock::ItemCreateError(StockGetHandler &get_handler,
 void
 Stock::OnCreateCanceled() noexcept
 {
-	if (!waiting.empty()) {
+	if (HasWaiting()) {
 		/* try to attach a waiting request to the canceled
 		   create request */
-		auto &w = waiting.front();
+		auto &w = PopWaiting();
 
 		if (GetCanceled(w.handler, w.cancel_ptr)) {
-			waiting.pop_front();
-			w.Destroy();
+			DisposeServedWaiting(w);
 			return;
 		}
+
+		UnpopWaiting(w);
 	}
 
 	ScheduleRetryWaiting();
@@ -7,10 +7,12 @@
 #include "BasicStock.hxx"
 #include "Request.hxx"
 #include "event/DeferEvent.hxx"
+#include "util/IntrusiveHashSet.hxx"
 #include "util/IntrusiveList.hxx"
 
 #include <cstddef>
 #include <cstdint>
+#include <functional> // for std::hash
 
 class CancellablePointer;
 class Stock;
@@ -25,7 +27,7 @@ class StockGetHandler;
 class Stock : public BasicStock {
 	/**
 	 * The maximum number of items in this stock.  If any more items
-	 * are requested, they are put into the #waiting list, which gets
+	 * are requested, they are put into the #waiting_queues, which gets
 	 * checked as soon as Put() is called.
 	 */
 	const std::size_t limit;
@@ -38,11 +40,41 @@ class Stock : public BasicStock {
 	DeferEvent retry_event;
 
 	struct Waiting;
-	using WaitingList = IntrusiveList<Waiting>;
+	struct WaitingQueue;
 
-	WaitingList waiting;
+	struct WaitingQueueGetKey {
+		[[gnu::pure]]
+		uint_least64_t operator()(const WaitingQueue &queue) const noexcept;
+	};
 
-	uint_least64_t last_fairness_hash = 0;
+	/**
+	 * Waiting requests are grouped by their fairness hash (see
+	 * StockClass::GetFairnessHash()); each distinct value has one
+	 * #WaitingQueue.  Queues are created on demand and deleted
+	 * as soon as they become empty.
+	 */
+	IntrusiveHashSet<WaitingQueue, 64,
+			 IntrusiveHashSetOperators<WaitingQueue,
+						   WaitingQueueGetKey,
+						   std::hash<uint_least64_t>,
+						   std::equal_to<uint_least64_t>>> waiting_queues;
+
+	/**
+	 * All (non-empty) #WaitingQueue instances in round-robin
+	 * order: the front one is served next, and then it moves to
+	 * the back.  This makes picking the next waiting request an
+	 * O(1) operation.
+	 */
+	IntrusiveList<WaitingQueue> waiting_rotation;
+
+	/**
+	 * The total number of requests in all #waiting_queues.
+	 */
+	std::size_t n_waiting = 0;
+
+	StockStats::DurationHistogram wait_duration;
+
+	uint_least64_t canceled_waits = 0;
 
 public:
 	/**
@@ -69,6 +101,16 @@ public:
 		return limit > 0 && GetActiveCount() >= limit;
 	}
 
+	/**
+	 * Obtain statistics.
+	 */
+	void AddStats(StockStats &data) const noexcept {
+		BasicStock::AddStats(data);
+		data.waiting += n_waiting;
+		data.wait_duration += wait_duration;
+		data.canceled_waits += canceled_waits;
+	}
+
 	void Get(StockRequest request,
 		 StockGetHandler &get_handler,
 		 CancellablePointer &cancel_ptr) noexcept;
@@ -100,10 +142,55 @@ public:
 	}
 
 private:
+	std::size_t GetPrewarmHeadroom() const noexcept override {
+		if (HasWaiting())
+			/* the waiting requests are served first */
+			return 0;
+
+		if (limit == 0)
+			return SIZE_MAX;
+
+		const std::size_t active = GetActiveCount();
+		return limit > active ? limit - active : 0;
+	}
+
 	void OnCreateCanceled() noexcept override;
 
-	[[gnu::pure]]
-	WaitingList::iterator PickWaiting() noexcept;
+	bool HasWaiting() const noexcept {
+		return n_waiting > 0;
+	}
+
+	/**
+	 * Add a new request to the #WaitingQueue for its fairness
+	 * hash.
+	 */
+	void AddWaiting(Waiting &w) noexcept;
+
+	/**
+	 * Remove the given request from its #WaitingQueue (and
+	 * delete the queue if it has become empty).  The
+	 * #Waiting object is not destroyed.
+	 */
+	void RemoveWaiting(Waiting &w) noexcept;
+
+	/**
+	 * Pick the next waiting request in round-robin order among
+	 * all fairness hashes, remove it from its queue and return
+	 * it.  Must not be called if there are no waiting requests.
+	 */
+	Waiting &PopWaiting() noexcept;
+
+	/**
+	 * Undo PopWaiting(): re-add the request to the front of its
+	 * queue.
+	 */
+	void UnpopWaiting(Waiting &w) noexcept;
+
+	/**
+	 * A waiting request is about to be served; update
+	 * statistics and destroy the #Waiting object.
+	 */
+	void DisposeServedWaiting(Waiting &w) noexcept;
 
 	/**
 	 * Retry the waiting requests.  This is called after the number of
@@ -4,9 +4,33 @@
 #include "EpollFD.hxx"
 #include "Error.hxx"
 
+#include <cerrno>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
 EpollFD::EpollFD()
 	:fd(::epoll_create1(EPOLL_CLOEXEC))
 {
 	if (!fd.IsDefined())
 		throw MakeErrno("epoll_create1() failed");
 }
+
+int
+EpollFD::Wait(epoll_event *events, int maxevents,
+	      const struct __kernel_timespec *timeout) noexcept
+{
+#ifdef __NR_epoll_pwait2
+	/* invoking the system call directly because the glibc
+	   wrapper requires glibc 2.35 and uses its own "struct
+	   timespec" which may be incompatible */
+	return ::syscall(__NR_epoll_pwait2, fd.Get(), events, maxevents,
+			 timeout, nullptr, 0);
+#else
+	(void)events;
+	(void)maxevents;
+	(void)timeout;
+	errno = ENOSYS;
+	return -1;
+#endif
+}
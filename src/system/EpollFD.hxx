@@ -8,6 +8,7 @@
 
 #include <cstdint>
 
+#include <linux/time_types.h> // for struct __kernel_timespec
 #include <sys/epoll.h>
 
 /**
@@ -29,6 +30,16 @@ public:
 		return ::epoll_wait(fd.Get(), events, maxevents, timeout);
 	}
 
+	/**
+	 * Like Wait(), but with nanosecond resolution, using
+	 * epoll_pwait2().  This requires Linux 5.11; on older
+	 * kernels, this fails with ENOSYS.
+	 *
+	 * @param timeout the timeout or nullptr to wait forever
+	 */
+	int Wait(epoll_event *events, int maxevents,
+		 const struct __kernel_timespec *timeout) noexcept;
+
 	bool Control(int op, int _fd, epoll_event *event) noexcept {
 		return ::epoll_ctl(fd.Get(), op, _fd, event) >= 0;
 	}
@@ -22,11 +22,19 @@
 #define STATMOUNT_MNT_POINT 0x00000010U
 #define STATMOUNT_FS_TYPE 0x00000020U
 
+/* these were added in Linux 6.11 and 6.13, and the fields are
+   declared in the struct below; with kernel headers between 6.8 and
+   6.12, they are not available */
+#define STATMOUNT_MNT_NS_ID 0x00000040U
+#define STATMOUNT_MNT_OPTS 0x00000080U
+#define STATMOUNT_FS_SUBTYPE 0x00000100U
+#define STATMOUNT_SB_SOURCE 0x00000200U
+
 struct mnt_id_req;
 
 struct statmount {
 	__u32 size;
-	__u32 __spare1;
+	__u32 mnt_opts;
 	__u64 mask;
 	__u32 sb_dev_major;
 	__u32 sb_dev_minor;
@@ -44,7 +52,10 @@ struct statmount {
 	__u64 propagate_from;
 	__u32 mnt_root;
 	__u32 mnt_point;
-	__u64 __spare2[50];
+	__u64 mnt_ns_id;
+	__u32 fs_subtype;
+	__u32 sb_source;
+	__u64 __spare2[48];
 	//char str[];
 };
 
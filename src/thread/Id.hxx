@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// author: Max Kellermann <max.kellermann@gmail.com>
+
+#pragma once
+
+#include <pthread.h>
+
+/**
+ * A low-level identification for a thread.
+ */
+class ThreadId {
+	pthread_t id;
+
+public:
+	/**
+	 * No initialisation.
+	 */
+	ThreadId() noexcept = default;
+
+	constexpr ThreadId(pthread_t _id) noexcept:id(_id) {}
+
+	static constexpr ThreadId Null() noexcept {
+		return pthread_t{};
+	}
+
+	[[gnu::pure]]
+	bool IsNull() const noexcept {
+		return *this == Null();
+	}
+
+	/**
+	 * Return the current thread's id .
+	 */
+	[[gnu::pure]]
+	static const ThreadId GetCurrent() noexcept {
+		return pthread_self();
+	}
+
+	[[gnu::pure]]
+	bool operator==(const ThreadId &other) const noexcept {
+		return pthread_equal(id, other.id);
+	}
+
+	/**
+	 * Check if this thread is the current thread.
+	 */
+	bool IsInside() const noexcept {
+		return *this == GetCurrent();
+	}
+};
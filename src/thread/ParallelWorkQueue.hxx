@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+/**
+ * A bounded stack of work items which are processed synchronously by
+ * a number of short-lived worker threads (plus the calling thread).
+ * Processing an item may push more items; Run() returns when the
+ * stack is empty and no thread is busy anymore.
+ *
+ * Unlike #ThreadQueue, this does not need an #EventLoop; it is meant
+ * for blocking operations which shall be parallelized internally,
+ * e.g. walking a directory tree.
+ *
+ * Items are processed in LIFO order, which keeps the number of
+ * pending items (and the resources held by them) low when walking a
+ * tree.
+ */
+template<typename T>
+class ParallelWorkQueue {
+	std::mutex mutex;
+	std::condition_variable cond;
+
+	std::vector<T> stack;
+
+	/**
+	 * TryPush() fails if the stack has this many items.
+	 */
+	const std::size_t max_size;
+
+	/**
+	 * The number of threads currently processing an item.
+	 */
+	unsigned n_busy = 0;
+
+	std::atomic_bool failed{false};
+
+	/**
+	 * The first error passed to Fail().  Protected by #mutex.
+	 */
+	std::exception_ptr error;
+
+public:
+	explicit ParallelWorkQueue(std::size_t _max_size) noexcept
+		:max_size(_max_size) {}
+
+	ParallelWorkQueue(const ParallelWorkQueue &) = delete;
+	ParallelWorkQueue &operator=(const ParallelWorkQueue &) = delete;
+
+	/**
+	 * Has Fail() been called?  Processing functions should check
+	 * this and skip all work which is no longer needed.
+	 */
+	bool IsFailed() const noexcept {
+		return failed.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Record an error; the first one will be rethrown by Run().
+	 */
+	void Fail(std::exception_ptr e) noexcept {
+		const std::scoped_lock lock{mutex};
+		if (!error)
+			error = std::move(e);
+		failed.store(true, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Add an item, even if the stack is "full".
+	 */
+	void Push(T &&item) {
+		const std::scoped_lock lock{mutex};
+		stack.push_back(std::move(item));
+		cond.notify_one();
+	}
+
+	/**
+	 * Add an item unless the stack is full.
+	 *
+	 * @return true on success, false if the stack is full (the
+	 * item was not moved from; the caller should process it
+	 * synchronously)
+	 */
+	bool TryPush(T &&item) {
+		const std::scoped_lock lock{mutex};
+		if (stack.size() >= max_size)
+			return false;
+
+		stack.push_back(std::move(item));
+		cond.notify_one();
+		return true;
+	}
+
+	/**
+	 * Process all items (including those pushed meanwhile) with
+	 * the given function and return when all are done.
+	 *
+	 * If a worker thread cannot be launched, the work is done by
+	 * the remaining threads.  Exceptions thrown by the function
+	 * are passed to Fail(); items are still being processed
+	 * afterwards, so they can release their resources.
+	 *
+	 * Throws the first error passed to Fail().
+	 *
+	 * @param n_threads the total number of threads including the
+	 * calling thread; 0 means one per CPU
+	 */
+	template<typename F>
+	void Run(unsigned n_threads, F &&process) {
+		if (n_threads == 0)
+			n_threads = std::thread::hardware_concurrency();
+
+		std::vector<std::jthread> threads;
+		threads.reserve(n_threads);
+
+		for (unsigned i = 1; i < n_threads; ++i) {
+			try {
+				threads.emplace_back([this, &process]{
+					Work(process);
+				});
+			} catch (const std::system_error &) {
+				break;
+			}
+		}
+
+		Work(process);
+
+		/* join all threads */
+		threads.clear();
+
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+private:
+	template<typename F>
+	void Work(F &process) noexcept {
+		std::unique_lock lock{mutex};
+
+		while (true) {
+			if (stack.empty()) {
+				if (n_busy == 0)
+					break;
+
+				cond.wait(lock);
+				continue;
+			}
+
+			T item = std::move(stack.back());
+			stack.pop_back();
+			++n_busy;
+			lock.unlock();
+
+			try {
+				process(std::move(item));
+			} catch (...) {
+				Fail(std::current_exception());
+			}
+
+			lock.lock();
+			--n_busy;
+
+			if (n_busy == 0 && stack.empty())
+				/* all done: wake up the idle threads so
+				   they can exit */
+				cond.notify_all();
+		}
+	}
+};
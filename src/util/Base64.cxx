@@ -0,0 +1,286 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "Base64.hxx"
+
+#include <array>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using std::string_view_literals::operator""sv;
+
+static constexpr char base64_original[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static constexpr char base64_url_safe[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+static constexpr uint8_t BASE64_INVALID = 0xff;
+
+static constexpr auto
+MakeDecodeTable(const char *alphabet) noexcept
+{
+	std::array<uint8_t, 256> table{};
+	for (auto &i : table)
+		i = BASE64_INVALID;
+
+	for (unsigned i = 0; i < 64; ++i)
+		table[(uint8_t)alphabet[i]] = i;
+
+	return table;
+}
+
+static constexpr auto decode_original = MakeDecodeTable(base64_original);
+static constexpr auto decode_url_safe = MakeDecodeTable(base64_url_safe);
+
+#ifdef __SSE2__
+
+/**
+ * Translate 16 6-bit values to base64 characters.
+ */
+[[gnu::always_inline]]
+static inline __m128i
+Base64TranslateSSE2(__m128i v, bool url_safe) noexcept
+{
+	/* offsets from the value to the character: 'A' for 0..25,
+	   'a'-26 for 26..51, '0'-52 for 52..61 and individual
+	   offsets for 62 and 63 */
+	const int8_t offset_62 = url_safe ? '-' - 62 : '+' - 62;
+	const int8_t offset_63 = url_safe ? '_' - 63 : '/' - 63;
+
+	__m128i offset = _mm_set1_epi8('A');
+	offset = _mm_add_epi8(offset, _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(25)),
+						    _mm_set1_epi8(('a' - 26) - 'A')));
+	offset = _mm_add_epi8(offset, _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(51)),
+						    _mm_set1_epi8(('0' - 52) - ('a' - 26))));
+	offset = _mm_add_epi8(offset, _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(62)),
+						    _mm_set1_epi8(offset_62 - ('0' - 52))));
+	offset = _mm_add_epi8(offset, _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(63)),
+						    _mm_set1_epi8(offset_63 - ('0' - 52))));
+	return _mm_add_epi8(v, offset);
+}
+
+[[gnu::always_inline]]
+static inline uint_least32_t
+Load24(const std::byte *p) noexcept
+{
+	return (uint_least32_t(p[0]) << 16) |
+		(uint_least32_t(p[1]) << 8) |
+		uint_least32_t(p[2]);
+}
+
+/**
+ * Encode 12 bytes to 16 characters.
+ */
+[[gnu::always_inline]]
+static inline void
+Base64Encode12SSE2(char *dest, const std::byte *src, bool url_safe) noexcept
+{
+	/* one 24 bit group per 32 bit lane */
+	const __m128i v = _mm_set_epi32(Load24(src + 9), Load24(src + 6),
+					Load24(src + 3), Load24(src));
+
+	/* split each group into four 6 bit values, the most
+	   significant one first */
+	const __m128i mask = _mm_set1_epi32(0x3f);
+	const __m128i values =
+		_mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 18), mask),
+					  _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(v, 12), mask), 8)),
+			     _mm_or_si128(_mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(v, 6), mask), 16),
+					  _mm_slli_epi32(_mm_and_si128(v, mask), 24)));
+
+	_mm_storeu_si128((__m128i *)dest, Base64TranslateSSE2(values, url_safe));
+}
+
+/**
+ * Returns a mask of all bytes in the range [min, max].
+ */
+[[gnu::always_inline]]
+static inline __m128i
+InRange(__m128i v, char min, char max) noexcept
+{
+	return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(min - 1)),
+			     _mm_cmpgt_epi8(_mm_set1_epi8(max + 1), v));
+}
+
+/**
+ * Decode 16 characters to 12 bytes.  This writes 13 bytes to the
+ * destination buffer; the last one is garbage.
+ *
+ * @return false on error
+ */
+[[gnu::always_inline]]
+static inline bool
+Base64Decode16SSE2(std::byte *dest, const char *src, bool url_safe) noexcept
+{
+	const char char_62 = url_safe ? '-' : '+';
+	const char char_63 = url_safe ? '_' : '/';
+
+	const __m128i v = _mm_loadu_si128((const __m128i *)src);
+
+	const __m128i upper = InRange(v, 'A', 'Z');
+	const __m128i lower = InRange(v, 'a', 'z');
+	const __m128i digit = InRange(v, '0', '9');
+	const __m128i is_62 = _mm_cmpeq_epi8(v, _mm_set1_epi8(char_62));
+	const __m128i is_63 = _mm_cmpeq_epi8(v, _mm_set1_epi8(char_63));
+
+	const __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower),
+					   _mm_or_si128(digit, _mm_or_si128(is_62, is_63)));
+	if (_mm_movemask_epi8(valid) != 0xffff)
+		return false;
+
+	__m128i offset = _mm_and_si128(upper, _mm_set1_epi8('A'));
+	offset = _mm_or_si128(offset, _mm_and_si128(lower, _mm_set1_epi8('a' - 26)));
+	offset = _mm_or_si128(offset, _mm_and_si128(digit, _mm_set1_epi8('0' - 52)));
+	offset = _mm_or_si128(offset, _mm_and_si128(is_62, _mm_set1_epi8(char_62 - 62)));
+	offset = _mm_or_si128(offset, _mm_and_si128(is_63, _mm_set1_epi8(char_63 - 63)));
+
+	const __m128i values = _mm_sub_epi8(v, offset);
+
+	/* combine pairs of 6 bit values to 12 bit values (one per
+	   16 bit lane), then pairs of those to 24 bit values (one
+	   per 32 bit lane); the first character is the most
+	   significant one */
+	const __m128i w = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(values, _mm_set1_epi16(0xff)), 6),
+				       _mm_srli_epi16(values, 8));
+	const __m128i d = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(w, _mm_set1_epi32(0xffff)), 12),
+				       _mm_srli_epi32(w, 16));
+
+	alignas(16) uint32_t groups[4];
+	_mm_store_si128((__m128i *)groups, d);
+
+	for (const uint32_t group : groups) {
+		/* store big-endian; the fourth byte is overwritten
+		   by the next group */
+		const uint32_t be = __builtin_bswap32(group << 8);
+		std::memcpy(dest, &be, sizeof(be));
+		dest += 3;
+	}
+
+	return true;
+}
+
+#endif
+
+char *
+Base64Encode(char *dest, std::span<const std::byte> src,
+	     Base64Variant variant) noexcept
+{
+	const bool url_safe = IsUrlSafe(variant);
+	const char *const alphabet = url_safe ? base64_url_safe : base64_original;
+
+#ifdef __SSE2__
+	/* Base64Encode12SSE2() processes 12 bytes */
+	for (; src.size() >= 12; src = src.subspan(12)) {
+		Base64Encode12SSE2(dest, src.data(), url_safe);
+		dest += 16;
+	}
+#endif
+
+	for (; src.size() >= 3; src = src.subspan(3)) {
+		const auto group = (uint_least32_t(src[0]) << 16) |
+			(uint_least32_t(src[1]) << 8) |
+			uint_least32_t(src[2]);
+
+		*dest++ = alphabet[(group >> 18) & 0x3f];
+		*dest++ = alphabet[(group >> 12) & 0x3f];
+		*dest++ = alphabet[(group >> 6) & 0x3f];
+		*dest++ = alphabet[group & 0x3f];
+	}
+
+	if (src.empty())
+		return dest;
+
+	const auto group = (uint_least32_t(src[0]) << 16) |
+		(src.size() > 1 ? uint_least32_t(src[1]) << 8 : 0);
+
+	*dest++ = alphabet[(group >> 18) & 0x3f];
+	*dest++ = alphabet[(group >> 12) & 0x3f];
+
+	if (src.size() > 1)
+		*dest++ = alphabet[(group >> 6) & 0x3f];
+	else if (HasPadding(variant))
+		*dest++ = '=';
+
+	if (HasPadding(variant))
+		*dest++ = '=';
+
+	return dest;
+}
+
+std::byte *
+Base64Decode(std::byte *dest, std::string_view src,
+	     Base64Variant variant) noexcept
+{
+	const bool url_safe = IsUrlSafe(variant);
+	const auto &table = url_safe ? decode_url_safe : decode_original;
+
+	if (HasPadding(variant)) {
+		if (src.size() % 4 != 0)
+			return nullptr;
+
+		/* strip the padding; the remaining length
+		   determines how much padding there must have
+		   been */
+		if (src.ends_with('='))
+			src.remove_suffix(src.ends_with("=="sv) ? 2 : 1);
+	}
+
+	if (src.size() % 4 == 1)
+		return nullptr;
+
+#ifdef __SSE2__
+	/* Base64Decode16SSE2() writes one byte too many, therefore
+	   leave room for it */
+	for (; src.size() >= 20; src.remove_prefix(16)) {
+		if (!Base64Decode16SSE2(dest, src.data(), url_safe))
+			return nullptr;
+
+		dest += 12;
+	}
+#endif
+
+	for (; src.size() >= 4; src.remove_prefix(4)) {
+		const uint8_t a = table[(uint8_t)src[0]];
+		const uint8_t b = table[(uint8_t)src[1]];
+		const uint8_t c = table[(uint8_t)src[2]];
+		const uint8_t d = table[(uint8_t)src[3]];
+		if ((a | b | c | d) == BASE64_INVALID)
+			return nullptr;
+
+		const auto group = (uint_least32_t(a) << 18) |
+			(uint_least32_t(b) << 12) |
+			(uint_least32_t(c) << 6) |
+			uint_least32_t(d);
+
+		*dest++ = std::byte(group >> 16);
+		*dest++ = std::byte(group >> 8);
+		*dest++ = std::byte(group);
+	}
+
+	if (src.empty())
+		return dest;
+
+	const uint8_t a = table[(uint8_t)src[0]];
+	const uint8_t b = table[(uint8_t)src[1]];
+	const uint8_t c = src.size() > 2 ? table[(uint8_t)src[2]] : 0;
+	if ((a | b | c) == BASE64_INVALID)
+		return nullptr;
+
+	const auto group = (uint_least32_t(a) << 18) |
+		(uint_least32_t(b) << 12) |
+		(uint_least32_t(c) << 6);
+
+	/* the trailing bits must be zero */
+	if ((group & (src.size() > 2 ? 0xff : 0xffff)) != 0)
+		return nullptr;
+
+	*dest++ = std::byte(group >> 16);
+	if (src.size() > 2)
+		*dest++ = std::byte(group >> 8);
+
+	return dest;
+}
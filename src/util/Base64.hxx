@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+/**
+ * The base64 variants; they correspond to libsodium's
+ * sodium_base64_VARIANT_* constants.
+ */
+enum class Base64Variant : uint_least8_t {
+	/**
+	 * RFC 4648 section 4 ('+' and '/') with padding.
+	 */
+	ORIGINAL,
+
+	ORIGINAL_NO_PADDING,
+
+	/**
+	 * RFC 4648 section 5 ('-' and '_') with padding.
+	 */
+	URL_SAFE,
+
+	URL_SAFE_NO_PADDING,
+};
+
+constexpr bool
+IsUrlSafe(Base64Variant variant) noexcept
+{
+	return variant == Base64Variant::URL_SAFE ||
+		variant == Base64Variant::URL_SAFE_NO_PADDING;
+}
+
+constexpr bool
+HasPadding(Base64Variant variant) noexcept
+{
+	return variant == Base64Variant::ORIGINAL ||
+		variant == Base64Variant::URL_SAFE;
+}
+
+/**
+ * Calculate the number of characters generated by Base64Encode()
+ * (excluding the null terminator).
+ */
+constexpr std::size_t
+CalcBase64EncodedSize(std::size_t src_size, Base64Variant variant) noexcept
+{
+	return HasPadding(variant)
+		? (src_size + 2) / 3 * 4
+		: src_size / 3 * 4 + (src_size % 3 == 0 ? 0 : src_size % 3 + 1);
+}
+
+/**
+ * Calculate the maximum number of bytes generated by
+ * Base64Decode().
+ */
+constexpr std::size_t
+CalcBase64DecodedMaxSize(std::size_t src_size) noexcept
+{
+	return src_size / 4 * 3 + (src_size % 4) * 3 / 4;
+}
+
+/**
+ * Encode the given buffer to base64.  The caller ensures that the
+ * destination buffer is at least CalcBase64EncodedSize() bytes
+ * large.  Does not null-terminate the output buffer.
+ *
+ * Large inputs are processed in blocks using SIMD instructions if
+ * available.
+ *
+ * @return a pointer to one after the last written character
+ */
+char *
+Base64Encode(char *dest, std::span<const std::byte> src,
+	     Base64Variant variant) noexcept;
+
+/**
+ * Decode the given base64 string.  The caller ensures that the
+ * destination buffer is at least CalcBase64DecodedMaxSize() bytes
+ * large.
+ *
+ * Decoding is strict (like libsodium's sodium_base642bin() without
+ * "ignore" characters): characters outside of the variant's alphabet,
+ * missing or excess padding and non-zero trailing bits are errors.
+ *
+ * @return a pointer to one after the last written byte or nullptr on
+ * error
+ */
+std::byte *
+Base64Decode(std::byte *dest, std::string_view src,
+	     Base64Variant variant) noexcept;
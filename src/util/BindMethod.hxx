@@ -51,6 +51,15 @@ public:
 	R operator()(Args... args) const noexcept(NoExcept) {
 		return function(instance_, std::forward<Args>(args)...);
 	}
+
+	/**
+	 * Returns the address of the function which will be called.
+	 * This is only meant for diagnostics, e.g. to look up its
+	 * symbol name.
+	 */
+	const void *GetFunctionAddress() const noexcept {
+		return reinterpret_cast<const void *>(function);
+	}
 };
 
 namespace BindMethodDetail {
@@ -4,18 +4,34 @@
 
 #pragma once
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <span>
 
 /**
- * A naive (and slow) CRC-32/ISO-HDLC implementation.
+ * A table-driven CRC-32/ISO-HDLC implementation.
  */
 class CRC32State {
 public:
 	using value_type = uint32_t;
 
 private:
+	static constexpr value_type POLYNOMIAL = 0xedb88320;
+
+	static constexpr auto table = []{
+		std::array<value_type, 256> t{};
+
+		for (unsigned i = 0; i < t.size(); ++i) {
+			value_type crc = i;
+			for (unsigned j = 0; j < 8; ++j)
+				crc = (crc >> 1) ^ (crc & 1 ? POLYNOMIAL : 0);
+			t[i] = crc;
+		}
+
+		return t;
+	}();
+
 	value_type state = 0xffffffff;
 
 public:
@@ -32,16 +48,7 @@ public:
 private:
 	static constexpr value_type Update(value_type crc,
 					   uint8_t octet) noexcept {
-		for (unsigned i = 0; i < 8; i++) {
-			uint32_t bit = (octet ^ crc) & 1;
-			crc >>= 1;
-			if (bit)
-				crc ^= 0xedb88320;
-
-			octet >>= 1;
-		}
-
-		return crc;
+		return table[(crc ^ octet) & 0xff] ^ (crc >> 8);
 	}
 };
 
@@ -36,6 +36,15 @@ public:
 
 	DynamicFifoBuffer(const DynamicFifoBuffer &) = delete;
 
+	void swap(DynamicFifoBuffer<T> &other) noexcept {
+		ForeignFifoBuffer<T>::swap(other);
+	}
+
+	friend void swap(DynamicFifoBuffer<T> &a,
+			 DynamicFifoBuffer<T> &b) noexcept {
+		a.swap(b);
+	}
+
 	using ForeignFifoBuffer<T>::GetCapacity;
 	using ForeignFifoBuffer<T>::Clear;
 	using ForeignFifoBuffer<T>::empty;
@@ -55,6 +64,21 @@ public:
 		delete[] old_data;
 	}
 
+	/**
+	 * Reallocate the buffer with a smaller capacity (e.g. to
+	 * release memory after a peak).  The data currently in the
+	 * buffer must fit.
+	 */
+	void Shrink(size_type new_capacity) noexcept {
+		assert(new_capacity < GetCapacity());
+		assert(new_capacity >= GetAvailable());
+
+		T *old_data = GetBuffer();
+		T *new_data = new T[new_capacity];
+		ForeignFifoBuffer<T>::MoveBuffer(new_data, new_capacity);
+		delete[] old_data;
+	}
+
 	void WantWrite(size_type n) noexcept {
 		if (ForeignFifoBuffer<T>::WantWrite(n))
 			/* we already have enough space */
@@ -7,6 +7,11 @@
 #include <array>
 #include <cstdint>
 #include <span>
+#include <type_traits> // for std::is_constant_evaluated()
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 constexpr char hex_digits[] = "0123456789abcdef";
 
@@ -54,6 +59,41 @@ HexFormatUint64Fixed(char dest[16], uint64_t number) noexcept
 	return dest;
 }
 
+#ifdef __SSE2__
+
+/**
+ * Convert each byte of the given vector (containing only values
+ * 0..15) to a lower-case hex digit.
+ */
+[[gnu::always_inline]]
+inline __m128i
+HexFormatNibblesSSE2(__m128i v) noexcept
+{
+	/* '0'..'9' for 0..9; for 10..15, add another 'a'-'0'-10 */
+	const __m128i letter = _mm_cmpgt_epi8(v, _mm_set1_epi8(9));
+	return _mm_add_epi8(_mm_add_epi8(v, _mm_set1_epi8('0')),
+			    _mm_and_si128(letter, _mm_set1_epi8('a' - '0' - 10)));
+}
+
+/**
+ * Format 16 bytes to 32 hex digits.
+ */
+[[gnu::always_inline]]
+inline void
+HexFormat16SSE2(char *output, const std::byte *input) noexcept
+{
+	const __m128i mask = _mm_set1_epi8(0xf);
+	const __m128i v = _mm_loadu_si128((const __m128i *)input);
+	const __m128i hi = HexFormatNibblesSSE2(_mm_and_si128(_mm_srli_epi16(v, 4), mask));
+	const __m128i lo = HexFormatNibblesSSE2(_mm_and_si128(v, mask));
+
+	/* interleave: the high nibble comes first */
+	_mm_storeu_si128((__m128i *)output, _mm_unpacklo_epi8(hi, lo));
+	_mm_storeu_si128((__m128i *)(output + 16), _mm_unpackhi_epi8(hi, lo));
+}
+
+#endif
+
 /**
  * Format the given input buffer of bytes to hex.  The caller ensures
  * that the output buffer is at least twice as large as the input.
@@ -64,6 +104,15 @@ HexFormatUint64Fixed(char dest[16], uint64_t number) noexcept
 constexpr char *
 HexFormat(char *output, std::span<const std::byte> input) noexcept
 {
+#ifdef __SSE2__
+	if (!std::is_constant_evaluated()) {
+		for (; input.size() >= 16; input = input.subspan(16)) {
+			HexFormat16SSE2(output, input.data());
+			output += 32;
+		}
+	}
+#endif
+
 	for (const auto &i : input)
 		output = HexFormatUint8Fixed(output, (uint8_t)i);
 
@@ -9,8 +9,15 @@
 #include <array>
 #include <concepts>
 #include <cstdint>
+#include <span>
 #include <string_view>
 
+#include <string.h> // for strnlen()
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 constexpr int
 ParseHexDigit(char ch) noexcept
 {
@@ -66,6 +73,123 @@ ParseLowerHexFixed(const char *input, std::byte &_output) noexcept
 	return ParseLowerHexFixed(input, output);
 }
 
+#ifdef __SSE2__
+
+/**
+ * Convert 16 lower-case hex digits to their values (one per byte).
+ *
+ * @param valid set to false if there is an invalid character
+ */
+[[gnu::always_inline]]
+inline __m128i
+ParseLowerHexDigitsSSE2(__m128i v, bool &valid) noexcept
+{
+	const __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+					    _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), v));
+	const __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('a' - 1)),
+					     _mm_cmpgt_epi8(_mm_set1_epi8('f' + 1), v));
+
+	if (_mm_movemask_epi8(_mm_or_si128(digit, letter)) != 0xffff)
+		valid = false;
+
+	const __m128i offset = _mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8('0')),
+					    _mm_and_si128(letter, _mm_set1_epi8('a' - 10)));
+	return _mm_sub_epi8(v, offset);
+}
+
+/**
+ * Combine pairs of nibbles (high nibble first) to bytes, one per
+ * 16 bit lane.
+ */
+[[gnu::always_inline]]
+inline __m128i
+CombineNibblesSSE2(__m128i v) noexcept
+{
+	return _mm_or_si128(_mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0xff)), 4),
+			    _mm_srli_epi16(v, 8));
+}
+
+/**
+ * Parse 32 lower-case hex digits to 16 bytes.
+ *
+ * @return false on error
+ */
+[[gnu::always_inline]]
+inline bool
+ParseLowerHex16SSE2(const char *input, std::byte *output) noexcept
+{
+	bool valid = true;
+	const __m128i a = ParseLowerHexDigitsSSE2(_mm_loadu_si128((const __m128i *)input), valid);
+	const __m128i b = ParseLowerHexDigitsSSE2(_mm_loadu_si128((const __m128i *)(input + 16)), valid);
+	_mm_storeu_si128((__m128i *)output,
+			 _mm_packus_epi16(CombineNibblesSSE2(a), CombineNibblesSSE2(b)));
+	return valid;
+}
+
+#endif
+
+/**
+ * Parse lower-case hex digits (exactly twice as many as the size of
+ * the output buffer) to the given byte buffer.
+ *
+ * @return true on success, false if the input has the wrong length
+ * or contains an invalid character
+ */
+inline bool
+ParseLowerHexFixed(std::string_view input, std::span<std::byte> output) noexcept
+{
+	if (input.size() != output.size() * 2)
+		return false;
+
+	const char *p = input.data();
+
+#ifdef __SSE2__
+	for (; output.size() >= 16; output = output.subspan(16)) {
+		if (!ParseLowerHex16SSE2(p, output.data()))
+			return false;
+
+		p += 32;
+	}
+#endif
+
+	for (auto &i : output) {
+		p = ParseLowerHexFixed(p, i);
+		if (p == nullptr)
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Parse lower-case hex digits (twice as many as the size of the
+ * output buffer) to the given byte buffer.  The input may be a
+ * shorter null-terminated string; that is an error.
+ *
+ * @return the end of the parsed string on success, nullptr on error
+ */
+inline const char *
+ParseLowerHexFixed(const char *input, std::span<std::byte> output) noexcept
+{
+	/* the SSE2 code reads 32 characters at a time, so don't
+	   let it run past the end of a short string */
+	const std::size_t length = output.size() * 2;
+	if (strnlen(input, length) < length)
+		return nullptr;
+
+	if (!ParseLowerHexFixed(std::string_view{input, length}, output))
+		return nullptr;
+
+	return input + length;
+}
+
+template<std::size_t size>
+const char *
+ParseLowerHexFixed(const char *input, std::array<std::byte, size> &output) noexcept
+{
+	return ParseLowerHexFixed(input, std::span<std::byte>{output});
+}
+
 /**
  * Parse the hex digits of a fixed-length string to the given integer
  * array.
@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iterator> // for std::size()
+
+/**
+ * Generate histogram bucket bounds which grow exponentially: the
+ * first bound is #first, and each following bound is the previous
+ * one shifted left by #shift bits.
+ */
+template<std::size_t N>
+constexpr std::array<uint_least64_t, N>
+MakeExponentialBounds(uint_least64_t first, unsigned shift) noexcept
+{
+	std::array<uint_least64_t, N> result{};
+	for (std::size_t i = 0; i < N; ++i)
+		result[i] = first << (shift * i);
+	return result;
+}
+
+/**
+ * A histogram with fixed bucket bounds, modeled after Prometheus
+ * histograms.  Durations are recorded in nanoseconds.
+ *
+ * @param bounds a sorted array of (inclusive) upper bucket bounds
+ */
+template<const auto &bounds>
+class Histogram {
+	/**
+	 * The last element counts values which are larger than all
+	 * bounds.
+	 */
+	std::array<uint_least64_t, std::size(bounds) + 1> buckets{};
+
+	uint_least64_t sum = 0;
+
+public:
+	void Add(uint_least64_t value) noexcept {
+		std::size_t i = 0;
+		while (i < bounds.size() && value > bounds[i])
+			++i;
+
+		++buckets[i];
+		sum += value;
+	}
+
+	template<class Rep, class Period>
+	void Add(std::chrono::duration<Rep, Period> value) noexcept {
+		Add(uint_least64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(value).count()));
+	}
+
+	constexpr Histogram &operator+=(const Histogram &other) noexcept {
+		for (std::size_t i = 0; i < buckets.size(); ++i)
+			buckets[i] += other.buckets[i];
+		sum += other.sum;
+		return *this;
+	}
+
+	static constexpr const auto &GetBounds() noexcept {
+		return bounds;
+	}
+
+	const auto &GetBuckets() const noexcept {
+		return buckets;
+	}
+
+	[[gnu::pure]]
+	uint_least64_t GetCount() const noexcept {
+		uint_least64_t count = 0;
+		for (const auto i : buckets)
+			count += i;
+		return count;
+	}
+
+	uint_least64_t GetSum() const noexcept {
+		return sum;
+	}
+};
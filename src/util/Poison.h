@@ -11,6 +11,8 @@
 #ifndef POISON_H
 #define POISON_H
 
+#include <stddef.h>
+
 #if defined(HAVE_VALGRIND_MEMCHECK_H) && !defined(NDEBUG)
 #include <valgrind/memcheck.h>
 #endif
@@ -19,6 +19,14 @@ public:
 		zero_time = 0;
 	}
 
+	/**
+	 * @return the number of tokens that are available now
+	 * (without consuming any)
+	 */
+	constexpr double GetAvailable(double now, double rate, double burst) const noexcept {
+		return std::min((now - zero_time) * rate, burst);
+	}
+
 	/**
 	 * @return true if the given transmission is conforming, false
 	 * to discard it
@@ -6,7 +6,13 @@
 #include "Compiler.h"
 
 #include <algorithm>
+#include <bit>
 #include <cstdint>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 /**
  * Is this a leading byte that is followed by 1 continuation byte?
@@ -141,6 +147,144 @@ ValidateUTF8(const char *p) noexcept
 	return true;
 }
 
+#ifdef __SSE2__
+
+/**
+ * Returns a bit mask of all bytes in #v which are equal to or
+ * larger than #threshold (unsigned).
+ */
+[[gnu::always_inline]]
+static inline uint_least32_t
+AtLeast(__m128i v, uint8_t threshold) noexcept
+{
+	const __m128i t = _mm_set1_epi8(threshold);
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, t), v));
+}
+
+/**
+ * Validate one 16 byte block.
+ *
+ * Each leading byte "requires" a number of continuation bytes after
+ * it; the block is valid if the set of required positions equals
+ * the set of continuation bytes.  Requirements which cross the block
+ * boundary are carried over to the next block.
+ *
+ * @param carry the continuation bytes required by the previous
+ * block; updated for the next block
+ */
+[[gnu::always_inline]]
+static inline bool
+ValidateBlockUTF8(__m128i v, uint_least32_t &carry) noexcept
+{
+	const uint_least32_t non_ascii = _mm_movemask_epi8(v);
+	if (non_ascii == 0)
+		/* fast path: plain ASCII */
+		return carry == 0;
+
+	/* a leading byte >= 0xc0 requires at least one continuation
+	   byte, >= 0xe0 at least two and so on */
+	const uint_least32_t leading = AtLeast(v, 0xc0);
+	const uint_least32_t required = carry |
+		(leading << 1) |
+		(AtLeast(v, 0xe0) << 2) |
+		(AtLeast(v, 0xf0) << 3) |
+		(AtLeast(v, 0xf8) << 4) |
+		(AtLeast(v, 0xfc) << 5);
+
+	const uint_least32_t continuation = non_ascii & ~leading;
+
+	carry = required >> 16;
+	return AtLeast(v, 0xfe) == 0 && (required & 0xffff) == continuation;
+}
+
+[[gnu::always_inline]]
+static inline __m128i
+LoadTail(const char *p, std::size_t size) noexcept
+{
+	alignas(16) char buffer[16]{};
+	std::memcpy(buffer, p, size);
+	return _mm_load_si128((const __m128i *)buffer);
+}
+
+bool
+ValidateUTF8(std::string_view s) noexcept
+{
+	const char *p = s.data();
+	std::size_t size = s.size();
+	uint_least32_t carry = 0;
+
+	for (; size >= 16; p += 16, size -= 16)
+		if (!ValidateBlockUTF8(_mm_loadu_si128((const __m128i *)p), carry))
+			return false;
+
+	if (size > 0 && !ValidateBlockUTF8(LoadTail(p, size), carry))
+		/* note: a truncated sequence in the tail requires
+		   the zero padding to be continuation bytes, which
+		   makes this fail */
+		return false;
+
+	return carry == 0;
+}
+
+std::size_t
+LengthUTF8(std::string_view s) noexcept
+{
+	const char *p = s.data();
+	std::size_t size = s.size();
+	std::size_t n_continuations = 0;
+
+	/* continuation bytes are 0x80..0xbf, i.e. -128..-65 as
+	   signed bytes */
+	const __m128i threshold = _mm_set1_epi8(-64);
+
+	for (; size >= 16; p += 16, size -= 16) {
+		const __m128i v = _mm_loadu_si128((const __m128i *)p);
+		n_continuations += std::popcount(unsigned(_mm_movemask_epi8(_mm_cmpgt_epi8(threshold, v))));
+	}
+
+	for (; size > 0; ++p, --size)
+		if (IsContinuation(*p))
+			++n_continuations;
+
+	return s.size() - n_continuations;
+}
+
+#else
+
+bool
+ValidateUTF8(std::string_view s) noexcept
+{
+	for (auto p = s.begin(), end = s.end(); p != end;) {
+		const uint8_t ch = *p;
+		if (IsASCII(ch)) {
+			++p;
+			continue;
+		}
+
+		const std::size_t length = SequenceLengthUTF8(ch);
+		if (length == 0 || std::size_t(end - p) < length)
+			return false;
+
+		for (std::size_t i = 1; i < length; ++i)
+			if (!IsContinuation(p[i]))
+				return false;
+
+		p += length;
+	}
+
+	return true;
+}
+
+std::size_t
+LengthUTF8(std::string_view s) noexcept
+{
+	return std::count_if(s.begin(), s.end(), [](uint8_t ch){
+		return !IsContinuation(ch);
+	});
+}
+
+#endif
+
 std::size_t
 SequenceLengthUTF8(char ch) noexcept
 {
@@ -5,6 +5,7 @@
 #define UTF8_HXX
 
 #include <cstddef>
+#include <string_view>
 
 /**
  * Is this a valid UTF-8 string?
@@ -13,6 +14,15 @@
 bool
 ValidateUTF8(const char *p) noexcept;
 
+/**
+ * Is this a valid UTF-8 string?  Unlike the null-terminated
+ * overload, this one processes the string in blocks (using SIMD
+ * instructions if available).  Null bytes are allowed.
+ */
+[[gnu::pure]]
+bool
+ValidateUTF8(std::string_view s) noexcept;
+
 /**
  * @return the number of the sequence beginning with the given
  * character, or 0 if the character is not a valid start byte
@@ -58,4 +68,13 @@ UnicodeToUTF8(unsigned ch, char *buffer) noexcept;
 std::size_t
 LengthUTF8(const char *p) noexcept;
 
+/**
+ * Returns the number of characters in the string (see above).  This
+ * overload processes the string in blocks (using SIMD instructions
+ * if available).
+ */
+[[gnu::pure]]
+std::size_t
+LengthUTF8(std::string_view s) noexcept;
+
 #endif
@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "lib/avahi/Batcher.hxx"
+#include "lib/avahi/BatchListener.hxx"
+#include "event/Loop.hxx"
+#include "event/FineTimerEvent.hxx"
+#include "net/IPv4Address.hxx"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace Avahi;
+
+namespace {
+
+struct MyBatchListener final : ServiceBatchListener {
+	std::vector<std::string> added, removed;
+	ServiceSnapshotPtr snapshot;
+	unsigned n_changes = 0, n_all_for_now = 0;
+
+	void OnAvahiChanges(const ServiceChangeSet &changes) noexcept override {
+		++n_changes;
+
+		added.clear();
+		for (const auto *i : changes.added)
+			added.emplace_back(i->key);
+
+		removed = changes.removed;
+		snapshot = changes.snapshot;
+	}
+
+	void OnAvahiAllForNow() noexcept override {
+		++n_all_for_now;
+	}
+};
+
+static IPv4Address
+MakeAddress(uint8_t last, uint16_t port=80) noexcept
+{
+	return IPv4Address{192, 168, 0, last, port};
+}
+
+} // anonymous namespace
+
+TEST(AvahiServiceBatcher, Basic)
+{
+	EventLoop event_loop;
+	MyBatchListener listener;
+	ServiceBatcher batcher{event_loop, std::chrono::milliseconds{10}, listener};
+	ServiceExplorerListener &explorer_listener = batcher;
+
+	ASSERT_TRUE(batcher.GetSnapshot());
+	ASSERT_TRUE(batcher.GetSnapshot()->empty());
+
+	explorer_listener.OnAvahiNewObject("b", MakeAddress(2));
+	explorer_listener.OnAvahiNewObject("a", MakeAddress(1));
+	explorer_listener.OnAvahiNewObject("c", MakeAddress(3));
+	ASSERT_EQ(listener.n_changes, 0u);
+
+	/* the timer delivers all changes at once */
+	FineTimerEvent stop{event_loop, BIND_METHOD(event_loop, &EventLoop::Break)};
+	stop.Schedule(std::chrono::milliseconds{50});
+	event_loop.Run();
+
+	ASSERT_EQ(listener.n_changes, 1u);
+	ASSERT_EQ(listener.added, (std::vector<std::string>{"a", "b", "c"}));
+	ASSERT_TRUE(listener.removed.empty());
+	ASSERT_EQ(listener.snapshot, batcher.GetSnapshot());
+	ASSERT_EQ(listener.snapshot->size(), 3u);
+
+	const auto *b = listener.snapshot->Find("b");
+	ASSERT_NE(b, nullptr);
+	ASSERT_EQ(b->key, "b");
+	ASSERT_TRUE(b->address == MakeAddress(2));
+	ASSERT_EQ(listener.snapshot->Find("d"), nullptr);
+
+	/* removing and adding */
+	const auto old_snapshot = listener.snapshot;
+	explorer_listener.OnAvahiRemoveObject("a");
+	explorer_listener.OnAvahiNewObject("d", MakeAddress(4));
+	batcher.Flush();
+
+	ASSERT_EQ(listener.n_changes, 2u);
+	ASSERT_EQ(listener.added, (std::vector<std::string>{"d"}));
+	ASSERT_EQ(listener.removed, (std::vector<std::string>{"a"}));
+	ASSERT_EQ(listener.snapshot->size(), 3u);
+	ASSERT_EQ(listener.snapshot->Find("a"), nullptr);
+
+	/* the old snapshot is immutable */
+	ASSERT_EQ(old_snapshot->size(), 3u);
+	ASSERT_NE(old_snapshot->Find("a"), nullptr);
+	ASSERT_EQ(old_snapshot->Find("d"), nullptr);
+
+	/* nothing pending */
+	batcher.Flush();
+	ASSERT_EQ(listener.n_changes, 2u);
+}
+
+TEST(AvahiServiceBatcher, Flap)
+{
+	EventLoop event_loop;
+	MyBatchListener listener;
+	ServiceBatcher batcher{event_loop, std::chrono::seconds{10}, listener};
+	ServiceExplorerListener &explorer_listener = batcher;
+
+	explorer_listener.OnAvahiNewObject("a", MakeAddress(1));
+	explorer_listener.OnAvahiNewObject("b", MakeAddress(2));
+	explorer_listener.OnAvahiAllForNow();
+
+	/* "all for now" flushes immediately */
+	ASSERT_EQ(listener.n_changes, 1u);
+	ASSERT_EQ(listener.n_all_for_now, 1u);
+	ASSERT_EQ(listener.added.size(), 2u);
+
+	/* a node which disappears and comes back with the same
+	   address is not reported */
+	explorer_listener.OnAvahiRemoveObject("a");
+	explorer_listener.OnAvahiNewObject("a", MakeAddress(1));
+	explorer_listener.OnAvahiRemoveObject("unknown");
+	batcher.Flush();
+	ASSERT_EQ(listener.n_changes, 1u);
+
+	/* ... but a changed address is */
+	explorer_listener.OnAvahiRemoveObject("b");
+	explorer_listener.OnAvahiNewObject("b", MakeAddress(2, 8080));
+	batcher.Flush();
+	ASSERT_EQ(listener.n_changes, 2u);
+	ASSERT_EQ(listener.added, (std::vector<std::string>{"b"}));
+	ASSERT_TRUE(listener.removed.empty());
+	ASSERT_TRUE(listener.snapshot->Find("b")->address == MakeAddress(2, 8080));
+
+	/* removing everything */
+	explorer_listener.OnAvahiRemoveObject("a");
+	explorer_listener.OnAvahiRemoveObject("b");
+	batcher.Flush();
+	ASSERT_EQ(listener.n_changes, 3u);
+	ASSERT_TRUE(listener.added.empty());
+	ASSERT_EQ(listener.removed, (std::vector<std::string>{"a", "b"}));
+	ASSERT_TRUE(listener.snapshot->empty());
+}
@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "co/FrameAllocator.hxx"
+#include "co/Task.hxx"
+#include "co/InvokeTask.hxx"
+
+#include <gtest/gtest.h>
+
+#include <optional>
+#include <thread>
+
+static Co::Task<int>
+Add(int a, int b)
+{
+	co_return a + b;
+}
+
+static Co::InvokeTask
+Sum(int n, int &result)
+{
+	for (int i = 0; i < n; ++i)
+		result = co_await Add(result, i);
+}
+
+TEST(FrameAllocator, Basic)
+{
+	Co::FrameAllocator a;
+
+	void *p = a.Allocate(100);
+	ASSERT_NE(p, nullptr);
+	a.Free(p, 100);
+	EXPECT_EQ(a.GetStats().n_cached, 1U);
+
+	/* same size class: recycled */
+	void *q = a.Allocate(128);
+	EXPECT_EQ(q, p);
+	EXPECT_EQ(a.GetStats().n_recycled, 1U);
+	EXPECT_EQ(a.GetStats().n_cached, 0U);
+
+	/* different size class: not recycled */
+	a.Free(q, 128);
+	void *r = a.Allocate(200);
+	EXPECT_NE(r, q);
+	EXPECT_EQ(a.GetStats().n_recycled, 1U);
+	a.Free(r, 200);
+
+	/* too large */
+	void *l = a.Allocate(1 << 20);
+	EXPECT_EQ(a.GetStats().n_large, 1U);
+	a.Free(l, 1 << 20);
+	EXPECT_EQ(a.GetStats().n_cached, 2U);
+	EXPECT_EQ(a.GetStats().n_allocations, 4U);
+}
+
+TEST(FrameAllocator, Coroutines)
+{
+	const auto before = Co::GetFrameAllocatorStats();
+
+	int result = 0;
+	std::exception_ptr error;
+
+	auto task = Sum(100, result);
+	task.Start({&error, [](void *error_p, std::exception_ptr _error) noexcept {
+		auto &error_r = *(std::exception_ptr *)error_p;
+		error_r = std::move(_error);
+	}});
+
+	ASSERT_FALSE(error);
+	ASSERT_EQ(result, 4950);
+
+	const auto &after = Co::GetFrameAllocatorStats();
+	EXPECT_EQ(after.n_allocations - before.n_allocations, 101U);
+
+	/* all but the first Add() frame were recycled */
+	EXPECT_GE(after.n_recycled - before.n_recycled, 99U);
+}
+
+/**
+ * A coroutine frame which is freed during thread exit, after the
+ * thread's #FrameAllocator has been destroyed.
+ */
+TEST(FrameAllocator, FreeAfterThreadExit)
+{
+	std::thread{[]{
+		/* constructed before the thread's FrameAllocator, so
+		   it is destroyed after it */
+		static thread_local std::optional<Co::Task<int>> task;
+		task.emplace();
+
+		/* this constructs the thread's FrameAllocator */
+		EXPECT_EQ(Co::GetFrameAllocatorStats().n_allocations, 0U);
+
+		/* recycle a frame, then allocate the one which
+		   outlives the FrameAllocator */
+		Add(1, 2);
+		*task = Add(3, 4);
+		EXPECT_EQ(Co::GetFrameAllocatorStats().n_recycled, 1U);
+	}}.join();
+}
@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "net/IPv4Address.hxx"
+#include "net/SocketAddress.hxx"
+#include "net/StaticSocketAddress.hxx"
+#include "net/UniqueSocketDescriptor.hxx"
+
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+
+/**
+ * A minimal HTTP server on a loopback port which serves a fixed
+ * response to a number of connections (one request each) in a
+ * separate thread.  Unlike "file:" URLs, HTTP transfers can be
+ * paused.
+ */
+class HttpServer {
+	UniqueSocketDescriptor listener;
+	std::string response;
+	std::thread thread;
+
+public:
+	explicit HttpServer(std::string_view body, unsigned n_connections=1) {
+		if (!listener.Create(AF_INET, SOCK_STREAM, 0))
+			throw std::runtime_error{"socket() failed"};
+
+		if (!listener.Bind(IPv4Address{IPv4Address::Loopback(), 0}) ||
+		    !listener.Listen(1))
+			throw std::runtime_error{"bind() failed"};
+
+		response = "HTTP/1.0 200 OK\r\nContent-Length: " +
+			std::to_string(body.size()) + "\r\n\r\n";
+		response += body;
+
+		thread = std::thread{[this, n_connections]{
+			for (unsigned i = 0; i < n_connections; ++i)
+				Serve();
+		}};
+	}
+
+	~HttpServer() noexcept {
+		thread.join();
+	}
+
+	unsigned GetPort() const {
+		const IPv4Address address{listener.GetLocalAddress()};
+		return address.GetPort();
+	}
+
+	std::string GetUrl() const {
+		return "http://127.0.0.1:" + std::to_string(GetPort()) + "/";
+	}
+
+private:
+	void Serve() noexcept {
+		auto s = listener.AcceptNonBlock();
+		if (!s.IsDefined())
+			return;
+
+		s.SetBlocking();
+
+		/* consume the request (but ignore it), or else
+		   close() would send RST */
+		std::string request;
+		while (!request.ends_with("\r\n\r\n")) {
+			std::array<char, 1024> buffer;
+			const auto nbytes = s.Receive(std::as_writable_bytes(std::span{buffer}));
+			if (nbytes <= 0)
+				return;
+			request.append(buffer.data(), nbytes);
+		}
+
+		std::span<const std::byte> r = std::as_bytes(std::span{response});
+		while (!r.empty()) {
+			const auto nbytes = s.Send(r);
+			if (nbytes <= 0)
+				break;
+			r = r.subspan(nbytes);
+		}
+	}
+};
@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "HttpServer.hxx"
+#include "lib/curl/Global.hxx"
+#include "lib/curl/CoStreamRequest.hxx"
+#include "co/InvokeTask.hxx"
+#include "event/Loop.hxx"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <string>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * A temporary file which is deleted by the destructor.
+ */
+class TempFile {
+	std::string path;
+
+public:
+	explicit TempFile(const std::string &contents) {
+		char buffer[] = "/tmp/TestCoStreamRequest.XXXXXX";
+		const int fd = mkstemp(buffer);
+		if (fd < 0)
+			throw std::runtime_error{"mkstemp() failed"};
+
+		path = buffer;
+
+		const bool ok = write(fd, contents.data(), contents.size()) == (ssize_t)contents.size();
+		close(fd);
+		if (!ok)
+			throw std::runtime_error{"write() failed"};
+	}
+
+	~TempFile() noexcept {
+		unlink(path.c_str());
+	}
+
+	std::string GetUrl() const noexcept {
+		return "file://" + path;
+	}
+};
+
+struct Instance {
+	EventLoop event_loop;
+	CurlGlobal curl_global{event_loop};
+
+	Co::InvokeTask task;
+
+	std::exception_ptr error;
+	bool done = false;
+
+	void OnCompletion(std::exception_ptr _error) noexcept {
+		error = std::move(_error);
+		done = true;
+		event_loop.Break();
+	}
+
+	void Run(Co::InvokeTask &&_task) noexcept {
+		task = std::move(_task);
+		task.Start(BIND_THIS_METHOD(OnCompletion));
+
+		if (!done)
+			event_loop.Run();
+	}
+};
+
+/**
+ * Read the whole response body chunk by chunk.
+ */
+static Co::InvokeTask
+ReadAll(CurlGlobal &global, const std::string &url, std::size_t buffer_size,
+	std::string &body, std::size_t &n_chunks)
+{
+	Curl::CoStreamRequest request(global, CurlEasy(url.c_str()),
+				      buffer_size);
+
+	co_await request.ReadHeaders();
+
+	while (true) {
+		const auto chunk = co_await request.Read();
+		if (chunk.empty())
+			break;
+
+		body.append((const char *)chunk.data(), chunk.size());
+		++n_chunks;
+	}
+}
+
+} // anonymous namespace
+
+TEST(CurlCoStreamRequest, Small)
+{
+	const TempFile file{"Hello world"};
+
+	Instance instance;
+	std::string body;
+	std::size_t n_chunks = 0;
+	instance.Run(ReadAll(instance.curl_global, file.GetUrl(), 65536,
+			     body, n_chunks));
+
+	ASSERT_TRUE(instance.done);
+	if (instance.error) std::rethrow_exception(instance.error);
+	EXPECT_EQ(body, "Hello world");
+	EXPECT_EQ(n_chunks, 1U);
+}
+
+/**
+ * The body is much larger than the buffer, which forces the
+ * transfer to be paused and resumed many times.
+ */
+TEST(CurlCoStreamRequest, Large)
+{
+	std::string contents;
+	for (unsigned i = 0; contents.size() < 4 * 1024 * 1024; ++i)
+		contents += std::to_string(i) + '\n';
+
+	HttpServer server{contents};
+
+	Instance instance;
+	std::string body;
+	std::size_t n_chunks = 0;
+	instance.Run(ReadAll(instance.curl_global, server.GetUrl(), 4096,
+			     body, n_chunks));
+
+	ASSERT_TRUE(instance.done);
+	if (instance.error) std::rethrow_exception(instance.error);
+	EXPECT_EQ(body, contents);
+	EXPECT_GT(n_chunks, 1U);
+}
+
+TEST(CurlCoStreamRequest, Error)
+{
+	Instance instance;
+	std::string body;
+	std::size_t n_chunks = 0;
+	instance.Run(ReadAll(instance.curl_global,
+			     "file:///nonexistent/TestCoStreamRequest",
+			     4096, body, n_chunks));
+
+	ASSERT_TRUE(instance.done);
+	EXPECT_TRUE(instance.error);
+}
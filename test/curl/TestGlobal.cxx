@@ -0,0 +1,222 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "HttpServer.hxx"
+#include "lib/curl/Global.hxx"
+#include "lib/curl/CoRequest.hxx"
+#include "co/InvokeTask.hxx"
+#include "event/Loop.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace {
+
+struct Instance {
+	EventLoop event_loop;
+	CurlGlobal curl_global;
+
+	Co::InvokeTask task;
+
+	bool done = false;
+
+	explicit Instance(const CurlGlobalConfig &config)
+		:curl_global(event_loop, config) {}
+
+	void OnCompletion(std::exception_ptr) noexcept {
+		done = true;
+		event_loop.Break();
+	}
+
+	void Run(Co::InvokeTask &&_task) noexcept {
+		done = false;
+		task = std::move(_task);
+		task.Start(BIND_THIS_METHOD(OnCompletion));
+
+		if (!done)
+			event_loop.Run();
+	}
+};
+
+/**
+ * Send a request and store the response body (or an empty string
+ * on error).
+ */
+static Co::InvokeTask
+Get(CurlGlobal &global, std::string url, std::string &body, bool &failed)
+{
+	try {
+		const auto response =
+			co_await Curl::CoRequest(global, CurlEasy(url.c_str()));
+		body = response.body;
+		failed = false;
+	} catch (...) {
+		body.clear();
+		failed = true;
+	}
+}
+
+/**
+ * Bind a loopback socket without listening, so connections to its
+ * port are refused.
+ *
+ * @return the port
+ */
+static unsigned
+BindRefused(UniqueSocketDescriptor &s)
+{
+	if (!s.Create(AF_INET, SOCK_STREAM, 0) ||
+	    !s.Bind(IPv4Address{IPv4Address::Loopback(), 0}))
+		throw std::runtime_error{"bind() failed"};
+
+	const IPv4Address address{s.GetLocalAddress()};
+	return address.GetPort();
+}
+
+} // anonymous namespace
+
+TEST(CurlShare, Basic)
+{
+	CurlShare empty{nullptr};
+	EXPECT_FALSE(empty);
+
+	CurlShare share;
+	EXPECT_TRUE(share);
+	EXPECT_NE(share.Get(), nullptr);
+
+	share.Share(CURL_LOCK_DATA_DNS);
+	share.Share(CURL_LOCK_DATA_SSL_SESSION);
+
+	/* libcurl rejects unknown data types */
+	EXPECT_THROW(share.Share(CURL_LOCK_DATA_LAST), std::runtime_error);
+
+	CURLSH *const handle = share.Get();
+	CurlShare moved{std::move(share)};
+	EXPECT_FALSE(share);
+	EXPECT_EQ(moved.Get(), handle);
+
+	empty = std::move(moved);
+	EXPECT_TRUE(empty);
+	EXPECT_EQ(empty.Get(), handle);
+}
+
+TEST(CurlGlobal, Share)
+{
+	HttpServer server{"Hello world", 2};
+
+	CurlGlobalConfig config;
+	config.share_dns = true;
+	config.share_ssl_sessions = true;
+
+	Instance instance{config};
+
+	/* two requests using the same "curl_share" object */
+	for (unsigned i = 0; i < 2; ++i) {
+		std::string body;
+		bool failed = true;
+		instance.Run(Get(instance.curl_global, server.GetUrl(),
+				 body, failed));
+
+		ASSERT_TRUE(instance.done);
+		EXPECT_FALSE(failed);
+		EXPECT_EQ(body, "Hello world");
+	}
+}
+
+TEST(CurlGlobal, HostStatsDisabled)
+{
+	HttpServer server{"Hello world"};
+
+	Instance instance{CurlGlobalConfig{}};
+
+	std::string body;
+	bool failed = true;
+	instance.Run(Get(instance.curl_global, server.GetUrl(),
+			 body, failed));
+
+	ASSERT_TRUE(instance.done);
+	EXPECT_FALSE(failed);
+	EXPECT_TRUE(instance.curl_global.GetHostStats().empty());
+}
+
+TEST(CurlGlobal, HostStats)
+{
+	HttpServer server{"Hello world", 2};
+	UniqueSocketDescriptor refused;
+	const auto refused_authority =
+		"127.0.0.1:" + std::to_string(BindRefused(refused));
+
+	CurlGlobalConfig config;
+	config.host_stats = true;
+
+	Instance instance{config};
+
+	for (unsigned i = 0; i < 2; ++i) {
+		std::string body;
+		bool failed = true;
+		instance.Run(Get(instance.curl_global, server.GetUrl(),
+				 body, failed));
+
+		ASSERT_TRUE(instance.done);
+		EXPECT_FALSE(failed);
+	}
+
+	{
+		std::string body;
+		bool failed = false;
+		instance.Run(Get(instance.curl_global,
+				 "http://" + refused_authority + "/",
+				 body, failed));
+
+		ASSERT_TRUE(instance.done);
+		EXPECT_TRUE(failed);
+	}
+
+	const auto &host_stats = instance.curl_global.GetHostStats();
+	ASSERT_EQ(host_stats.size(), 2U);
+
+	/* the key includes the port */
+	const auto i = host_stats.find("127.0.0.1:" + std::to_string(server.GetPort()));
+	ASSERT_NE(i, host_stats.end());
+	EXPECT_EQ(i->second.n_requests, 2U);
+	EXPECT_EQ(i->second.n_errors, 0U);
+
+	/* HTTP/1.0: each request needs a new connection */
+	EXPECT_EQ(i->second.n_new_connections, 2U);
+	EXPECT_EQ(i->second.n_http2, 0U);
+
+	const auto j = host_stats.find(refused_authority);
+	ASSERT_NE(j, host_stats.end());
+	EXPECT_EQ(j->second.n_requests, 1U);
+	EXPECT_EQ(j->second.n_errors, 1U);
+}
+
+TEST(CurlGlobal, HostStatsLimit)
+{
+	HttpServer server1{"Hello"}, server2{"world"};
+
+	CurlGlobalConfig config;
+	config.host_stats = true;
+	config.max_host_stats = 1;
+
+	Instance instance{config};
+
+	for (const auto *server : {&server1, &server2}) {
+		std::string body;
+		bool failed = true;
+		instance.Run(Get(instance.curl_global, server->GetUrl(),
+				 body, failed));
+
+		ASSERT_TRUE(instance.done);
+		EXPECT_FALSE(failed);
+	}
+
+	/* the second host was not added */
+	const auto &host_stats = instance.curl_global.GetHostStats();
+	ASSERT_EQ(host_stats.size(), 1U);
+	EXPECT_EQ(host_stats.begin()->first,
+		  "127.0.0.1:" + std::to_string(server1.GetPort()));
+	EXPECT_EQ(host_stats.begin()->second.n_requests, 1U);
+}
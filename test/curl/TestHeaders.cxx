@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "lib/curl/Headers.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using std::string_view_literals::operator""sv;
+
+TEST(CurlHeaders, Empty)
+{
+	const Curl::Headers headers;
+	EXPECT_TRUE(headers.empty());
+	EXPECT_EQ(headers.size(), 0U);
+	EXPECT_EQ(headers.begin(), headers.end());
+	EXPECT_EQ(headers.find("foo"), headers.end());
+	EXPECT_FALSE(headers.contains("foo"));
+	EXPECT_EQ(headers.Get("foo"), nullptr);
+}
+
+TEST(CurlHeaders, Basic)
+{
+	Curl::Headers headers;
+	headers.emplace("content-type", "text/plain");
+	headers.emplace("set-cookie", "a=1");
+	headers.emplace("x-empty", "");
+	headers.emplace("set-cookie", "b=2");
+
+	EXPECT_FALSE(headers.empty());
+	EXPECT_EQ(headers.size(), 4U);
+
+	EXPECT_STREQ(headers.Get("content-type"), "text/plain");
+	EXPECT_STREQ(headers.Get("x-empty"), "");
+	EXPECT_EQ(headers.Get("content-length"), nullptr);
+
+	/* lookups are case sensitive; names are normalized by the
+	   caller */
+	EXPECT_EQ(headers.Get("Content-Type"), nullptr);
+
+	/* the first of duplicate headers is found */
+	EXPECT_STREQ(headers.Get("set-cookie"), "a=1");
+
+	auto i = headers.find("set-cookie");
+	ASSERT_NE(i, headers.end());
+	EXPECT_EQ((*i).second, "a=1"sv);
+	EXPECT_TRUE(headers.contains("x-empty"));
+
+	/* iteration preserves the order */
+	std::vector<std::pair<std::string, std::string>> v;
+	for (const auto &[name, value] : headers)
+		v.emplace_back(name, value);
+
+	EXPECT_EQ(v, (std::vector<std::pair<std::string, std::string>>{
+		{"content-type", "text/plain"},
+		{"set-cookie", "a=1"},
+		{"x-empty", ""},
+		{"set-cookie", "b=2"},
+	}));
+}
+
+TEST(CurlHeaders, Move)
+{
+	Curl::Headers headers;
+
+	/* more than fits into the initial reservation */
+	for (unsigned i = 0; i < 100; ++i)
+		headers.emplace("x-" + std::to_string(i), std::string(50, 'a' + i % 26));
+
+	const Curl::Headers moved{std::move(headers)};
+	EXPECT_EQ(moved.size(), 100U);
+	EXPECT_STREQ(moved.Get("x-0"), std::string(50, 'a').c_str());
+	EXPECT_STREQ(moved.Get("x-99"), std::string(50, 'a' + 99 % 26).c_str());
+	EXPECT_EQ(moved.Get("x-100"), nullptr);
+}
+
+TEST(CurlHeaders, Clear)
+{
+	Curl::Headers headers;
+	headers.emplace("foo", "bar");
+	headers.clear();
+
+	EXPECT_TRUE(headers.empty());
+	EXPECT_EQ(headers.Get("foo"), nullptr);
+
+	headers.emplace("abc", "def");
+	EXPECT_EQ(headers.size(), 1U);
+	EXPECT_STREQ(headers.Get("abc"), "def");
+}
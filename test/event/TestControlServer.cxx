@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "event/net/control/Server.hxx"
+#include "event/net/control/Handler.hxx"
+#include "event/Loop.hxx"
+#include "net/control/Builder.hxx"
+#include "net/SocketAddress.hxx"
+#include "net/SocketPair.hxx"
+#include "net/UniqueSocketDescriptor.hxx"
+#include "util/ByteOrder.hxx"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+using namespace BengControl;
+using namespace std::chrono_literals;
+
+TEST(CachedReply, Basic)
+{
+	CachedReply reply{1s};
+
+	const Event::TimePoint now{};
+	unsigned n_calls = 0;
+
+	/* the serializer returns a temporary container */
+	auto serialize = [&n_calls]{
+		++n_calls;
+		return std::vector<std::byte>(1000, std::byte(n_calls));
+	};
+
+	auto payload = reply.Get(now, serialize);
+	EXPECT_EQ(n_calls, 1U);
+	ASSERT_EQ(payload.size(), 1000U);
+	EXPECT_EQ(payload.front(), std::byte{1});
+	EXPECT_EQ(payload.back(), std::byte{1});
+
+	/* not expired yet */
+	payload = reply.Get(now + 500ms, serialize);
+	EXPECT_EQ(n_calls, 1U);
+	EXPECT_EQ(payload.back(), std::byte{1});
+
+	/* expired */
+	payload = reply.Get(now + 1s, serialize);
+	EXPECT_EQ(n_calls, 2U);
+	EXPECT_EQ(payload.back(), std::byte{2});
+
+	reply.Invalidate();
+	payload = reply.Get(now + 1s, serialize);
+	EXPECT_EQ(n_calls, 3U);
+	EXPECT_EQ(payload.back(), std::byte{3});
+}
+
+namespace {
+
+struct MyHandler final : Handler {
+	EventLoop &event_loop;
+
+	CachedReply stats{1h};
+
+	std::vector<std::string> invalidated;
+
+	unsigned n_stats = 0, n_serialize = 0, n_errors = 0;
+
+	explicit MyHandler(EventLoop &_event_loop) noexcept
+		:event_loop(_event_loop) {}
+
+	void OnControlPacket(Server &server, Command command,
+			     std::span<const std::byte> payload,
+			     std::span<UniqueFileDescriptor>,
+			     SocketAddress address, int) override {
+		switch (command) {
+		case Command::TCACHE_INVALIDATE:
+			invalidated.emplace_back(ToStringView(payload));
+			break;
+
+		case Command::STATS:
+			++n_stats;
+			server.ReplyCached(address, command, stats, [this]{
+				++n_serialize;
+				return std::vector<std::byte>(64, std::byte{0x42});
+			});
+
+			/* STATS is the last command of each datagram
+			   sent by the test */
+			event_loop.Break();
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	void OnControlError(std::exception_ptr) noexcept override {
+		++n_errors;
+		event_loop.Break();
+	}
+};
+
+static void
+Send(SocketDescriptor s, std::span<const std::byte> datagram)
+{
+	if (s.Send(datagram) < 0)
+		throw std::runtime_error{"send() failed"};
+}
+
+/**
+ * Receive a reply and return its payload.
+ */
+static std::vector<std::byte>
+ReceiveReply(SocketDescriptor s, Command expected_command)
+{
+	std::array<std::byte, 4096> buffer;
+	const auto nbytes = s.Receive(buffer);
+	if (nbytes < (ssize_t)sizeof(Header))
+		throw std::runtime_error{"recv() failed"};
+
+	const auto &header = *(const Header *)buffer.data();
+	EXPECT_EQ(FromBE16(header.command), uint16_t(expected_command));
+
+	const std::size_t length = FromBE16(header.length);
+	EXPECT_EQ(sizeof(header) + length, std::size_t(nbytes));
+
+	return {buffer.begin() + sizeof(header),
+		buffer.begin() + sizeof(header) + length};
+}
+
+} // anonymous namespace
+
+TEST(ControlServer, Coalesce)
+{
+	EventLoop event_loop;
+	MyHandler handler{event_loop};
+
+	auto [server_socket, client_socket] = CreateSocketPairNonBlock(SOCK_DGRAM);
+	Server server{event_loop, std::move(server_socket), handler};
+
+	Builder b;
+	b.Add(Command::TCACHE_INVALIDATE, "foo");
+	b.Add(Command::TCACHE_INVALIDATE, "bar");
+	b.Add(Command::TCACHE_INVALIDATE, "foo");
+	Send(client_socket, b);
+
+	b.reset();
+	b.Add(Command::TCACHE_INVALIDATE, "foo");
+	b.Add(Command::STATS);
+	Send(client_socket, b);
+
+	event_loop.Run();
+
+	/* both datagrams were received in the same iteration, and
+	   the duplicates were dropped */
+	EXPECT_EQ(handler.invalidated, (std::vector<std::string>{"foo", "bar"}));
+	EXPECT_EQ(handler.n_stats, 1U);
+	EXPECT_EQ(handler.n_errors, 0U);
+
+	EXPECT_EQ(ReceiveReply(client_socket, Command::STATS),
+		  std::vector<std::byte>(64, std::byte{0x42}));
+
+	/* in the next iteration, the same command is handled again;
+	   the STATS reply comes from the cache */
+	b.reset();
+	b.Add(Command::TCACHE_INVALIDATE, "foo");
+	b.Add(Command::STATS);
+	Send(client_socket, b);
+
+	event_loop.Run();
+
+	EXPECT_EQ(handler.invalidated, (std::vector<std::string>{"foo", "bar", "foo"}));
+	EXPECT_EQ(handler.n_stats, 2U);
+	EXPECT_EQ(handler.n_serialize, 1U);
+	EXPECT_EQ(handler.n_errors, 0U);
+
+	EXPECT_EQ(ReceiveReply(client_socket, Command::STATS),
+		  std::vector<std::byte>(64, std::byte{0x42}));
+}
+
+TEST(ControlServer, EmptyDatagram)
+{
+	EventLoop event_loop;
+	MyHandler handler{event_loop};
+
+	auto [server_socket, client_socket] = CreateSocketPairNonBlock(SOCK_DGRAM);
+	Server server{event_loop, std::move(server_socket), handler};
+
+	/* an empty datagram is not an error */
+	Send(client_socket, {});
+
+	Builder b;
+	b.Add(Command::STATS);
+	Send(client_socket, b);
+
+	event_loop.Run();
+
+	EXPECT_EQ(handler.n_stats, 1U);
+	EXPECT_EQ(handler.n_errors, 0U);
+}
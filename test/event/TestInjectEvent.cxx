@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "event/Loop.hxx"
+#include "event/InjectEvent.hxx"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <forward_list>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Counter {
+	std::atomic_uint n{0};
+
+	void OnInject() noexcept {
+		++n;
+	}
+};
+
+class Producer {
+	EventLoop &event_loop;
+
+	InjectEvent event, finish_event;
+
+	std::atomic_uint &n_finished;
+	const unsigned n_threads;
+
+public:
+	unsigned n_callbacks = 0;
+
+	Producer(EventLoop &_event_loop,
+		 std::atomic_uint &_n_finished, unsigned _n_threads) noexcept
+		:event_loop(_event_loop),
+		 event(event_loop, BIND_THIS_METHOD(OnInject)),
+		 finish_event(event_loop, BIND_THIS_METHOD(OnFinished)),
+		 n_finished(_n_finished), n_threads(_n_threads) {}
+
+	void Run(unsigned iterations) noexcept {
+		for (unsigned i = 0; i < iterations; ++i)
+			event.Schedule();
+
+		finish_event.Schedule();
+	}
+
+private:
+	void OnInject() noexcept {
+		++n_callbacks;
+	}
+
+	void OnFinished() noexcept {
+		if (++n_finished == n_threads)
+			event_loop.Break();
+	}
+};
+
+} // anonymous namespace
+
+TEST(InjectEvent, Basic)
+{
+	EventLoop event_loop;
+	Counter counter;
+
+	InjectEvent a{event_loop, BIND_METHOD(counter, &Counter::OnInject)};
+	InjectEvent b{event_loop, BIND_METHOD(counter, &Counter::OnInject)};
+	InjectEvent stop{event_loop, BIND_METHOD(event_loop, &EventLoop::Break)};
+
+	/* scheduling twice results in only one call */
+	a.Schedule();
+	a.Schedule();
+	EXPECT_TRUE(a.IsPending());
+
+	b.Schedule();
+	b.Cancel();
+	EXPECT_FALSE(b.IsPending());
+
+	stop.Schedule();
+	event_loop.Run();
+
+	EXPECT_EQ(counter.n, 1U);
+	EXPECT_FALSE(a.IsPending());
+
+	/* after having been canceled, it can be scheduled again */
+	b.Schedule();
+	stop.Schedule();
+	event_loop.Run();
+
+	EXPECT_EQ(counter.n, 2U);
+}
+
+TEST(InjectEvent, CrossThread)
+{
+	constexpr unsigned n_threads = 4;
+
+	EventLoop event_loop;
+	std::atomic_uint n_finished{0};
+
+	std::forward_list<Producer> producers;
+	for (unsigned i = 0; i < n_threads; ++i)
+		producers.emplace_front(event_loop, n_finished, n_threads);
+
+	std::vector<std::thread> threads;
+	for (auto &i : producers)
+		threads.emplace_back([&i]{ i.Run(100000); });
+
+	event_loop.Run();
+
+	for (auto &i : threads)
+		i.join();
+
+	EXPECT_EQ(n_finished, n_threads);
+
+	for (const auto &i : producers) {
+		/* calls may have been coalesced, but each producer's
+		   event was invoked at least once after its last
+		   Schedule() call */
+		EXPECT_GT(i.n_callbacks, 0U);
+	}
+}
+
+/**
+ * Cancel and destroy InjectEvents in another thread while the
+ * #EventLoop is running.  The #EventLoop must not refer to them after
+ * Cancel() has returned.
+ */
+TEST(InjectEvent, CrossThreadCancel)
+{
+	EventLoop event_loop;
+	Counter counter;
+
+	std::thread thread{[&event_loop, &counter]{
+		for (unsigned i = 0; i < 100000; ++i) {
+			auto event = std::make_unique<InjectEvent>(event_loop,
+								   BIND_METHOD(counter, &Counter::OnInject));
+			event->Schedule();
+
+			if (i % 2 == 0)
+				event->Cancel();
+
+			/* the destructor cancels implicitly */
+		}
+
+		event_loop.InjectBreak();
+	}};
+
+	event_loop.Run();
+	thread.join();
+}
+
+/**
+ * Like CrossThreadCancel, but the #EventLoop is not running while the
+ * other thread schedules, cancels and destroys.
+ */
+TEST(InjectEvent, CancelWhileIdle)
+{
+	EventLoop event_loop;
+	Counter counter;
+
+	InjectEvent kept{event_loop, BIND_METHOD(counter, &Counter::OnInject)};
+	InjectEvent stop{event_loop, BIND_METHOD(event_loop, &EventLoop::Break)};
+
+	std::thread{[&]{
+		kept.Schedule();
+
+		{
+			InjectEvent canceled{event_loop, BIND_METHOD(counter, &Counter::OnInject)};
+			canceled.Schedule();
+		}
+
+		stop.Schedule();
+	}}.join();
+
+	event_loop.Run();
+
+	/* only the surviving event was invoked */
+	EXPECT_EQ(counter.n, 1U);
+}
@@ -0,0 +1,184 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "event/LoopStats.hxx"
+#include "event/Loop.hxx"
+#include "event/DeferEvent.hxx"
+#include "event/SocketEvent.hxx"
+#include "event/FineTimerEvent.hxx"
+#include "net/SocketPair.hxx"
+#include "net/UniqueSocketDescriptor.hxx"
+
+#include <gtest/gtest.h>
+
+using std::string_view_literals::operator""sv;
+using namespace std::chrono_literals;
+
+namespace {
+
+/**
+ * Break the #EventLoop after a timeout.
+ */
+struct Timeout {
+	FineTimerEvent timer;
+
+	Timeout(EventLoop &event_loop, Event::Duration d) noexcept
+		:timer(event_loop, BIND_METHOD(event_loop, &EventLoop::Break))
+	{
+		timer.Schedule(d);
+	}
+};
+
+/**
+ * A #DeferEvent which (optionally) disables the #EventLoopStats and
+ * then breaks the #EventLoop.
+ */
+struct MyDefer {
+	EventLoop &event_loop;
+	DeferEvent event;
+
+	bool disable_stats = false;
+
+	explicit MyDefer(EventLoop &_event_loop) noexcept
+		:event_loop(_event_loop),
+		 event(event_loop, BIND_THIS_METHOD(OnDeferred)) {}
+
+	void OnDeferred() noexcept {
+		if (disable_stats)
+			event_loop.SetStats(nullptr);
+
+		event_loop.Break();
+	}
+};
+
+/**
+ * Like #MyDefer, but for a #SocketEvent.
+ */
+struct MySocket {
+	EventLoop &event_loop;
+	SocketEvent event;
+
+	bool disable_stats = false;
+
+	MySocket(EventLoop &_event_loop, SocketDescriptor fd) noexcept
+		:event_loop(_event_loop),
+		 event(event_loop, BIND_THIS_METHOD(OnSocketReady), fd) {}
+
+	void OnSocketReady(unsigned) noexcept {
+		if (disable_stats)
+			event_loop.SetStats(nullptr);
+
+		event.Cancel();
+		event_loop.Break();
+	}
+};
+
+} // anonymous namespace
+
+TEST(LoopStats, WritePrometheus)
+{
+	EventLoopStats stats;
+	stats.ready_sockets.Add(0);
+	stats.ready_sockets.Add(3);
+	stats.socket.Add(2ms);
+
+	stats.SetSlowThreshold(1ms);
+	stats.CheckSlow("socket", nullptr, 500us);
+	stats.CheckSlow("socket", nullptr, 2ms);
+	EXPECT_EQ(stats.n_slow_callbacks, 1U);
+
+	std::string buffer;
+	stats.WritePrometheus(buffer, "foo_"sv);
+
+	/* buckets are cumulative */
+	EXPECT_NE(buffer.find("# TYPE foo_event_loop_ready_sockets histogram\n"), buffer.npos);
+	EXPECT_NE(buffer.find("foo_event_loop_ready_sockets_bucket{le=\"0\"} 1\n"), buffer.npos);
+	EXPECT_NE(buffer.find("foo_event_loop_ready_sockets_bucket{le=\"2\"} 1\n"), buffer.npos);
+	EXPECT_NE(buffer.find("foo_event_loop_ready_sockets_bucket{le=\"4\"} 2\n"), buffer.npos);
+	EXPECT_NE(buffer.find("foo_event_loop_ready_sockets_bucket{le=\"+Inf\"} 2\n"), buffer.npos);
+	EXPECT_NE(buffer.find("foo_event_loop_ready_sockets_sum 3\n"), buffer.npos);
+	EXPECT_NE(buffer.find("foo_event_loop_ready_sockets_count 2\n"), buffer.npos);
+
+	/* durations are converted to seconds */
+	EXPECT_NE(buffer.find("foo_event_loop_socket_callback_seconds_sum 0.002\n"), buffer.npos);
+	EXPECT_NE(buffer.find("foo_event_loop_socket_callback_seconds_count 1\n"), buffer.npos);
+	EXPECT_NE(buffer.find("foo_event_loop_wait_seconds_count 0\n"), buffer.npos);
+
+	EXPECT_NE(buffer.find("# TYPE foo_event_loop_slow_callbacks_total counter\n"), buffer.npos);
+	EXPECT_NE(buffer.find("foo_event_loop_slow_callbacks_total 1\n"), buffer.npos);
+}
+
+TEST(LoopStats, Measure)
+{
+	EventLoop event_loop;
+	EventLoopStats stats;
+	event_loop.SetStats(&stats);
+
+	auto [a, b] = CreateSocketPairNonBlock(SOCK_STREAM);
+	MySocket s{event_loop, a};
+	ASSERT_TRUE(s.event.ScheduleWrite());
+
+	MyDefer d{event_loop};
+	d.event.Schedule();
+
+	{
+		const Timeout timeout{event_loop, 5s};
+		event_loop.Run();
+	}
+
+	EXPECT_EQ(stats.defer.GetCount(), 1U);
+
+	{
+		const Timeout timeout{event_loop, 5s};
+		event_loop.Run();
+	}
+
+	EXPECT_EQ(stats.socket.GetCount(), 1U);
+	EXPECT_GE(stats.wait.GetCount(), 1U);
+	EXPECT_GE(stats.ready_sockets.GetCount(), 1U);
+
+	event_loop.SetStats(nullptr);
+}
+
+/**
+ * A #DeferEvent callback disables the stats; the #EventLoop must not
+ * dereference the stale pointer.
+ */
+TEST(LoopStats, DisableInDefer)
+{
+	EventLoop event_loop;
+	EventLoopStats stats;
+	event_loop.SetStats(&stats);
+
+	MyDefer d{event_loop};
+	d.disable_stats = true;
+	d.event.Schedule();
+
+	const Timeout timeout{event_loop, 5s};
+	event_loop.Run();
+
+	EXPECT_EQ(event_loop.GetStats(), nullptr);
+	EXPECT_EQ(stats.defer.GetCount(), 0U);
+}
+
+/**
+ * Like DisableInDefer, but in a #SocketEvent callback.
+ */
+TEST(LoopStats, DisableInSocket)
+{
+	EventLoop event_loop;
+	EventLoopStats stats;
+	event_loop.SetStats(&stats);
+
+	auto [a, b] = CreateSocketPairNonBlock(SOCK_STREAM);
+	MySocket s{event_loop, a};
+	s.disable_stats = true;
+	ASSERT_TRUE(s.event.ScheduleWrite());
+
+	const Timeout timeout{event_loop, 5s};
+	event_loop.Run();
+
+	EXPECT_EQ(event_loop.GetStats(), nullptr);
+	EXPECT_EQ(stats.socket.GetCount(), 0U);
+}
@@ -0,0 +1,183 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "event/PipeLineReader.hxx"
+#include "event/Loop.hxx"
+#include "io/Pipe.hxx"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct MyHandler final : PipeLineReaderHandler {
+	EventLoop &event_loop;
+
+	const PipeLineReader *reader = nullptr;
+
+	std::vector<std::string> lines;
+
+	std::size_t max_capacity = 0;
+
+	bool end = false;
+
+	explicit MyHandler(EventLoop &_event_loop) noexcept
+		:event_loop(_event_loop) {}
+
+	bool OnPipeLine(std::span<char> line) noexcept override {
+		lines.emplace_back(line.begin(), line.end());
+
+		if (reader != nullptr)
+			max_capacity = std::max(max_capacity,
+						reader->GetBufferCapacity());
+
+		return true;
+	}
+
+	void OnPipeEnd() noexcept override {
+		end = true;
+		event_loop.Break();
+	}
+};
+
+static void
+Write(FileDescriptor fd, std::string_view s)
+{
+	if (fd.Write(std::as_bytes(std::span{s})) != (ssize_t)s.size())
+		throw std::runtime_error{"write() failed"};
+}
+
+} // anonymous namespace
+
+TEST(PipeLineReader, Basic)
+{
+	EventLoop event_loop;
+	MyHandler handler{event_loop};
+
+	auto [r, w] = CreatePipeNonBlock();
+	PipeLineReader reader{event_loop, std::move(r), handler};
+
+	Write(w, "foo\nbar\r\n\nbaz");
+	w.Close();
+
+	event_loop.Run();
+
+	EXPECT_TRUE(handler.end);
+	EXPECT_EQ(handler.lines,
+		  (std::vector<std::string>{"foo", "bar", "", "baz"}));
+}
+
+TEST(PipeLineReader, ManyShortLines)
+{
+	EventLoop event_loop;
+	MyHandler handler{event_loop};
+
+	auto [r, w] = CreatePipeNonBlock();
+	PipeLineReader reader{event_loop, std::move(r), handler};
+	reader.SetMaxLineLength(1024 * 1024);
+	handler.reader = &reader;
+	const std::size_t initial_capacity = reader.GetBufferCapacity();
+
+	/* much more than the initial buffer capacity, but no line
+	   is longer than 100 bytes: the lines must not be split */
+	const std::string line(99, 'x');
+	std::vector<std::string> expected;
+	for (unsigned i = 0; i < 500; ++i) {
+		Write(w, line + "\n");
+		expected.push_back(line);
+	}
+
+	w.Close();
+
+	event_loop.Run();
+
+	EXPECT_TRUE(handler.end);
+	EXPECT_EQ(handler.lines, expected);
+
+	/* the buffer did not grow */
+	EXPECT_EQ(handler.max_capacity, initial_capacity);
+}
+
+TEST(PipeLineReader, LongLine)
+{
+	EventLoop event_loop;
+	MyHandler handler{event_loop};
+
+	auto [r, w] = CreatePipeNonBlock();
+	PipeLineReader reader{event_loop, std::move(r), handler};
+	reader.SetMaxLineLength(65536);
+	handler.reader = &reader;
+	const std::size_t initial_capacity = reader.GetBufferCapacity();
+
+	/* longer than the initial buffer capacity: the buffer grows
+	   and the line arrives in one piece */
+	const std::string long_line(30000, 'a');
+	Write(w, long_line + "\nshort\n");
+	w.Close();
+
+	event_loop.Run();
+
+	EXPECT_TRUE(handler.end);
+	EXPECT_EQ(handler.lines,
+		  (std::vector<std::string>{long_line, "short"}));
+
+	/* the buffer grew for the long line and was shrunk again
+	   after it had been consumed */
+	EXPECT_GT(handler.max_capacity, initial_capacity);
+	EXPECT_EQ(reader.GetBufferCapacity(), initial_capacity);
+}
+
+TEST(PipeLineReader, Split)
+{
+	EventLoop event_loop;
+	MyHandler handler{event_loop};
+
+	auto [r, w] = CreatePipeNonBlock();
+	PipeLineReader reader{event_loop, std::move(r), handler};
+	reader.SetMaxLineLength(100);
+
+	/* lines longer than the limit are split even though they
+	   fit into the buffer */
+	Write(w, std::string(250, 'a') + "\n" + std::string(99, 'b') + "\nc\n");
+	w.Close();
+
+	event_loop.Run();
+
+	EXPECT_TRUE(handler.end);
+	EXPECT_EQ(handler.lines,
+		  (std::vector<std::string>{
+			  std::string(100, 'a'),
+			  std::string(100, 'a'),
+			  std::string(50, 'a'),
+			  std::string(99, 'b'),
+			  "c",
+		  }));
+}
+
+TEST(PipeLineReader, Flush)
+{
+	EventLoop event_loop;
+	MyHandler handler{event_loop};
+
+	auto [r, w] = CreatePipeNonBlock();
+	PipeLineReader reader{event_loop, std::move(r), handler};
+
+	Write(w, "foo\nbar");
+
+	reader.Flush();
+
+	EXPECT_FALSE(handler.end);
+	EXPECT_EQ(handler.lines,
+		  (std::vector<std::string>{"foo", "bar"}));
+
+	/* the buffer is empty now */
+	Write(w, "baz\n");
+	reader.Flush();
+
+	EXPECT_EQ(handler.lines,
+		  (std::vector<std::string>{"foo", "bar", "baz"}));
+}
@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "event/SocketEvent.hxx"
+#include "event/FineTimerEvent.hxx"
+#include "event/Loop.hxx"
+#include "net/SocketPair.hxx"
+#include "net/UniqueSocketDescriptor.hxx"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+struct MySocket {
+	EventLoop &event_loop;
+	SocketEvent event;
+
+	unsigned flags = 0, n_calls = 0;
+
+	MySocket(EventLoop &_event_loop, SocketDescriptor fd) noexcept
+		:event_loop(_event_loop),
+		 event(event_loop, BIND_THIS_METHOD(OnSocketReady), fd) {}
+
+	void OnSocketReady(unsigned _flags) noexcept {
+		flags = _flags;
+		++n_calls;
+
+		event.Cancel();
+		event_loop.Break();
+	}
+};
+
+/**
+ * Break the #EventLoop after a timeout.
+ */
+struct Timeout {
+	FineTimerEvent timer;
+
+	Timeout(EventLoop &event_loop, Event::Duration d) noexcept
+		:timer(event_loop, BIND_METHOD(event_loop, &EventLoop::Break))
+	{
+		timer.Schedule(d);
+	}
+};
+
+} // anonymous namespace
+
+TEST(SocketEvent, CoalescedModify)
+{
+	EventLoop event_loop;
+
+	auto [a, b] = CreateSocketPairNonBlock(SOCK_STREAM);
+	MySocket s{event_loop, a};
+
+	/* nothing is readable; register the socket in epoll */
+	ASSERT_TRUE(s.event.ScheduleRead());
+
+	/* several modifications in one iteration; only the last
+	   one must reach epoll */
+	ASSERT_TRUE(s.event.ScheduleWrite());
+	s.event.CancelWrite();
+	ASSERT_TRUE(s.event.ScheduleWrite());
+
+	const Timeout timeout{event_loop, 5s};
+	event_loop.Run();
+
+	EXPECT_EQ(s.n_calls, 1U);
+	EXPECT_EQ(s.flags, SocketEvent::WRITE);
+}
+
+TEST(SocketEvent, RevertedModify)
+{
+	EventLoop event_loop;
+
+	auto [a, b] = CreateSocketPairNonBlock(SOCK_STREAM);
+	MySocket s{event_loop, a};
+
+	ASSERT_TRUE(s.event.ScheduleRead());
+
+	/* the modification is reverted in the same iteration: the
+	   (writable) socket must not be reported */
+	ASSERT_TRUE(s.event.ScheduleWrite());
+	s.event.CancelWrite();
+
+	{
+		const Timeout timeout{event_loop, 50ms};
+		event_loop.Run();
+	}
+
+	EXPECT_EQ(s.n_calls, 0U);
+
+	/* the read registration is still intact */
+	ASSERT_EQ(b.Write(std::as_bytes(std::span{"x", 1})), 1);
+
+	const Timeout timeout{event_loop, 5s};
+	event_loop.Run();
+
+	EXPECT_EQ(s.n_calls, 1U);
+	EXPECT_EQ(s.flags, SocketEvent::READ);
+}
+
+TEST(SocketEvent, ModifyClosed)
+{
+	EventLoop event_loop;
+
+	auto [a, b] = CreateSocketPairNonBlock(SOCK_STREAM);
+	MySocket s{event_loop, a.Release()};
+
+	ASSERT_TRUE(s.event.ScheduleRead());
+
+	/* the socket gets closed behind the SocketEvent's back;
+	   the deferred epoll_ctl() fails with EBADF, which must be
+	   reported to the handler because Schedule() has already
+	   returned true */
+	close(s.event.GetSocket().Get());
+	ASSERT_TRUE(s.event.ScheduleWrite());
+
+	const Timeout timeout{event_loop, 5s};
+	event_loop.Run();
+
+	EXPECT_EQ(s.n_calls, 1U);
+	EXPECT_EQ(s.flags, SocketEvent::ERROR);
+}
@@ -0,0 +1,244 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "event/net/log/SpillSender.hxx"
+#include "event/FineTimerEvent.hxx"
+#include "event/Loop.hxx"
+#include "net/log/SpillJournal.hxx"
+#include "net/log/Serializer.hxx"
+#include "net/log/Parser.hxx"
+#include "net/log/Datagram.hxx"
+#include "net/SocketPair.hxx"
+#include "net/UniqueSocketDescriptor.hxx"
+#include "util/SpanCast.hxx"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <string>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+using std::string_view_literals::operator""sv;
+using namespace std::chrono_literals;
+
+namespace {
+
+class TempPath {
+	char path[64] = "/tmp/TestSpillSender.XXXXXX";
+
+public:
+	TempPath() {
+		const int fd = mkstemp(path);
+		if (fd < 0)
+			throw std::runtime_error("mkstemp() failed");
+		close(fd);
+	}
+
+	~TempPath() noexcept {
+		unlink(path);
+	}
+
+	const char *c_str() const noexcept {
+		return path;
+	}
+};
+
+/**
+ * Run the #EventLoop until the journal of the given #SpillSender is
+ * empty or until the timeout expires.
+ */
+class DrainWaiter {
+	const Net::Log::SpillSender &sender;
+
+	FineTimerEvent poll_timer, timeout_timer;
+
+public:
+	DrainWaiter(EventLoop &event_loop,
+		    const Net::Log::SpillSender &_sender) noexcept
+		:sender(_sender),
+		 poll_timer(event_loop, BIND_THIS_METHOD(OnPollTimer)),
+		 timeout_timer(event_loop, BIND_METHOD(event_loop, &EventLoop::Break)) {}
+
+	void Run(Event::Duration timeout) noexcept {
+		poll_timer.Schedule(1ms);
+		timeout_timer.Schedule(timeout);
+		poll_timer.GetEventLoop().Run();
+		poll_timer.Cancel();
+		timeout_timer.Cancel();
+	}
+
+private:
+	void OnPollTimer() noexcept {
+		if (sender.IsJournalEmpty())
+			poll_timer.GetEventLoop().Break();
+		else
+			poll_timer.Schedule(1ms);
+	}
+};
+
+static std::size_t
+Serialize(std::span<std::byte> buffer, std::string_view message)
+{
+	Net::Log::Datagram d;
+	d.message = message;
+	return Net::Log::Serialize(buffer.data(), buffer.size(), d);
+}
+
+static void
+PushDatagram(Net::Log::SpillJournal &journal, std::string_view message)
+{
+	std::array<std::byte, 1024> buffer;
+	const std::size_t size = Serialize(buffer, message);
+	ASSERT_TRUE(journal.Push(std::span{buffer}.first(size)));
+}
+
+/**
+ * Receive one datagram and return its message.
+ */
+static std::string
+ReceiveMessage(SocketDescriptor s)
+{
+	std::array<std::byte, 1024> buffer;
+	const auto nbytes = s.ReadNoWait(buffer);
+	if (nbytes <= 0)
+		return {};
+
+	const auto d = Net::Log::ParseDatagram(std::span{buffer}.first(nbytes));
+	return std::string{d.message};
+}
+
+/**
+ * Send junk datagrams until the socket buffer is full.
+ *
+ * @return the number of datagrams sent
+ */
+static unsigned
+FillSocket(SocketDescriptor s) noexcept
+{
+	unsigned n = 0;
+	while (s.WriteNoWait(AsBytes("junk"sv)) > 0)
+		++n;
+	return n;
+}
+
+} // anonymous namespace
+
+TEST(SpillSender, Spill)
+{
+	const TempPath path;
+	EventLoop event_loop;
+	auto [a, b] = CreateSocketPairNonBlock(SOCK_DGRAM);
+
+	Net::Log::SpillSender sender{event_loop, a, path.c_str(), 65536};
+	ASSERT_TRUE(sender.IsJournalEmpty());
+
+	/* the socket is writable: no spilling */
+	Net::Log::Datagram d;
+	d.message = "direct";
+	sender.Send(d);
+	ASSERT_TRUE(sender.IsJournalEmpty());
+	ASSERT_EQ(ReceiveMessage(b), "direct"sv);
+
+	/* the socket is full: the datagrams go to the journal */
+	const unsigned n_junk = FillSocket(a);
+	ASSERT_GT(n_junk, 0u);
+
+	d.message = "one";
+	sender.Send(d);
+	d.message = "two";
+	sender.Send(d);
+	ASSERT_FALSE(sender.IsJournalEmpty());
+	ASSERT_EQ(sender.GetSpilledCount(), 2u);
+
+	/* make room; the journal must still not be overtaken */
+	std::array<std::byte, 64> buffer;
+	for (unsigned i = 0; i < n_junk; ++i)
+		ASSERT_GT(b.ReadNoWait(buffer), 0);
+
+	d.message = "three";
+	sender.Send(d);
+	ASSERT_EQ(sender.GetSpilledCount(), 3u);
+	ASSERT_LT(b.ReadNoWait(buffer), 0);
+
+	DrainWaiter{event_loop, sender}.Run(5s);
+	ASSERT_TRUE(sender.IsJournalEmpty());
+	ASSERT_EQ(sender.GetReplayedCount(), 3u);
+	ASSERT_EQ(sender.GetDroppedCount(), 0u);
+
+	ASSERT_EQ(ReceiveMessage(b), "one"sv);
+	ASSERT_EQ(ReceiveMessage(b), "two"sv);
+	ASSERT_EQ(ReceiveMessage(b), "three"sv);
+	ASSERT_LT(b.ReadNoWait(buffer), 0);
+}
+
+TEST(SpillSender, RateLimit)
+{
+	const TempPath path;
+
+	{
+		/* fill the journal left over by a "previous
+		   process" */
+		Net::Log::SpillJournal journal{path.c_str(), 65536};
+		for (unsigned i = 0; i < 5; ++i)
+			PushDatagram(journal, std::to_string(i));
+	}
+
+	EventLoop event_loop;
+	auto [a, b] = CreateSocketPairNonBlock(SOCK_DGRAM);
+
+	Net::Log::SpillSender sender{event_loop, a, path.c_str(), 65536};
+	ASSERT_FALSE(sender.IsJournalEmpty());
+	sender.SetRateLimit(50, 1);
+
+	const auto start = event_loop.SteadyNow();
+
+	/* each datagram must be replayed as soon as its token is
+	   due, not after a fixed (much longer) interval */
+	DrainWaiter{event_loop, sender}.Run(2s);
+	ASSERT_TRUE(sender.IsJournalEmpty());
+	ASSERT_EQ(sender.GetReplayedCount(), 5u);
+
+	event_loop.FlushClockCaches();
+	ASSERT_GE(event_loop.SteadyNow() - start, 70ms);
+
+	for (unsigned i = 0; i < 5; ++i)
+		ASSERT_EQ(ReceiveMessage(b), std::to_string(i));
+}
+
+TEST(SpillSender, Corrupt)
+{
+	const TempPath path;
+
+	{
+		Net::Log::SpillJournal journal{path.c_str(), 65536};
+		PushDatagram(journal, "before");
+
+		/* a datagram with a CRC mismatch */
+		std::array<std::byte, 1024> buffer;
+		const std::size_t size = Serialize(buffer, "corrupt");
+		buffer[size / 2] ^= std::byte{0x01};
+		ASSERT_TRUE(journal.Push(std::span{buffer}.first(size)));
+
+		PushDatagram(journal, "after");
+	}
+
+	EventLoop event_loop;
+	auto [a, b] = CreateSocketPairNonBlock(SOCK_DGRAM);
+
+	Net::Log::SpillSender sender{event_loop, a, path.c_str(), 65536};
+
+	DrainWaiter{event_loop, sender}.Run(2s);
+	ASSERT_TRUE(sender.IsJournalEmpty());
+	ASSERT_EQ(sender.GetReplayedCount(), 2u);
+	ASSERT_EQ(sender.GetDroppedCount(), 1u);
+
+	/* the corrupt record was not sent */
+	ASSERT_EQ(ReceiveMessage(b), "before"sv);
+	ASSERT_EQ(ReceiveMessage(b), "after"sv);
+
+	std::array<std::byte, 64> buffer;
+	ASSERT_LT(b.ReadNoWait(buffer), 0);
+}
@@ -0,0 +1,202 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "io/CopyRegularFile.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+namespace {
+
+static constexpr off_t MiB = 1024 * 1024;
+
+/**
+ * An anonymous temporary file.
+ */
+static UniqueFileDescriptor
+CreateTempFile()
+{
+	UniqueFileDescriptor fd;
+	if (!fd.Open("/tmp", O_TMPFILE|O_RDWR, 0600))
+		throw std::runtime_error{"Failed to create temporary file"};
+	return fd;
+}
+
+static void
+WriteAt(FileDescriptor fd, off_t offset, const std::string &s)
+{
+	if (pwrite(fd.Get(), s.data(), s.size(), offset) != (ssize_t)s.size())
+		throw std::runtime_error{"pwrite() failed"};
+}
+
+/**
+ * Create a sparse file with two data extents and a trailing hole.
+ */
+static UniqueFileDescriptor
+CreateSparseFile()
+{
+	auto fd = CreateTempFile();
+	WriteAt(fd, 0, std::string(100000, 'a'));
+	WriteAt(fd, 4 * MiB, std::string(200000, 'b'));
+
+	if (ftruncate(fd.Get(), 16 * MiB) < 0)
+		throw std::runtime_error{"ftruncate() failed"};
+
+	return fd;
+}
+
+static struct stat
+Stat(FileDescriptor fd)
+{
+	struct stat st;
+	if (fstat(fd.Get(), &st) < 0)
+		throw std::runtime_error{"fstat() failed"};
+	return st;
+}
+
+static std::string
+ReadAll(FileDescriptor fd)
+{
+	std::string result(Stat(fd).st_size, '\0');
+	if (pread(fd.Get(), result.data(), result.size(), 0) != (ssize_t)result.size())
+		throw std::runtime_error{"pread() failed"};
+	return result;
+}
+
+struct ProgressRecorder {
+	std::vector<off_t> positions;
+	off_t cancel_at = -1;
+
+	bool OnProgress(off_t position) noexcept {
+		positions.push_back(position);
+		return cancel_at < 0 || position < cancel_at;
+	}
+};
+
+} // anonymous namespace
+
+TEST(CopyRegularFile, Sparse)
+{
+	for (const bool sparse : {true, false}) {
+		const auto src = CreateSparseFile();
+		const auto src_st = Stat(src);
+		const auto dst = CreateTempFile();
+
+		ProgressRecorder recorder;
+		CopyRegularFileOptions options{
+			.progress = BIND_METHOD(recorder, &ProgressRecorder::OnProgress),
+			.chunk_size = 65536,
+			.reflink = false,
+			.sparse = sparse,
+		};
+
+		EXPECT_TRUE(CopyRegularFile(src, dst, src_st.st_size, options));
+
+		const auto dst_st = Stat(dst);
+		EXPECT_EQ(dst_st.st_size, src_st.st_size);
+		EXPECT_EQ(ReadAll(dst), ReadAll(src));
+
+		if (sparse) {
+			/* the holes have been preserved */
+			EXPECT_LE(dst_st.st_blocks, src_st.st_blocks);
+		}
+
+		ASSERT_FALSE(recorder.positions.empty());
+		EXPECT_TRUE(std::is_sorted(recorder.positions.begin(),
+					   recorder.positions.end()));
+		EXPECT_EQ(recorder.positions.back(), src_st.st_size);
+	}
+}
+
+TEST(CopyRegularFile, Cancel)
+{
+	const auto src = CreateSparseFile();
+	const auto dst = CreateTempFile();
+
+	ProgressRecorder recorder;
+	recorder.cancel_at = 4 * MiB;
+
+	CopyRegularFileOptions options{
+		.progress = BIND_METHOD(recorder, &ProgressRecorder::OnProgress),
+		.chunk_size = 65536,
+		.reflink = false,
+	};
+
+	EXPECT_FALSE(CopyRegularFile(src, dst, Stat(src).st_size, options));
+	EXPECT_GE(recorder.positions.back(), 4 * MiB);
+	EXPECT_LT(recorder.positions.back(), 16 * MiB);
+}
+
+TEST(CopyRegularFile, Default)
+{
+	const auto src = CreateSparseFile();
+	const auto dst = CreateTempFile();
+
+	CopyRegularFile(src, dst, Stat(src).st_size);
+	EXPECT_EQ(ReadAll(dst), ReadAll(src));
+}
+
+TEST(CopyRegularFile, UnexpectedEnd)
+{
+	for (const bool sparse : {true, false}) {
+		const auto src = CreateTempFile();
+		WriteAt(src, 0, "foo");
+
+		const auto dst = CreateTempFile();
+
+		CopyRegularFileOptions options;
+		options.reflink = false;
+		options.sparse = sparse;
+
+		EXPECT_THROW(CopyRegularFile(src, dst, 1000, options),
+			     std::runtime_error);
+	}
+
+	/* default options (sparse, reflink); the source ends
+	   inside a data extent and with a hole */
+	for (const off_t length : {off_t{3}, 4 * MiB}) {
+		const auto src = CreateTempFile();
+		WriteAt(src, 0, "foo");
+		if (ftruncate(src.Get(), length) < 0)
+			throw std::runtime_error{"ftruncate() failed"};
+
+		const auto dst = CreateTempFile();
+
+		EXPECT_THROW(CopyRegularFile(src, dst, 16 * MiB),
+			     std::runtime_error);
+	}
+}
+
+/**
+ * The source is longer than the given size: only that many bytes
+ * are copied, in every mode (including FICLONE, if the filesystem
+ * supports it).
+ */
+TEST(CopyRegularFile, LongerSource)
+{
+	const auto src = CreateSparseFile();
+	const off_t size = 4 * MiB + 1000;
+
+	for (const bool reflink : {true, false}) {
+		for (const bool sparse : {true, false}) {
+			const auto dst = CreateTempFile();
+
+			CopyRegularFileOptions options;
+			options.reflink = reflink;
+			options.sparse = sparse;
+
+			EXPECT_TRUE(CopyRegularFile(src, dst, size, options));
+			EXPECT_EQ(Stat(dst).st_size, size);
+			EXPECT_EQ(ReadAll(dst), ReadAll(src).substr(0, size));
+		}
+	}
+}
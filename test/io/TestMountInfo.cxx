@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+/*
+ * Compare the statmount()/listmount() backend of MountInfo.cxx with
+ * the /proc/self/mountinfo parser.
+ */
+
+#include "io/linux/MountInfo.hxx"
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h> // for AT_*
+#include <sys/stat.h> // for statx()
+
+#ifndef STATX_MNT_ID_UNIQUE
+#define STATX_MNT_ID_UNIQUE 0x00004000U
+#endif
+
+namespace {
+
+struct MountPoint {
+	std::string path;
+	std::string device;
+};
+
+/**
+ * Obtain the mount points and devices from /proc/self/mountinfo.
+ * Mount points which are listed more than once (because something
+ * was mounted on top) and those which need escaping are omitted.
+ */
+static std::vector<MountPoint>
+ListMountPoints()
+{
+	std::ifstream file{"/proc/self/mountinfo"};
+
+	std::vector<MountPoint> result;
+	std::map<std::string, unsigned> n_paths;
+
+	std::string line;
+	while (std::getline(file, line)) {
+		std::istringstream s{line};
+		std::string mnt_id, parent_id, device, root, path;
+		s >> mnt_id >> parent_id >> device >> root >> path;
+
+		if (path.find('\\') != path.npos)
+			continue;
+
+		if (++n_paths[path] == 1)
+			result.push_back({path, device});
+	}
+
+	std::erase_if(result, [&n_paths](const MountPoint &i){
+		return n_paths[i.path] > 1;
+	});
+
+	return result;
+}
+
+struct Results {
+	std::vector<MountInfo> read_process_mount, by_path, by_id;
+
+	/**
+	 * Results of FindMountInfoByDevice(), only for devices which
+	 * are mounted only once (else the result depends on the
+	 * order).
+	 */
+	std::map<std::string, MountInfo> by_device;
+};
+
+static Results
+Collect(const std::vector<MountPoint> &mount_points)
+{
+	std::map<std::string, unsigned> n_devices;
+	for (const auto &i : mount_points)
+		++n_devices[i.device];
+
+	Results r;
+
+	for (const auto &i : mount_points) {
+		r.read_process_mount.push_back(ReadProcessMount(0, i.path.c_str()));
+		r.by_path.push_back(FindMountInfoByPath(i.path.c_str()));
+		r.by_id.push_back(FindMountInfoById(0, r.by_path.back().mnt_id));
+
+		if (n_devices[i.device] == 1)
+			r.by_device.emplace(i.device,
+					    FindMountInfoByDevice(0, i.device.c_str()));
+	}
+
+	return r;
+}
+
+static void
+ExpectEqual(const MountInfo &a, const MountInfo &b, const std::string &what)
+{
+	EXPECT_EQ(a.mnt_id, b.mnt_id) << what;
+	EXPECT_EQ(a.root, b.root) << what;
+	EXPECT_EQ(a.filesystem, b.filesystem) << what;
+	EXPECT_EQ(a.source, b.source) << what;
+}
+
+static void
+ExpectEqual(const Results &a, const Results &b,
+	    const std::vector<MountPoint> &mount_points)
+{
+	for (std::size_t i = 0; i < mount_points.size(); ++i) {
+		const auto &path = mount_points[i].path;
+		EXPECT_TRUE(a.read_process_mount[i].IsDefined()) << path;
+		ExpectEqual(a.read_process_mount[i], b.read_process_mount[i],
+			    "ReadProcessMount " + path);
+		ExpectEqual(a.by_path[i], b.by_path[i],
+			    "FindMountInfoByPath " + path);
+		ExpectEqual(a.by_id[i], b.by_id[i],
+			    "FindMountInfoById " + path);
+	}
+
+	ASSERT_EQ(a.by_device.size(), b.by_device.size());
+	for (const auto &[device, info] : a.by_device) {
+		EXPECT_TRUE(info.IsDefined()) << device;
+		ExpectEqual(info, b.by_device.at(device),
+			    "FindMountInfoByDevice " + device);
+	}
+}
+
+} // anonymous namespace
+
+/**
+ * This test must run last, because DisableMountInfoSyscalls()
+ * cannot be undone.
+ */
+TEST(MountInfo, CompareBackends)
+{
+	const auto mount_points = ListMountPoints();
+	ASSERT_FALSE(mount_points.empty());
+
+	/* a unique mount id is looked up directly */
+	struct statx stx;
+	if (statx(AT_FDCWD, "/", 0, STATX_MNT_ID_UNIQUE, &stx) == 0 &&
+	    (stx.stx_mask & STATX_MNT_ID_UNIQUE) != 0) {
+		const auto by_unique_id = FindMountInfoById(0, stx.stx_mnt_id);
+		EXPECT_TRUE(by_unique_id.IsDefined());
+		ExpectEqual(by_unique_id, FindMountInfoByPath("/"),
+			    "unique id");
+	}
+
+	/* not found */
+	EXPECT_FALSE(ReadProcessMount(0, "/proc/self").IsDefined());
+	EXPECT_FALSE(FindMountInfoByDevice(0, "0:0").IsDefined());
+
+	const auto syscalls = Collect(mount_points);
+
+	DisableMountInfoSyscalls();
+
+	EXPECT_FALSE(ReadProcessMount(0, "/proc/self").IsDefined());
+	EXPECT_FALSE(FindMountInfoByDevice(0, "0:0").IsDefined());
+
+	const auto text = Collect(mount_points);
+
+	ExpectEqual(syscalls, text, mount_points);
+}
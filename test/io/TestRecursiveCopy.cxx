@@ -0,0 +1,181 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "io/RecursiveCopy.hxx"
+#include "io/RecursiveDelete.hxx"
+#include "io/UniqueFileDescriptor.hxx"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+
+#include <fcntl.h>
+#include <stdlib.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+class TempDirectory {
+	fs::path path;
+
+public:
+	TempDirectory() {
+		std::string tmpl = (fs::temp_directory_path() / "TestRecursiveCopy.XXXXXX").native();
+		if (mkdtemp(tmpl.data()) == nullptr)
+			throw std::runtime_error{"mkdtemp() failed"};
+		path = tmpl;
+	}
+
+	~TempDirectory() noexcept {
+		std::error_code ec;
+		fs::remove_all(path, ec);
+	}
+
+	const fs::path &GetPath() const noexcept {
+		return path;
+	}
+};
+
+static void
+WriteFile(const fs::path &path, const std::string &contents)
+{
+	std::ofstream{path} << contents;
+}
+
+static std::string
+ReadFile(const fs::path &path)
+{
+	std::ifstream f{path};
+	return {std::istreambuf_iterator<char>{f}, {}};
+}
+
+/**
+ * Generate a tree with nested directories, regular files and
+ * symlinks.
+ */
+static void
+GenerateTree(const fs::path &path, unsigned depth)
+{
+	fs::create_directory(path);
+
+	for (unsigned i = 0; i < 8; ++i)
+		WriteFile(path / ("file" + std::to_string(i)),
+			  std::string(i * 100, 'a' + i));
+
+	fs::create_symlink("file0", path / "link");
+
+	if (depth > 0)
+		for (unsigned i = 0; i < 4; ++i)
+			GenerateTree(path / ("dir" + std::to_string(i)),
+				     depth - 1);
+}
+
+/**
+ * Describe all entries of a tree: the type and the contents of
+ * regular files or the target of symlinks.
+ */
+static std::map<std::string, std::string>
+DescribeTree(const fs::path &path)
+{
+	std::map<std::string, std::string> result;
+
+	for (const auto &i : fs::recursive_directory_iterator{path}) {
+		const auto relative = fs::relative(i.path(), path).native();
+
+		if (i.is_symlink())
+			result.emplace(relative, "l:" + fs::read_symlink(i.path()).native());
+		else if (i.is_directory())
+			result.emplace(relative, "d");
+		else
+			result.emplace(relative, "f:" + ReadFile(i.path()));
+	}
+
+	return result;
+}
+
+static UniqueFileDescriptor
+OpenPath(const fs::path &path)
+{
+	UniqueFileDescriptor fd;
+	if (!fd.Open(path.c_str(), O_PATH|O_DIRECTORY))
+		throw std::runtime_error{"open() failed"};
+	return fd;
+}
+
+} // anonymous namespace
+
+TEST(RecursiveCopy, Parallel)
+{
+	const TempDirectory tmp;
+	const auto src = tmp.GetPath() / "src";
+	GenerateTree(src, 3);
+
+	const auto expected = DescribeTree(src);
+	ASSERT_GT(expected.size(), 500U);
+
+	const auto parent = OpenPath(tmp.GetPath());
+
+	RecursiveCopy(parent, "src", parent, "sequential");
+	EXPECT_EQ(DescribeTree(tmp.GetPath() / "sequential"), expected);
+
+	for (const unsigned n_threads : {1U, 4U}) {
+		ParallelRecursiveCopy(parent, "src", parent, "parallel",
+				      0, n_threads);
+		EXPECT_EQ(DescribeTree(tmp.GetPath() / "parallel"), expected);
+
+		/* copying again overwrites all files */
+		WriteFile(tmp.GetPath() / "parallel/dir1/dir2/file3", "modified");
+		ParallelRecursiveCopy(parent, "src", parent, "parallel",
+				      0, n_threads);
+		EXPECT_EQ(DescribeTree(tmp.GetPath() / "parallel"), expected);
+
+		ParallelRecursiveDelete(parent, "parallel", n_threads);
+		EXPECT_FALSE(fs::exists(tmp.GetPath() / "parallel"));
+	}
+
+	/* deleting a nonexistent file is not an error */
+	ParallelRecursiveDelete(parent, "parallel", 4);
+
+	RecursiveDelete(parent, "sequential");
+	EXPECT_FALSE(fs::exists(tmp.GetPath() / "sequential"));
+}
+
+TEST(RecursiveCopy, ParallelNoOverwrite)
+{
+	const TempDirectory tmp;
+	const auto src = tmp.GetPath() / "src";
+	GenerateTree(src, 2);
+
+	const auto parent = OpenPath(tmp.GetPath());
+
+	ParallelRecursiveCopy(parent, "src", parent, "dst", 0, 4);
+	WriteFile(tmp.GetPath() / "dst/dir3/dir0/file5", "modified");
+
+	ParallelRecursiveCopy(parent, "src", parent, "dst",
+			      RECURSIVE_COPY_NO_OVERWRITE, 4);
+	EXPECT_EQ(ReadFile(tmp.GetPath() / "dst/dir3/dir0/file5"), "modified");
+}
+
+TEST(RecursiveCopy, ParallelError)
+{
+	const TempDirectory tmp;
+	const auto parent = OpenPath(tmp.GetPath());
+
+	EXPECT_THROW(ParallelRecursiveCopy(parent, "nonexistent",
+					   parent, "dst", 0, 4),
+		     std::system_error);
+
+	/* a regular file in the way of a directory */
+	GenerateTree(tmp.GetPath() / "src", 2);
+	fs::create_directory(tmp.GetPath() / "dst");
+	WriteFile(tmp.GetPath() / "dst/dir2", "");
+
+	EXPECT_THROW(ParallelRecursiveCopy(parent, "src", parent, "dst",
+					   0, 4),
+		     std::system_error);
+}
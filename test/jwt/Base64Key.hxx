@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#pragma once
+
+#include "lib/sodium/SignKey.hxx"
+
+#include <sodium/utils.h>
+
+#include <stdexcept>
+#include <string_view>
+
+/**
+ * Decode a base64url-encoded Ed25519 public key ("x" of a JWK).
+ *
+ * Throws on error.
+ */
+inline CryptoSignPublicKey
+ParseBase64Key(const std::string_view base64)
+{
+	CryptoSignPublicKey key;
+
+	size_t length;
+	if (sodium_base642bin((unsigned char *)key.data(), key.size(),
+			      base64.data(), base64.size(),
+			      nullptr, &length,
+			      nullptr, sodium_base64_VARIANT_URLSAFE_NO_PADDING) != 0)
+		throw std::runtime_error("sodium_base642bin() failed");
+
+	if (length != key.size())
+		throw std::runtime_error("Wrong key length");
+
+	return key;
+}
+
+/**
+ * Decode a base64url-encoded Ed25519 secret key ("d" and "x" of a
+ * JWK).
+ *
+ * Throws on error.
+ */
+inline CryptoSignSecretKey
+ParseBase64Key(const std::string_view d_base64,
+	       const std::string_view x_base64)
+{
+	CryptoSignSecretKey key;
+
+	size_t d_length;
+	if (sodium_base642bin((unsigned char *)key.data(), key.size(),
+			      d_base64.data(), d_base64.size(),
+			      nullptr, &d_length,
+			      nullptr, sodium_base64_VARIANT_URLSAFE_NO_PADDING) != 0)
+		throw std::runtime_error("sodium_base642bin() failed");
+
+	size_t x_length;
+	if (sodium_base642bin((unsigned char *)key.data() + d_length,
+			      key.size() - d_length,
+			      x_base64.data(), x_base64.size(),
+			      nullptr, &x_length,
+			      nullptr, sodium_base64_VARIANT_URLSAFE_NO_PADDING) != 0)
+		throw std::runtime_error("sodium_base642bin() failed");
+
+	if (d_length + x_length != key.size())
+		throw std::runtime_error("Wrong key length");
+
+	return key;
+}
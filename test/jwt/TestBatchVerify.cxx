@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "Base64Key.hxx"
+#include "jwt/thread/BatchVerify.hxx"
+#include "jwt/VerifyCache.hxx"
+#include "thread/Queue.hxx"
+#include "thread/Worker.hxx"
+#include "event/Loop.hxx"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <vector>
+
+using std::string_view_literals::operator""sv;
+using namespace std::chrono_literals;
+
+/* data from RFC 8037 A.4 */
+static constexpr auto x_base64 = "11qYAYKxCrfVS_7TyWQHOg7hcvPapiMlrwIaaPcHURo"sv;
+static constexpr auto token = "eyJhbGciOiJFZERTQSJ9.RXhhbXBsZSBvZiBFZDI1NTE5IHNpZ25pbmc.hgyY0il_MGCjP0JzlnLWG1PPOt7-09PGcvMg3AIbQR6dWbhijcNR4ki4iylGjg5BhVsPt9g7sVvpAr_MuM0KAg"sv;
+static constexpr auto bad_token = "eyJhbGciOiJFZERTQSJ9.RXhhbXBsZSBvZiBFZDI1NTE5IHNpZ25pbmc.igyY0il_MGCjP0JzlnLWG1PPOt7-09PGcvMg3AIbQR6dWbhijcNR4ki4iylGjg5BhVsPt9g7sVvpAr_MuM0KAg"sv;
+
+namespace {
+
+struct Instance {
+	EventLoop event_loop;
+	ThreadQueue queue{event_loop};
+	ThreadWorker worker{queue};
+
+	~Instance() noexcept {
+		queue.Stop();
+		worker.Join();
+	}
+};
+
+struct Handler final : JWT::BatchVerifyHandler {
+	EventLoop &event_loop;
+
+	std::vector<bool> results;
+
+	unsigned n_calls = 0;
+
+	explicit Handler(EventLoop &_event_loop) noexcept
+		:event_loop(_event_loop) {}
+
+	void OnJWTBatchVerified(std::span<const bool> _results) noexcept override {
+		results.assign(_results.begin(), _results.end());
+		++n_calls;
+		event_loop.Break();
+	}
+};
+
+} // anonymous namespace
+
+TEST(JWTBatchVerify, Basic)
+{
+	const auto key = ParseBase64Key(x_base64);
+
+	Instance instance;
+	Handler handler{instance.event_loop};
+	JWT::EdDSABatchVerifier verifier{instance.queue, nullptr, handler};
+
+	static constexpr std::array tokens{token, bad_token, token};
+	verifier.Start(key, tokens);
+	instance.event_loop.Run();
+
+	ASSERT_EQ(handler.n_calls, 1U);
+	EXPECT_EQ(handler.results, (std::vector<bool>{true, false, true}));
+	EXPECT_TRUE(verifier.IsIdle());
+}
+
+TEST(JWTBatchVerify, Cache)
+{
+	const auto key = ParseBase64Key(x_base64);
+
+	Instance instance;
+	JWT::VerifyCache cache{1min};
+	Handler handler{instance.event_loop};
+	JWT::EdDSABatchVerifier verifier{instance.queue, &cache, handler};
+
+	static constexpr std::array tokens{token, bad_token};
+	verifier.Start(key, tokens);
+	instance.event_loop.Run();
+
+	ASSERT_EQ(handler.n_calls, 1U);
+	EXPECT_EQ(handler.results, (std::vector<bool>{true, false}));
+
+	/* the valid token has been added to the cache, the invalid
+	   one has not */
+	const Expiry now = instance.event_loop.SteadyNow();
+	EXPECT_TRUE(cache.Check(key, token, now));
+	EXPECT_FALSE(cache.Check(key, bad_token, now));
+
+	/* a batch which is served completely from the cache
+	   finishes synchronously, without a worker thread */
+	static constexpr std::array cached_tokens{token, token};
+	verifier.Start(key, cached_tokens);
+
+	ASSERT_EQ(handler.n_calls, 2U);
+	EXPECT_EQ(handler.results, (std::vector<bool>{true, true}));
+	EXPECT_TRUE(verifier.IsIdle());
+}
+
+TEST(JWTBatchVerify, Cancel)
+{
+	const auto key = ParseBase64Key(x_base64);
+
+	Instance instance;
+	Handler handler{instance.event_loop};
+	JWT::EdDSABatchVerifier verifier{instance.queue, nullptr, handler};
+
+	static constexpr std::array tokens{token};
+	verifier.Start(key, tokens);
+
+	if (verifier.Cancel()) {
+		/* canceled before a worker thread picked it up: the
+		   handler must not be invoked */
+		EXPECT_EQ(handler.n_calls, 0U);
+	} else {
+		/* a worker thread is already busy with it; wait for
+		   the handler */
+		instance.event_loop.Run();
+		EXPECT_EQ(handler.n_calls, 1U);
+	}
+
+	EXPECT_TRUE(verifier.IsIdle());
+}
@@ -2,6 +2,7 @@
 // Copyright CM4all GmbH
 // author: Max Kellermann <mk@cm4all.com>
 
+#include "Base64Key.hxx"
 #include "jwt/EdDSA.hxx"
 #include "util/AllocatedArray.hxx"
 #include "util/AllocatedString.hxx"
@@ -11,57 +12,8 @@
 
 #include <gtest/gtest.h>
 
-#include <sodium/utils.h>
-
-#include <stdexcept>
-
 using std::string_view_literals::operator""sv;
 
-static CryptoSignPublicKey
-ParseBase64Key(const std::string_view base64)
-{
-	CryptoSignPublicKey key;
-
-	size_t length;
-	if (sodium_base642bin((unsigned char *)key.data(), key.size(),
-			      base64.data(), base64.size(),
-			      nullptr, &length,
-			      nullptr, sodium_base64_VARIANT_URLSAFE_NO_PADDING) != 0)
-		throw std::runtime_error("sodium_base642bin() failed");
-
-	if (length != key.size())
-		throw std::runtime_error("Wrong key length");
-
-	return key;
-}
-
-static CryptoSignSecretKey
-ParseBase64Key(const std::string_view d_base64,
-	       const std::string_view x_base64)
-{
-	CryptoSignSecretKey key;
-
-	size_t d_length;
-	if (sodium_base642bin((unsigned char *)key.data(), key.size(),
-			      d_base64.data(), d_base64.size(),
-			      nullptr, &d_length,
-			      nullptr, sodium_base64_VARIANT_URLSAFE_NO_PADDING) != 0)
-		throw std::runtime_error("sodium_base642bin() failed");
-
-	size_t x_length;
-	if (sodium_base642bin((unsigned char *)key.data() + d_length,
-			      key.size() - d_length,
-			      x_base64.data(), x_base64.size(),
-			      nullptr, &x_length,
-			      nullptr, sodium_base64_VARIANT_URLSAFE_NO_PADDING) != 0)
-		throw std::runtime_error("sodium_base642bin() failed");
-
-	if (d_length + x_length != key.size())
-		throw std::runtime_error("Wrong key length");
-
-	return key;
-}
-
 TEST(JWTEdDSA, Basic)
 {
 	/* data from RFC 8037 A.4 */
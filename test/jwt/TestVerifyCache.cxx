@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "Base64Key.hxx"
+#include "jwt/VerifyCache.hxx"
+#include "util/AllocatedArray.hxx"
+#include "util/SpanCast.hxx"
+
+#include <gtest/gtest.h>
+
+using std::string_view_literals::operator""sv;
+using namespace std::chrono_literals;
+
+/* data from RFC 8037 A.4 */
+static constexpr auto x_base64 = "11qYAYKxCrfVS_7TyWQHOg7hcvPapiMlrwIaaPcHURo"sv;
+static constexpr auto token = "eyJhbGciOiJFZERTQSJ9.RXhhbXBsZSBvZiBFZDI1NTE5IHNpZ25pbmc.hgyY0il_MGCjP0JzlnLWG1PPOt7-09PGcvMg3AIbQR6dWbhijcNR4ki4iylGjg5BhVsPt9g7sVvpAr_MuM0KAg"sv;
+static constexpr auto bad_token = "eyJhbGciOiJFZERTQSJ9.RXhhbXBsZSBvZiBFZDI1NTE5IHNpZ25pbmc.igyY0il_MGCjP0JzlnLWG1PPOt7-09PGcvMg3AIbQR6dWbhijcNR4ki4iylGjg5BhVsPt9g7sVvpAr_MuM0KAg"sv;
+
+TEST(JWTVerifyCache, Basic)
+{
+	const auto key = ParseBase64Key(x_base64);
+	const Expiry now = Expiry::Now();
+
+	JWT::VerifyCache cache{1min};
+	ASSERT_FALSE(cache.Check(key, token, now));
+
+	ASSERT_TRUE(cache.VerifyEdDSA(key, token, now));
+	ASSERT_TRUE(cache.Check(key, token, now));
+
+	const auto d = cache.VerifyDecodeEdDSA(key, token, now);
+	ASSERT_EQ(ToStringView(d), "Example of Ed25519 signing"sv);
+
+	/* invalid tokens are never cached */
+	ASSERT_FALSE(cache.VerifyEdDSA(key, bad_token, now));
+	ASSERT_FALSE(cache.Check(key, bad_token, now));
+	ASSERT_TRUE(cache.VerifyDecodeEdDSA(key, bad_token, now) == nullptr);
+
+	/* a different key must not hit the cache */
+	auto other_key = key;
+	other_key[0] ^= std::byte{1};
+	ASSERT_FALSE(cache.Check(other_key, token, now));
+
+	/* entries expire after the maximum age */
+	ASSERT_FALSE(cache.Check(key, token, Expiry::Touched(now, 2min)));
+	ASSERT_FALSE(cache.Check(key, token, now));
+
+	cache.Clear();
+	ASSERT_FALSE(cache.Check(key, token, now));
+}
+
+TEST(JWTVerifyCache, Expires)
+{
+	const auto key = ParseBase64Key(x_base64);
+	const Expiry now = Expiry::Now();
+
+	JWT::VerifyCache cache{1h};
+
+	/* the token's own expiry is shorter than the maximum age */
+	cache.Add(key, token, now, Expiry::Touched(now, 10s));
+	ASSERT_TRUE(cache.Check(key, token, Expiry::Touched(now, 5s)));
+	ASSERT_FALSE(cache.Check(key, token, Expiry::Touched(now, 20s)));
+
+	/* already expired tokens are not added */
+	cache.Add(key, token, now, now);
+	ASSERT_FALSE(cache.Check(key, token, now));
+
+	cache.Add(key, token, now);
+	cache.Expire(Expiry::Touched(now, 2h));
+	ASSERT_FALSE(cache.Check(key, token, now));
+}
@@ -0,0 +1,237 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+/*
+ * Most of these tests need a MariaDB server; they are skipped unless
+ * the environment variable MARIADB_TEST_HOST or MARIADB_TEST_SOCKET
+ * is set (optionally with MARIADB_TEST_USER, MARIADB_TEST_PASSWORD
+ * and MARIADB_TEST_DB).
+ */
+
+#include "lib/mariadb/AsyncConnection.hxx"
+#include "lib/mariadb/CoQuery.hxx"
+#include "lib/mariadb/CoStockQuery.hxx"
+#include "lib/mariadb/Stock.hxx"
+#include "event/FineTimerEvent.hxx"
+#include "event/Loop.hxx"
+#include "co/InvokeTask.hxx"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <string>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+struct ServerConfig {
+	const char *host = getenv("MARIADB_TEST_HOST");
+	const char *unix_socket = getenv("MARIADB_TEST_SOCKET");
+	const char *user = getenv("MARIADB_TEST_USER");
+	const char *password = getenv("MARIADB_TEST_PASSWORD");
+	const char *db = getenv("MARIADB_TEST_DB");
+
+	bool IsDefined() const noexcept {
+		return host != nullptr || unix_socket != nullptr;
+	}
+};
+
+struct MyConnectionHandler final : MysqlAsyncConnectionHandler {
+	EventLoop &event_loop;
+
+	std::exception_ptr error;
+
+	bool connected = false;
+
+	explicit MyConnectionHandler(EventLoop &_event_loop) noexcept
+		:event_loop(_event_loop) {}
+
+	void OnMysqlConnect() noexcept override {
+		connected = true;
+		event_loop.Break();
+	}
+
+	void OnMysqlError(std::exception_ptr _error) noexcept override {
+		error = std::move(_error);
+		event_loop.Break();
+	}
+};
+
+/**
+ * Break the #EventLoop after a timeout.
+ */
+struct Timeout {
+	FineTimerEvent timer;
+
+	Timeout(EventLoop &event_loop, Event::Duration d) noexcept
+		:timer(event_loop, BIND_METHOD(event_loop, &EventLoop::Break))
+	{
+		timer.Schedule(d);
+	}
+};
+
+struct Completion {
+	EventLoop &event_loop;
+
+	std::exception_ptr error;
+	bool done = false;
+
+	explicit Completion(EventLoop &_event_loop) noexcept
+		:event_loop(_event_loop) {}
+
+	void Callback(std::exception_ptr _error) noexcept {
+		error = std::move(_error);
+		done = true;
+		event_loop.Break();
+	}
+};
+
+static Co::InvokeTask
+SelectOne(MysqlAsyncConnection &connection, std::string &value)
+{
+	const auto result = co_await MysqlCoQuery(connection, "SELECT 1");
+	if (const auto row = result.FetchRow())
+		value = row[0];
+}
+
+static Co::InvokeTask
+StockQuery(MysqlStock &stock, std::string_view sql)
+{
+	co_await MysqlCoStockQuery(stock, sql);
+}
+
+static void
+Connect(MysqlAsyncConnection &connection, const ServerConfig &config)
+{
+	connection.Connect(config.host, config.user, config.password,
+			   config.db, 3306, config.unix_socket);
+}
+
+} // anonymous namespace
+
+TEST(MysqlAsyncConnection, ConnectError)
+{
+	EventLoop event_loop;
+	MyConnectionHandler handler{event_loop};
+	MysqlAsyncConnection connection{event_loop, handler};
+
+	connection.Connect(nullptr, nullptr, nullptr, nullptr, 0,
+			   "/nonexistent/mysqld.sock");
+
+	if (!handler.error) {
+		const Timeout timeout{event_loop, 10s};
+		event_loop.Run();
+	}
+
+	EXPECT_FALSE(handler.connected);
+	EXPECT_TRUE(handler.error);
+	EXPECT_TRUE(connection.IsBroken());
+}
+
+TEST(MysqlAsyncConnection, Query)
+{
+	const ServerConfig config;
+	if (!config.IsDefined())
+		GTEST_SKIP();
+
+	EventLoop event_loop;
+	MyConnectionHandler handler{event_loop};
+	MysqlAsyncConnection connection{event_loop, handler};
+
+	Connect(connection, config);
+	event_loop.Run();
+	ASSERT_TRUE(handler.connected);
+	ASSERT_FALSE(handler.error);
+
+	std::string value;
+	Completion completion{event_loop};
+	auto task = SelectOne(connection, value);
+	task.Start(BIND_METHOD(completion, &Completion::Callback));
+
+	if (!completion.done)
+		event_loop.Run();
+
+	ASSERT_TRUE(completion.done);
+	EXPECT_FALSE(completion.error);
+	EXPECT_EQ(value, "1");
+	EXPECT_TRUE(connection.IsReady());
+}
+
+/**
+ * The server closes the connection while it is idle; this must be
+ * noticed without sending another query.
+ */
+TEST(MysqlAsyncConnection, IdleDisconnect)
+{
+	const ServerConfig config;
+	if (!config.IsDefined())
+		GTEST_SKIP();
+
+	EventLoop event_loop;
+	MyConnectionHandler handler{event_loop};
+	MysqlAsyncConnection connection{event_loop, handler};
+
+	Connect(connection, config);
+	event_loop.Run();
+	ASSERT_TRUE(handler.connected);
+
+	Completion completion{event_loop};
+	auto task = [](MysqlAsyncConnection &c) -> Co::InvokeTask {
+		co_await MysqlCoQuery(c, "SET SESSION wait_timeout=1");
+	}(connection);
+	task.Start(BIND_METHOD(completion, &Completion::Callback));
+
+	if (!completion.done)
+		event_loop.Run();
+
+	ASSERT_TRUE(completion.done);
+	ASSERT_FALSE(completion.error);
+	ASSERT_FALSE(handler.error);
+
+	const Timeout timeout{event_loop, 10s};
+	event_loop.Run();
+
+	EXPECT_TRUE(handler.error);
+	EXPECT_TRUE(connection.IsBroken());
+}
+
+/**
+ * An idle #MysqlStock item whose connection gets closed by the
+ * server is removed from the stock.
+ */
+TEST(MysqlStock, IdleDisconnect)
+{
+	const ServerConfig config;
+	if (!config.IsDefined())
+		GTEST_SKIP();
+
+	EventLoop event_loop;
+	MysqlStock stock{event_loop, config.host, config.user,
+			 config.password, config.db, 3306,
+			 config.unix_socket, 0, 4, 4};
+
+	Completion completion{event_loop};
+	auto task = StockQuery(stock, "SET SESSION wait_timeout=1");
+	task.Start(BIND_METHOD(completion, &Completion::Callback));
+
+	if (!completion.done)
+		event_loop.Run();
+
+	ASSERT_TRUE(completion.done);
+	ASSERT_FALSE(completion.error);
+
+	::Stock &s = stock;
+	EXPECT_FALSE(s.IsEmpty());
+
+	/* wait until the server has closed the idle connection */
+	for (unsigned i = 0; i < 100 && !s.IsEmpty(); ++i) {
+		const Timeout timeout{event_loop, 100ms};
+		event_loop.Run();
+	}
+
+	EXPECT_TRUE(s.IsEmpty());
+
+	stock.Shutdown();
+}
@@ -5,6 +5,7 @@
 #include "net/log/Send.hxx"
 #include "net/log/Serializer.hxx"
 #include "net/log/Parser.hxx"
+#include "net/log/IndexedDatagram.hxx"
 #include "net/log/Datagram.hxx"
 #include "net/SocketError.hxx"
 #include "net/SocketPair.hxx"
@@ -150,3 +151,60 @@ TEST(Log, Send)
 	d.duration = Net::Log::Duration(3);
 	EXPECT_TRUE(SendReceive(d) == d);
 }
+
+static bool
+ParseIndexedEquals(std::span<const std::byte> src,
+		   const Net::Log::Datagram &expected)
+{
+	const Net::Log::IndexedDatagram indexed{src};
+	return indexed.ToDatagram() == expected &&
+		indexed.ToDatagram() == Net::Log::ParseDatagram(src);
+}
+
+TEST(Log, IndexedDatagram)
+{
+	std::array<std::byte, 4096> buffer;
+	Net::Log::Datagram d;
+
+	size_t size = Net::Log::Serialize(buffer.data(), buffer.size(), d);
+	EXPECT_TRUE(ParseIndexedEquals(std::span{buffer}.first(size), d));
+
+	d.message = "foo";
+	d.remote_host = "a";
+	d.site = "c";
+	d.http_uri = "d";
+	d.http_method = HttpMethod::POST;
+	d.http_status = HttpStatus::NO_CONTENT;
+	d.timestamp = Net::Log::FromSystem(std::chrono::system_clock::now());
+	d.SetLength(0x123456789abcdef);
+	d.SetTraffic(1, 2);
+	d.SetDuration(Net::Log::Duration(3));
+	size = Net::Log::Serialize(buffer.data(), buffer.size(), d);
+
+	/* the type is guessed from the other attributes */
+	d.type = Net::Log::Type::HTTP_ERROR;
+	EXPECT_TRUE(ParseIndexedEquals(std::span{buffer}.first(size), d));
+
+	const Net::Log::IndexedDatagram indexed{std::span{buffer}.first(size)};
+	EXPECT_TRUE(indexed.Has(Net::Log::Attribute::SITE));
+	EXPECT_FALSE(indexed.Has(Net::Log::Attribute::HOST));
+	EXPECT_STREQ(indexed.GetString(Net::Log::Attribute::SITE), "c");
+	EXPECT_EQ(indexed.GetString(Net::Log::Attribute::HOST), nullptr);
+
+	/* attributes unknown to this parser are never present */
+	EXPECT_FALSE(indexed.Has(static_cast<Net::Log::Attribute>(200)));
+	EXPECT_EQ(indexed.GetString(static_cast<Net::Log::Attribute>(255)), nullptr);
+	EXPECT_EQ(indexed.GetHttpStatus(), HttpStatus::NO_CONTENT);
+	EXPECT_EQ(indexed.GetTraffic()->received, 1u);
+	EXPECT_EQ(indexed.GetTraffic()->sent, 2u);
+
+	/* a corrupt CRC is detected */
+	buffer[size - 1] ^= std::byte{1};
+	EXPECT_THROW(Net::Log::IndexedDatagram{std::span{buffer}.first(size)},
+		     Net::Log::ProtocolError);
+
+	/* a truncated datagram is detected */
+	buffer[size - 1] ^= std::byte{1};
+	EXPECT_THROW(Net::Log::IndexedDatagram{std::span{buffer}.first(size - 6)},
+		     Net::Log::ProtocolError);
+}
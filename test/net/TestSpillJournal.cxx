@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "net/log/SpillJournal.hxx"
+#include "net/log/Serializer.hxx"
+#include "net/log/Parser.hxx"
+#include "net/log/Datagram.hxx"
+#include "util/SpanCast.hxx"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <string>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+using std::string_view_literals::operator""sv;
+
+namespace {
+
+class TempPath {
+	char path[64] = "/tmp/TestSpillJournal.XXXXXX";
+
+public:
+	TempPath() {
+		const int fd = mkstemp(path);
+		if (fd < 0)
+			throw std::runtime_error("mkstemp() failed");
+		close(fd);
+	}
+
+	~TempPath() noexcept {
+		unlink(path);
+	}
+
+	const char *c_str() const noexcept {
+		return path;
+	}
+};
+
+} // anonymous namespace
+
+TEST(SpillJournal, Basic)
+{
+	const TempPath path;
+	Net::Log::SpillJournal journal{path.c_str(), 4096};
+
+	ASSERT_TRUE(journal.empty());
+	ASSERT_EQ(journal.GetUsed(), 0u);
+	ASSERT_TRUE(journal.Front().empty());
+
+	ASSERT_TRUE(journal.Push(AsBytes("hello"sv)));
+	ASSERT_TRUE(journal.Push(AsBytes("world!"sv)));
+	ASSERT_FALSE(journal.empty());
+
+	ASSERT_EQ(ToStringView(journal.Front()), "hello"sv);
+	journal.Pop();
+	ASSERT_EQ(ToStringView(journal.Front()), "world!"sv);
+	journal.Pop();
+	ASSERT_TRUE(journal.empty());
+}
+
+TEST(SpillJournal, Wrap)
+{
+	const TempPath path;
+	Net::Log::SpillJournal journal{path.c_str(), 4096};
+
+	const std::string record(1000, 'x');
+
+	/* fill the journal and drain it again many times so the
+	   ring buffer wraps around */
+	for (unsigned round = 0; round < 16; ++round) {
+		unsigned n = 0;
+		while (journal.Push(AsBytes(std::string_view{record})))
+			++n;
+
+		ASSERT_GE(n, 2u);
+
+		for (unsigned i = 0; i < n; ++i) {
+			ASSERT_EQ(ToStringView(journal.Front()), record);
+			journal.Pop();
+		}
+
+		ASSERT_TRUE(journal.empty());
+
+		/* shift the write position a bit */
+		ASSERT_TRUE(journal.Push(AsBytes("y"sv)));
+		journal.Pop();
+	}
+
+	/* records which are bigger than the journal are refused */
+	const std::string huge(8192, 'z');
+	ASSERT_FALSE(journal.Push(AsBytes(std::string_view{huge})));
+}
+
+TEST(SpillJournal, Persistent)
+{
+	const TempPath path;
+
+	std::array<std::byte, 1024> buffer;
+	Net::Log::Datagram d;
+	d.message = "foo";
+	const std::size_t size = Net::Log::Serialize(buffer.data(), buffer.size(), d);
+
+	{
+		Net::Log::SpillJournal journal{path.c_str(), 4096};
+		ASSERT_TRUE(journal.Push(std::span{buffer}.first(size)));
+	}
+
+	{
+		/* reopen: the datagram is still there */
+		Net::Log::SpillJournal journal{path.c_str(), 4096};
+		ASSERT_FALSE(journal.empty());
+
+		const auto d2 = Net::Log::ParseDatagram(journal.Front());
+		ASSERT_EQ(d2.message, "foo"sv);
+		journal.Pop();
+		ASSERT_TRUE(journal.empty());
+	}
+
+	{
+		Net::Log::SpillJournal journal{path.c_str(), 4096};
+		ASSERT_TRUE(journal.Push(std::span{buffer}.first(size)));
+	}
+
+	{
+		/* reopening with a different size resets the journal */
+		Net::Log::SpillJournal journal{path.c_str(), 8192};
+		ASSERT_TRUE(journal.empty());
+	}
+}
@@ -189,3 +189,45 @@ TEST(RegexTest, CaptureOptional2)
 		ASSERT_EQ(m[2].size(), 0U);
 	}
 }
+
+TEST(RegexTest, Test)
+{
+	const UniqueRegex r{"/fo(o)?/(.+)?", {.anchored=true, .capture=true}};
+	ASSERT_TRUE(r.Test("/foo/bar"));
+	ASSERT_TRUE(r.Test("/fo/"));
+	ASSERT_FALSE(r.Test("/f/"));
+	ASSERT_FALSE(r.Test("x/foo/"));
+}
+
+TEST(RegexTest, MatchReuse)
+{
+	const UniqueRegex r1{"/foo/(.*)", {.anchored=true, .capture=true}};
+	const UniqueRegex r2{"/fo(o)?/(.+)?", {.anchored=true, .capture=true}};
+
+	MatchData m;
+	ASSERT_FALSE(m);
+
+	static constexpr auto s1 = "/foo/bar";
+	ASSERT_TRUE(r1.Match(s1, m));
+	ASSERT_TRUE(m);
+	ASSERT_EQ(m.size(), 2U);
+	ASSERT_EQ(m[1].data(), s1 + 5);
+	ASSERT_EQ(m[1].size(), 3U);
+
+	ASSERT_FALSE(r1.Match("/bar/", m));
+	ASSERT_FALSE(m);
+
+	/* the second pattern has more captures; the buffer is
+	   enlarged */
+	static constexpr auto s2 = "/fo/x";
+	ASSERT_TRUE(r2.Match(s2, m));
+	ASSERT_EQ(m.size(), 3U);
+	ASSERT_EQ(m[1].data(), nullptr);
+	ASSERT_EQ(m[2].data(), s2 + 4);
+	ASSERT_EQ(m[2].size(), 1U);
+
+	/* and reused for the first one */
+	ASSERT_TRUE(r1.Match(s1, m));
+	ASSERT_EQ(m.size(), 2U);
+	ASSERT_EQ(m[1].data(), s1 + 5);
+}
@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "lib/pcre/RegexSet.hxx"
+
+#include <gtest/gtest.h>
+
+using std::string_view_literals::operator""sv;
+
+TEST(RegexSet, ExtractRequiredLiteral)
+{
+	using Pcre::ExtractRequiredLiteral;
+
+	EXPECT_EQ(ExtractRequiredLiteral("foo"), "foo"sv);
+	EXPECT_EQ(ExtractRequiredLiteral("^/foo/bar/"), "/foo/bar/"sv);
+	EXPECT_EQ(ExtractRequiredLiteral("/a/.*\\.php$"), ".php"sv);
+	EXPECT_EQ(ExtractRequiredLiteral("/abc?def/"), "def/"sv);
+	EXPECT_EQ(ExtractRequiredLiteral("/abcd*e"), "/abc"sv);
+	EXPECT_EQ(ExtractRequiredLiteral("/abcd+e"), "/abcd"sv);
+	EXPECT_EQ(ExtractRequiredLiteral("/ab{2}xyz"), "xyz"sv);
+	EXPECT_EQ(ExtractRequiredLiteral("[a-z]+\\.example\\.com"), ".example.com"sv);
+	EXPECT_EQ(ExtractRequiredLiteral("[]x|]+foo"), "foo"sv);
+	EXPECT_EQ(ExtractRequiredLiteral("(foo|bar)/baz"), "/baz"sv);
+	EXPECT_EQ(ExtractRequiredLiteral("(?:foo|bar)/baz"), "/baz"sv);
+	EXPECT_EQ(ExtractRequiredLiteral("/x\\d+/yy"), "/yy"sv);
+
+	/* unsupported or no literal */
+	EXPECT_EQ(ExtractRequiredLiteral("foo|bar"), ""sv);
+	EXPECT_EQ(ExtractRequiredLiteral("(?i)foo"), ""sv);
+	EXPECT_EQ(ExtractRequiredLiteral("\\Qfoo\\E"), ""sv);
+	EXPECT_EQ(ExtractRequiredLiteral("a\\x{41}"), ""sv);
+	EXPECT_EQ(ExtractRequiredLiteral(".*"), ""sv);
+	EXPECT_EQ(ExtractRequiredLiteral("a?"), ""sv);
+}
+
+TEST(RegexSet, Match)
+{
+	RegexSet set;
+	ASSERT_TRUE(set.empty());
+
+	ASSERT_EQ(set.Add("^/static/", {.anchored=true}), 0U);
+	ASSERT_EQ(set.Add("\\.(png|jpe?g)$"), 1U);
+	ASSERT_EQ(set.Add("/api/v[0-9]+/", {.caseless=true}), 2U);
+	ASSERT_EQ(set.Add("foo|bar"), 3U);
+	ASSERT_EQ(set.size(), 4U);
+
+	EXPECT_EQ(set.GetLiteral(0), "/static/"sv);
+	EXPECT_EQ(set.GetLiteral(1), "."sv);
+	EXPECT_EQ(set.GetLiteral(2), "/api/v"sv);
+	EXPECT_EQ(set.GetLiteral(3), ""sv);
+
+	EXPECT_EQ(set.MatchFirst("/static/logo.png"), 0U);
+	EXPECT_EQ(set.MatchFirst("/img/logo.gif"), RegexSet::npos);
+	EXPECT_EQ(set.MatchFirst("/img/logo.jpg"), 1U);
+	EXPECT_EQ(set.MatchFirst("/API/V2/users"), 2U);
+	EXPECT_EQ(set.MatchFirst("/x/bar"), 3U);
+	EXPECT_EQ(set.MatchFirst("/nothing"), RegexSet::npos);
+
+	EXPECT_EQ(set.MatchAll("/static/foo.png"),
+		  (std::vector<bool>{true, true, false, true}));
+	EXPECT_EQ(set.MatchAll("/Api/v1/foo"),
+		  (std::vector<bool>{false, false, true, true}));
+	EXPECT_EQ(set.MatchAll(""),
+		  (std::vector<bool>{false, false, false, false}));
+}
@@ -5,9 +5,14 @@
 #include "lib/sodium/Base64.hxx"
 #include "util/AllocatedArray.hxx"
 #include "util/AllocatedString.hxx"
+#include "util/Base64.hxx"
 
 #include <gtest/gtest.h>
 
+#include <random>
+#include <string>
+#include <vector>
+
 TEST(TestBase64, Empty)
 {
 	const auto b64 = FixedBase64<0, sodium_base64_VARIANT_ORIGINAL>("");
@@ -60,3 +65,73 @@ TEST(TestBase64, DecodeUrlSafeBase64)
 	EXPECT_EQ(std::string_view(leviathan),
 		  std::string_view((const char *)d.data(), d.size()));
 }
+
+/**
+ * Compare our own codec (util/Base64.hxx) with libsodium.
+ */
+TEST(TestBase64, CompareSodium)
+{
+	static constexpr std::pair<Base64Variant, int> variants[] = {
+		{Base64Variant::ORIGINAL, sodium_base64_VARIANT_ORIGINAL},
+		{Base64Variant::ORIGINAL_NO_PADDING, sodium_base64_VARIANT_ORIGINAL_NO_PADDING},
+		{Base64Variant::URL_SAFE, sodium_base64_VARIANT_URLSAFE},
+		{Base64Variant::URL_SAFE_NO_PADDING, sodium_base64_VARIANT_URLSAFE_NO_PADDING},
+	};
+
+	static constexpr char noise[] = "A/+-_=\0\x80 ";
+
+	std::mt19937 gen{42};
+	std::uniform_int_distribution<std::size_t> size_dist{0, 100};
+	std::uniform_int_distribution<unsigned> byte_dist{0, 0xff};
+	std::uniform_int_distribution<std::size_t> noise_dist{0, sizeof(noise) - 1};
+
+	for (unsigned i = 0; i < 20000; ++i) {
+		const auto [variant, sodium_variant] = variants[i % std::size(variants)];
+
+		std::vector<std::byte> src(size_dist(gen));
+		for (auto &b : src)
+			b = std::byte(byte_dist(gen));
+
+		/* encode */
+
+		const std::size_t encoded_size = CalcBase64EncodedSize(src.size(), variant);
+		ASSERT_EQ(encoded_size + 1, sodium_base64_ENCODED_LEN(src.size(), sodium_variant));
+
+		std::string expected(encoded_size + 1, '\0');
+		sodium_bin2base64(expected.data(), expected.size(),
+				  (const unsigned char *)src.data(), src.size(),
+				  sodium_variant);
+		expected.pop_back();
+
+		std::string encoded(encoded_size, '\0');
+		ASSERT_EQ(Base64Encode(encoded.data(), src, variant),
+			  encoded.data() + encoded.size());
+		ASSERT_EQ(encoded, expected);
+
+		/* decode a (possibly corrupted) string */
+
+		if (i % 2 == 1 && !encoded.empty())
+			encoded[gen() % encoded.size()] = noise[noise_dist(gen)];
+		if (i % 7 == 3)
+			encoded.push_back('=');
+
+		std::vector<std::byte> sodium_decoded(encoded.size());
+		std::size_t sodium_decoded_size;
+		const bool sodium_success =
+			sodium_base642bin((unsigned char *)sodium_decoded.data(),
+					  sodium_decoded.size(),
+					  encoded.data(), encoded.size(),
+					  nullptr, &sodium_decoded_size,
+					  nullptr, sodium_variant) == 0;
+
+		std::vector<std::byte> decoded(CalcBase64DecodedMaxSize(encoded.size()) + 1);
+		const std::byte *end = Base64Decode(decoded.data(), encoded, variant);
+
+		ASSERT_EQ(end != nullptr, sodium_success) << encoded;
+		if (end != nullptr) {
+			decoded.resize(end - decoded.data());
+			sodium_decoded.resize(sodium_decoded_size);
+			ASSERT_EQ(decoded, sodium_decoded) << encoded;
+		}
+	}
+}
@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "spawn/ExecBatch.hxx"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+using std::string_view_literals::operator""sv;
+
+namespace {
+
+/**
+ * Build a fake EXEC payload: the request id followed by a string.
+ */
+static std::vector<std::byte>
+MakeExecPayload(unsigned id, std::string_view s)
+{
+	std::vector<std::byte> result;
+	const auto id_bytes = std::as_bytes(std::span{&id, 1});
+	result.insert(result.end(), id_bytes.begin(), id_bytes.end());
+
+	const auto s_bytes = std::as_bytes(std::span{s});
+	result.insert(result.end(), s_bytes.begin(), s_bytes.end());
+	return result;
+}
+
+static std::vector<std::byte>
+MakeBatch()
+{
+	std::vector<std::byte> batch;
+	AppendExecBatchEntry(batch, MakeExecPayload(1, "foo"sv), 0);
+	AppendExecBatchEntry(batch, MakeExecPayload(2, "bar"sv), 2);
+	AppendExecBatchEntry(batch, MakeExecPayload(3, ""sv), 1);
+	return batch;
+}
+
+struct Entry {
+	unsigned id, n_fds;
+	std::size_t size;
+};
+
+} // anonymous namespace
+
+TEST(ExecBatch, Header)
+{
+	std::vector<std::byte> batch;
+	AppendExecBatchEntry(batch, MakeExecPayload(42, "xyz"sv), 3);
+
+	ASSERT_EQ(batch.size(), sizeof(SpawnExecBatchHeader) + sizeof(unsigned) + 3);
+
+	SpawnExecBatchHeader header;
+	memcpy(&header, batch.data(), sizeof(header));
+	EXPECT_EQ(header.size, sizeof(unsigned) + 3);
+	EXPECT_EQ(header.n_fds, 3U);
+
+	/* no uninitialized padding goes on the wire */
+	EXPECT_EQ(header.reserved, 0U);
+}
+
+TEST(ExecBatch, ForEach)
+{
+	const auto batch = MakeBatch();
+	const SpawnPayload payload{batch};
+
+	CheckExecBatch(payload, 3);
+
+	std::vector<Entry> entries;
+	ForEachExecBatchEntry(payload, [&entries](SpawnPayload p, unsigned n_fds){
+		const std::size_t size = p.GetSize();
+		unsigned id;
+		p.ReadUnsigned(id);
+		entries.push_back({id, n_fds, size});
+	}, [](unsigned){
+		FAIL();
+	});
+
+	ASSERT_EQ(entries.size(), 3U);
+	EXPECT_EQ(entries[0].id, 1U);
+	EXPECT_EQ(entries[0].n_fds, 0U);
+	EXPECT_EQ(entries[0].size, sizeof(unsigned) + 3);
+	EXPECT_EQ(entries[1].id, 2U);
+	EXPECT_EQ(entries[1].n_fds, 2U);
+	EXPECT_EQ(entries[2].id, 3U);
+	EXPECT_EQ(entries[2].n_fds, 1U);
+	EXPECT_EQ(entries[2].size, sizeof(unsigned));
+}
+
+TEST(ExecBatch, Empty)
+{
+	const SpawnPayload payload{std::span<const std::byte>{}};
+	CheckExecBatch(payload, 0);
+	EXPECT_THROW(CheckExecBatch(payload, 1), MalformedSpawnPayloadError);
+}
+
+TEST(ExecBatch, Malformed)
+{
+	const auto batch = MakeBatch();
+
+	/* wrong number of file descriptors */
+	EXPECT_THROW(CheckExecBatch(SpawnPayload{batch}, 2),
+		     MalformedSpawnPayloadError);
+	EXPECT_THROW(CheckExecBatch(SpawnPayload{batch}, 4),
+		     MalformedSpawnPayloadError);
+
+	/* truncated at every possible position */
+	for (std::size_t size = 1; size < batch.size(); ++size)
+		EXPECT_THROW(CheckExecBatch(SpawnPayload{std::span{batch}.first(size)}, 3),
+			     MalformedSpawnPayloadError);
+
+	/* an entry without a request id */
+	std::vector<std::byte> no_id;
+	AppendExecBatchEntry(no_id, std::as_bytes(std::span{"x", 1}), 0);
+	EXPECT_THROW(CheckExecBatch(SpawnPayload{no_id}, 0),
+		     MalformedSpawnPayloadError);
+}
+
+/**
+ * One malformed entry must not prevent the following ones from
+ * being handled.
+ */
+TEST(ExecBatch, MalformedEntry)
+{
+	const auto batch = MakeBatch();
+
+	std::vector<unsigned> handled, malformed;
+	ForEachExecBatchEntry(SpawnPayload{batch}, [&handled](SpawnPayload p, unsigned){
+		unsigned id;
+		p.ReadUnsigned(id);
+		if (id == 2)
+			throw MalformedSpawnPayloadError();
+
+		handled.push_back(id);
+	}, [&malformed](unsigned id){
+		malformed.push_back(id);
+	});
+
+	EXPECT_EQ(handled, (std::vector<unsigned>{1, 3}));
+	EXPECT_EQ(malformed, (std::vector<unsigned>{2}));
+}
+
+/**
+ * Other exceptions are not caught.
+ */
+TEST(ExecBatch, OtherError)
+{
+	const auto batch = MakeBatch();
+
+	unsigned n = 0;
+	EXPECT_THROW(ForEachExecBatchEntry(SpawnPayload{batch}, [&n](SpawnPayload, unsigned){
+		++n;
+		throw std::runtime_error{"error"};
+	}, [](unsigned){
+		FAIL();
+	}), std::runtime_error);
+
+	EXPECT_EQ(n, 1U);
+}
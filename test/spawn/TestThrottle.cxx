@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "spawn/Throttle.hxx"
+
+#include <gtest/gtest.h>
+
+using std::chrono_literals::operator""ms;
+
+/**
+ * Feed one window's worth of completions with the given latency.
+ */
+static void
+CompleteWindow(SpawnThrottle &throttle, Event::Duration latency,
+	       bool saturated=true) noexcept
+{
+	const unsigned n = throttle.GetWindow();
+	for (unsigned i = 0; i < n; ++i) {
+		if (saturated)
+			throttle.SetSaturated();
+		throttle.OnComplete(latency);
+	}
+}
+
+TEST(SpawnThrottle, Initial)
+{
+	SpawnThrottle throttle;
+	EXPECT_EQ(throttle.GetWindow(), 8U);
+}
+
+TEST(SpawnThrottle, Grow)
+{
+	SpawnThrottle throttle;
+
+	unsigned previous = throttle.GetWindow();
+	for (unsigned i = 0; i < 8; ++i) {
+		CompleteWindow(throttle, 2ms);
+		EXPECT_GT(throttle.GetWindow(), previous);
+		previous = throttle.GetWindow();
+	}
+
+	/* bounded */
+	for (unsigned i = 0; i < 64; ++i)
+		CompleteWindow(throttle, 2ms);
+	EXPECT_EQ(throttle.GetWindow(), 256U);
+}
+
+TEST(SpawnThrottle, NoGrowWithoutSaturation)
+{
+	SpawnThrottle throttle;
+
+	for (unsigned i = 0; i < 8; ++i)
+		CompleteWindow(throttle, 2ms, false);
+
+	EXPECT_EQ(throttle.GetWindow(), 8U);
+}
+
+TEST(SpawnThrottle, Shrink)
+{
+	SpawnThrottle throttle;
+
+	for (unsigned i = 0; i < 8; ++i)
+		CompleteWindow(throttle, 2ms);
+
+	const unsigned grown = throttle.GetWindow();
+	ASSERT_GT(grown, 8U);
+
+	/* the spawner becomes much slower */
+	for (unsigned i = 0; i < 8; ++i)
+		CompleteWindow(throttle, 50ms);
+
+	EXPECT_LT(throttle.GetWindow(), grown);
+
+	/* bounded */
+	for (unsigned i = 0; i < 64; ++i)
+		CompleteWindow(throttle, 50ms);
+	EXPECT_EQ(throttle.GetWindow(), 4U);
+}
+
+/**
+ * Overload which lasts longer than one baseline period must not
+ * become the new baseline.
+ */
+TEST(SpawnThrottle, SustainedOverload)
+{
+	SpawnThrottle throttle;
+
+	for (unsigned i = 0; i < 8; ++i)
+		CompleteWindow(throttle, 2ms);
+
+	for (unsigned i = 0; i < 6000; ++i) {
+		throttle.SetSaturated();
+		throttle.OnComplete(50ms);
+	}
+
+	EXPECT_EQ(throttle.GetWindow(), 4U);
+
+	/* after two full periods, the old minimum has been
+	   forgotten and the higher latency is the new normal */
+	for (unsigned i = 0; i < 4000; ++i) {
+		throttle.SetSaturated();
+		throttle.OnComplete(50ms);
+	}
+
+	EXPECT_GT(throttle.GetWindow(), 4U);
+}
@@ -581,3 +581,142 @@ TEST(Stock, ContinueOnCancel)
 	EXPECT_EQ(num_release, 0);
 	EXPECT_EQ(num_destroy, 0);
 }
+
+TEST(Stock, Fairness)
+{
+	Instance instance;
+
+	struct FairStockClass final : StockClass {
+		void Create(CreateStockItem c,
+			    [[maybe_unused]] StockRequest request,
+			    StockGetHandler &handler,
+			    CancellablePointer &) override {
+			(new MyStockItem(c))->InvokeCreateSuccess(handler);
+		}
+
+		/* the request pointer is the fairness hash */
+		uint_fast64_t GetFairnessHash(const void *request) const noexcept override {
+			return reinterpret_cast<uintptr_t>(request);
+		}
+	} cls;
+
+	const auto MakeRequest = [](uintptr_t fairness_hash){
+		return StockRequest{reinterpret_cast<void *>(fairness_hash),
+				    [](void *) noexcept {}};
+	};
+
+	Stock stock(instance.event_loop, cls, "test", 1, 8,
+		    Event::Duration::zero());
+
+	num_borrow = num_release = num_destroy = 0;
+
+	MyStockGetHandler first;
+	CancellablePointer first_cancel_ptr;
+	stock.Get(MakeRequest(1), first, first_cancel_ptr);
+	ASSERT_TRUE(first.got_item);
+	StockItem *item = first.last_item;
+
+	/* three requests from "1", one from "2", two from "3" */
+	static constexpr uintptr_t hashes[] = {1, 1, 1, 2, 3, 3};
+	MyStockGetHandler handlers[std::size(hashes)];
+	CancellablePointer cancel_ptrs[std::size(hashes)];
+	for (std::size_t i = 0; i < std::size(hashes); ++i) {
+		stock.Get(MakeRequest(hashes[i]), handlers[i], cancel_ptrs[i]);
+		ASSERT_FALSE(handlers[i].got_item);
+	}
+
+	StockStats stats{};
+	stock.AddStats(stats);
+	EXPECT_EQ(stats.busy, 1u);
+	EXPECT_EQ(stats.waiting, std::size(hashes));
+	EXPECT_EQ(stats.create_duration.GetCount(), 1u);
+
+	/* cancel the second request from "3" */
+	cancel_ptrs[5].Cancel();
+
+	/* each returned item is passed to the next fairness hash in
+	   round-robin order */
+	static constexpr std::size_t expected_order[] = {0, 3, 4, 1, 2};
+	for (const std::size_t i : expected_order) {
+		stock.Put(*item, PutAction::REUSE);
+		instance.RunSome();
+
+		ASSERT_TRUE(handlers[i].got_item);
+		ASSERT_EQ(handlers[i].last_item, item);
+	}
+
+	stats = {};
+	stock.AddStats(stats);
+	EXPECT_EQ(stats.busy, 1u);
+	EXPECT_EQ(stats.idle, 0u);
+	EXPECT_EQ(stats.waiting, 0u);
+	EXPECT_EQ(stats.wait_duration.GetCount(), std::size(expected_order));
+	EXPECT_EQ(stats.canceled_waits, 1u);
+	EXPECT_EQ(stats.create_errors, 0u);
+	EXPECT_FALSE(handlers[5].got_item);
+
+	stock.Put(*item, PutAction::DESTROY);
+	EXPECT_EQ(num_destroy, 1);
+}
+
+TEST(Stock, Prewarm)
+{
+	Instance instance;
+
+	struct PrewarmStockClass final : StockClass {
+		EventLoop &event_loop;
+		unsigned n_create = 0, n_break = 0;
+
+		explicit PrewarmStockClass(EventLoop &_event_loop) noexcept
+			:event_loop(_event_loop) {}
+
+		void Create(CreateStockItem c,
+			    [[maybe_unused]] StockRequest request,
+			    StockGetHandler &handler,
+			    CancellablePointer &) override {
+			(new MyStockItem(c))->InvokeCreateSuccess(handler);
+
+			if (++n_create == n_break)
+				event_loop.Break();
+		}
+	} cls{instance.event_loop};
+
+	Stock stock(instance.event_loop, cls, "test", 4, 8,
+		    Event::Duration::zero());
+
+	num_borrow = num_release = num_destroy = 0;
+
+	/* two idle items are created in the background */
+	cls.n_break = 2;
+	stock.SetPrewarm({.min_idle = 2});
+	instance.event_loop.Run();
+
+	StockStats stats{};
+	stock.AddStats(stats);
+	EXPECT_EQ(cls.n_create, 2u);
+	EXPECT_EQ(stats.idle, 2u);
+	EXPECT_EQ(stats.busy, 0u);
+
+	/* the first request is served without creating a new item */
+	MyStockGetHandler handler;
+	CancellablePointer cancel_ptr;
+	stock.Get(nullptr, handler, cancel_ptr);
+	ASSERT_TRUE(handler.got_item);
+	ASSERT_NE(handler.last_item, nullptr);
+	EXPECT_EQ(cls.n_create, 2u);
+	EXPECT_EQ(num_borrow, 1);
+
+	/* the missing idle item is replaced */
+	cls.n_break = 3;
+	instance.event_loop.Run();
+
+	stats = {};
+	stock.AddStats(stats);
+	EXPECT_EQ(cls.n_create, 3u);
+	EXPECT_EQ(stats.idle, 2u);
+	EXPECT_EQ(stats.busy, 1u);
+
+	stock.Put(*handler.last_item, PutAction::DESTROY);
+	stock.Shutdown();
+	EXPECT_EQ(num_destroy, 3);
+}
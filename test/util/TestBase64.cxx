@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "util/Base64.hxx"
+#include "util/SpanCast.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using std::string_view_literals::operator""sv;
+
+static std::string
+Encode(std::string_view src, Base64Variant variant)
+{
+	std::string result(CalcBase64EncodedSize(src.size(), variant), '\0');
+	char *end = Base64Encode(result.data(), AsBytes(src), variant);
+	EXPECT_EQ(end, result.data() + result.size());
+	return result;
+}
+
+static std::string
+Decode(std::string_view src, Base64Variant variant)
+{
+	std::vector<std::byte> buffer(CalcBase64DecodedMaxSize(src.size()) + 1);
+	const std::byte *end = Base64Decode(buffer.data(), src, variant);
+	if (end == nullptr)
+		return "ERROR";
+
+	return std::string{ToStringView(std::span{buffer.data(), end})};
+}
+
+static constexpr std::string_view leviathan = "Man is distinguished, not only by his reason, but by this singular passion from other animals, which is a lust of the mind, that by a perseverance of delight in the continued and indefatigable generation of knowledge, exceeds the short vehemence of any carnal pleasure.";
+static constexpr std::string_view leviathan_b64 = "TWFuIGlzIGRpc3Rpbmd1aXNoZWQsIG5vdCBvbmx5IGJ5IGhpcyByZWFzb24sIGJ1dCBieSB0aGlzIHNpbmd1bGFyIHBhc3Npb24gZnJvbSBvdGhlciBhbmltYWxzLCB3aGljaCBpcyBhIGx1c3Qgb2YgdGhlIG1pbmQsIHRoYXQgYnkgYSBwZXJzZXZlcmFuY2Ugb2YgZGVsaWdodCBpbiB0aGUgY29udGludWVkIGFuZCBpbmRlZmF0aWdhYmxlIGdlbmVyYXRpb24gb2Yga25vd2xlZGdlLCBleGNlZWRzIHRoZSBzaG9ydCB2ZWhlbWVuY2Ugb2YgYW55IGNhcm5hbCBwbGVhc3VyZS4=";
+
+TEST(Base64, Encode)
+{
+	EXPECT_EQ(Encode(""sv, Base64Variant::ORIGINAL), "");
+	EXPECT_EQ(Encode("f"sv, Base64Variant::ORIGINAL), "Zg==");
+	EXPECT_EQ(Encode("fo"sv, Base64Variant::ORIGINAL), "Zm8=");
+	EXPECT_EQ(Encode("foo"sv, Base64Variant::ORIGINAL), "Zm9v");
+	EXPECT_EQ(Encode("foob"sv, Base64Variant::ORIGINAL), "Zm9vYg==");
+	EXPECT_EQ(Encode("f"sv, Base64Variant::ORIGINAL_NO_PADDING), "Zg");
+	EXPECT_EQ(Encode("fo"sv, Base64Variant::URL_SAFE_NO_PADDING), "Zm8");
+	EXPECT_EQ(Encode(leviathan, Base64Variant::ORIGINAL), leviathan_b64);
+
+	/* characters 62 and 63, inside and outside of a SIMD block */
+	EXPECT_EQ(Encode("\xfb\xff\xbf\xfb\xff\xbf\xfb\xff\xbf\xfb\xff\xbf\xfb\xff\xbf"sv,
+			 Base64Variant::ORIGINAL),
+		  "+/+/+/+/+/+/+/+/+/+/");
+	EXPECT_EQ(Encode("\xfb\xff\xbf\xfb\xff\xbf\xfb\xff\xbf\xfb\xff\xbf\xfb\xff\xbf"sv,
+			 Base64Variant::URL_SAFE),
+		  "-_-_-_-_-_-_-_-_-_-_");
+}
+
+TEST(Base64, Decode)
+{
+	EXPECT_EQ(Decode(""sv, Base64Variant::ORIGINAL), "");
+	EXPECT_EQ(Decode("Zg=="sv, Base64Variant::ORIGINAL), "f");
+	EXPECT_EQ(Decode("Zm8="sv, Base64Variant::ORIGINAL), "fo");
+	EXPECT_EQ(Decode("Zm9v"sv, Base64Variant::ORIGINAL), "foo");
+	EXPECT_EQ(Decode("Zg"sv, Base64Variant::ORIGINAL_NO_PADDING), "f");
+	EXPECT_EQ(Decode(leviathan_b64, Base64Variant::ORIGINAL), leviathan);
+	EXPECT_EQ(Decode("-_-_-_-_-_-_-_-_-_-_"sv, Base64Variant::URL_SAFE_NO_PADDING),
+		  "\xfb\xff\xbf\xfb\xff\xbf\xfb\xff\xbf\xfb\xff\xbf\xfb\xff\xbf"sv);
+
+	/* wrong padding */
+	EXPECT_EQ(Decode("Zg"sv, Base64Variant::ORIGINAL), "ERROR");
+	EXPECT_EQ(Decode("Zg="sv, Base64Variant::ORIGINAL), "ERROR");
+	EXPECT_EQ(Decode("Zm9v===="sv, Base64Variant::ORIGINAL), "ERROR");
+	EXPECT_EQ(Decode("Zg=="sv, Base64Variant::ORIGINAL_NO_PADDING), "ERROR");
+
+	/* non-zero trailing bits */
+	EXPECT_EQ(Decode("Zh=="sv, Base64Variant::ORIGINAL), "ERROR");
+	EXPECT_EQ(Decode("Zm9="sv, Base64Variant::ORIGINAL), "ERROR");
+
+	/* truncated */
+	EXPECT_EQ(Decode("Z"sv, Base64Variant::ORIGINAL_NO_PADDING), "ERROR");
+
+	/* wrong alphabet, inside and outside of a SIMD block */
+	EXPECT_EQ(Decode("-_-_-_-_-_-_-_-_-_-_"sv, Base64Variant::ORIGINAL_NO_PADDING), "ERROR");
+	EXPECT_EQ(Decode("+/+/"sv, Base64Variant::URL_SAFE_NO_PADDING), "ERROR");
+	EXPECT_EQ(Decode("Zm9vZm9vZm9vZm9v\x80m9vZm9v"sv, Base64Variant::ORIGINAL), "ERROR");
+}
+
+TEST(Base64, RoundTrip)
+{
+	std::string src;
+	for (unsigned i = 0; i < 256; ++i) {
+		for (const auto variant : {Base64Variant::ORIGINAL,
+					   Base64Variant::ORIGINAL_NO_PADDING,
+					   Base64Variant::URL_SAFE,
+					   Base64Variant::URL_SAFE_NO_PADDING})
+			ASSERT_EQ(Decode(Encode(src, variant), variant), src);
+
+		src.push_back(char(i * 37));
+	}
+}
@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "util/HexFormat.hxx"
+#include "util/HexParse.hxx"
+#include "util/SpanCast.hxx"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using std::string_view_literals::operator""sv;
+
+/* compile-time evaluation must still work */
+static constexpr std::byte constexpr_input[] = {std::byte{0xde}, std::byte{0xad}};
+static_assert(ToStringView(HexFormat(std::span{constexpr_input})) == "dead"sv);
+
+static std::string
+ScalarHexFormat(std::span<const std::byte> src)
+{
+	std::string result;
+	for (const auto i : src) {
+		char buffer[2];
+		HexFormatUint8Fixed(buffer, (uint8_t)i);
+		result.append(buffer, 2);
+	}
+
+	return result;
+}
+
+TEST(Hex, Format)
+{
+	std::vector<std::byte> src;
+	for (unsigned i = 0; i < 100; ++i) {
+		std::string result(src.size() * 2, '\0');
+		ASSERT_EQ(HexFormat(result.data(), src), result.data() + result.size());
+		ASSERT_EQ(result, ScalarHexFormat(src));
+
+		src.push_back(std::byte(i * 37));
+	}
+}
+
+TEST(Hex, Parse)
+{
+	std::vector<std::byte> src;
+	for (unsigned i = 0; i < 100; ++i) {
+		const auto hex = ScalarHexFormat(src);
+
+		std::vector<std::byte> result(src.size());
+		ASSERT_EQ(ParseLowerHexFixed(hex.c_str(), std::span{result}),
+			  hex.c_str() + hex.size());
+		ASSERT_EQ(result, src);
+
+		/* invalid characters anywhere must be detected */
+		for (const char ch : {'g', 'A', '/', ':', '`', '\x80'}) {
+			if (hex.empty())
+				break;
+
+			auto invalid = hex;
+			invalid[(i * 7) % invalid.size()] = ch;
+			ASSERT_EQ(ParseLowerHexFixed(invalid.c_str(), std::span{result}),
+				  nullptr);
+		}
+
+		src.push_back(std::byte(i * 37));
+	}
+
+	/* a short null-terminated string must not be read beyond
+	   its end (the allocation has the exact size to let
+	   AddressSanitizer detect that) */
+	const std::vector<char> short_hex{'0', '1', '\0'};
+	std::array<std::byte, 32> large;
+	EXPECT_EQ(ParseLowerHexFixed(short_hex.data(), std::span{large}), nullptr);
+
+	/* with a length */
+	const auto hex32 = ScalarHexFormat(large);
+	EXPECT_TRUE(ParseLowerHexFixed(std::string_view{hex32}, std::span{large}));
+	EXPECT_FALSE(ParseLowerHexFixed(std::string_view{hex32}.substr(1), std::span{large}));
+
+	std::array<std::byte, 20> array;
+	EXPECT_TRUE(ParseLowerHexFixed("000102030405060708090a0b0c0d0e0f10111213"sv,
+				       array));
+	EXPECT_EQ(array[19], std::byte{0x13});
+}
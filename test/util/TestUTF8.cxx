@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: BSD-2-Clause
+// Copyright CM4all GmbH
+// author: Max Kellermann <mk@cm4all.com>
+
+#include "util/UTF8.hxx"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+
+using std::string_view_literals::operator""sv;
+
+TEST(UTF8, Validate)
+{
+	EXPECT_TRUE(ValidateUTF8(""sv));
+	EXPECT_TRUE(ValidateUTF8("hello"sv));
+	EXPECT_TRUE(ValidateUTF8("h\0llo"sv));
+	EXPECT_TRUE(ValidateUTF8("gr\xc3\xbc\xc3\x9f" "e"sv));
+	EXPECT_TRUE(ValidateUTF8("\xe2\x82\xac"sv));
+	EXPECT_TRUE(ValidateUTF8("\xf0\x9f\x98\x80"sv));
+
+	/* sequences crossing the 16 byte block boundary */
+	EXPECT_TRUE(ValidateUTF8("0123456789abcde\xf0\x9f\x98\x80"sv));
+	EXPECT_TRUE(ValidateUTF8("0123456789abcdef\xf0\x9f\x98\x80"sv));
+	EXPECT_FALSE(ValidateUTF8("0123456789abcde\xf0\x9f\x98"sv));
+	EXPECT_FALSE(ValidateUTF8("0123456789abcdef\xf0\x9f\x98" "0123456789abcdef"sv));
+
+	EXPECT_FALSE(ValidateUTF8("\x80"sv));
+	EXPECT_FALSE(ValidateUTF8("\xc3"sv));
+	EXPECT_FALSE(ValidateUTF8("\xc3\xbc\xbc"sv));
+	EXPECT_FALSE(ValidateUTF8("\xe2\x82" "a"sv));
+	EXPECT_FALSE(ValidateUTF8("\xff"sv));
+	EXPECT_FALSE(ValidateUTF8("\xfe"sv));
+}
+
+TEST(UTF8, Length)
+{
+	EXPECT_EQ(LengthUTF8(""sv), 0U);
+	EXPECT_EQ(LengthUTF8("hello"sv), 5U);
+	EXPECT_EQ(LengthUTF8("gr\xc3\xbc\xc3\x9f" "e"sv), 5U);
+	EXPECT_EQ(LengthUTF8("0123456789abcde\xf0\x9f\x98\x80" "0123456789"sv), 26U);
+}
+
+/**
+ * Compare the string_view overloads with the (scalar) null-terminated
+ * ones.
+ */
+TEST(UTF8, Random)
+{
+	static constexpr unsigned char alphabet[] = {
+		'a', 'z', 0x7f, 0x80, 0xbf, 0xc3, 0xdf, 0xe2, 0xef,
+		0xf0, 0xf7, 0xf8, 0xfb, 0xfc, 0xfd, 0xfe, 0xff,
+	};
+
+	std::mt19937 gen{42};
+	std::uniform_int_distribution<std::size_t> length_dist{0, 80};
+	std::uniform_int_distribution<std::size_t> char_dist{0, std::size(alphabet) - 1};
+	std::uniform_int_distribution<unsigned> ascii_dist{0, 3};
+
+	for (unsigned i = 0; i < 100000; ++i) {
+		std::string s;
+		const std::size_t length = length_dist(gen);
+		for (std::size_t j = 0; j < length; ++j) {
+			/* mostly continuation bytes to make valid
+			   sequences likely */
+			const unsigned k = ascii_dist(gen);
+			s.push_back(k == 0 ? char(alphabet[char_dist(gen)])
+				    : k == 1 ? 'x' : char(0x80 | j));
+		}
+
+		ASSERT_EQ(ValidateUTF8(std::string_view{s}), ValidateUTF8(s.c_str())) << s;
+		ASSERT_EQ(LengthUTF8(std::string_view{s}), LengthUTF8(s.c_str())) << s;
+	}
+}